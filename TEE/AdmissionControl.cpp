@@ -0,0 +1,153 @@
+#include "AdmissionControl.hpp"
+#include "Metrics.hpp"
+#include <algorithm>
+#include <cmath>
+
+static const std::string kOverflowAddress = "*";
+
+static MetricCounter &rateLimited = MetricsRegistry::instance().counter(
+    "tee_admission_rate_limited_total", "Messages refused by a per-connection or per-address token bucket.");
+static MetricCounter &verificationCapped = MetricsRegistry::instance().counter(
+    "tee_admission_verification_cap_total", "Offers refused because the in-flight verification cap was reached.");
+
+/*************************
+ * TokenBucket
+ ************************/
+TokenBucket::TokenBucket(double rate, double burst)
+    : rate_(rate), burst_(std::max(burst, 1.0)), tokens_(burst_), last_(std::chrono::steady_clock::now())
+{
+}
+
+bool TokenBucket::tryTake(double cost, std::chrono::steady_clock::time_point now, std::int64_t &retryAfterMs)
+{
+    if (rate_ <= 0)
+        return true;
+
+    double elapsed = std::chrono::duration<double>(now - last_).count();
+    if (elapsed > 0)
+    {
+        tokens_ = std::min(burst_, tokens_ + elapsed * rate_);
+        last_ = now;
+    }
+
+    double needed = std::min(cost, burst_);
+    if (tokens_ >= needed)
+    {
+        tokens_ -= cost;
+        return true;
+    }
+    retryAfterMs = static_cast<std::int64_t>(std::ceil((needed - tokens_) / rate_ * 1000.0));
+    return false;
+}
+
+void TokenBucket::refund(double cost)
+{
+    if (rate_ > 0)
+        tokens_ = std::min(burst_, tokens_ + cost);
+}
+
+/*************************
+ * AdmissionController
+ ************************/
+AdmissionController::AdmissionController(const AdmissionLimits &limits)
+    : limits_(limits), lastPrune_(std::chrono::steady_clock::now())
+{
+}
+
+ConnectionBuckets AdmissionController::connectionBuckets() const
+{
+    return ConnectionBuckets{
+        TokenBucket(limits_.ingestRate, limits_.ingestRate * limits_.burstSeconds),
+        TokenBucket(limits_.queryRate, limits_.queryRate * limits_.burstSeconds)};
+}
+
+AdmissionDecision AdmissionController::admit(ConnectionBuckets &connection, const std::string &address,
+                                             AdmissionClass admissionClass, std::size_t cost)
+{
+    AdmissionDecision decision;
+    auto now = std::chrono::steady_clock::now();
+    bool ingest = admissionClass == AdmissionClass::Ingest;
+    double tokens = static_cast<double>(std::max<std::size_t>(cost, 1));
+
+    TokenBucket &perConnection = ingest ? connection.ingest : connection.query;
+    if (!perConnection.tryTake(tokens, now, decision.retryAfterMs))
+    {
+        rateLimited.add();
+        decision.admitted = false;
+        decision.reason = "Connection rate limit exceeded.";
+        return decision;
+    }
+
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto sincePrune = now - lastPrune_;
+    if (sincePrune > kIdleAddressTimeout ||
+        (addresses_.size() >= kMaxTrackedAddresses && sincePrune > std::chrono::seconds(1)))
+        pruneLocked(now);
+
+    auto it = addresses_.find(address);
+    if (it == addresses_.end())
+    {
+        // With the table full of active addresses, new ones share a bucket.
+        const std::string &key = addresses_.size() < kMaxTrackedAddresses ? address : kOverflowAddress;
+        it = addresses_.find(key);
+        if (it == addresses_.end())
+        {
+            AddressBuckets buckets{
+                TokenBucket(limits_.addressIngestRate, limits_.addressIngestRate * limits_.burstSeconds),
+                TokenBucket(limits_.addressQueryRate, limits_.addressQueryRate * limits_.burstSeconds)};
+            it = addresses_.emplace(key, buckets).first;
+        }
+    }
+    TokenBucket &perAddress = ingest ? it->second.ingest : it->second.query;
+    if (!perAddress.tryTake(tokens, now, decision.retryAfterMs))
+    {
+        perConnection.refund(tokens);
+        rateLimited.add();
+        decision.admitted = false;
+        decision.reason = "Address rate limit exceeded.";
+    }
+    return decision;
+}
+
+void AdmissionController::pruneLocked(std::chrono::steady_clock::time_point now)
+{
+    for (auto it = addresses_.begin(); it != addresses_.end();)
+    {
+        auto lastUsed = std::max(it->second.ingest.lastUsed(), it->second.query.lastUsed());
+        if (now - lastUsed > kIdleAddressTimeout)
+            it = addresses_.erase(it);
+        else
+            ++it;
+    }
+    lastPrune_ = now;
+}
+
+AdmissionDecision AdmissionController::acquireVerifications(std::size_t count)
+{
+    AdmissionDecision decision;
+    if (limits_.maxInFlightVerifications == 0)
+    {
+        inFlight_.fetch_add(count, std::memory_order_relaxed);
+        return decision;
+    }
+
+    // A batch larger than the cap is admitted only when nothing else is in flight.
+    std::size_t current = inFlight_.load(std::memory_order_relaxed);
+    do
+    {
+        if (current != 0 && current + count > limits_.maxInFlightVerifications)
+        {
+            verificationCapped.add(count);
+            decision.admitted = false;
+            decision.retryAfterMs = kVerificationRetryAfterMs;
+            decision.reason = "Too many offers awaiting verification.";
+            return decision;
+        }
+    } while (!inFlight_.compare_exchange_weak(current, current + count, std::memory_order_relaxed));
+    return decision;
+}
+
+void AdmissionController::releaseVerifications(std::size_t count)
+{
+    inFlight_.fetch_sub(count, std::memory_order_relaxed);
+}
@@ -0,0 +1,105 @@
+#ifndef ADMISSIONCONTROL_HPP
+#define ADMISSIONCONTROL_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+enum class AdmissionClass
+{
+    Ingest, // submitOffer / submitOffers, cost = number of offers
+    Query   // everything else, cost = 1
+};
+
+// Rates are per second; a rate of 0 disables that limit. Buckets hold
+// burstSeconds worth of tokens.
+struct AdmissionLimits
+{
+    double ingestRate = 20;
+    double queryRate = 200;
+    double addressIngestRate = 50; // shared by all connections from one address
+    double addressQueryRate = 500;
+    double burstSeconds = 2;
+    std::size_t maxInFlightVerifications = 256; // 0 = unlimited
+};
+
+struct AdmissionDecision
+{
+    bool admitted = true;
+    std::int64_t retryAfterMs = 0;
+    const char *reason = "";
+};
+
+class TokenBucket
+{
+private:
+    double rate_ = 0;
+    double burst_ = 0;
+    double tokens_ = 0;
+    std::chrono::steady_clock::time_point last_;
+
+public:
+    TokenBucket() = default;
+    TokenBucket(double rate, double burst);
+
+    // Admits when min(cost, burst) tokens are available and charges the
+    // full cost, so a batch larger than the burst is admitted into debt
+    // rather than never. Otherwise reports when it would be admitted.
+    bool tryTake(double cost, std::chrono::steady_clock::time_point now, std::int64_t &retryAfterMs);
+    void refund(double cost);
+    std::chrono::steady_clock::time_point lastUsed() const { return last_; }
+};
+
+// Per-connection buckets; owned by the session and only touched on its executor.
+struct ConnectionBuckets
+{
+    TokenBucket ingest;
+    TokenBucket query;
+};
+
+// Token-bucket rate limits per connection and per remote address, plus a
+// global cap on offers admitted for verification but not yet finished.
+// The cap bounds the backlog ahead of any newly admitted offer, which is
+// what keeps well-behaved clients' latency bounded while others are refused.
+class AdmissionController
+{
+private:
+    struct AddressBuckets
+    {
+        TokenBucket ingest;
+        TokenBucket query;
+    };
+
+    static constexpr std::size_t kMaxTrackedAddresses = 100000;
+    static constexpr auto kIdleAddressTimeout = std::chrono::seconds(60);
+
+    AdmissionLimits limits_;
+    std::mutex mtx_;
+    std::unordered_map<std::string, AddressBuckets> addresses_;
+    std::chrono::steady_clock::time_point lastPrune_;
+    std::atomic<std::size_t> inFlight_{0};
+
+    void pruneLocked(std::chrono::steady_clock::time_point now);
+
+public:
+    // Suggested back-off when the verification cap is reached.
+    static constexpr std::int64_t kVerificationRetryAfterMs = 50;
+
+    explicit AdmissionController(const AdmissionLimits &limits);
+
+    ConnectionBuckets connectionBuckets() const;
+
+    AdmissionDecision admit(ConnectionBuckets &connection, const std::string &address,
+                            AdmissionClass admissionClass, std::size_t cost);
+
+    // Reserve slots under the global verification cap; every successful
+    // acquire must be matched by a release once the offers are finished.
+    AdmissionDecision acquireVerifications(std::size_t count);
+    void releaseVerifications(std::size_t count);
+    std::size_t inFlightVerifications() const { return inFlight_.load(std::memory_order_relaxed); }
+};
+
+#endif // ADMISSIONCONTROL_HPP
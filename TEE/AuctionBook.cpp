@@ -0,0 +1,362 @@
+#include "AuctionBook.hpp"
+#include "Logger.hpp"
+#include "Metrics.hpp"
+#include <algorithm>
+#include <future>
+#include <unordered_set>
+
+static LatencyHistogram &clearLatency = MetricsRegistry::instance().histogram(
+    "tee_auction_clear_seconds", "Time to clear one auction: select the winners and set the price.");
+static LatencyHistogram &batchClearLatency = MetricsRegistry::instance().histogram(
+    "tee_auction_clear_batch_seconds", "Time to clear one batch of auctions, terms lookup included.");
+static MetricCounter &bidsAccepted = MetricsRegistry::instance().counter(
+    "tee_auction_bids_total", "Sealed bids accepted.");
+static MetricCounter &bidsRefused = MetricsRegistry::instance().counter(
+    "tee_auction_bids_refused_total", "Bids refused: below the reserve, auction closed or offer unknown.");
+static MetricCounter &auctionsCleared = MetricsRegistry::instance().counter(
+    "tee_auctions_cleared_total", "Auctions cleared.");
+
+// Batches at least this large are cleared on several threads.
+static constexpr std::size_t kParallelClearing = 256;
+
+static std::int64_t nowMicros()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+const char *clearingRuleName(ClearingRule rule)
+{
+    return rule == ClearingRule::Uniform ? "uniform" : "second-price";
+}
+
+bool parseClearingRule(const std::string &name, ClearingRule &rule)
+{
+    if (name == "uniform")
+        rule = ClearingRule::Uniform;
+    else if (name == "second-price")
+        rule = ClearingRule::SecondPrice;
+    else
+        return false;
+    return true;
+}
+
+AuctionBook::AuctionBook(TermsLookup lookup, UnitGrant grant) : lookup_(std::move(lookup)), grant_(std::move(grant))
+{
+}
+
+AuctionBook::~AuctionBook()
+{
+    {
+        std::lock_guard<std::mutex> lock(sweeperMtx_);
+        stopping_ = true;
+    }
+    sweeperCv_.notify_all();
+    if (sweeper_.joinable())
+        sweeper_.join();
+}
+
+std::shared_ptr<AuctionBook::Auction> AuctionBook::find(const std::string &offerId)
+{
+    Shard &shard = shardOf(offerId);
+    std::shared_lock<std::shared_mutex> lock(shard.mtx);
+    auto it = shard.auctions.find(offerId);
+    return it == shard.auctions.end() ? nullptr : it->second;
+}
+
+std::shared_ptr<AuctionBook::Auction> AuctionBook::insert(const std::string &offerId, const AuctionTerms &terms)
+{
+    Shard &shard = shardOf(offerId);
+    std::unique_lock<std::shared_mutex> lock(shard.mtx);
+    auto &auction = shard.auctions[offerId];
+    if (!auction)
+    {
+        auction = std::make_shared<Auction>();
+        auction->terms = terms;
+    }
+    return auction;
+}
+
+// Max-heap order: higher amount first, then the earlier bid.
+static bool bidBefore(double a, std::uint64_t seqA, double b, std::uint64_t seqB)
+{
+    return a > b || (a == b && seqA < seqB);
+}
+
+BidStatus AuctionBook::submitBid(const std::string &offerId, const std::string &bidder, double amount)
+{
+    auto auction = find(offerId);
+    if (!auction)
+    {
+        std::vector<std::optional<AuctionTerms>> terms;
+        if (lookup_)
+            lookup_({offerId}, terms);
+        if (terms.empty() || !terms[0])
+        {
+            bidsRefused.add();
+            return BidStatus::UnknownOffer;
+        }
+        auction = insert(offerId, *terms[0]);
+    }
+
+    std::lock_guard<std::mutex> lock(auction->mtx);
+    if (auction->result)
+    {
+        bidsRefused.add();
+        return BidStatus::Closed;
+    }
+    if (!(amount >= auction->terms.reservePrice))
+    {
+        bidsRefused.add();
+        return BidStatus::BelowReserve;
+    }
+    auction->heap.push_back(Bid{amount, auction->nextSeq++, bidder});
+    std::push_heap(auction->heap.begin(), auction->heap.end(), [](const Bid &a, const Bid &b) {
+        return bidBefore(b.amount, b.seq, a.amount, a.seq);
+    });
+    bidsAccepted.add();
+    return BidStatus::Accepted;
+}
+
+void AuctionBook::clearLocked(const std::string &offerId, Auction &auction)
+{
+    ScopedLatency timer(clearLatency);
+    auto order = [](const Bid &a, const Bid &b) { return bidBefore(b.amount, b.seq, a.amount, a.seq); };
+    const AuctionTerms &terms = auction.terms;
+    ClearingRule rule = this->rule();
+
+    AuctionResult result;
+    result.offerId = offerId;
+    result.rule = rule;
+    result.terms = terms;
+    result.bids = auction.heap.size();
+    result.winners.reserve(std::min<std::size_t>(terms.units, auction.heap.size()));
+
+    // Best bid of each distinct bidder, until k winners (or no unit left to
+    // grant) and, for the second-price rule, the best losing bid are known.
+    // The reserve may have risen since the bids came in.
+    std::unordered_set<std::string> seen;
+    bool needLoser = rule == ClearingRule::SecondPrice;
+    bool unitsLeft = true;
+    std::optional<double> bestLoser;
+    std::vector<Bid> &heap = auction.heap;
+    while (!heap.empty() && ((unitsLeft && result.winners.size() < terms.units) || (needLoser && !bestLoser)))
+    {
+        std::pop_heap(heap.begin(), heap.end(), order);
+        Bid bid = std::move(heap.back());
+        heap.pop_back();
+        if (bid.amount < terms.reservePrice)
+            break;
+        if (!seen.insert(bid.bidder).second)
+            continue;
+        if (unitsLeft && result.winners.size() < terms.units && (!grant_ || grant_(offerId, bid.bidder)))
+            result.winners.push_back(AuctionWinner{std::move(bid.bidder), bid.amount});
+        else
+        {
+            unitsLeft = false;
+            bestLoser = bid.amount;
+        }
+    }
+
+    if (!result.winners.empty())
+    {
+        if (rule == ClearingRule::Uniform)
+            result.price = result.winners.back().bid;
+        else
+            result.price = std::max(terms.reservePrice, bestLoser.value_or(terms.reservePrice));
+    }
+    result.clearedAtUs = nowMicros();
+    auction.result = std::move(result);
+    auctionsCleared.add();
+    auction.spent = std::move(heap);
+    heap = std::vector<Bid>();
+}
+
+std::vector<AuctionResult> AuctionBook::clearAll(
+    const std::vector<std::pair<std::string, std::shared_ptr<Auction>>> &auctions)
+{
+    std::vector<AuctionResult> results(auctions.size());
+    auto clearOne = [&](std::size_t i) {
+        Auction &auction = *auctions[i].second;
+        std::lock_guard<std::mutex> lock(auction.mtx);
+        if (!auction.result)
+            clearLocked(auctions[i].first, auction);
+        results[i] = *auction.result;
+    };
+
+    std::size_t n = auctions.size();
+    std::size_t workers = 1;
+    if (n >= kParallelClearing)
+        workers = std::min<std::size_t>(n / (kParallelClearing / 2), std::max(1u, std::thread::hardware_concurrency()));
+    if (workers <= 1)
+    {
+        for (std::size_t i = 0; i < n; ++i)
+            clearOne(i);
+        return results;
+    }
+
+    std::atomic<std::size_t> next{0};
+    std::vector<std::future<void>> tasks;
+    for (std::size_t w = 0; w < workers; ++w)
+    {
+        tasks.push_back(std::async(std::launch::async, [&] {
+            std::size_t i;
+            while ((i = next++) < n)
+                clearOne(i);
+        }));
+    }
+    for (auto &t : tasks)
+        t.wait();
+    return results;
+}
+
+std::vector<AuctionResult> AuctionBook::clear(const std::vector<std::string> &offerIds)
+{
+    ScopedLatency timer(batchClearLatency);
+    std::vector<std::optional<AuctionTerms>> terms;
+    if (lookup_)
+        lookup_(offerIds, terms);
+    terms.resize(offerIds.size());
+
+    std::vector<std::pair<std::string, std::shared_ptr<Auction>>> auctions;
+    auctions.reserve(offerIds.size());
+    for (std::size_t i = 0; i < offerIds.size(); ++i)
+    {
+        auto auction = find(offerIds[i]);
+        if (!auction && terms[i])
+            auction = insert(offerIds[i], *terms[i]);
+        if (!auction)
+            continue;
+        if (terms[i])
+            setTerms(offerIds[i], *terms[i]);
+        auctions.emplace_back(offerIds[i], std::move(auction));
+    }
+    return clearAll(auctions);
+}
+
+std::optional<AuctionResult> AuctionBook::result(const std::string &offerId)
+{
+    auto auction = find(offerId);
+    if (!auction)
+        return std::nullopt;
+    std::lock_guard<std::mutex> lock(auction->mtx);
+    if (auction->result)
+        return auction->result;
+    AuctionResult open;
+    open.offerId = offerId;
+    open.rule = rule();
+    open.terms = auction->terms;
+    return open;
+}
+
+void AuctionBook::setTerms(const std::string &offerId, const AuctionTerms &terms)
+{
+    auto auction = find(offerId);
+    if (!auction)
+        return;
+    std::lock_guard<std::mutex> lock(auction->mtx);
+    if (!auction->result)
+        auction->terms = terms;
+}
+
+std::size_t AuctionBook::sweep()
+{
+    std::vector<std::string> openIds;
+    std::vector<std::pair<std::string, std::shared_ptr<Auction>>> open;
+    std::int64_t retainAfterUs = nowMicros() - std::chrono::duration_cast<std::chrono::microseconds>(kResultRetention).count();
+    std::size_t forgotten = 0;
+    std::vector<std::vector<Bid>> spent;
+    for (auto &shard : shards_)
+    {
+        std::unique_lock<std::shared_mutex> lock(shard.mtx);
+        for (auto it = shard.auctions.begin(); it != shard.auctions.end();)
+        {
+            std::lock_guard<std::mutex> auctionLock(it->second->mtx);
+            if (!it->second->spent.empty())
+                spent.push_back(std::move(it->second->spent));
+            if (!it->second->result)
+            {
+                openIds.push_back(it->first);
+                open.emplace_back(it->first, it->second);
+            }
+            else if (it->second->result->clearedAtUs < retainAfterUs)
+            {
+                it = shard.auctions.erase(it);
+                ++forgotten;
+                continue;
+            }
+            ++it;
+        }
+    }
+
+    spent.clear();
+
+    std::vector<std::optional<AuctionTerms>> terms;
+    if (lookup_ && !openIds.empty())
+        lookup_(openIds, terms);
+    terms.resize(openIds.size());
+
+    std::vector<std::pair<std::string, std::shared_ptr<Auction>>> due;
+    for (std::size_t i = 0; i < open.size(); ++i)
+    {
+        if (!terms[i])
+            due.push_back(std::move(open[i]));
+        else
+            setTerms(openIds[i], *terms[i]);
+    }
+    if (!due.empty())
+    {
+        ScopedLatency timer(batchClearLatency);
+        clearAll(due);
+        TEE_LOG_INFO("AuctionBook", "Cleared {} auctions of expired offers.", due.size());
+    }
+    if (forgotten > 0)
+        TEE_LOG_DEBUG("AuctionBook", "Dropped {} auction results past retention.", forgotten);
+    return due.size();
+}
+
+void AuctionBook::startSweeper(std::chrono::milliseconds interval)
+{
+    if (sweeper_.joinable())
+        return;
+    sweeper_ = std::thread([this, interval] {
+        std::unique_lock<std::mutex> lock(sweeperMtx_);
+        while (!sweeperCv_.wait_for(lock, interval, [&] { return stopping_; }))
+        {
+            lock.unlock();
+            sweep();
+            lock.lock();
+        }
+    });
+}
+
+std::size_t AuctionBook::openAuctions()
+{
+    std::size_t n = 0;
+    for (auto &shard : shards_)
+    {
+        std::shared_lock<std::shared_mutex> lock(shard.mtx);
+        for (const auto &kv : shard.auctions)
+        {
+            std::lock_guard<std::mutex> auctionLock(kv.second->mtx);
+            n += !kv.second->result;
+        }
+    }
+    return n;
+}
+
+std::size_t AuctionBook::openBids()
+{
+    std::size_t n = 0;
+    for (auto &shard : shards_)
+    {
+        std::shared_lock<std::shared_mutex> lock(shard.mtx);
+        for (const auto &kv : shard.auctions)
+        {
+            std::lock_guard<std::mutex> auctionLock(kv.second->mtx);
+            n += kv.second->heap.size();
+        }
+    }
+    return n;
+}
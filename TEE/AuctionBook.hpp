@@ -0,0 +1,162 @@
+#ifndef AUCTIONBOOK_HPP
+#define AUCTIONBOOK_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// How the single price every winner pays is set.
+enum class ClearingRule
+{
+    Uniform,    // the lowest winning bid
+    SecondPrice // the highest losing bid, or the reserve if every bid wins
+};
+
+const char *clearingRuleName(ClearingRule rule);
+bool parseClearingRule(const std::string &name, ClearingRule &rule);
+
+// reservePrice and preferredNumberOfBuyers of the offer being auctioned.
+struct AuctionTerms
+{
+    double reservePrice = 0;
+    std::uint32_t units = 0;
+};
+
+struct AuctionWinner
+{
+    std::string bidder;
+    double bid = 0;
+};
+
+struct AuctionResult
+{
+    std::string offerId;
+    ClearingRule rule = ClearingRule::SecondPrice;
+    AuctionTerms terms;
+    double price = 0;                   // paid by every winner; 0 when nothing sold
+    std::vector<AuctionWinner> winners; // highest bid first
+    std::size_t bids = 0;               // sealed bids received
+    std::int64_t clearedAtUs = 0;
+};
+
+enum class BidStatus
+{
+    Accepted,
+    BelowReserve,
+    Closed,
+    UnknownOffer
+};
+
+// Sealed-bid k-unit auctions, one per offer: k = preferredNumberOfBuyers
+// units sold to the k highest bidders at or above reservePrice, each
+// bidder winning at most one unit at its highest bid (ties go to the
+// earlier bid). Bids are never revealed before clearing.
+//
+// Each offer keeps its bids in a max-heap, so clearing pops the k + 1 best
+// distinct bidders in O(k log n) however many bids arrived. Auctions clear
+// on demand or, through the sweeper, once their offer has expired or been
+// removed; clearing many offers at once shares one terms lookup and is
+// spread over the cores.
+//
+// The book does not own the units: each winner, best first, is granted one
+// by the UnitGrant at clearing, and the first refusal means the units are
+// gone, so that bid and the ones below it lose.
+class AuctionBook
+{
+public:
+    // Current terms for each id (nullopt: the offer is gone), in one call.
+    using TermsLookup = std::function<void(const std::vector<std::string> &offerIds,
+                                           std::vector<std::optional<AuctionTerms>> &terms)>;
+    // Takes one unit of the offer for a winner; false when none is left.
+    // Called with the auction locked, possibly on several threads at once.
+    using UnitGrant = std::function<bool(const std::string &offerId, const std::string &bidder)>;
+
+private:
+    struct Bid
+    {
+        double amount;
+        std::uint64_t seq;
+        std::string bidder;
+    };
+
+    struct Auction
+    {
+        std::mutex mtx;
+        AuctionTerms terms;
+        std::vector<Bid> heap;
+        std::uint64_t nextSeq = 0;
+        std::optional<AuctionResult> result; // set once cleared; bids are refused from then on
+        std::vector<Bid> spent;              // losing bids, freed by the next sweep
+    };
+
+    static constexpr std::size_t kShards = 64;
+    struct Shard
+    {
+        std::shared_mutex mtx;
+        std::unordered_map<std::string, std::shared_ptr<Auction>> auctions;
+    };
+
+    // Cleared auctions answer auctionResult for this long.
+    static constexpr auto kResultRetention = std::chrono::hours(24);
+
+    TermsLookup lookup_;
+    UnitGrant grant_;
+    std::atomic<ClearingRule> rule_{ClearingRule::SecondPrice};
+    Shard shards_[kShards];
+
+    std::mutex sweeperMtx_;
+    std::condition_variable sweeperCv_;
+    bool stopping_ = false;
+    std::thread sweeper_;
+
+    Shard &shardOf(const std::string &offerId) { return shards_[std::hash<std::string>{}(offerId) % kShards]; }
+    std::shared_ptr<Auction> find(const std::string &offerId);
+    std::shared_ptr<Auction> insert(const std::string &offerId, const AuctionTerms &terms);
+    void clearLocked(const std::string &offerId, Auction &auction);
+    std::vector<AuctionResult> clearAll(const std::vector<std::pair<std::string, std::shared_ptr<Auction>>> &auctions);
+
+public:
+    // Without a grant every winner gets its unit.
+    explicit AuctionBook(TermsLookup lookup, UnitGrant grant = nullptr);
+    ~AuctionBook();
+
+    void setRule(ClearingRule rule) { rule_.store(rule, std::memory_order_relaxed); }
+    ClearingRule rule() const { return rule_.load(std::memory_order_relaxed); }
+
+    // amount must be positive and finite.
+    BidStatus submitBid(const std::string &offerId, const std::string &bidder, double amount);
+
+    // Clears the given auctions now, including offers nobody has bid on;
+    // already cleared ones return their existing result. Unknown offers
+    // are left out.
+    std::vector<AuctionResult> clear(const std::vector<std::string> &offerIds);
+
+    // While the auction is open only its terms are filled in (clearedAtUs
+    // is 0): sealed bids reveal nothing, not even their number.
+    std::optional<AuctionResult> result(const std::string &offerId);
+
+    // Applies changed terms (e.g. an updated reservePrice) to an open auction.
+    void setTerms(const std::string &offerId, const AuctionTerms &terms);
+
+    // Clears auctions whose offer is gone, refreshes the terms of the
+    // others, frees the losing bids of cleared auctions (which can take
+    // longer than clearing them) and forgets results past their retention.
+    // Returns the number of auctions cleared.
+    std::size_t sweep();
+    void startSweeper(std::chrono::milliseconds interval);
+
+    std::size_t openAuctions();
+    std::size_t openBids();
+};
+
+#endif // AUCTIONBOOK_HPP
@@ -0,0 +1,117 @@
+#ifndef BOUNDEDQUEUE_HPP
+#define BOUNDEDQUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+// Bounded lock-free multi-producer/multi-consumer queue (Vyukov's array
+// queue). Each cell carries a sequence number that tells producers and
+// consumers whether it is free for their ticket, so push and pop are one
+// CAS on the shared position plus one release store on the cell.
+template <typename T>
+class BoundedQueue
+{
+private:
+    struct Cell
+    {
+        std::atomic<std::size_t> seq;
+        T data;
+    };
+
+    static constexpr std::size_t kCacheLine = 64;
+
+    std::unique_ptr<Cell[]> cells_;
+    std::size_t mask_;
+    alignas(kCacheLine) std::atomic<std::size_t> enqueuePos_{0};
+    alignas(kCacheLine) std::atomic<std::size_t> dequeuePos_{0};
+
+    static std::size_t roundUpPow2(std::size_t n)
+    {
+        std::size_t p = 2;
+        while (p < n)
+            p <<= 1;
+        return p;
+    }
+
+public:
+    // Capacity is rounded up to a power of two.
+    explicit BoundedQueue(std::size_t capacity)
+        : cells_(new Cell[roundUpPow2(capacity)]), mask_(roundUpPow2(capacity) - 1)
+    {
+        for (std::size_t i = 0; i <= mask_; ++i)
+            cells_[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    BoundedQueue(const BoundedQueue &) = delete;
+    BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+    bool tryPush(T &&value)
+    {
+        std::size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Cell &cell = cells_[pos & mask_];
+            std::size_t seq = cell.seq.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0)
+            {
+                if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    cell.data = std::move(value);
+                    cell.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false; // full
+            }
+            else
+            {
+                pos = enqueuePos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool tryPop(T &out)
+    {
+        std::size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Cell &cell = cells_[pos & mask_];
+            std::size_t seq = cell.seq.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0)
+            {
+                if (dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    out = std::move(cell.data);
+                    cell.seq.store(pos + mask_ + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false; // empty
+            }
+            else
+            {
+                pos = dequeuePos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Racy by nature; good enough for metrics.
+    std::size_t sizeApprox() const
+    {
+        std::size_t enq = enqueuePos_.load(std::memory_order_relaxed);
+        std::size_t deq = dequeuePos_.load(std::memory_order_relaxed);
+        return enq > deq ? enq - deq : 0;
+    }
+
+    std::size_t capacity() const { return mask_ + 1; }
+};
+
+#endif // BOUNDEDQUEUE_HPP
@@ -0,0 +1,164 @@
+#include "ChainClient.hpp"
+#include "Logger.hpp"
+#include "Merkle.hpp"
+#include <random>
+#include <thread>
+
+ChainReceipt LoggingChainClient::submit(const ChainTransaction &tx)
+{
+    ChainReceipt receipt;
+    receipt.accepted = true;
+    receipt.txHash = toHex(merkleLeafHash(tx.payload));
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        receipt.blockNumber = ++count_;
+    }
+    TEE_LOG_INFO("OnChainPoster", "Posting tx {} (nonce {}, {} bytes) on chain: {}",
+                 receipt.txHash, tx.nonce, tx.payload.size(), tx.payload);
+    return receipt;
+}
+
+LocalChain::LocalChain(const LocalChainConfig &config)
+    : config_(config), genesis_(std::chrono::steady_clock::now())
+{
+}
+
+ChainReceipt LocalChain::receiptOf(const Transaction &tx) const
+{
+    ChainReceipt receipt;
+    receipt.accepted = !tx.reverted;
+    receipt.txHash = tx.txHash;
+    receipt.blockNumber = tx.blockNumber;
+    receipt.error = tx.error;
+    return receipt;
+}
+
+std::uint64_t LocalChain::openBlockLocked(std::chrono::steady_clock::time_point now)
+{
+    if (config_.blockTime.count() == 0)
+        return ++sealedBlocks_;
+    return static_cast<std::uint64_t>((now - genesis_) / config_.blockTime) + 1;
+}
+
+std::chrono::steady_clock::time_point LocalChain::sealTime(std::uint64_t blockNumber) const
+{
+    if (config_.blockTime.count() == 0)
+        return std::chrono::steady_clock::time_point::min();
+    return genesis_ + config_.blockTime * static_cast<std::int64_t>(blockNumber);
+}
+
+static std::chrono::microseconds sampleLatency(std::mt19937_64 &rng, std::chrono::microseconds mean, LatencyShape shape)
+{
+    if (mean.count() <= 0)
+        return std::chrono::microseconds(0);
+    double us = static_cast<double>(mean.count());
+    switch (shape)
+    {
+    case LatencyShape::Uniform:
+        us = std::uniform_real_distribution<double>(0.0, 2.0 * us)(rng);
+        break;
+    case LatencyShape::Exponential:
+        us = std::exponential_distribution<double>(1.0 / us)(rng);
+        break;
+    case LatencyShape::Constant:
+        break;
+    }
+    return std::chrono::microseconds(static_cast<std::int64_t>(us));
+}
+
+ChainReceipt LocalChain::submit(const ChainTransaction &tx)
+{
+    std::uint32_t attempt;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        stats_.submissions++;
+        attempt = attempts_[tx.nonce]++;
+    }
+
+    // Seeded per transaction attempt, so a run replays the same latencies and
+    // failures however the poster's submitters interleave.
+    std::seed_seq seeds{config_.seed, tx.nonce, static_cast<std::uint64_t>(attempt)};
+    std::mt19937_64 rng(seeds);
+    std::uniform_real_distribution<double> chance(0.0, 1.0);
+    std::this_thread::sleep_for(sampleLatency(rng, config_.latency, config_.latencyShape));
+    bool unavailable = chance(rng) < config_.failureRate;
+    bool revert = chance(rng) < config_.revertRate;
+
+    std::unique_lock<std::mutex> lock(mtx_);
+    if (unavailable)
+    {
+        stats_.injectedFailures++;
+        ChainReceipt receipt;
+        receipt.retryable = true;
+        receipt.error = "endpoint unavailable (injected)";
+        return receipt;
+    }
+
+    auto known = [&] { return !tx.idempotencyKey.empty() && byKey_.count(tx.idempotencyKey) > 0; };
+    if (!cv_.wait_for(lock, config_.gapTimeout, [&] { return known() || tx.nonce <= nextNonce_; }))
+    {
+        stats_.gapTimeouts++;
+        ChainReceipt receipt;
+        receipt.retryable = true;
+        receipt.error = "nonce gap: expected " + std::to_string(nextNonce_) + ", got " + std::to_string(tx.nonce);
+        return receipt;
+    }
+
+    Transaction included;
+    if (known())
+    {
+        stats_.duplicates++;
+        included = transactions_[byKey_.at(tx.idempotencyKey)];
+    }
+    else if (tx.nonce < nextNonce_)
+    {
+        ChainReceipt receipt;
+        receipt.error = "nonce " + std::to_string(tx.nonce) + " already used";
+        return receipt;
+    }
+    else
+    {
+        std::string error;
+        if (config_.maxPayloadBytes > 0 && tx.payload.size() > config_.maxPayloadBytes)
+            error = "payload of " + std::to_string(tx.payload.size()) + " bytes exceeds the " +
+                    std::to_string(config_.maxPayloadBytes) + " byte limit";
+        else if (revert)
+            error = "reverted (injected)";
+
+        included = Transaction{openBlockLocked(std::chrono::steady_clock::now()), tx.nonce,
+                               toHex(merkleLeafHash(tx.payload)), tx.payload, !error.empty(), error};
+        if (!tx.idempotencyKey.empty())
+            byKey_.emplace(tx.idempotencyKey, transactions_.size());
+        transactions_.push_back(included);
+        attempts_.erase(tx.nonce);
+        nextNonce_++;
+        if (included.reverted)
+            stats_.reverted++;
+        else
+            stats_.included++;
+        cv_.notify_all();
+    }
+    lock.unlock();
+
+    // The receipt only exists once the block is sealed.
+    std::this_thread::sleep_until(sealTime(included.blockNumber));
+    return receiptOf(included);
+}
+
+std::optional<std::uint64_t> LocalChain::nextNonce()
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    return nextNonce_;
+}
+
+std::vector<LocalChain::Transaction> LocalChain::transactions()
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    return transactions_;
+}
+
+LocalChain::Stats LocalChain::stats()
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    return stats_;
+}
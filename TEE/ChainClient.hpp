@@ -0,0 +1,135 @@
+#ifndef CHAINCLIENT_HPP
+#define CHAINCLIENT_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct ChainTransaction
+{
+    std::string payload;
+    std::uint64_t nonce = 0;
+    // Stable across resubmissions; a chain that has already included a
+    // transaction with this key answers with the original receipt.
+    std::string idempotencyKey;
+};
+
+struct ChainReceipt
+{
+    bool accepted = false;
+    // Refused for now (endpoint down, nonce gap); the same transaction may
+    // be resubmitted. A final refusal consumes the nonce.
+    bool retryable = false;
+    std::string txHash;
+    std::uint64_t blockNumber = 0;
+    std::string error;
+};
+
+// Something OnChainPoster can submit transactions to. submit() blocks until
+// the transaction is included or refused; OnChainPoster pipelines several
+// submissions, so it is called from more than one thread.
+class ChainClient
+{
+public:
+    virtual ~ChainClient() = default;
+    virtual ChainReceipt submit(const ChainTransaction &tx) = 0;
+    // The account's next unused nonce as the chain sees it, when known.
+    virtual std::optional<std::uint64_t> nextNonce() { return std::nullopt; }
+    // Largest payload the chain takes (0 = no limit); the poster cuts smaller batches.
+    virtual std::size_t maxPayloadBytes() const { return 0; }
+};
+
+// Logs each transaction instead of sending it (the original behaviour).
+class LoggingChainClient : public ChainClient
+{
+private:
+    std::mutex mtx_;
+    std::uint64_t count_ = 0;
+
+public:
+    ChainReceipt submit(const ChainTransaction &tx) override;
+};
+
+enum class LatencyShape
+{
+    Constant,   // always the mean
+    Uniform,    // uniform over [0, 2 * mean)
+    Exponential // memoryless, with a long tail
+};
+
+struct LocalChainConfig
+{
+    std::chrono::milliseconds blockTime{0};             // 0 = one block per transaction, sealed at once
+    std::chrono::microseconds latency{0};               // mean submission round trip...
+    LatencyShape latencyShape = LatencyShape::Constant; // ...and its distribution
+    double failureRate = 0;                             // chance a submission is refused as retryable
+    double revertRate = 0;                              // chance an included transaction reverts
+    std::size_t maxPayloadBytes = 0;                    // larger payloads are refused for good; 0 = no limit
+    std::uint64_t seed = 1;                             // draws depend only on seed, nonce and attempt
+    std::chrono::milliseconds gapTimeout{2000};         // how long a nonce waits for the ones before it
+};
+
+// In-process stand-in ledger for tests and benchmarks. Transactions go into
+// the block open when they arrive and submit() returns once it is sealed;
+// the hash of a transaction is the SHA-256 of its payload. Nonces are used
+// in order; one that arrives ahead of a gap waits up to gapTimeout for the
+// gap to fill, then is refused as retryable. Like a real chain, a final
+// refusal (size limit, revert) still takes the nonce.
+class LocalChain : public ChainClient
+{
+public:
+    struct Transaction
+    {
+        std::uint64_t blockNumber;
+        std::uint64_t nonce;
+        std::string txHash;
+        std::string payload;
+        bool reverted;
+        std::string error;
+    };
+
+    struct Stats
+    {
+        std::uint64_t submissions = 0;
+        std::uint64_t injectedFailures = 0; // retryable refusals drawn from failureRate
+        std::uint64_t gapTimeouts = 0;
+        std::uint64_t duplicates = 0;       // answered from the idempotency key
+        std::uint64_t included = 0;
+        std::uint64_t reverted = 0;         // by revertRate or the size limit
+    };
+
+private:
+    LocalChainConfig config_;
+    std::chrono::steady_clock::time_point genesis_;
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::uint64_t nextNonce_ = 0;
+    std::uint64_t sealedBlocks_ = 0; // with blockTime 0
+    std::vector<Transaction> transactions_;
+    std::unordered_map<std::string, std::size_t> byKey_;
+    std::unordered_map<std::uint64_t, std::uint32_t> attempts_; // by nonce, for the draws
+    Stats stats_;
+
+    ChainReceipt receiptOf(const Transaction &tx) const;
+    std::uint64_t openBlockLocked(std::chrono::steady_clock::time_point now);
+    std::chrono::steady_clock::time_point sealTime(std::uint64_t blockNumber) const;
+
+public:
+    explicit LocalChain(const LocalChainConfig &config = LocalChainConfig{});
+
+    ChainReceipt submit(const ChainTransaction &tx) override;
+    std::optional<std::uint64_t> nextNonce() override;
+    std::size_t maxPayloadBytes() const override { return config_.maxPayloadBytes; }
+
+    // Every transaction taken, in nonce order, reverted ones included.
+    std::vector<Transaction> transactions();
+    Stats stats();
+};
+
+#endif // CHAINCLIENT_HPP
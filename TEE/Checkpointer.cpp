@@ -0,0 +1,289 @@
+#include "Checkpointer.hpp"
+#include "OfferJson.hpp"
+#include "Logger.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <nlohmann/json.hpp>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using json = nlohmann::json;
+
+static constexpr std::size_t kWriteChunk = 1 << 20;
+
+// Private_Dirty of the calling process from /proc/self/smaps_rollup, in bytes.
+// Read with raw syscalls because it runs in the forked child.
+static std::uint64_t privateDirtyBytes()
+{
+    int fd = ::open("/proc/self/smaps_rollup", O_RDONLY);
+    if (fd < 0)
+        return 0;
+
+    char buf[4096];
+    ssize_t n = ::read(fd, buf, sizeof(buf) - 1);
+    ::close(fd);
+    if (n <= 0)
+        return 0;
+    buf[n] = '\0';
+
+    const char *field = std::strstr(buf, "Private_Dirty:");
+    if (!field)
+        return 0;
+    return std::strtoull(field + std::strlen("Private_Dirty:"), nullptr, 10) * 1024;
+}
+
+static bool writeAll(int fd, const std::string &data)
+{
+    std::size_t written = 0;
+    while (written < data.size())
+    {
+        ssize_t n = ::write(fd, data.data() + written, data.size() - written);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        written += static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+// Runs in the forked child: serialize the frozen image and report stats on statsFd.
+static int writeCheckpoint(const std::string &path, int statsFd, const TEEStorage::FrozenView &frozen)
+{
+    std::uint64_t dirtyAtFork = privateDirtyBytes();
+    std::string tmpPath = path + ".tmp";
+    int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0)
+        return 1;
+
+    std::uint64_t bytesWritten = 0;
+    std::string buffer = json{{"seq", frozen.seq()}, {"count", frozen.size()}}.dump();
+    buffer.push_back('\n');
+    bool ok = true;
+    frozen.forEach([&](const std::string &offerId, const Offer &offer, std::int64_t storedAtUs) {
+        buffer += json{{"offerId", offerId}, {"offer", offer}, {"storedAtUs", storedAtUs}}.dump();
+        buffer.push_back('\n');
+        if (buffer.size() >= kWriteChunk)
+        {
+            ok = ok && writeAll(fd, buffer);
+            bytesWritten += buffer.size();
+            buffer.clear();
+        }
+    });
+    ok = ok && writeAll(fd, buffer);
+    bytesWritten += buffer.size();
+    ok = ok && ::fsync(fd) == 0;
+    ::close(fd);
+    ok = ok && ::rename(tmpPath.c_str(), path.c_str()) == 0;
+
+    std::uint64_t dirtyAtExit = privateDirtyBytes();
+    json stats{
+        {"ok", ok},
+        {"seq", frozen.seq()},
+        {"offers", frozen.size()},
+        {"bytesWritten", bytesWritten},
+        {"cowBytes", dirtyAtExit > dirtyAtFork ? dirtyAtExit - dirtyAtFork : 0}};
+    writeAll(statsFd, stats.dump());
+    ::close(statsFd);
+    return ok ? 0 : 1;
+}
+
+Checkpointer::Checkpointer(TEEStorage &storage, const std::string &path)
+    : storage_(storage), path_(path)
+{
+}
+
+Checkpointer::~Checkpointer()
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    if (periodicThread_.joinable())
+        periodicThread_.join();
+    wait();
+    // The reaper still touches mtx_ and cv_ after clearing inProgress_.
+    if (reaper_.joinable())
+        reaper_.join();
+}
+
+bool Checkpointer::start()
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (inProgress_)
+            return false;
+        inProgress_ = true;
+    }
+    // Only the caller that set inProgress_ touches reaper_, and the last reap is done bar returning.
+    if (reaper_.joinable())
+        reaper_.join();
+
+    int fds[2];
+    if (::pipe(fds) < 0)
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        inProgress_ = false;
+        return false;
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    std::int64_t stallMicros = 0;
+    std::string path = path_;
+    int readFd = fds[0];
+    int writeFd = fds[1];
+    pid_t pid = storage_.forkFrozen(
+        [path, readFd, writeFd](const TEEStorage::FrozenView &frozen) {
+            ::close(readFd);
+            return writeCheckpoint(path, writeFd, frozen);
+        },
+        stallMicros);
+    ::close(writeFd);
+
+    if (pid < 0)
+    {
+        TEE_LOG_ERROR("Checkpointer", "fork failed: {}", std::strerror(errno));
+        ::close(readFd);
+        std::lock_guard<std::mutex> lock(mtx_);
+        inProgress_ = false;
+        return false;
+    }
+
+    reaper_ = std::thread(&Checkpointer::reap, this, pid, readFd, stallMicros, started);
+    return true;
+}
+
+void Checkpointer::reap(pid_t pid, int statsFd, std::int64_t stallMicros,
+                        std::chrono::steady_clock::time_point started)
+{
+    std::string report;
+    char buf[512];
+    ssize_t n;
+    while ((n = ::read(statsFd, buf, sizeof(buf))) != 0)
+    {
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        report.append(buf, static_cast<std::size_t>(n));
+    }
+    ::close(statsFd);
+
+    int status = 0;
+    ::waitpid(pid, &status, 0);
+
+    CheckpointStats stats;
+    stats.stallMicros = stallMicros;
+    stats.durationMicros = std::chrono::duration_cast<std::chrono::microseconds>(
+                               std::chrono::steady_clock::now() - started)
+                               .count();
+    try
+    {
+        auto j = json::parse(report);
+        stats.ok = j.value("ok", false) && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        stats.seq = j.value("seq", std::uint64_t{0});
+        stats.offers = j.value("offers", std::uint64_t{0});
+        stats.bytesWritten = j.value("bytesWritten", std::uint64_t{0});
+        stats.cowBytes = j.value("cowBytes", std::uint64_t{0});
+    }
+    catch (...)
+    {
+        stats.ok = false;
+    }
+
+    if (stats.ok)
+        TEE_LOG_INFO("Checkpointer", "Wrote {} offers (seq {}) to {} in {}us, stall {}us, copy-on-write {} KiB",
+                     stats.offers, stats.seq, path_, stats.durationMicros, stats.stallMicros, stats.cowBytes / 1024);
+    else
+        TEE_LOG_ERROR("Checkpointer", "Checkpoint to {} failed.", path_);
+
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        lastStats_ = stats;
+        ++completed_;
+        inProgress_ = false;
+    }
+    cv_.notify_all();
+}
+
+CheckpointStats Checkpointer::wait()
+{
+    std::unique_lock<std::mutex> lock(mtx_);
+    cv_.wait(lock, [&] { return !inProgress_; });
+    return lastStats_;
+}
+
+CheckpointStats Checkpointer::lastStats()
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    return lastStats_;
+}
+
+std::uint64_t Checkpointer::completedCount()
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    return completed_;
+}
+
+void Checkpointer::startPeriodic(std::chrono::seconds interval)
+{
+    periodicThread_ = std::thread([this, interval] {
+        std::unique_lock<std::mutex> lock(mtx_);
+        while (!cv_.wait_for(lock, interval, [&] { return stopping_; }))
+        {
+            lock.unlock();
+            start();
+            lock.lock();
+        }
+    });
+}
+
+bool Checkpointer::restore(TEEStorage &storage, const std::string &path)
+{
+    std::ifstream in(path);
+    if (!in)
+        return false;
+
+    try
+    {
+        std::string line;
+        if (!std::getline(in, line))
+            return false;
+        auto header = json::parse(line);
+        std::uint64_t seq = header.value("seq", std::uint64_t{0});
+        std::size_t count = header.value("count", std::size_t{0});
+
+        // Checkpoints written before storedAtUs was recorded restore as stored now.
+        std::vector<std::pair<std::string, Offer>> offers;
+        std::vector<std::int64_t> storedAtUs;
+        offers.reserve(count);
+        storedAtUs.reserve(count);
+        while (std::getline(in, line))
+        {
+            auto entry = json::parse(line);
+            offers.emplace_back(entry.value("offerId", ""), entry.at("offer").get<Offer>());
+            storedAtUs.push_back(entry.value("storedAtUs", std::int64_t{0}));
+        }
+        if (offers.size() != count)
+            return false;
+
+        storage.loadSnapshot(seq, std::move(offers), std::move(storedAtUs));
+        std::size_t expired = storage.expireOffers(); // lapsed while the service was down
+        TEE_LOG_INFO("Checkpointer", "Restored {} offers (seq {}) from {}, {} since expired", count, seq, path, expired);
+        return true;
+    }
+    catch (const std::exception &e)
+    {
+        TEE_LOG_ERROR("Checkpointer", "Corrupt checkpoint {}: {}", path, e.what());
+        return false;
+    }
+}
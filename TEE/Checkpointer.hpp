@@ -0,0 +1,62 @@
+#ifndef CHECKPOINTER_HPP
+#define CHECKPOINTER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "TEEStorage.hpp"
+
+struct CheckpointStats
+{
+    bool ok = false;
+    std::uint64_t seq = 0;
+    std::uint64_t offers = 0;
+    std::uint64_t bytesWritten = 0;
+    std::int64_t stallMicros = 0;    // time ingest was blocked (the fork)
+    std::int64_t durationMicros = 0; // fork to child exit
+    std::uint64_t cowBytes = 0;      // pages unshared between parent and child while writing
+};
+
+// Writes TEEStorage to disk from a forked child so the parent only stalls
+// for the fork itself. File format: a JSON header line {"seq","count"}
+// followed by one {"offerId","offer"} line per offer.
+class Checkpointer
+{
+private:
+    TEEStorage &storage_;
+    std::string path_;
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    bool inProgress_ = false;
+    bool stopping_ = false;
+    CheckpointStats lastStats_;
+    std::uint64_t completed_ = 0;
+    std::thread periodicThread_;
+    std::thread reaper_; // waits for the running child; joined by the next start() or the destructor
+
+    void reap(pid_t pid, int statsFd, std::int64_t stallMicros,
+              std::chrono::steady_clock::time_point started);
+
+public:
+    Checkpointer(TEEStorage &storage, const std::string &path);
+    ~Checkpointer();
+
+    // Returns false if a checkpoint is already running or fork() failed.
+    bool start();
+
+    // Blocks until no checkpoint is running; returns the stats of the last one.
+    CheckpointStats wait();
+
+    CheckpointStats lastStats();
+    std::uint64_t completedCount();
+
+    void startPeriodic(std::chrono::seconds interval);
+
+    // Loads a checkpoint file into storage; returns false if it does not exist or is corrupt.
+    static bool restore(TEEStorage &storage, const std::string &path);
+};
+
+#endif // CHECKPOINTER_HPP
@@ -0,0 +1,56 @@
+#include "ConsistentHashRing.hpp"
+#include <stdexcept>
+
+ConsistentHashRing::ConsistentHashRing(std::size_t virtualNodes)
+    : virtualNodes_(virtualNodes == 0 ? 1 : virtualNodes)
+{
+}
+
+std::uint64_t ConsistentHashRing::hash(const std::string &key)
+{
+    // FNV-1a followed by a splitmix64 finalizer to spread short, similar ids.
+    std::uint64_t h = 1469598103934665603ULL;
+    for (unsigned char c : key)
+    {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+std::size_t ConsistentHashRing::addShard(const std::string &shardName)
+{
+    std::size_t shard = shards_.size();
+    shards_.push_back(shardName);
+    for (std::size_t v = 0; v < virtualNodes_; ++v)
+    {
+        ring_.emplace(hash(shardName + "#" + std::to_string(v)), shard);
+    }
+    return shard;
+}
+
+std::size_t ConsistentHashRing::shardFor(const std::string &key) const
+{
+    if (ring_.empty())
+        throw std::runtime_error("ConsistentHashRing has no shards");
+
+    auto it = ring_.lower_bound(hash(key));
+    if (it == ring_.end())
+        it = ring_.begin();
+    return it->second;
+}
+
+std::size_t ConsistentHashRing::shardCount() const
+{
+    return shards_.size();
+}
+
+const std::string &ConsistentHashRing::shardName(std::size_t shard) const
+{
+    return shards_.at(shard);
+}
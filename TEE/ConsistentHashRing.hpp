@@ -0,0 +1,34 @@
+#ifndef CONSISTENTHASHRING_HPP
+#define CONSISTENTHASHRING_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// Consistent hashing of keys onto named shards. Each shard owns
+// virtualNodes points on a 64-bit ring, so adding the (N+1)th shard only
+// moves roughly 1/(N+1) of the keys.
+class ConsistentHashRing
+{
+private:
+    std::size_t virtualNodes_;
+    std::map<std::uint64_t, std::size_t> ring_;
+    std::vector<std::string> shards_;
+
+public:
+    explicit ConsistentHashRing(std::size_t virtualNodes = 128);
+
+    static std::uint64_t hash(const std::string &key);
+
+    // Returns the index of the new shard.
+    std::size_t addShard(const std::string &shardName);
+
+    std::size_t shardFor(const std::string &key) const;
+
+    std::size_t shardCount() const;
+    const std::string &shardName(std::size_t shard) const;
+};
+
+#endif // CONSISTENTHASHRING_HPP
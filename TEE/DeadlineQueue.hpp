@@ -0,0 +1,100 @@
+#ifndef DEADLINEQUEUE_HPP
+#define DEADLINEQUEUE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <utility>
+#include <vector>
+
+// Set by the owner of some queued work (a WebSocket session) when nobody
+// is waiting for the result any more.
+class CancellationToken
+{
+private:
+    std::atomic<bool> cancelled_{false};
+
+public:
+    void cancel() { cancelled_.store(true, std::memory_order_relaxed); }
+    bool cancelled() const { return cancelled_.load(std::memory_order_relaxed); }
+};
+
+// Deadline and cancellation carried by a verification request. Checked just
+// before the pairing so abandoned or late work costs a queue slot, not a proof check.
+struct VerificationTicket
+{
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+    std::shared_ptr<const CancellationToken> token;
+
+    bool cancelled() const { return token && token->cancelled(); }
+    bool expired(std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now()) const
+    {
+        return now > deadline;
+    }
+};
+
+// Bounded earliest-deadline-first queue; equal deadlines pop in push order.
+// A mutex-guarded heap rather than BoundedQueue's lock-free ring, since the
+// order depends on the contents; it feeds millisecond-scale proof checks.
+template <typename T>
+class DeadlineQueue
+{
+private:
+    struct Entry
+    {
+        std::chrono::steady_clock::time_point deadline;
+        std::uint64_t seq;
+        T value;
+
+        bool operator>(const Entry &other) const
+        {
+            return deadline != other.deadline ? deadline > other.deadline : seq > other.seq;
+        }
+    };
+
+    std::size_t capacity_;
+    mutable std::mutex mtx_;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap_;
+    std::uint64_t nextSeq_ = 0;
+
+public:
+    explicit DeadlineQueue(std::size_t capacity) : capacity_(capacity) {}
+
+    DeadlineQueue(const DeadlineQueue &) = delete;
+    DeadlineQueue &operator=(const DeadlineQueue &) = delete;
+
+    bool tryPush(T &&value, std::chrono::steady_clock::time_point deadline)
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (heap_.size() >= capacity_)
+            return false;
+        heap_.push(Entry{deadline, nextSeq_++, std::move(value)});
+        return true;
+    }
+
+    bool tryPop(T &out)
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (heap_.empty())
+            return false;
+        // top() is const; the entry is discarded right after.
+        out = std::move(const_cast<Entry &>(heap_.top()).value);
+        heap_.pop();
+        return true;
+    }
+
+    std::size_t capacity() const { return capacity_; }
+
+    std::size_t sizeApprox() const
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return heap_.size();
+    }
+};
+
+#endif // DEADLINEQUEUE_HPP
@@ -0,0 +1,116 @@
+#include "IncrementalMerkleTree.hpp"
+#include <algorithm>
+#include <thread>
+
+// Below this many items per thread, spawning costs more than it saves.
+static constexpr std::size_t kMinChunk = 4096;
+
+void parallelChunks(std::size_t count, unsigned threads, const std::function<void(std::size_t, std::size_t)> &work)
+{
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    std::size_t chunks = std::min<std::size_t>(threads, (count + kMinChunk - 1) / kMinChunk);
+    if (chunks <= 1)
+    {
+        work(0, count);
+        return;
+    }
+
+    std::size_t per = (count + chunks - 1) / chunks;
+    std::vector<std::thread> workers;
+    workers.reserve(chunks - 1);
+    for (std::size_t c = 1; c < chunks; ++c)
+    {
+        std::size_t begin = c * per;
+        std::size_t end = std::min(count, begin + per);
+        if (begin < end)
+            workers.emplace_back(work, begin, end);
+    }
+    work(0, std::min(count, per));
+    for (auto &worker : workers)
+        worker.join();
+}
+
+void IncrementalMerkleTree::updatePath(std::size_t index)
+{
+    for (std::size_t k = 0; levels_[k].size() > 1; ++k)
+    {
+        const std::vector<MerkleHash> &level = levels_[k];
+        std::size_t parent = index / 2;
+        std::size_t left = parent * 2;
+        MerkleHash node = left + 1 < level.size() ? merkleNodeHash(level[left], level[left + 1]) : level[left];
+
+        if (k + 1 == levels_.size())
+            levels_.emplace_back();
+        std::vector<MerkleHash> &above = levels_[k + 1];
+        if (parent < above.size())
+            above[parent] = node;
+        else
+            above.push_back(node);
+        index = parent;
+    }
+}
+
+std::size_t IncrementalMerkleTree::append(const MerkleHash &leaf)
+{
+    if (levels_.empty())
+        levels_.emplace_back();
+    levels_[0].push_back(leaf);
+    std::size_t index = levels_[0].size() - 1;
+    updatePath(index);
+    return index;
+}
+
+void IncrementalMerkleTree::set(std::size_t index, const MerkleHash &leaf)
+{
+    levels_[0][index] = leaf;
+    updatePath(index);
+}
+
+MerkleHash IncrementalMerkleTree::root() const
+{
+    return levels_.empty() || levels_.back().empty() ? MerkleHash{} : levels_.back()[0];
+}
+
+std::vector<MerkleHash> IncrementalMerkleTree::proof(std::size_t index) const
+{
+    std::vector<MerkleHash> siblings;
+    if (index >= size())
+        return siblings;
+    for (std::size_t k = 0; levels_[k].size() > 1; ++k, index /= 2)
+    {
+        std::size_t sibling = index ^ 1;
+        if (sibling < levels_[k].size())
+            siblings.push_back(levels_[k][sibling]);
+    }
+    return siblings;
+}
+
+void IncrementalMerkleTree::rebuild(std::vector<MerkleHash> leaves, unsigned threads)
+{
+    levels_.clear();
+    if (leaves.empty())
+        return;
+    levels_.push_back(std::move(leaves));
+    while (levels_.back().size() > 1)
+    {
+        const std::vector<MerkleHash> &below = levels_.back();
+        std::vector<MerkleHash> level((below.size() + 1) / 2);
+        parallelChunks(level.size(), threads, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                std::size_t left = 2 * i;
+                level[i] = left + 1 < below.size() ? merkleNodeHash(below[left], below[left + 1]) : below[left];
+            }
+        });
+        levels_.push_back(std::move(level));
+    }
+}
+
+std::size_t IncrementalMerkleTree::nodeCount() const
+{
+    std::size_t count = 0;
+    for (const auto &level : levels_)
+        count += level.size();
+    return count;
+}
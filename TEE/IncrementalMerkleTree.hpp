@@ -0,0 +1,44 @@
+#ifndef INCREMENTALMERKLETREE_HPP
+#define INCREMENTALMERKLETREE_HPP
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+#include "Merkle.hpp"
+
+// Merkle tree over a growing array of leaf slots, shaped like merkleRoot
+// (an odd node is carried up) so verifyMerkleProof checks its proofs.
+// Every node is kept, one contiguous vector per level: appending touches
+// only the right-most node of each level (the frontier), and changing a
+// leaf rehashes its path, so both cost O(log n) hashes. Not synchronized.
+class IncrementalMerkleTree
+{
+private:
+    std::vector<std::vector<MerkleHash>> levels_; // levels_[0] are the leaves, back() is {root}
+
+    void updatePath(std::size_t index);
+
+public:
+    std::size_t size() const { return levels_.empty() ? 0 : levels_[0].size(); }
+
+    // Returns the new leaf's index.
+    std::size_t append(const MerkleHash &leaf);
+    void set(std::size_t index, const MerkleHash &leaf);
+    const MerkleHash &leaf(std::size_t index) const { return levels_[0][index]; }
+
+    // All zeros while the tree is empty.
+    MerkleHash root() const;
+    std::vector<MerkleHash> proof(std::size_t index) const;
+
+    // Replaces every leaf and recomputes the interior level by level,
+    // splitting wide levels across threads (0 = hardware concurrency).
+    void rebuild(std::vector<MerkleHash> leaves, unsigned threads = 0);
+
+    std::size_t nodeCount() const;
+};
+
+// Runs work(begin, end) over [0, count) in contiguous chunks on up to
+// threads threads (0 = hardware concurrency); small ranges stay inline.
+void parallelChunks(std::size_t count, unsigned threads, const std::function<void(std::size_t, std::size_t)> &work);
+
+#endif // INCREMENTALMERKLETREE_HPP
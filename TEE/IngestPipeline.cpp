@@ -0,0 +1,213 @@
+#include "IngestPipeline.hpp"
+
+static std::uint64_t elapsedNs(std::chrono::steady_clock::time_point since)
+{
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                          std::chrono::steady_clock::now() - since)
+                                          .count());
+}
+
+IngestPipeline::IngestPipeline(std::vector<StageSpec> stages)
+{
+    for (auto &spec : stages)
+    {
+        if (spec.workers == 0)
+            spec.workers = 1;
+        stages_.push_back(std::make_unique<Stage>(std::move(spec)));
+    }
+}
+
+IngestPipeline::~IngestPipeline()
+{
+    stop();
+}
+
+void IngestPipeline::start()
+{
+    running_ = true;
+    for (std::size_t i = 0; i < stages_.size(); ++i)
+    {
+        for (std::size_t w = 0; w < stages_[i]->spec.workers; ++w)
+        {
+            stages_[i]->workers.emplace_back(&IngestPipeline::workerLoop, this, i);
+        }
+    }
+}
+
+void IngestPipeline::stop()
+{
+    if (!running_)
+        return;
+
+    while (inFlight_.load() > 0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    running_ = false;
+    for (auto &stage : stages_)
+    {
+        {
+            std::lock_guard<std::mutex> lock(stage->parkMtx);
+        }
+        stage->nonEmpty.notify_all();
+        stage->nonFull.notify_all();
+    }
+    for (auto &stage : stages_)
+    {
+        for (auto &t : stage->workers)
+            t.join();
+        stage->workers.clear();
+    }
+}
+
+bool IngestPipeline::submit(nlohmann::json message, IngestCallback done, VerificationTicket ticket)
+{
+    auto *job = new IngestJob();
+    job->message = std::move(message);
+    job->done = std::move(done);
+    job->ticket = std::move(ticket);
+    job->enqueuedAt = std::chrono::steady_clock::now();
+
+    inFlight_++;
+    Stage &first = *stages_.front();
+    if (!running_ || !first.tryPush(job))
+    {
+        inFlight_--;
+        delete job;
+        return false;
+    }
+    wake(first, first.parkedConsumers, first.nonEmpty);
+    return true;
+}
+
+// Called after a push (or pop) that a parked consumer (or producer) may be
+// waiting for. The fence pairs with the one in the waiter: either the waiter
+// sees the queue change before parking, or this sees it parked and takes the
+// mutex, which the waiter holds until it is inside wait().
+void IngestPipeline::wake(Stage &stage, std::atomic<std::size_t> &parked, std::condition_variable &cv)
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (parked.load(std::memory_order_relaxed) == 0)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(stage.parkMtx);
+    }
+    cv.notify_one();
+}
+
+bool IngestPipeline::pushBlocking(Stage &stage, IngestJob *job)
+{
+    job->enqueuedAt = std::chrono::steady_clock::now();
+    if (!stage.tryPush(job))
+    {
+        std::unique_lock<std::mutex> lock(stage.parkMtx);
+        stage.parkedProducers++;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        while (!stage.tryPush(job))
+        {
+            if (!running_)
+            {
+                stage.parkedProducers--;
+                return false;
+            }
+            stage.nonFull.wait(lock);
+        }
+        stage.parkedProducers--;
+    }
+    wake(stage, stage.parkedConsumers, stage.nonEmpty);
+    return true;
+}
+
+// Returns false once the pipeline stops with the stage's queue empty.
+bool IngestPipeline::popBlocking(Stage &stage, IngestJob *&job)
+{
+    if (!stage.tryPop(job))
+    {
+        std::unique_lock<std::mutex> lock(stage.parkMtx);
+        stage.parkedConsumers++;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        while (!stage.tryPop(job))
+        {
+            if (!running_)
+            {
+                stage.parkedConsumers--;
+                return false;
+            }
+            stage.nonEmpty.wait(lock);
+        }
+        stage.parkedConsumers--;
+    }
+    wake(stage, stage.parkedProducers, stage.nonFull);
+    return true;
+}
+
+void IngestPipeline::finish(IngestJob *job)
+{
+    if (job->done)
+        job->done(job->result);
+    delete job;
+    inFlight_--;
+}
+
+void IngestPipeline::workerLoop(std::size_t stageIndex)
+{
+    Stage &stage = *stages_[stageIndex];
+    Stage *next = stageIndex + 1 < stages_.size() ? stages_[stageIndex + 1].get() : nullptr;
+
+    IngestJob *job = nullptr;
+    while (popBlocking(stage, job))
+    {
+        stage.queueWaitNs += elapsedNs(job->enqueuedAt);
+        auto started = std::chrono::steady_clock::now();
+        bool keepGoing = stage.spec.handler(*job);
+        std::uint64_t serviceNs = elapsedNs(started);
+
+        stage.processed++;
+        stage.serviceNs += serviceNs;
+        std::uint64_t prevMax = stage.maxServiceNs.load(std::memory_order_relaxed);
+        while (serviceNs > prevMax && !stage.maxServiceNs.compare_exchange_weak(prevMax, serviceNs))
+        {
+        }
+
+        if (!keepGoing)
+        {
+            if (!job->result.pending)
+                stage.rejected++;
+            job->result.accepted = job->result.pending;
+            finish(job);
+        }
+        else if (!next)
+        {
+            job->result.accepted = true;
+            finish(job);
+        }
+        else if (!pushBlocking(*next, job))
+        {
+            job->result.accepted = false;
+            job->result.message = "Ingest pipeline shutting down.";
+            finish(job);
+        }
+    }
+}
+
+std::vector<StageMetrics> IngestPipeline::metrics() const
+{
+    std::vector<StageMetrics> out;
+    for (const auto &stage : stages_)
+    {
+        StageMetrics m;
+        m.name = stage->spec.name;
+        m.workers = stage->spec.workers;
+        m.queueCapacity = stage->capacity();
+        m.queueDepth = stage->depth();
+        m.processed = stage->processed.load();
+        m.rejected = stage->rejected.load();
+        if (m.processed > 0)
+        {
+            m.avgServiceUs = stage->serviceNs.load() / 1000.0 / m.processed;
+            m.avgQueueWaitUs = stage->queueWaitNs.load() / 1000.0 / m.processed;
+        }
+        m.maxServiceUs = stage->maxServiceNs.load() / 1000.0;
+        out.push_back(m);
+    }
+    return out;
+}
@@ -0,0 +1,136 @@
+#ifndef INGESTPIPELINE_HPP
+#define INGESTPIPELINE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "BoundedQueue.hpp"
+#include "DeadlineQueue.hpp"
+#include "Offer.hpp"
+#include "OnChainPoster.hpp"
+
+struct IngestResult
+{
+    bool accepted = false;
+    bool pending = false; // acknowledged speculatively; the proof is still being verified
+    std::string offerId;
+    std::string message;
+};
+
+using IngestCallback = std::function<void(const IngestResult &)>;
+
+// One submission travelling through the pipeline.
+struct IngestJob
+{
+    nlohmann::json message;
+    OfferRequest request;
+    FinancialDetails details; // taken before persist moves request.offer away
+    IngestResult result;
+    IngestCallback done;
+    VerificationTicket ticket;
+    std::chrono::steady_clock::time_point enqueuedAt;
+};
+
+// A stage handler returns false to finish the job early: rejected with
+// result.message set, or accepted with result.pending set.
+struct StageSpec
+{
+    std::string name;
+    std::size_t workers = 1;
+    std::size_t queueCapacity = 1024;
+    std::function<bool(IngestJob &job)> handler;
+    bool earliestDeadlineFirst = false; // pop by job.ticket.deadline instead of FIFO
+};
+
+struct StageMetrics
+{
+    std::string name;
+    std::size_t workers = 0;
+    std::size_t queueCapacity = 0;
+    std::size_t queueDepth = 0;
+    std::uint64_t processed = 0;
+    std::uint64_t rejected = 0;
+    double avgServiceUs = 0;
+    double maxServiceUs = 0;
+    double avgQueueWaitUs = 0;
+};
+
+// Chain of stages connected by bounded lock-free queues. Each stage has its
+// own worker threads; a full downstream queue makes upstream workers wait,
+// so backpressure reaches submit(), which refuses work instead of queueing
+// without bound. Jobs that pass the last stage complete as accepted.
+// Workers with nothing to pop, or nowhere to push, sleep on the stage's
+// condition variables; pushes and pops only take its mutex when one does.
+class IngestPipeline
+{
+private:
+    struct Stage
+    {
+        StageSpec spec;
+        BoundedQueue<IngestJob *> queue;
+        std::unique_ptr<DeadlineQueue<IngestJob *>> deadlineQueue; // replaces queue when EDF
+        std::vector<std::thread> workers;
+        std::atomic<std::uint64_t> processed{0};
+        std::atomic<std::uint64_t> rejected{0};
+        std::atomic<std::uint64_t> serviceNs{0};
+        std::atomic<std::uint64_t> maxServiceNs{0};
+        std::atomic<std::uint64_t> queueWaitNs{0};
+        std::mutex parkMtx;
+        std::condition_variable nonEmpty; // consumers waiting for a job
+        std::condition_variable nonFull;  // upstream workers waiting for room
+        std::atomic<std::size_t> parkedConsumers{0};
+        std::atomic<std::size_t> parkedProducers{0};
+
+        explicit Stage(StageSpec s) : spec(std::move(s)), queue(spec.earliestDeadlineFirst ? 2 : spec.queueCapacity)
+        {
+            if (spec.earliestDeadlineFirst)
+                deadlineQueue = std::make_unique<DeadlineQueue<IngestJob *>>(spec.queueCapacity);
+        }
+
+        bool tryPush(IngestJob *job)
+        {
+            if (deadlineQueue)
+            {
+                auto deadline = job->ticket.deadline;
+                return deadlineQueue->tryPush(std::move(job), deadline);
+            }
+            return queue.tryPush(std::move(job));
+        }
+        bool tryPop(IngestJob *&job) { return deadlineQueue ? deadlineQueue->tryPop(job) : queue.tryPop(job); }
+        std::size_t depth() const { return deadlineQueue ? deadlineQueue->sizeApprox() : queue.sizeApprox(); }
+        std::size_t capacity() const { return deadlineQueue ? deadlineQueue->capacity() : queue.capacity(); }
+    };
+
+    std::vector<std::unique_ptr<Stage>> stages_;
+    std::atomic<bool> running_{false};
+    std::atomic<std::uint64_t> inFlight_{0};
+
+    void workerLoop(std::size_t stageIndex);
+    void finish(IngestJob *job);
+    bool pushBlocking(Stage &stage, IngestJob *job);
+    bool popBlocking(Stage &stage, IngestJob *&job);
+    static void wake(Stage &stage, std::atomic<std::size_t> &parked, std::condition_variable &cv);
+
+public:
+    explicit IngestPipeline(std::vector<StageSpec> stages);
+    ~IngestPipeline();
+
+    void start();
+    // Drains in-flight jobs, then joins the workers.
+    void stop();
+
+    // Returns false without calling done if the first stage's queue is full.
+    bool submit(nlohmann::json message, IngestCallback done, VerificationTicket ticket = {});
+
+    std::vector<StageMetrics> metrics() const;
+};
+
+#endif // INGESTPIPELINE_HPP
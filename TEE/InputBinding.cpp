@@ -0,0 +1,155 @@
+#include "InputBinding.hpp"
+#include "Metrics.hpp"
+#include <algorithm>
+#include <sstream>
+
+static LatencyHistogram &bindingLatency = MetricsRegistry::instance().histogram(
+    "tee_input_binding_seconds", "Time to recompute the keyword commitment and nullifier of one offer or one batch.");
+
+bool parseCircuitLayout(const std::string &text, CircuitLayout &layout)
+{
+    std::istringstream in(text);
+    std::size_t values[4];
+    char comma;
+    for (int i = 0; i < 4; ++i)
+    {
+        if (!(in >> values[i]) || (i < 3 && !(in >> comma && comma == ',')))
+            return false;
+    }
+    if (in.peek() != EOF || values[2] == 0 || values[3] == 0)
+        return false;
+    CircuitLayout parsed{values[0], values[1], values[2], values[3]};
+    if (parsed.commitmentInputs() > kPoseidonMaxInputs)
+        return false;
+    layout = parsed;
+    return true;
+}
+
+bool encodeKeywords(const std::vector<std::string> &keywords, const CircuitLayout &layout,
+                    FieldElement *inputs, std::string &error)
+{
+    if (keywords.size() > layout.maxKeywords)
+    {
+        error = "At most " + std::to_string(layout.maxKeywords) + " verifiedKeywords fit the circuit.";
+        return false;
+    }
+    const std::size_t chunks = layout.chunksPerKeyword();
+    inputs[0] = fieldFromUint(keywords.size());
+    for (std::size_t k = 0; k < layout.maxKeywords; ++k)
+    {
+        const std::string *keyword = k < keywords.size() ? &keywords[k] : nullptr;
+        if (keyword && (keyword->empty() || keyword->size() > layout.maxKeywordLen ||
+                        keyword->find('\0') != std::string::npos))
+        {
+            error = "Each verified keyword must be 1 to " + std::to_string(layout.maxKeywordLen) +
+                    " bytes, without NUL.";
+            return false;
+        }
+        for (std::size_t c = 0; c < chunks; ++c)
+        {
+            std::size_t begin = c * 31;
+            std::size_t len = keyword && keyword->size() > begin ? std::min<std::size_t>(31, keyword->size() - begin) : 0;
+            inputs[1 + k * chunks + c] =
+                fieldFromBytes(reinterpret_cast<const unsigned char *>(len ? keyword->data() + begin : ""), len);
+        }
+    }
+    return true;
+}
+
+static bool parseNullifier(const Offer &offer, FieldElement &nullifier, std::string &error)
+{
+    if (!parseFieldElement(offer.nullifier, nullifier))
+    {
+        error = "nullifier must be the decimal field element the proof outputs.";
+        return false;
+    }
+    return true;
+}
+
+bool computeBinding(const Offer &offer, const CircuitLayout &layout, OfferBinding &binding, std::string &error)
+{
+    ScopedLatency timer(bindingLatency);
+    FieldElement inputs[kPoseidonMaxInputs];
+    if (!parseNullifier(offer, binding.nullifier, error) ||
+        !encodeKeywords(offer.verifiedKeywords, layout, inputs, error))
+        return false;
+    binding.keywordCommitment = poseidonHash(inputs, layout.commitmentInputs());
+    return true;
+}
+
+void computeBindings(const std::vector<const Offer *> &offers, const CircuitLayout &layout,
+                     std::vector<OfferBinding> &bindings, std::vector<std::string> &errors)
+{
+    ScopedLatency timer(bindingLatency);
+    const std::size_t n = layout.commitmentInputs();
+    bindings.assign(offers.size(), OfferBinding{});
+    errors.assign(offers.size(), std::string());
+
+    // Encodable offers are hashed together; rejects keep no slot.
+    std::vector<FieldElement> inputs(offers.size() * n);
+    std::vector<std::size_t> slotOf;
+    slotOf.reserve(offers.size());
+    for (std::size_t i = 0; i < offers.size(); ++i)
+    {
+        FieldElement *slot = &inputs[slotOf.size() * n];
+        if (parseNullifier(*offers[i], bindings[i].nullifier, errors[i]) &&
+            encodeKeywords(offers[i]->verifiedKeywords, layout, slot, errors[i]))
+            slotOf.push_back(i);
+    }
+
+    std::vector<FieldElement> commitments(slotOf.size());
+    poseidonHashBatch(inputs.data(), n, slotOf.size(), commitments.data());
+    for (std::size_t s = 0; s < slotOf.size(); ++s)
+        bindings[slotOf[s]].keywordCommitment = commitments[s];
+}
+
+bool checkBinding(const std::vector<std::string> &signals, const CircuitLayout &layout,
+                  const OfferBinding &binding, std::string &error)
+{
+    if (signals.size() != layout.signalCount())
+    {
+        error = "Public inputs have " + std::to_string(signals.size()) + " signals; the circuit has " +
+                std::to_string(layout.signalCount()) + ".";
+        return false;
+    }
+    if (signals[layout.allKeywordsPresentIndex()] != "1")
+    {
+        error = "Proof does not attest that the keywords are present.";
+        return false;
+    }
+    FieldElement nullifier, commitment;
+    if (!parseFieldElement(signals[layout.nullifierIndex()], nullifier) || nullifier != binding.nullifier)
+    {
+        error = "nullifier does not match the proof.";
+        return false;
+    }
+    if (!parseFieldElement(signals[layout.keywordCommitmentIndex()], commitment) ||
+        commitment != binding.keywordCommitment)
+    {
+        error = "verifiedKeywords do not match the proof's keyword commitment.";
+        return false;
+    }
+    return true;
+}
+
+bool emailNullifier(const std::vector<FieldElement> &signatureChunks, unsigned bitsPerChunk, FieldElement &nullifier)
+{
+    std::size_t chunks = signatureChunks.size();
+    if (chunks <= kPoseidonMaxInputs || chunks > 2 * kPoseidonMaxInputs || bitsPerChunk == 0 || 2 * bitsPerChunk >= 251)
+        return false;
+
+    FieldElement shift = fieldFromUint(1);
+    for (unsigned i = 0; i < bitsPerChunk; ++i)
+        shift = fieldAdd(shift, shift);
+
+    std::vector<FieldElement> merged((chunks + 1) / 2);
+    for (std::size_t i = 0; i < merged.size(); ++i)
+    {
+        merged[i] = signatureChunks[2 * i];
+        if (2 * i + 1 < chunks)
+            merged[i] = fieldAdd(merged[i], fieldMul(shift, signatureChunks[2 * i + 1]));
+    }
+    FieldElement signatureHash = poseidonHash(merged);
+    nullifier = poseidonHash(&signatureHash, 1);
+    return true;
+}
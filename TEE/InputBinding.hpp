@@ -0,0 +1,63 @@
+#ifndef INPUTBINDING_HPP
+#define INPUTBINDING_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "Offer.hpp"
+#include "Poseidon.hpp"
+
+// Where the email circuit (circom/email-verifier-with-keywords.circom) puts
+// the signals an offer must agree with. The public signals are the
+// circuit's outputs in declaration order; the sizes are the parameters
+// circom/email_circuit.circom instantiates it with.
+struct CircuitLayout
+{
+    std::size_t maxHeadersLength = 512;
+    std::size_t maxBodyLength = 64;
+    std::size_t maxKeywords = 1;
+    std::size_t maxKeywordLen = 16;
+
+    // pubkeyHash, maskedHeader[], maskedBody[], allKeywordsPresent, nullifier, keywordCommitment
+    std::size_t allKeywordsPresentIndex() const { return 1 + maxHeadersLength + maxBodyLength; }
+    std::size_t nullifierIndex() const { return allKeywordsPresentIndex() + 1; }
+    std::size_t keywordCommitmentIndex() const { return nullifierIndex() + 1; }
+    std::size_t signalCount() const { return keywordCommitmentIndex() + 1; }
+
+    std::size_t chunksPerKeyword() const { return (maxKeywordLen + 30) / 31; }
+    // Poseidon inputs of the keyword commitment: numKeywords, then every keyword slot.
+    std::size_t commitmentInputs() const { return 1 + maxKeywords * chunksPerKeyword(); }
+};
+
+// "512,64,1,16": maxHeadersLength, maxBodyLength, maxKeywords, maxKeywordLen.
+bool parseCircuitLayout(const std::string &text, CircuitLayout &layout);
+
+// What an offer's own fields say its proof's public signals must be.
+struct OfferBinding
+{
+    FieldElement keywordCommitment;
+    FieldElement nullifier;
+};
+
+// Poseidon inputs for verifiedKeywords, as the circuit hashes its keyword
+// inputs: the count, then each slot zero-padded to maxKeywordLen bytes and
+// packed 31 bytes per element, little-endian; unused slots are zero.
+bool encodeKeywords(const std::vector<std::string> &keywords, const CircuitLayout &layout,
+                    FieldElement *inputs, std::string &error);
+
+bool computeBinding(const Offer &offer, const CircuitLayout &layout, OfferBinding &binding, std::string &error);
+// The same for many offers, hashing their commitments in one batch.
+// errors[i] is empty when bindings[i] was computed.
+void computeBindings(const std::vector<const Offer *> &offers, const CircuitLayout &layout,
+                     std::vector<OfferBinding> &bindings, std::vector<std::string> &errors);
+
+// signals are the proof's public signals as decimal strings.
+bool checkBinding(const std::vector<std::string> &signals, const CircuitLayout &layout,
+                  const OfferBinding &binding, std::string &error);
+
+// zk-email's EmailNullifier: Poseidon(1) of PoseidonLarge over the DKIM
+// signature limbs (17..32 limbs of bitsPerChunk bits, merged in pairs).
+// For clients that hold the signature and compute the nullifier they submit.
+bool emailNullifier(const std::vector<FieldElement> &signatureChunks, unsigned bitsPerChunk, FieldElement &nullifier);
+
+#endif // INPUTBINDING_HPP
@@ -0,0 +1,726 @@
+#include "KeywordIndex.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+
+// Price bands: 64 per doubling of (1 + reservePrice), the last one open-ended.
+static constexpr std::uint32_t kPriceBands = 2048;
+// Storage time bands of 2^26 us (about 67 s).
+static constexpr unsigned kTimeBandShift = 26;
+// Up to this many matches (or 8x the limit) are ranked without the bands.
+static constexpr std::size_t kDirectRanking = 8192;
+// An AND whose rarest keyword has at most this many documents in a chunk
+// probes them instead of combining blocks.
+static constexpr std::size_t kProbeMax = 64;
+
+static constexpr std::size_t kWords = KeywordIndex::kBlockWords;
+
+static std::uint32_t priceBandOf(double price)
+{
+    if (!(price > 0))
+        return 0;
+    double band = std::log2(1 + price) * 64;
+    return band >= kPriceBands - 1 ? kPriceBands - 1 : static_cast<std::uint32_t>(band);
+}
+
+/************************* Block operations ************************/
+// 64-word blocks; the loops vectorize, and the AVX2 clones are chosen at
+// load time on CPUs that have it.
+
+__attribute__((target_clones("avx2", "default")))
+static void andBlock(std::uint64_t *__restrict out, const std::uint64_t *__restrict in)
+{
+    for (std::size_t i = 0; i < kWords; ++i)
+        out[i] &= in[i];
+}
+
+__attribute__((target_clones("avx2", "default")))
+static void orBlock(std::uint64_t *__restrict out, const std::uint64_t *__restrict in)
+{
+    for (std::size_t i = 0; i < kWords; ++i)
+        out[i] |= in[i];
+}
+
+__attribute__((target_clones("avx2", "default")))
+static void andNotBlock(std::uint64_t *__restrict out, const std::uint64_t *__restrict in)
+{
+    for (std::size_t i = 0; i < kWords; ++i)
+        out[i] &= ~in[i];
+}
+
+__attribute__((target_clones("avx2", "default")))
+static bool emptyBlock(const std::uint64_t *in)
+{
+    std::uint64_t any = 0;
+    for (std::size_t i = 0; i < kWords; ++i)
+        any |= in[i];
+    return any == 0;
+}
+
+__attribute__((target_clones("popcnt", "default")))
+static std::size_t popcountBlock(const std::uint64_t *in)
+{
+    std::size_t n = 0;
+    for (std::size_t i = 0; i < kWords; ++i)
+        n += static_cast<std::size_t>(__builtin_popcountll(in[i]));
+    return n;
+}
+
+const char *queryRankName(QueryRank rank)
+{
+    switch (rank)
+    {
+    case QueryRank::Recent:
+        return "recent";
+    case QueryRank::PriceLow:
+        return "price";
+    case QueryRank::PriceHigh:
+        return "price_desc";
+    }
+    return "recent";
+}
+
+bool parseQueryRank(const std::string &name, QueryRank &rank)
+{
+    if (name == "recent")
+        rank = QueryRank::Recent;
+    else if (name == "price")
+        rank = QueryRank::PriceLow;
+    else if (name == "price_desc")
+        rank = QueryRank::PriceHigh;
+    else
+        return false;
+    return true;
+}
+
+/************************* Postings ************************/
+
+bool KeywordIndex::Container::contains(std::uint16_t low) const
+{
+    if (!bits.empty())
+        return (bits[low >> 6] >> (low & 63)) & 1;
+    return std::binary_search(array.begin(), array.end(), low);
+}
+
+bool KeywordIndex::Container::add(std::uint16_t low)
+{
+    if (!bits.empty())
+    {
+        std::uint64_t mask = 1ull << (low & 63);
+        if (bits[low >> 6] & mask)
+            return false;
+        bits[low >> 6] |= mask;
+        ++count;
+        return true;
+    }
+    auto it = std::lower_bound(array.begin(), array.end(), low);
+    if (it != array.end() && *it == low)
+        return false;
+    array.insert(it, low);
+    ++count;
+    if (array.size() > kArrayMax)
+    {
+        bits.assign(kWords, 0);
+        for (std::uint16_t v : array)
+            bits[v >> 6] |= 1ull << (v & 63);
+        array = std::vector<std::uint16_t>();
+    }
+    return true;
+}
+
+bool KeywordIndex::Container::remove(std::uint16_t low)
+{
+    if (bits.empty())
+    {
+        auto it = std::lower_bound(array.begin(), array.end(), low);
+        if (it == array.end() || *it != low)
+            return false;
+        array.erase(it);
+        --count;
+        return true;
+    }
+    std::uint64_t mask = 1ull << (low & 63);
+    if (!(bits[low >> 6] & mask))
+        return false;
+    bits[low >> 6] &= ~mask;
+    --count;
+    // Back to an array well below the threshold, so a chunk hovering
+    // around it does not flip on every change.
+    if (count < kArrayMax / 2)
+    {
+        array.clear();
+        for (std::size_t w = 0; w < kWords; ++w)
+        {
+            for (std::uint64_t word = bits[w]; word; word &= word - 1)
+                array.push_back(static_cast<std::uint16_t>(w * 64 + __builtin_ctzll(word)));
+        }
+        bits = std::vector<std::uint64_t>();
+    }
+    return true;
+}
+
+const KeywordIndex::Container *KeywordIndex::PostingSet::find(std::uint32_t chunk) const
+{
+    auto it = std::lower_bound(chunks.begin(), chunks.end(), chunk,
+                               [](const Container &c, std::uint32_t id) { return c.chunk < id; });
+    return it != chunks.end() && it->chunk == chunk ? &*it : nullptr;
+}
+
+void KeywordIndex::PostingSet::add(std::uint32_t doc)
+{
+    std::uint32_t chunk = doc >> kChunkShift;
+    auto it = std::lower_bound(chunks.begin(), chunks.end(), chunk,
+                               [](const Container &c, std::uint32_t id) { return c.chunk < id; });
+    if (it == chunks.end() || it->chunk != chunk)
+    {
+        it = chunks.insert(it, Container());
+        it->chunk = chunk;
+    }
+    count += it->add(static_cast<std::uint16_t>(doc & (kChunkDocs - 1)));
+}
+
+void KeywordIndex::PostingSet::remove(std::uint32_t doc)
+{
+    std::uint32_t chunk = doc >> kChunkShift;
+    auto it = std::lower_bound(chunks.begin(), chunks.end(), chunk,
+                               [](const Container &c, std::uint32_t id) { return c.chunk < id; });
+    if (it == chunks.end() || it->chunk != chunk)
+        return;
+    count -= it->remove(static_cast<std::uint16_t>(doc & (kChunkDocs - 1)));
+    if (it->count == 0)
+        chunks.erase(it);
+}
+
+/************************* Maintenance ************************/
+
+KeywordIndex::KeywordIndex() : priceBands_(kPriceBands)
+{
+}
+
+void KeywordIndex::linkRankLocked(std::uint32_t doc)
+{
+    Document &d = docs_[doc];
+    d.priceBand = priceBandOf(keys_[doc].reservePrice);
+    d.timeBand = keys_[doc].storedAtUs >> kTimeBandShift;
+    priceBands_[d.priceBand].add(doc);
+    timeBands_[d.timeBand].add(doc);
+}
+
+void KeywordIndex::unlinkRankLocked(std::uint32_t doc)
+{
+    const Document &d = docs_[doc];
+    priceBands_[d.priceBand].remove(doc);
+    auto band = timeBands_.find(d.timeBand);
+    band->second.remove(doc);
+    if (band->second.count == 0)
+        timeBands_.erase(band);
+}
+
+void KeywordIndex::linkLocked(std::uint32_t doc)
+{
+    for (const auto &keyword : docs_[doc].keywords)
+        keywords_[keyword].add(doc);
+    live_.add(doc);
+    linkRankLocked(doc);
+}
+
+void KeywordIndex::unlinkLocked(std::uint32_t doc)
+{
+    for (const auto &keyword : docs_[doc].keywords)
+    {
+        auto it = keywords_.find(keyword);
+        it->second.remove(doc);
+        if (it->second.count == 0)
+            keywords_.erase(it);
+    }
+    live_.remove(doc);
+    unlinkRankLocked(doc);
+}
+
+void KeywordIndex::put(const std::string &offerId, const std::vector<std::string> &keywords, double reservePrice,
+                       std::int64_t storedAtUs)
+{
+    std::vector<std::string> sorted(keywords);
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+    std::unique_lock<std::shared_mutex> lock(mtx_);
+    auto it = docOf_.find(offerId);
+    if (it != docOf_.end())
+    {
+        // Financial updates keep the keywords; only the rank bands move.
+        std::uint32_t doc = it->second;
+        Document &d = docs_[doc];
+        if (d.keywords == sorted)
+        {
+            unlinkRankLocked(doc);
+            keys_[doc] = RankKeys{reservePrice, storedAtUs};
+            linkRankLocked(doc);
+            return;
+        }
+        unlinkLocked(doc);
+        d.keywords = std::move(sorted);
+        keys_[doc] = RankKeys{reservePrice, storedAtUs};
+        linkLocked(doc);
+        return;
+    }
+
+    std::uint32_t doc;
+    if (!freeDocs_.empty())
+    {
+        doc = freeDocs_.back();
+        freeDocs_.pop_back();
+    }
+    else
+    {
+        doc = static_cast<std::uint32_t>(docs_.size());
+        docs_.emplace_back();
+        keys_.emplace_back();
+    }
+    Document &d = docs_[doc];
+    d.offerId = offerId;
+    d.keywords = std::move(sorted);
+    keys_[doc] = RankKeys{reservePrice, storedAtUs};
+    docOf_.emplace(offerId, doc);
+    linkLocked(doc);
+}
+
+void KeywordIndex::remove(const std::string &offerId)
+{
+    std::unique_lock<std::shared_mutex> lock(mtx_);
+    auto it = docOf_.find(offerId);
+    if (it == docOf_.end())
+        return;
+    std::uint32_t doc = it->second;
+    unlinkLocked(doc);
+    docs_[doc] = Document();
+    freeDocs_.push_back(doc);
+    docOf_.erase(it);
+}
+
+void KeywordIndex::clear()
+{
+    std::unique_lock<std::shared_mutex> lock(mtx_);
+    docs_.clear();
+    keys_.clear();
+    freeDocs_.clear();
+    docOf_.clear();
+    keywords_.clear();
+    live_ = PostingSet();
+    priceBands_.assign(kPriceBands, PostingSet());
+    timeBands_.clear();
+}
+
+std::size_t KeywordIndex::size() const
+{
+    std::shared_lock<std::shared_mutex> lock(mtx_);
+    return docOf_.size();
+}
+
+std::size_t KeywordIndex::keywordCount() const
+{
+    std::shared_lock<std::shared_mutex> lock(mtx_);
+    return keywords_.size();
+}
+
+/************************* Query execution ************************/
+
+// The query compiled against the index: each node knows its postings or
+// how it combines its children, and has its own block of scratch space.
+struct KeywordIndex::Plan
+{
+    struct Step
+    {
+        QueryNode::Kind kind = QueryNode::Kind::Term;
+        const PostingSet *postings = nullptr; // Term; null if no offer has the keyword
+        std::vector<std::uint32_t> positives; // And: rarest first; Or: every child; Not: the child
+        std::vector<std::uint32_t> negatives; // And: children under a NOT
+        std::size_t estimate = 0;             // upper bound on matches
+    };
+
+    const KeywordIndex &index;
+    std::vector<Step> steps;
+    std::vector<std::uint64_t> scratch;
+    std::vector<const Container *> current; // each Term's container in the chunk being evaluated
+
+    Plan(const KeywordIndex &idx, const KeywordQuery &query)
+        : index(idx), steps(query.nodes.size()), scratch(query.nodes.size() * kWords), current(query.nodes.size())
+    {
+        std::size_t all = index.live_.count;
+        for (std::size_t i = 0; i < query.nodes.size(); ++i)
+        {
+            const QueryNode &node = query.nodes[i];
+            Step &step = steps[i];
+            step.kind = node.kind;
+            switch (node.kind)
+            {
+            case QueryNode::Kind::Term:
+            {
+                auto it = index.keywords_.find(node.keyword);
+                step.postings = it == index.keywords_.end() ? nullptr : &it->second;
+                step.estimate = step.postings ? step.postings->count : 0;
+                break;
+            }
+            case QueryNode::Kind::Not:
+                step.positives = node.children;
+                step.estimate = all;
+                break;
+            case QueryNode::Kind::Or:
+                step.positives = node.children;
+                for (std::uint32_t child : node.children)
+                    step.estimate += steps[child].estimate;
+                step.estimate = std::min(step.estimate, all);
+                break;
+            case QueryNode::Kind::And:
+                for (std::uint32_t child : node.children)
+                {
+                    if (steps[child].kind == QueryNode::Kind::Not)
+                        step.negatives.push_back(steps[child].positives[0]);
+                    else
+                        step.positives.push_back(child);
+                }
+                std::sort(step.positives.begin(), step.positives.end(),
+                          [&](std::uint32_t a, std::uint32_t b) { return steps[a].estimate < steps[b].estimate; });
+                step.estimate = step.positives.empty() ? all : steps[step.positives[0]].estimate;
+                break;
+            }
+        }
+    }
+
+    std::uint64_t *block(std::uint32_t node) { return scratch.data() + node * kWords; }
+
+    static void load(const Container &c, std::uint64_t *out)
+    {
+        if (!c.bits.empty())
+        {
+            std::memcpy(out, c.bits.data(), kWords * sizeof(std::uint64_t));
+            return;
+        }
+        std::memset(out, 0, kWords * sizeof(std::uint64_t));
+        for (std::uint16_t v : c.array)
+            out[v >> 6] |= 1ull << (v & 63);
+    }
+
+    // out &= c, walking the array instead of expanding it.
+    static void intersect(std::uint64_t *out, const Container &c, std::uint64_t *tmp)
+    {
+        if (!c.bits.empty())
+        {
+            andBlock(out, c.bits.data());
+            return;
+        }
+        std::memset(tmp, 0, kWords * sizeof(std::uint64_t));
+        for (std::uint16_t v : c.array)
+            tmp[v >> 6] |= out[v >> 6] & (1ull << (v & 63));
+        std::memcpy(out, tmp, kWords * sizeof(std::uint64_t));
+    }
+
+    bool loadLive(std::uint32_t chunk, std::uint64_t *out) const
+    {
+        const Container *c = index.live_.find(chunk);
+        if (!c)
+            return false;
+        load(*c, out);
+        return true;
+    }
+
+    // Chunks that may hold a match, ascending.
+    std::vector<std::uint32_t> candidateChunks(std::uint32_t node) const
+    {
+        const Step &step = steps[node];
+        std::vector<std::uint32_t> out;
+        const PostingSet *drive = nullptr;
+        if (step.kind == QueryNode::Kind::Term)
+            drive = step.postings;
+        else if (step.kind == QueryNode::Kind::Not || (step.kind == QueryNode::Kind::And && step.positives.empty()))
+            drive = &index.live_;
+        else if (step.kind == QueryNode::Kind::And)
+            return candidateChunks(step.positives[0]);
+        else
+        {
+            for (std::uint32_t child : step.positives)
+            {
+                std::vector<std::uint32_t> more = candidateChunks(child), merged;
+                std::set_union(out.begin(), out.end(), more.begin(), more.end(), std::back_inserter(merged));
+                out.swap(merged);
+            }
+            return out;
+        }
+        if (drive)
+        {
+            for (const auto &c : drive->chunks)
+                out.push_back(c.chunk);
+        }
+        return out;
+    }
+
+    // Looks up every keyword's container in chunk, for eval and contains.
+    void enter(std::uint32_t chunk)
+    {
+        for (std::size_t i = 0; i < steps.size(); ++i)
+        {
+            if (steps[i].kind == QueryNode::Kind::Term)
+                current[i] = steps[i].postings ? steps[i].postings->find(chunk) : nullptr;
+        }
+    }
+
+    // Whether a live document of the current chunk matches node.
+    bool contains(std::uint32_t node, std::uint16_t low) const
+    {
+        const Step &step = steps[node];
+        switch (step.kind)
+        {
+        case QueryNode::Kind::Term:
+            return current[node] && current[node]->contains(low);
+        case QueryNode::Kind::Not:
+            return !contains(step.positives[0], low);
+        case QueryNode::Kind::Or:
+            return std::any_of(step.positives.begin(), step.positives.end(),
+                               [&](std::uint32_t child) { return contains(child, low); });
+        case QueryNode::Kind::And:
+            return std::all_of(step.positives.begin(), step.positives.end(),
+                               [&](std::uint32_t child) { return contains(child, low); }) &&
+                   std::none_of(step.negatives.begin(), step.negatives.end(),
+                                [&](std::uint32_t child) { return contains(child, low); });
+        }
+        return false;
+    }
+
+    // Fills out with the node's matches in the current chunk; false means
+    // none (out is then unspecified).
+    bool eval(std::uint32_t node, std::uint32_t chunk, std::uint64_t *out)
+    {
+        const Step &step = steps[node];
+        switch (step.kind)
+        {
+        case QueryNode::Kind::Term:
+        {
+            const Container *c = current[node];
+            if (!c)
+                return false;
+            load(*c, out);
+            return true;
+        }
+        case QueryNode::Kind::Not:
+        {
+            if (!loadLive(chunk, out))
+                return false;
+            std::uint64_t *tmp = block(step.positives[0]);
+            if (eval(step.positives[0], chunk, tmp))
+                andNotBlock(out, tmp);
+            return !emptyBlock(out);
+        }
+        case QueryNode::Kind::Or:
+        {
+            bool any = false;
+            for (std::uint32_t child : step.positives)
+            {
+                std::uint64_t *tmp = any ? block(child) : out;
+                if (!eval(child, chunk, tmp))
+                    continue;
+                if (any)
+                    orBlock(out, tmp);
+                any = true;
+            }
+            return any;
+        }
+        case QueryNode::Kind::And:
+        {
+            // A rarest keyword with few documents here: probe each of them.
+            if (!step.positives.empty() && steps[step.positives[0]].kind == QueryNode::Kind::Term)
+            {
+                const Container *driver = current[step.positives[0]];
+                if (!driver)
+                    return false;
+                if (driver->bits.empty() && driver->array.size() <= kProbeMax)
+                {
+                    std::memset(out, 0, kWords * sizeof(std::uint64_t));
+                    bool any = false;
+                    auto others = [&](std::uint16_t low) {
+                        return std::all_of(step.positives.begin() + 1, step.positives.end(),
+                                           [&](std::uint32_t child) { return contains(child, low); }) &&
+                               std::none_of(step.negatives.begin(), step.negatives.end(),
+                                            [&](std::uint32_t child) { return contains(child, low); });
+                    };
+                    for (std::uint16_t low : driver->array)
+                    {
+                        if (others(low))
+                        {
+                            out[low >> 6] |= 1ull << (low & 63);
+                            any = true;
+                        }
+                    }
+                    return any;
+                }
+            }
+
+            if (step.positives.empty() ? !loadLive(chunk, out) : !eval(step.positives[0], chunk, out))
+                return false;
+            for (std::size_t i = 1; i < step.positives.size(); ++i)
+            {
+                std::uint32_t child = step.positives[i];
+                std::uint64_t *tmp = block(child);
+                if (steps[child].kind == QueryNode::Kind::Term)
+                {
+                    const Container *c = current[child];
+                    if (!c)
+                        return false;
+                    intersect(out, *c, tmp);
+                }
+                else
+                {
+                    if (!eval(child, chunk, tmp))
+                        return false;
+                    andBlock(out, tmp);
+                }
+                if (emptyBlock(out))
+                    return false;
+            }
+            for (std::uint32_t child : step.negatives)
+            {
+                std::uint64_t *tmp = block(child);
+                if (eval(child, chunk, tmp))
+                    andNotBlock(out, tmp);
+            }
+            return !emptyBlock(out);
+        }
+        }
+        return false;
+    }
+};
+
+QueryResult KeywordIndex::search(const KeywordQuery &query, QueryRank rank, std::size_t limit) const
+{
+    QueryResult result;
+    if (query.nodes.empty())
+        return result;
+    limit = std::min(limit, kMaxLimit);
+
+    std::shared_lock<std::shared_mutex> lock(mtx_);
+    Plan plan(*this, query);
+
+    // Matching blocks of every chunk that has any.
+    std::vector<std::uint32_t> hitChunks;
+    std::vector<std::uint64_t> hitBits;
+    std::vector<std::uint64_t> block(kWords);
+    for (std::uint32_t chunk : plan.candidateChunks(query.root))
+    {
+        plan.enter(chunk);
+        if (!plan.eval(query.root, chunk, block.data()))
+            continue;
+        std::size_t n = popcountBlock(block.data());
+        if (n == 0)
+            continue;
+        result.total += n;
+        hitChunks.push_back(chunk);
+        hitBits.insert(hitBits.end(), block.begin(), block.end());
+    }
+    if (result.total == 0 || limit == 0)
+        return result;
+
+    // Higher score ranks first, ties to the lower document number. The heap
+    // keeps the worst of the best limit on top.
+    auto score = [&](std::uint32_t doc) {
+        const RankKeys &k = keys_[doc];
+        if (rank == QueryRank::Recent)
+            return static_cast<double>(k.storedAtUs);
+        return rank == QueryRank::PriceLow ? -k.reservePrice : k.reservePrice;
+    };
+    using Entry = std::pair<double, std::uint32_t>;
+    auto better = [](const Entry &a, const Entry &b) { return a.first > b.first || (a.first == b.first && a.second < b.second); };
+    std::vector<Entry> heap;
+    heap.reserve(limit + 1);
+    auto offer = [&](std::uint32_t doc) {
+        Entry entry{score(doc), doc};
+        if (heap.size() < limit)
+        {
+            heap.push_back(entry);
+            std::push_heap(heap.begin(), heap.end(), better);
+        }
+        else if (better(entry, heap.front()))
+        {
+            std::pop_heap(heap.begin(), heap.end(), better);
+            heap.back() = entry;
+            std::push_heap(heap.begin(), heap.end(), better);
+        }
+    };
+
+    if (result.total <= std::max(kDirectRanking, limit * 8))
+    {
+        for (std::size_t i = 0; i < hitChunks.size(); ++i)
+        {
+            const std::uint64_t *words = &hitBits[i * kWords];
+            for (std::size_t w = 0; w < kWords; ++w)
+            {
+                for (std::uint64_t word = words[w]; word; word &= word - 1)
+                    offer((hitChunks[i] << kChunkShift) | static_cast<std::uint32_t>(w * 64 + __builtin_ctzll(word)));
+            }
+        }
+    }
+    else
+    {
+        // Every document of a later band ranks below every document of an
+        // earlier one, so a full heap after a whole band is final.
+        auto takeBand = [&](const PostingSet &band) {
+            for (const Container &c : band.chunks)
+            {
+                auto it = std::lower_bound(hitChunks.begin(), hitChunks.end(), c.chunk);
+                if (it == hitChunks.end() || *it != c.chunk)
+                    continue;
+                const std::uint64_t *words = &hitBits[static_cast<std::size_t>(it - hitChunks.begin()) * kWords];
+                std::uint32_t base = c.chunk << kChunkShift;
+                if (!c.bits.empty())
+                {
+                    for (std::size_t w = 0; w < kWords; ++w)
+                    {
+                        for (std::uint64_t word = words[w] & c.bits[w]; word; word &= word - 1)
+                            offer(base | static_cast<std::uint32_t>(w * 64 + __builtin_ctzll(word)));
+                    }
+                }
+                else
+                {
+                    for (std::uint16_t v : c.array)
+                    {
+                        if (words[v >> 6] & (1ull << (v & 63)))
+                            offer(base | v);
+                    }
+                }
+            }
+            return heap.size() >= limit;
+        };
+        if (rank == QueryRank::Recent)
+        {
+            for (auto it = timeBands_.rbegin(); it != timeBands_.rend(); ++it)
+            {
+                if (takeBand(it->second))
+                    break;
+            }
+        }
+        else if (rank == QueryRank::PriceLow)
+        {
+            for (std::uint32_t b = 0; b < kPriceBands; ++b)
+            {
+                if (takeBand(priceBands_[b]))
+                    break;
+            }
+        }
+        else
+        {
+            for (std::uint32_t b = kPriceBands; b-- > 0;)
+            {
+                if (takeBand(priceBands_[b]))
+                    break;
+            }
+        }
+    }
+
+    std::sort_heap(heap.begin(), heap.end(), better);
+    result.hits.reserve(heap.size());
+    for (const auto &entry : heap)
+    {
+        result.hits.push_back(
+            QueryHit{docs_[entry.second].offerId, keys_[entry.second].reservePrice, keys_[entry.second].storedAtUs});
+    }
+    return result;
+}
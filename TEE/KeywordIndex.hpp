@@ -0,0 +1,134 @@
+#ifndef KEYWORDINDEX_HPP
+#define KEYWORDINDEX_HPP
+
+#include <cstdint>
+#include <map>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "KeywordQuery.hpp"
+
+enum class QueryRank
+{
+    Recent,   // newest stored first
+    PriceLow, // lowest reservePrice first
+    PriceHigh
+};
+
+const char *queryRankName(QueryRank rank);
+bool parseQueryRank(const std::string &name, QueryRank &rank);
+
+struct QueryHit
+{
+    std::string offerId;
+    double reservePrice = 0;
+    std::int64_t storedAtUs = 0;
+};
+
+struct QueryResult
+{
+    std::size_t total = 0;       // offers matching the query
+    std::vector<QueryHit> hits;  // the best limit of them, in rank order
+};
+
+// Inverted index from verifiedKeywords to the offers carrying them, for
+// boolean queries ranked by price or recency.
+//
+// Offers get dense document numbers, split into chunks of 4096. In each
+// chunk a keyword's documents are a sorted array while there are few of
+// them and a 4096-bit bitmap beyond that, so a query is evaluated chunk by
+// chunk with word-wise AND / OR / AND NOT over 64-word blocks (compiled
+// for AVX2 as well and picked at load time). Only chunks that can hold a
+// match are visited, driven by the rarest keyword an AND requires, and an
+// AND stops as soon as its block is empty; when that keyword has only a
+// few documents in the chunk, they are probed one by one instead.
+//
+// Ranking does not sort the matches: documents are also indexed by price
+// band and by storage time band, and the top-k heap walks the bands best
+// first, stopping once a whole band has been taken with the heap full.
+// Small match sets skip the bands and go straight to the heap.
+class KeywordIndex
+{
+public:
+    static constexpr std::size_t kMaxLimit = 1000;
+    static constexpr unsigned kChunkShift = 12;
+    static constexpr std::uint32_t kChunkDocs = 1u << kChunkShift;
+    static constexpr std::size_t kBlockWords = kChunkDocs / 64;
+
+private:
+    static constexpr std::size_t kArrayMax = 256; // an array this long takes as much room as a bitmap
+
+    // The documents of one chunk, as a sorted array or a bitmap.
+    struct Container
+    {
+        std::uint32_t chunk = 0;
+        std::uint32_t count = 0;
+        std::vector<std::uint16_t> array;
+        std::vector<std::uint64_t> bits; // kBlockWords words in bitmap form, else empty
+
+        bool contains(std::uint16_t low) const;
+        // Return whether the document was added / removed.
+        bool add(std::uint16_t low);
+        bool remove(std::uint16_t low);
+    };
+
+    // Documents of one keyword or band, chunks in ascending order.
+    struct PostingSet
+    {
+        std::vector<Container> chunks;
+        std::size_t count = 0;
+
+        const Container *find(std::uint32_t chunk) const;
+        void add(std::uint32_t doc);
+        void remove(std::uint32_t doc);
+    };
+
+    struct Document
+    {
+        std::string offerId; // empty when the number is free
+        std::vector<std::string> keywords;
+        std::uint32_t priceBand = 0;
+        std::int64_t timeBand = 0;
+    };
+
+    // Kept apart from Document so ranking reads a dense array.
+    struct RankKeys
+    {
+        double reservePrice = 0;
+        std::int64_t storedAtUs = 0;
+    };
+
+    struct Plan;
+
+    mutable std::shared_mutex mtx_;
+    std::vector<Document> docs_;
+    std::vector<RankKeys> keys_;
+    std::vector<std::uint32_t> freeDocs_;
+    std::unordered_map<std::string, std::uint32_t> docOf_;
+    std::unordered_map<std::string, PostingSet> keywords_;
+    PostingSet live_;
+    std::vector<PostingSet> priceBands_;
+    std::map<std::int64_t, PostingSet> timeBands_;
+
+    void linkLocked(std::uint32_t doc);
+    void unlinkLocked(std::uint32_t doc);
+    void linkRankLocked(std::uint32_t doc);
+    void unlinkRankLocked(std::uint32_t doc);
+
+public:
+    KeywordIndex();
+
+    // Adds or replaces an offer.
+    void put(const std::string &offerId, const std::vector<std::string> &keywords, double reservePrice,
+             std::int64_t storedAtUs);
+    void remove(const std::string &offerId);
+    void clear();
+
+    QueryResult search(const KeywordQuery &query, QueryRank rank, std::size_t limit) const;
+
+    std::size_t size() const;
+    std::size_t keywordCount() const;
+};
+
+#endif // KEYWORDINDEX_HPP
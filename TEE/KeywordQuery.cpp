@@ -0,0 +1,232 @@
+#include "KeywordQuery.hpp"
+#include <cctype>
+
+namespace
+{
+struct Token
+{
+    enum class Kind
+    {
+        Word,
+        Quoted,
+        Open,
+        Close,
+        End
+    };
+    Kind kind;
+    std::string text;
+};
+
+class Parser
+{
+private:
+    std::vector<Token> tokens_;
+    std::size_t pos_ = 0;
+    std::size_t depth_ = 0;
+    std::size_t terms_ = 0;
+    KeywordQuery &query_;
+    std::string &error_;
+
+    const Token &peek() const { return tokens_[pos_]; }
+    bool isOperator(const char *op) const { return peek().kind == Token::Kind::Word && peek().text == op; }
+
+    std::uint32_t add(QueryNode node)
+    {
+        query_.nodes.push_back(std::move(node));
+        return static_cast<std::uint32_t>(query_.nodes.size() - 1);
+    }
+
+    // Children of the same kind are spliced in, so A AND (B AND C) has three children.
+    std::uint32_t combine(QueryNode::Kind kind, const std::vector<std::uint32_t> &parts)
+    {
+        if (parts.size() == 1)
+            return parts[0];
+        QueryNode node;
+        node.kind = kind;
+        for (std::uint32_t part : parts)
+        {
+            const QueryNode &child = query_.nodes[part];
+            if (child.kind == kind)
+                node.children.insert(node.children.end(), child.children.begin(), child.children.end());
+            else
+                node.children.push_back(part);
+        }
+        return add(std::move(node));
+    }
+
+    bool parseOr(std::uint32_t &out)
+    {
+        std::vector<std::uint32_t> parts(1);
+        if (!parseAnd(parts[0]))
+            return false;
+        while (isOperator("OR"))
+        {
+            ++pos_;
+            parts.emplace_back();
+            if (!parseAnd(parts.back()))
+                return false;
+        }
+        out = combine(QueryNode::Kind::Or, parts);
+        return true;
+    }
+
+    bool parseAnd(std::uint32_t &out)
+    {
+        std::vector<std::uint32_t> parts(1);
+        if (!parseUnary(parts[0]))
+            return false;
+        for (;;)
+        {
+            if (isOperator("AND"))
+                ++pos_;
+            else if (peek().kind == Token::Kind::End || peek().kind == Token::Kind::Close || isOperator("OR"))
+                break;
+            parts.emplace_back();
+            if (!parseUnary(parts.back()))
+                return false;
+        }
+        out = combine(QueryNode::Kind::And, parts);
+        return true;
+    }
+
+    bool parseUnary(std::uint32_t &out)
+    {
+        if (++depth_ > kMaxQueryDepth)
+        {
+            error_ = "Query nested too deeply.";
+            return false;
+        }
+        bool ok = parseUnaryInner(out);
+        --depth_;
+        return ok;
+    }
+
+    bool parseUnaryInner(std::uint32_t &out)
+    {
+        const Token &token = peek();
+        if (isOperator("NOT"))
+        {
+            ++pos_;
+            std::uint32_t child;
+            if (!parseUnary(child))
+                return false;
+            if (query_.nodes[child].kind == QueryNode::Kind::Not)
+            {
+                out = query_.nodes[child].children[0];
+                return true;
+            }
+            QueryNode node;
+            node.kind = QueryNode::Kind::Not;
+            node.children.push_back(child);
+            out = add(std::move(node));
+            return true;
+        }
+        if (token.kind == Token::Kind::Open)
+        {
+            ++pos_;
+            if (!parseOr(out))
+                return false;
+            if (peek().kind != Token::Kind::Close)
+            {
+                error_ = "Missing closing parenthesis.";
+                return false;
+            }
+            ++pos_;
+            return true;
+        }
+        if (token.kind == Token::Kind::Quoted ||
+            (token.kind == Token::Kind::Word && !isOperator("AND") && !isOperator("OR")))
+        {
+            if (++terms_ > kMaxQueryTerms)
+            {
+                error_ = "At most " + std::to_string(kMaxQueryTerms) + " keywords per query.";
+                return false;
+            }
+            QueryNode node;
+            node.keyword = token.text;
+            ++pos_;
+            out = add(std::move(node));
+            return true;
+        }
+        error_ = token.kind == Token::Kind::End ? "Query ends too early." : "Unexpected '" + token.text + "' in query.";
+        return false;
+    }
+
+public:
+    Parser(std::vector<Token> tokens, KeywordQuery &query, std::string &error)
+        : tokens_(std::move(tokens)), query_(query), error_(error)
+    {
+    }
+
+    bool parse()
+    {
+        if (!parseOr(query_.root))
+            return false;
+        if (peek().kind != Token::Kind::End)
+        {
+            error_ = "Unexpected '" + peek().text + "' in query.";
+            return false;
+        }
+        return true;
+    }
+};
+
+bool tokenize(const std::string &text, std::vector<Token> &tokens, std::string &error)
+{
+    std::size_t i = 0;
+    while (i < text.size())
+    {
+        char c = text[i];
+        if (std::isspace(static_cast<unsigned char>(c)))
+        {
+            ++i;
+        }
+        else if (c == '(' || c == ')')
+        {
+            tokens.push_back(Token{c == '(' ? Token::Kind::Open : Token::Kind::Close, std::string(1, c)});
+            ++i;
+        }
+        else if (c == '"')
+        {
+            std::size_t close = text.find('"', i + 1);
+            if (close == std::string::npos)
+            {
+                error = "Unterminated quote in query.";
+                return false;
+            }
+            if (close == i + 1)
+            {
+                error = "Empty keyword in query.";
+                return false;
+            }
+            tokens.push_back(Token{Token::Kind::Quoted, text.substr(i + 1, close - i - 1)});
+            i = close + 1;
+        }
+        else
+        {
+            std::size_t end = i;
+            while (end < text.size() && !std::isspace(static_cast<unsigned char>(text[end])) && text[end] != '(' &&
+                   text[end] != ')' && text[end] != '"')
+                ++end;
+            tokens.push_back(Token{Token::Kind::Word, text.substr(i, end - i)});
+            i = end;
+        }
+    }
+    tokens.push_back(Token{Token::Kind::End, ""});
+    return true;
+}
+}
+
+bool parseKeywordQuery(const std::string &text, KeywordQuery &query, std::string &error)
+{
+    query = KeywordQuery();
+    if (text.size() > kMaxQueryLength)
+    {
+        error = "Query longer than " + std::to_string(kMaxQueryLength) + " bytes.";
+        return false;
+    }
+    std::vector<Token> tokens;
+    if (!tokenize(text, tokens, error))
+        return false;
+    return Parser(std::move(tokens), query, error).parse();
+}
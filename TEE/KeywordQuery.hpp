@@ -0,0 +1,47 @@
+#ifndef KEYWORDQUERY_HPP
+#define KEYWORDQUERY_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Boolean query over verifiedKeywords, e.g. (EPA OR DOJ) AND fine AND NOT settlement.
+//
+//   query   := or
+//   or      := and ("OR" and)*
+//   and     := unary (["AND"] unary)*     adjacent terms are ANDed
+//   unary   := "NOT" unary | "(" or ")" | keyword
+//   keyword := bare word, or "quoted" to allow spaces, parentheses and the
+//              operator words themselves
+//
+// Operators are upper case; keywords match exactly, as the proof binds them.
+struct QueryNode
+{
+    enum class Kind : std::uint8_t
+    {
+        Term,
+        And,
+        Or,
+        Not
+    };
+
+    Kind kind = Kind::Term;
+    std::string keyword;                 // Term
+    std::vector<std::uint32_t> children; // indices of earlier nodes
+};
+
+// Nodes are stored children first; root is the last one. Nested ANDs and
+// ORs are flattened and double negations removed.
+struct KeywordQuery
+{
+    std::vector<QueryNode> nodes;
+    std::uint32_t root = 0;
+};
+
+constexpr std::size_t kMaxQueryLength = 4096;
+constexpr std::size_t kMaxQueryTerms = 64;
+constexpr std::size_t kMaxQueryDepth = 32;
+
+bool parseKeywordQuery(const std::string &text, KeywordQuery &query, std::string &error);
+
+#endif // KEYWORDQUERY_HPP
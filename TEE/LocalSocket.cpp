@@ -0,0 +1,115 @@
+#include "LocalSocket.hpp"
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static sockaddr_un makeAddress(const std::string &path)
+{
+    sockaddr_un addr{};
+    if (path.size() >= sizeof(addr.sun_path))
+        throw std::runtime_error("Unix socket path too long: " + path);
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return addr;
+}
+
+int listenUnixSocket(const std::string &path)
+{
+    sockaddr_un addr = makeAddress(path);
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        throw std::runtime_error("Unable to create Unix socket: " + std::string(std::strerror(errno)));
+
+    ::unlink(path.c_str());
+    if (::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 || ::listen(fd, SOMAXCONN) < 0)
+    {
+        int err = errno;
+        ::close(fd);
+        throw std::runtime_error("Unable to listen on " + path + ": " + std::strerror(err));
+    }
+    return fd;
+}
+
+int connectUnixSocket(const std::string &path)
+{
+    sockaddr_un addr = makeAddress(path);
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        throw std::runtime_error("Unable to create Unix socket: " + std::string(std::strerror(errno)));
+
+    if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0)
+    {
+        int err = errno;
+        ::close(fd);
+        throw std::runtime_error("Unable to connect to " + path + ": " + std::strerror(err));
+    }
+    return fd;
+}
+
+bool sendLine(int fd, const std::string &line)
+{
+    std::string framed = line;
+    framed.push_back('\n');
+
+    std::size_t sent = 0;
+    while (sent < framed.size())
+    {
+        ssize_t n = ::send(fd, framed.data() + sent, framed.size() - sent, MSG_NOSIGNAL);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        sent += static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+LineReader::LineReader(int fd)
+    : fd_(fd)
+{
+}
+
+bool LineReader::readLine(std::string &line, int timeoutMs, bool &timedOut)
+{
+    timedOut = false;
+    char chunk[4096];
+    while (true)
+    {
+        auto pos = buffer_.find('\n');
+        if (pos != std::string::npos)
+        {
+            line.assign(buffer_, 0, pos);
+            buffer_.erase(0, pos + 1);
+            return true;
+        }
+
+        pollfd pfd{fd_, POLLIN, 0};
+        int ready = ::poll(&pfd, 1, timeoutMs);
+        if (ready == 0)
+        {
+            timedOut = true;
+            return false;
+        }
+        if (ready < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+
+        ssize_t n = ::recv(fd_, chunk, sizeof(chunk), 0);
+        if (n <= 0)
+        {
+            if (n < 0 && errno == EINTR)
+                continue;
+            return false;
+        }
+        buffer_.append(chunk, static_cast<std::size_t>(n));
+    }
+}
@@ -0,0 +1,29 @@
+#ifndef LOCALSOCKET_HPP
+#define LOCALSOCKET_HPP
+
+#include <string>
+
+// Thin POSIX helpers for newline-delimited messages over Unix domain sockets.
+// Setup failures throw std::runtime_error; I/O failures are reported as false.
+
+int listenUnixSocket(const std::string &path);
+
+int connectUnixSocket(const std::string &path);
+
+bool sendLine(int fd, const std::string &line);
+
+class LineReader
+{
+private:
+    int fd_;
+    std::string buffer_;
+
+public:
+    explicit LineReader(int fd);
+
+    // Returns false on EOF, error or when timeoutMs elapses without a full line
+    // (timedOut is set in the last case).
+    bool readLine(std::string &line, int timeoutMs, bool &timedOut);
+};
+
+#endif // LOCALSOCKET_HPP
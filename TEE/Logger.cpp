@@ -0,0 +1,263 @@
+#include "Logger.hpp"
+#include <cstdio>
+#include <ctime>
+
+namespace
+{
+constexpr std::size_t kMaxRecordsPerRing = 1024; // per drain pass, so one busy thread cannot starve the rest
+constexpr auto kIdleSleep = std::chrono::milliseconds(1);
+
+// Registers the thread's ring on first use and marks it retired when the
+// thread exits; the writer frees it once drained.
+struct ThreadRing
+{
+    std::shared_ptr<LogRing> ring;
+
+    ~ThreadRing()
+    {
+        if (ring)
+            ring->retired.store(true, std::memory_order_release);
+    }
+};
+
+thread_local ThreadRing threadRing_;
+
+void appendTimestamp(std::int64_t timeNs, std::string &out)
+{
+    std::time_t secs = static_cast<std::time_t>(timeNs / 1000000000);
+    std::tm tm{};
+    gmtime_r(&secs, &tm);
+    char buf[40];
+    std::size_t n = std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &tm);
+    std::snprintf(buf + n, sizeof(buf) - n, ".%06dZ", static_cast<int>(timeNs % 1000000000 / 1000));
+    out += buf;
+}
+
+// Appends the argument at pos and advances pos; false when the payload is exhausted.
+bool appendArg(const LogRecord &r, std::size_t &pos, std::string &out)
+{
+    if (pos >= r.payloadBytes)
+        return false;
+    char tag = r.payload[pos++];
+    const char *p = r.payload + pos;
+    switch (tag)
+    {
+    case 'i':
+    {
+        std::int64_t v;
+        std::memcpy(&v, p, sizeof(v));
+        out += std::to_string(v);
+        pos += sizeof(v);
+        return true;
+    }
+    case 'u':
+    {
+        std::uint64_t v;
+        std::memcpy(&v, p, sizeof(v));
+        out += std::to_string(v);
+        pos += sizeof(v);
+        return true;
+    }
+    case 'd':
+    {
+        double v;
+        std::memcpy(&v, p, sizeof(v));
+        char buf[32];
+        std::snprintf(buf, sizeof(buf), "%g", v);
+        out += buf;
+        pos += sizeof(v);
+        return true;
+    }
+    case 'b':
+    {
+        bool v;
+        std::memcpy(&v, p, sizeof(v));
+        out += v ? "true" : "false";
+        pos += sizeof(v);
+        return true;
+    }
+    case 's':
+    {
+        std::uint16_t len;
+        std::memcpy(&len, p, sizeof(len));
+        out.append(p + sizeof(len), len);
+        pos += sizeof(len) + len;
+        return true;
+    }
+    default:
+        pos = r.payloadBytes;
+        return false;
+    }
+}
+} // namespace
+
+const char *logLevelName(LogLevel level)
+{
+    switch (level)
+    {
+    case LogLevel::Debug:
+        return "DEBUG";
+    case LogLevel::Info:
+        return "INFO";
+    case LogLevel::Warn:
+        return "WARN";
+    case LogLevel::Error:
+        return "ERROR";
+    default:
+        return "OFF";
+    }
+}
+
+bool parseLogLevel(const std::string &name, LogLevel &level)
+{
+    static const std::pair<const char *, LogLevel> names[] = {
+        {"debug", LogLevel::Debug},
+        {"info", LogLevel::Info},
+        {"warn", LogLevel::Warn},
+        {"error", LogLevel::Error},
+        {"off", LogLevel::Off}};
+    for (const auto &n : names)
+    {
+        if (name == n.first)
+        {
+            level = n.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+Logger::Logger()
+{
+    writer_ = std::thread(&Logger::writerLoop, this);
+}
+
+Logger::~Logger()
+{
+    stopping_ = true;
+    if (writer_.joinable())
+        writer_.join();
+    flush();
+}
+
+Logger &Logger::instance()
+{
+    static Logger logger;
+    return logger;
+}
+
+LogRing *Logger::threadRing()
+{
+    if (!threadRing_.ring)
+    {
+        auto ring = std::make_shared<LogRing>();
+        std::lock_guard<std::mutex> lock(ringsMtx_);
+        rings_.push_back(ring);
+        threadRing_.ring = std::move(ring);
+    }
+    return threadRing_.ring.get();
+}
+
+void Logger::flush()
+{
+    std::lock_guard<std::mutex> lock(drainMtx_);
+    while (drainLocked() > 0)
+    {
+    }
+}
+
+void Logger::writerLoop()
+{
+    while (!stopping_)
+    {
+        std::size_t written;
+        {
+            std::lock_guard<std::mutex> lock(drainMtx_);
+            written = drainLocked();
+        }
+        if (written == 0)
+            std::this_thread::sleep_for(kIdleSleep);
+    }
+}
+
+std::size_t Logger::drainLocked()
+{
+    {
+        std::lock_guard<std::mutex> lock(ringsMtx_);
+        drainRings_ = rings_;
+    }
+
+    batch_.clear();
+    LogRecord record;
+    for (const auto &ring : drainRings_)
+    {
+        for (std::size_t i = 0; i < kMaxRecordsPerRing && ring->read(record); ++i)
+        {
+            batch_.push_back(record);
+        }
+    }
+    std::stable_sort(batch_.begin(), batch_.end(), [](const LogRecord &a, const LogRecord &b) {
+        return a.timeNs < b.timeNs;
+    });
+
+    out_.clear();
+    err_.clear();
+    for (const auto &r : batch_)
+    {
+        format(r, r.level >= LogLevel::Warn ? err_ : out_);
+    }
+    std::uint64_t dropped = dropped_.exchange(0, std::memory_order_relaxed);
+    if (dropped > 0)
+    {
+        appendTimestamp(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::system_clock::now().time_since_epoch())
+                            .count(),
+                        err_);
+        err_ += " WARN Logger: Dropped " + std::to_string(dropped) + " records, ring full\n";
+    }
+    if (!out_.empty())
+    {
+        std::fwrite(out_.data(), 1, out_.size(), stdout);
+        std::fflush(stdout);
+    }
+    if (!err_.empty())
+    {
+        std::fwrite(err_.data(), 1, err_.size(), stderr);
+        std::fflush(stderr);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(ringsMtx_);
+        rings_.erase(std::remove_if(rings_.begin(), rings_.end(),
+                                    [](const std::shared_ptr<LogRing> &ring) {
+                                        return ring->retired.load(std::memory_order_acquire) && ring->empty();
+                                    }),
+                     rings_.end());
+    }
+    drainRings_.clear();
+    return batch_.size();
+}
+
+void Logger::format(const LogRecord &r, std::string &out)
+{
+    appendTimestamp(r.timeNs, out);
+    out += ' ';
+    out += logLevelName(r.level);
+    out += ' ';
+    out += r.component;
+    out += ": ";
+
+    std::size_t pos = 0;
+    for (const char *f = r.format; *f != '\0'; ++f)
+    {
+        if (f[0] == '{' && f[1] == '}' && appendArg(r, pos, out))
+        {
+            ++f;
+            continue;
+        }
+        out += *f;
+    }
+    if (r.truncated)
+        out += " [truncated]";
+    out += '\n';
+}
@@ -0,0 +1,267 @@
+#ifndef LOGGER_HPP
+#define LOGGER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+enum class LogLevel : std::uint8_t
+{
+    Debug,
+    Info,
+    Warn,
+    Error,
+    Off
+};
+
+const char *logLevelName(LogLevel level);
+bool parseLogLevel(const std::string &name, LogLevel &level);
+
+// Calls below this level compile to nothing (-DTEE_LOG_MIN_LEVEL=1 drops Debug).
+#ifndef TEE_LOG_MIN_LEVEL
+#define TEE_LOG_MIN_LEVEL 0
+#endif
+
+constexpr bool logLevelCompiledIn(int level)
+{
+    return level >= TEE_LOG_MIN_LEVEL;
+}
+
+// Fixed-size binary record. The format string and component must be string
+// literals (only their pointers are stored); arguments are encoded into the
+// payload as tagged values and formatted later by the writer thread.
+struct LogRecord
+{
+    static constexpr std::size_t kPayloadBytes = 224;
+
+    std::int64_t timeNs;
+    const char *component;
+    const char *format;
+    LogLevel level;
+    bool truncated;
+    std::uint16_t payloadBytes;
+    char payload[kPayloadBytes];
+};
+
+namespace logdetail
+{
+inline void put(LogRecord &r, char tag, const void *data, std::size_t n)
+{
+    if (r.payloadBytes + 1 + n > LogRecord::kPayloadBytes)
+    {
+        r.truncated = true;
+        return;
+    }
+    r.payload[r.payloadBytes] = tag;
+    std::memcpy(r.payload + r.payloadBytes + 1, data, n);
+    r.payloadBytes += static_cast<std::uint16_t>(1 + n);
+}
+
+// Word-at-a-time copy; GCC otherwise inlines variable-length memcpy as
+// rep movs, whose startup cost dominates for the short strings logged here.
+inline void copyShort(char *dst, const char *src, std::size_t n)
+{
+    for (; n >= 8; n -= 8, dst += 8, src += 8)
+        std::memcpy(dst, src, 8);
+    for (; n > 0; --n)
+        *dst++ = *src++;
+}
+
+inline void putString(LogRecord &r, std::string_view s)
+{
+    std::size_t room = LogRecord::kPayloadBytes - r.payloadBytes;
+    if (room < 3)
+    {
+        r.truncated = true;
+        return;
+    }
+    std::uint16_t len = static_cast<std::uint16_t>(std::min(s.size(), room - 3));
+    if (len < s.size())
+        r.truncated = true;
+    char *p = r.payload + r.payloadBytes;
+    p[0] = 's';
+    std::memcpy(p + 1, &len, sizeof(len));
+    copyShort(p + 3, s.data(), len);
+    r.payloadBytes += static_cast<std::uint16_t>(3 + len);
+}
+
+template <typename T>
+void encode(LogRecord &r, const T &v)
+{
+    if constexpr (std::is_same_v<T, bool>)
+    {
+        put(r, 'b', &v, sizeof(v));
+    }
+    else if constexpr (std::is_same_v<T, char>)
+    {
+        putString(r, std::string_view(&v, 1));
+    }
+    else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>)
+    {
+        std::int64_t x = v;
+        put(r, 'i', &x, sizeof(x));
+    }
+    else if constexpr (std::is_integral_v<T>)
+    {
+        std::uint64_t x = v;
+        put(r, 'u', &x, sizeof(x));
+    }
+    else if constexpr (std::is_floating_point_v<T>)
+    {
+        double x = v;
+        put(r, 'd', &x, sizeof(x));
+    }
+    else if constexpr (std::is_enum_v<T>)
+    {
+        std::int64_t x = static_cast<std::int64_t>(v);
+        put(r, 'i', &x, sizeof(x));
+    }
+    else
+    {
+        putString(r, std::string_view(v));
+    }
+}
+} // namespace logdetail
+
+// Single-producer/single-consumer ring owned by one logging thread; the
+// writer thread is the only consumer. Records are filled in place.
+class LogRing
+{
+private:
+    static constexpr std::size_t kCapacity = 512;
+    static constexpr std::size_t kCacheLine = 64;
+
+    LogRecord slots_[kCapacity];
+    alignas(kCacheLine) std::atomic<std::uint64_t> head_{0}; // next to read
+    alignas(kCacheLine) std::atomic<std::uint64_t> tail_{0}; // next to write
+    // Producer-private copies, so the common case touches no shared line
+    // except the release store of tail_.
+    alignas(kCacheLine) std::uint64_t producerTail_ = 0;
+    std::uint64_t cachedHead_ = 0;
+
+public:
+    std::atomic<bool> retired{false}; // owning thread has exited
+
+    LogRecord *beginWrite()
+    {
+        if (producerTail_ - cachedHead_ == kCapacity)
+        {
+            cachedHead_ = head_.load(std::memory_order_acquire);
+            if (producerTail_ - cachedHead_ == kCapacity)
+                return nullptr;
+        }
+        return &slots_[producerTail_ & (kCapacity - 1)];
+    }
+
+    void commitWrite()
+    {
+        tail_.store(++producerTail_, std::memory_order_release);
+    }
+
+    bool empty() const
+    {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+    bool read(LogRecord &out)
+    {
+        std::uint64_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire))
+            return false;
+        const LogRecord &slot = slots_[head & (kCapacity - 1)];
+        std::memcpy(&out, &slot, offsetof(LogRecord, payload) + slot.payloadBytes);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+// Asynchronous logger. A log call copies its arguments into the calling
+// thread's ring and returns; it never locks, allocates or formats. The
+// writer thread merges the rings in time order, formats "{}" placeholders
+// and writes Debug/Info to stdout, Warn/Error to stderr. When a ring is
+// full the record is dropped and counted rather than blocking the caller.
+class Logger
+{
+private:
+    static inline std::atomic<std::uint8_t> level_{static_cast<std::uint8_t>(LogLevel::Info)};
+
+    std::mutex ringsMtx_;
+    std::vector<std::shared_ptr<LogRing>> rings_;
+    std::mutex drainMtx_;
+    std::vector<std::shared_ptr<LogRing>> drainRings_;
+    std::vector<LogRecord> batch_;
+    std::string out_;
+    std::string err_;
+    std::atomic<std::uint64_t> dropped_{0};
+    std::atomic<bool> stopping_{false};
+    std::thread writer_;
+
+    Logger();
+    ~Logger();
+
+    LogRing *threadRing();
+    void writerLoop();
+    std::size_t drainLocked();
+    static void format(const LogRecord &record, std::string &out);
+
+public:
+    Logger(const Logger &) = delete;
+    Logger &operator=(const Logger &) = delete;
+
+    static Logger &instance();
+
+    static void setLevel(LogLevel level) { level_.store(static_cast<std::uint8_t>(level), std::memory_order_relaxed); }
+    static bool enabled(LogLevel level)
+    {
+        return static_cast<std::uint8_t>(level) >= level_.load(std::memory_order_relaxed);
+    }
+
+    template <typename... Args>
+    void log(LogLevel level, const char *component, const char *format, const Args &...args)
+    {
+        LogRing *ring = threadRing();
+        LogRecord *r = ring->beginWrite();
+        if (r == nullptr)
+        {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        r->timeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::system_clock::now().time_since_epoch())
+                        .count();
+        r->component = component;
+        r->format = format;
+        r->level = level;
+        r->truncated = false;
+        r->payloadBytes = 0;
+        (logdetail::encode(*r, args), ...);
+        ring->commitWrite();
+    }
+
+    // Blocks until everything logged so far has been written.
+    void flush();
+};
+
+#define TEE_LOG(level, component, ...)                                                   \
+    do                                                                                   \
+    {                                                                                    \
+        if (logLevelCompiledIn(static_cast<int>(level)) && Logger::enabled(level))       \
+            Logger::instance().log(level, component, __VA_ARGS__);                       \
+    } while (0)
+
+#define TEE_LOG_DEBUG(component, ...) TEE_LOG(LogLevel::Debug, component, __VA_ARGS__)
+#define TEE_LOG_INFO(component, ...) TEE_LOG(LogLevel::Info, component, __VA_ARGS__)
+#define TEE_LOG_WARN(component, ...) TEE_LOG(LogLevel::Warn, component, __VA_ARGS__)
+#define TEE_LOG_ERROR(component, ...) TEE_LOG(LogLevel::Error, component, __VA_ARGS__)
+
+#endif // LOGGER_HPP
@@ -0,0 +1,45 @@
+#ifndef MEMORYACCOUNTING_HPP
+#define MEMORYACCOUNTING_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "Offer.hpp"
+
+// Heap bytes owned by standard containers, as allocated (capacity, not size).
+// Allocator headers are not included; everything else a container owns is.
+
+inline std::size_t heapBytes(const std::string &s)
+{
+    static const std::size_t ssoCapacity = std::string().capacity();
+    return s.capacity() > ssoCapacity ? s.capacity() + 1 : 0;
+}
+
+inline std::size_t heapBytes(const std::vector<std::string> &v)
+{
+    std::size_t bytes = v.capacity() * sizeof(std::string);
+    for (const auto &s : v)
+    {
+        bytes += heapBytes(s);
+    }
+    return bytes;
+}
+
+inline std::size_t heapBytes(const Offer &off)
+{
+    return heapBytes(off.title) +
+           heapBytes(off.verifiedKeywords) +
+           heapBytes(off.unverifiedText) +
+           heapBytes(off.publicVerificationKeyFDE) +
+           heapBytes(off.encryptedPlaintext) +
+           heapBytes(off.nullifier) +
+           heapBytes(off.sellerPublicKey);
+}
+
+// Red-black tree node header (colour + parent/left/right) that precedes each std::map value.
+constexpr std::size_t kMapNodeOverhead = 4 * sizeof(void *);
+
+// Previous/next pointers that precede each std::list value.
+constexpr std::size_t kListNodeOverhead = 2 * sizeof(void *);
+
+#endif // MEMORYACCOUNTING_HPP
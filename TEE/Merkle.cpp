@@ -0,0 +1,131 @@
+#include "Merkle.hpp"
+#include <algorithm>
+#include <memory>
+#include <openssl/evp.h>
+
+// One-shot SHA256() looks the digest up on every call, and the lookup takes
+// a lock shared by all threads; fetch it once and keep a context per thread.
+static EVP_MD_CTX *sha256Context()
+{
+    static EVP_MD *sha256 = EVP_MD_fetch(nullptr, "SHA256", nullptr);
+    thread_local std::unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)> ctx(EVP_MD_CTX_new(), &EVP_MD_CTX_free);
+    EVP_DigestInit_ex(ctx.get(), sha256, nullptr);
+    return ctx.get();
+}
+
+MerkleHash merkleLeafHash(std::string_view data)
+{
+    // Streaming, so the prefix needs no copy of data.
+    static const unsigned char prefix = 0x00;
+    EVP_MD_CTX *ctx = sha256Context();
+    MerkleHash out;
+    EVP_DigestUpdate(ctx, &prefix, 1);
+    EVP_DigestUpdate(ctx, data.data(), data.size());
+    EVP_DigestFinal_ex(ctx, out.data(), nullptr);
+    return out;
+}
+
+MerkleHash merkleNodeHash(const MerkleHash &left, const MerkleHash &right)
+{
+    unsigned char buf[1 + 2 * 32];
+    buf[0] = 0x01;
+    std::copy(left.begin(), left.end(), buf + 1);
+    std::copy(right.begin(), right.end(), buf + 33);
+    EVP_MD_CTX *ctx = sha256Context();
+    MerkleHash out;
+    EVP_DigestUpdate(ctx, buf, sizeof(buf));
+    EVP_DigestFinal_ex(ctx, out.data(), nullptr);
+    return out;
+}
+
+std::string toHex(const MerkleHash &hash)
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string out(hash.size() * 2, '0');
+    for (std::size_t i = 0; i < hash.size(); ++i)
+    {
+        out[2 * i] = digits[hash[i] >> 4];
+        out[2 * i + 1] = digits[hash[i] & 0xf];
+    }
+    return out;
+}
+
+bool fromHex(const std::string &hex, MerkleHash &hash)
+{
+    if (hex.size() != hash.size() * 2)
+        return false;
+    auto value = [](char c) {
+        if (c >= '0' && c <= '9')
+            return c - '0';
+        if (c >= 'a' && c <= 'f')
+            return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F')
+            return c - 'A' + 10;
+        return -1;
+    };
+    for (std::size_t i = 0; i < hash.size(); ++i)
+    {
+        int hi = value(hex[2 * i]);
+        int lo = value(hex[2 * i + 1]);
+        if (hi < 0 || lo < 0)
+            return false;
+        hash[i] = static_cast<unsigned char>(hi << 4 | lo);
+    }
+    return true;
+}
+
+// Replaces level with its parent level.
+static void reduceLevel(std::vector<MerkleHash> &level)
+{
+    std::size_t parents = (level.size() + 1) / 2;
+    for (std::size_t i = 0; i < parents; ++i)
+    {
+        level[i] = 2 * i + 1 < level.size() ? merkleNodeHash(level[2 * i], level[2 * i + 1]) : level[2 * i];
+    }
+    level.resize(parents);
+}
+
+MerkleHash merkleRoot(std::vector<MerkleHash> level)
+{
+    if (level.empty())
+        return MerkleHash{};
+    while (level.size() > 1)
+        reduceLevel(level);
+    return level[0];
+}
+
+std::vector<MerkleHash> merkleProof(std::vector<MerkleHash> level, std::size_t index)
+{
+    std::vector<MerkleHash> proof;
+    if (index >= level.size())
+        return proof;
+    while (level.size() > 1)
+    {
+        std::size_t sibling = index ^ 1;
+        if (sibling < level.size())
+            proof.push_back(level[sibling]);
+        reduceLevel(level);
+        index /= 2;
+    }
+    return proof;
+}
+
+bool verifyMerkleProof(const MerkleHash &leaf, std::size_t index, std::size_t count,
+                       const std::vector<MerkleHash> &proof, const MerkleHash &root)
+{
+    if (index >= count)
+        return false;
+    MerkleHash node = leaf;
+    std::size_t used = 0;
+    for (; count > 1; count = (count + 1) / 2, index /= 2)
+    {
+        std::size_t sibling = index ^ 1;
+        if (sibling >= count)
+            continue;
+        if (used == proof.size())
+            return false;
+        node = (index & 1) ? merkleNodeHash(proof[used], node) : merkleNodeHash(node, proof[used]);
+        ++used;
+    }
+    return used == proof.size() && node == root;
+}
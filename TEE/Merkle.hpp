@@ -0,0 +1,30 @@
+#ifndef MERKLE_HPP
+#define MERKLE_HPP
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// SHA-256 Merkle hashing with domain separation (RFC 6962 style): leaves
+// hash 0x00 || data, interior nodes 0x01 || left || right.
+using MerkleHash = std::array<unsigned char, 32>;
+
+MerkleHash merkleLeafHash(std::string_view data);
+MerkleHash merkleNodeHash(const MerkleHash &left, const MerkleHash &right);
+std::string toHex(const MerkleHash &hash);
+bool fromHex(const std::string &hex, MerkleHash &hash);
+
+// Root of a list of leaf hashes; an odd node at the end of a level is
+// carried up unchanged. The root of no leaves is all zeros.
+MerkleHash merkleRoot(std::vector<MerkleHash> level);
+
+// Sibling hashes for leaves[index], bottom-up. Levels where the node was
+// carried up contribute no sibling; verifyMerkleProof replays that from
+// index and leaf count.
+std::vector<MerkleHash> merkleProof(std::vector<MerkleHash> level, std::size_t index);
+bool verifyMerkleProof(const MerkleHash &leaf, std::size_t index, std::size_t count,
+                       const std::vector<MerkleHash> &proof, const MerkleHash &root);
+
+#endif // MERKLE_HPP
@@ -0,0 +1,175 @@
+#include "Metrics.hpp"
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+
+/*************************
+ * Counters and histograms
+ ************************/
+std::uint64_t MetricCounter::value() const
+{
+    std::uint64_t total = 0;
+    for (const auto &shard : shards_)
+    {
+        total += shard.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+std::uint64_t LatencyHistogram::bucketUpperBound(unsigned index)
+{
+    if (index < kSubBuckets)
+        return index;
+    unsigned octave = index / kSubBuckets;
+    unsigned sub = index % kSubBuckets;
+    unsigned shift = octave - 1;
+    return ((static_cast<std::uint64_t>(kSubBuckets + sub) + 1) << shift) - 1;
+}
+
+HistogramSnapshot LatencyHistogram::snapshot() const
+{
+    HistogramSnapshot snap;
+    snap.counts.assign(kBuckets, 0);
+    for (const auto &shard : shards_)
+    {
+        for (unsigned i = 0; i < kBuckets; ++i)
+        {
+            snap.counts[i] += shard.counts[i].load(std::memory_order_relaxed);
+        }
+        snap.sumNs += shard.sumNs.load(std::memory_order_relaxed);
+    }
+    for (auto c : snap.counts)
+    {
+        snap.count += c;
+    }
+    return snap;
+}
+
+std::uint64_t HistogramSnapshot::quantileNs(double q) const
+{
+    if (count == 0)
+        return 0;
+    auto rank = static_cast<std::uint64_t>(std::ceil(q * static_cast<double>(count)));
+    if (rank == 0)
+        rank = 1;
+    std::uint64_t seen = 0;
+    for (unsigned i = 0; i < counts.size(); ++i)
+    {
+        seen += counts[i];
+        if (seen >= rank)
+            return LatencyHistogram::bucketUpperBound(i);
+    }
+    return maxNs();
+}
+
+std::uint64_t HistogramSnapshot::maxNs() const
+{
+    for (unsigned i = static_cast<unsigned>(counts.size()); i-- > 0;)
+    {
+        if (counts[i] != 0)
+            return LatencyHistogram::bucketUpperBound(i);
+    }
+    return 0;
+}
+
+/*************************
+ * Registry
+ ************************/
+MetricsRegistry &MetricsRegistry::instance()
+{
+    static MetricsRegistry registry;
+    return registry;
+}
+
+MetricsRegistry::Family *MetricsRegistry::findLocked(const std::string &name)
+{
+    for (auto &family : families_)
+    {
+        if (family.name == name)
+            return &family;
+    }
+    return nullptr;
+}
+
+MetricCounter &MetricsRegistry::counter(const std::string &name, const std::string &help)
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    Family *family = findLocked(name);
+    if (family == nullptr)
+    {
+        families_.push_back(Family{name, help, std::make_unique<MetricCounter>(), nullptr});
+        family = &families_.back();
+    }
+    if (!family->counter)
+        throw std::logic_error("Metric " + name + " is not a counter");
+    return *family->counter;
+}
+
+LatencyHistogram &MetricsRegistry::histogram(const std::string &name, const std::string &help)
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    Family *family = findLocked(name);
+    if (family == nullptr)
+    {
+        families_.push_back(Family{name, help, nullptr, std::make_unique<LatencyHistogram>()});
+        family = &families_.back();
+    }
+    if (!family->histogram)
+        throw std::logic_error("Metric " + name + " is not a histogram");
+    return *family->histogram;
+}
+
+void MetricsRegistry::render(std::string &out)
+{
+    static const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+
+    std::lock_guard<std::mutex> lock(mtx_);
+    for (const auto &family : families_)
+    {
+        const char *name = family.name.c_str();
+        if (family.counter)
+        {
+            appendMetricHeader(out, name, family.help.c_str(), "counter");
+            appendMetricSample(out, name, static_cast<double>(family.counter->value()));
+            continue;
+        }
+
+        HistogramSnapshot snap = family.histogram->snapshot();
+        appendMetricHeader(out, name, family.help.c_str(), "summary");
+        for (double q : quantiles)
+        {
+            char label[32];
+            std::snprintf(label, sizeof(label), "quantile=\"%g\"", q);
+            appendMetricSample(out, name, snap.quantileNs(q) / 1e9, label);
+        }
+        appendMetricSample(out, (family.name + "_sum").c_str(), snap.sumNs / 1e9);
+        appendMetricSample(out, (family.name + "_count").c_str(), static_cast<double>(snap.count));
+    }
+}
+
+void appendMetricHeader(std::string &out, const char *name, const char *help, const char *type)
+{
+    out += "# HELP ";
+    out += name;
+    out += ' ';
+    out += help;
+    out += "\n# TYPE ";
+    out += name;
+    out += ' ';
+    out += type;
+    out += '\n';
+}
+
+void appendMetricSample(std::string &out, const char *name, double value, const std::string &labels)
+{
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), " %.9g\n", value);
+    out += name;
+    if (!labels.empty())
+    {
+        out += '{';
+        out += labels;
+        out += '}';
+    }
+    out += buf;
+}
@@ -0,0 +1,149 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Updates go to one of kMetricShards cache-line-aligned slots picked per
+// thread, so concurrent writers do not contend; reads sum the shards.
+constexpr std::size_t kMetricShards = 16;
+
+inline std::size_t metricShardIndex()
+{
+    static std::atomic<std::size_t> nextShard{0};
+    thread_local std::size_t shard = nextShard.fetch_add(1, std::memory_order_relaxed) % kMetricShards;
+    return shard;
+}
+
+class MetricCounter
+{
+private:
+    struct alignas(64) Shard
+    {
+        std::atomic<std::uint64_t> value{0};
+    };
+    Shard shards_[kMetricShards];
+
+public:
+    void add(std::uint64_t n = 1)
+    {
+        shards_[metricShardIndex()].value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    std::uint64_t value() const;
+};
+
+struct HistogramSnapshot
+{
+    std::vector<std::uint64_t> counts;
+    std::uint64_t count = 0;
+    std::uint64_t sumNs = 0;
+
+    // Highest value equivalent to the q-th quantile's bucket, in nanoseconds.
+    std::uint64_t quantileNs(double q) const;
+    std::uint64_t maxNs() const;
+};
+
+// HDR-style log-linear latency histogram over nanoseconds: 16 linear
+// sub-buckets per power of two (at most 6.25% relative error) from 1ns up
+// to 2^40ns (~18 minutes); larger values land in the top bucket. Recording
+// is two relaxed adds on the calling thread's shard.
+class LatencyHistogram
+{
+public:
+    static constexpr unsigned kSubBucketBits = 4;
+    static constexpr unsigned kSubBuckets = 1u << kSubBucketBits;
+    static constexpr unsigned kMaxExponent = 40;
+    static constexpr unsigned kBuckets = (kMaxExponent - kSubBucketBits + 1) * kSubBuckets;
+    static constexpr std::size_t kShards = 8;
+
+    static unsigned bucketIndex(std::uint64_t ns)
+    {
+        if (ns < kSubBuckets)
+            return static_cast<unsigned>(ns);
+        unsigned exponent = 63u - static_cast<unsigned>(__builtin_clzll(ns));
+        if (exponent >= kMaxExponent)
+            return kBuckets - 1;
+        return (exponent - kSubBucketBits + 1) * kSubBuckets +
+               static_cast<unsigned>((ns >> (exponent - kSubBucketBits)) & (kSubBuckets - 1));
+    }
+
+    static std::uint64_t bucketUpperBound(unsigned index);
+
+    void record(std::uint64_t ns)
+    {
+        Shard &shard = shards_[metricShardIndex() % kShards];
+        shard.counts[bucketIndex(ns)].fetch_add(1, std::memory_order_relaxed);
+        shard.sumNs.fetch_add(ns, std::memory_order_relaxed);
+    }
+
+    void record(std::chrono::steady_clock::duration elapsed)
+    {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+        record(static_cast<std::uint64_t>(ns < 0 ? 0 : ns));
+    }
+
+    HistogramSnapshot snapshot() const;
+
+private:
+    struct alignas(64) Shard
+    {
+        std::atomic<std::uint64_t> counts[kBuckets]{};
+        std::atomic<std::uint64_t> sumNs{0};
+    };
+    Shard shards_[kShards];
+};
+
+// Records the lifetime of the scope into a histogram.
+class ScopedLatency
+{
+private:
+    LatencyHistogram &histogram_;
+    std::chrono::steady_clock::time_point start_;
+
+public:
+    explicit ScopedLatency(LatencyHistogram &histogram)
+        : histogram_(histogram), start_(std::chrono::steady_clock::now())
+    {
+    }
+    ~ScopedLatency() { histogram_.record(std::chrono::steady_clock::now() - start_); }
+};
+
+// Process-wide registry. Metrics are created once (usually into a
+// file-scope reference) and live until exit; render() writes them in the
+// Prometheus text format, histograms as summaries in seconds.
+class MetricsRegistry
+{
+private:
+    struct Family
+    {
+        std::string name;
+        std::string help;
+        std::unique_ptr<MetricCounter> counter;
+        std::unique_ptr<LatencyHistogram> histogram;
+    };
+
+    std::mutex mtx_;
+    std::vector<Family> families_;
+
+    Family *findLocked(const std::string &name);
+
+public:
+    static MetricsRegistry &instance();
+
+    MetricCounter &counter(const std::string &name, const std::string &help);
+    LatencyHistogram &histogram(const std::string &name, const std::string &help);
+
+    void render(std::string &out);
+};
+
+// Helpers for values computed at scrape time (gauges, labelled samples).
+void appendMetricHeader(std::string &out, const char *name, const char *help, const char *type);
+void appendMetricSample(std::string &out, const char *name, double value, const std::string &labels = "");
+
+#endif // METRICS_HPP
@@ -1,6 +1,8 @@
 #ifndef OFFER_HPP
 #define OFFER_HPP
 
+#include <cstdint>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -16,6 +18,45 @@ struct Offer
     std::string publicVerificationKeyFDE;
     std::string encryptedPlaintext;
     std::string nullifier;
+    std::string sellerPublicKey; // hex Ed25519 key authorizing updates; empty = immutable
+    std::uint64_t updateNonce = 0; // nonce of the last applied update; kept when the id is resubmitted
+};
+
+// One bit per Offer field, for reads that only need some of them.
+using OfferFieldMask = std::uint32_t;
+constexpr OfferFieldMask kOfferFieldTitle = 1u << 0;
+constexpr OfferFieldMask kOfferFieldVerifiedKeywords = 1u << 1;
+constexpr OfferFieldMask kOfferFieldUnverifiedText = 1u << 2;
+constexpr OfferFieldMask kOfferFieldReservePrice = 1u << 3;
+constexpr OfferFieldMask kOfferFieldPreferredBuyers = 1u << 4;
+constexpr OfferFieldMask kOfferFieldExpiryDays = 1u << 5;
+constexpr OfferFieldMask kOfferFieldCooldownMonths = 1u << 6;
+constexpr OfferFieldMask kOfferFieldFDEKey = 1u << 7;
+constexpr OfferFieldMask kOfferFieldEncryptedPlaintext = 1u << 8;
+constexpr OfferFieldMask kOfferFieldNullifier = 1u << 9;
+constexpr OfferFieldMask kOfferFieldSellerKey = 1u << 10;
+constexpr OfferFieldMask kOfferFieldUpdateNonce = 1u << 11;
+constexpr OfferFieldMask kOfferFieldsAll = (1u << 12) - 1;
+// What gets posted on chain (see FinancialDetails).
+constexpr OfferFieldMask kOfferFieldsOnChain = kOfferFieldReservePrice | kOfferFieldPreferredBuyers |
+                                               kOfferFieldExpiryDays | kOfferFieldCooldownMonths | kOfferFieldFDEKey;
+
+// Seller-signed change to fields the proof does not bind; unset fields keep their value.
+struct FinancialUpdate
+{
+    std::uint64_t nonce = 0; // must exceed the offer's updateNonce
+    std::optional<double> reservePrice;
+    std::optional<int> preferredBuyers;
+    std::optional<int> expiryDays;
+};
+
+// An offer submission as received from a seller, before verification.
+struct OfferRequest
+{
+    std::string offerId;
+    Offer offer;
+    std::string proofPath;
+    std::string publicInputsPath;
 };
 
 #endif // OFFER_HPP
@@ -0,0 +1,173 @@
+#ifndef OFFERJSON_HPP
+#define OFFERJSON_HPP
+
+#include <stdexcept>
+#include <utility>
+#include <nlohmann/json.hpp>
+#include "Offer.hpp"
+
+// nlohmann/json conversions for Offer, used wherever offers cross a process boundary.
+inline void to_json(nlohmann::json &j, const Offer &off)
+{
+    j = nlohmann::json{
+        {"title", off.title},
+        {"verifiedKeywords", off.verifiedKeywords},
+        {"unverifiedText", off.unverifiedText},
+        {"reservePrice", off.reservePrice},
+        {"preferredBuyers", off.preferredNumberOfBuyers},
+        {"expiryDays", off.expiryDays},
+        {"cooldownMonths", off.cooldownMonths},
+        {"publicVerificationKeyFDE", off.publicVerificationKeyFDE},
+        {"encryptedPlaintext", off.encryptedPlaintext},
+        {"nullifier", off.nullifier},
+        {"sellerPublicKey", off.sellerPublicKey},
+        {"updateNonce", off.updateNonce}};
+}
+
+// JSON key of each projectable field (same keys as to_json).
+inline constexpr std::pair<const char *, OfferFieldMask> kOfferFieldNames[] = {
+    {"title", kOfferFieldTitle},
+    {"verifiedKeywords", kOfferFieldVerifiedKeywords},
+    {"unverifiedText", kOfferFieldUnverifiedText},
+    {"reservePrice", kOfferFieldReservePrice},
+    {"preferredBuyers", kOfferFieldPreferredBuyers},
+    {"expiryDays", kOfferFieldExpiryDays},
+    {"cooldownMonths", kOfferFieldCooldownMonths},
+    {"publicVerificationKeyFDE", kOfferFieldFDEKey},
+    {"encryptedPlaintext", kOfferFieldEncryptedPlaintext},
+    {"nullifier", kOfferFieldNullifier},
+    {"sellerPublicKey", kOfferFieldSellerKey},
+    {"updateNonce", kOfferFieldUpdateNonce}};
+
+// Builds a mask from an array of field names; on an unknown name returns
+// false and reports it in unknown.
+inline bool parseOfferFields(const nlohmann::json &names, OfferFieldMask &mask, std::string &unknown)
+{
+    mask = 0;
+    if (!names.is_array())
+    {
+        unknown = names.dump();
+        return false;
+    }
+    for (const auto &name : names)
+    {
+        OfferFieldMask bit = 0;
+        if (name.is_string())
+        {
+            for (const auto &field : kOfferFieldNames)
+            {
+                if (name.get_ref<const std::string &>() == field.first)
+                    bit = field.second;
+            }
+        }
+        if (bit == 0)
+        {
+            unknown = name.is_string() ? name.get<std::string>() : name.dump();
+            return false;
+        }
+        mask |= bit;
+    }
+    return true;
+}
+
+// Serializes only the fields in mask.
+inline void projectionToJson(nlohmann::json &j, const Offer &off, OfferFieldMask mask)
+{
+    j = nlohmann::json::object();
+    if (mask & kOfferFieldTitle)
+        j["title"] = off.title;
+    if (mask & kOfferFieldVerifiedKeywords)
+        j["verifiedKeywords"] = off.verifiedKeywords;
+    if (mask & kOfferFieldUnverifiedText)
+        j["unverifiedText"] = off.unverifiedText;
+    if (mask & kOfferFieldReservePrice)
+        j["reservePrice"] = off.reservePrice;
+    if (mask & kOfferFieldPreferredBuyers)
+        j["preferredBuyers"] = off.preferredNumberOfBuyers;
+    if (mask & kOfferFieldExpiryDays)
+        j["expiryDays"] = off.expiryDays;
+    if (mask & kOfferFieldCooldownMonths)
+        j["cooldownMonths"] = off.cooldownMonths;
+    if (mask & kOfferFieldFDEKey)
+        j["publicVerificationKeyFDE"] = off.publicVerificationKeyFDE;
+    if (mask & kOfferFieldEncryptedPlaintext)
+        j["encryptedPlaintext"] = off.encryptedPlaintext;
+    if (mask & kOfferFieldNullifier)
+        j["nullifier"] = off.nullifier;
+    if (mask & kOfferFieldSellerKey)
+        j["sellerPublicKey"] = off.sellerPublicKey;
+    if (mask & kOfferFieldUpdateNonce)
+        j["updateNonce"] = off.updateNonce;
+}
+
+inline void from_json(const nlohmann::json &j, Offer &off)
+{
+    off.title = j.value("title", "");
+    off.verifiedKeywords = j.value("verifiedKeywords", std::vector<std::string>{});
+    off.unverifiedText = j.value("unverifiedText", "");
+    off.reservePrice = j.value("reservePrice", 0.0);
+    off.preferredNumberOfBuyers = j.value("preferredBuyers", 0);
+    off.expiryDays = j.value("expiryDays", 0);
+    off.cooldownMonths = j.value("cooldownMonths", 0);
+    off.publicVerificationKeyFDE = j.value("publicVerificationKeyFDE", "");
+    off.encryptedPlaintext = j.value("encryptedPlaintext", "");
+    off.nullifier = j.value("nullifier", "");
+    off.sellerPublicKey = j.value("sellerPublicKey", "");
+    off.updateNonce = j.value("updateNonce", std::uint64_t{0});
+}
+
+// Field names and defaults of the submitOffer WebSocket message.
+inline void from_json(const nlohmann::json &j, OfferRequest &req)
+{
+    req.offerId = j.value("offerId", "unknown_offer");
+    from_json(j, req.offer);
+    req.proofPath = j.value("proofPath", "");
+    req.publicInputsPath = j.value("publicInputsPath", "");
+}
+
+// Moving variants for the ingest path: string fields are moved out of the
+// parsed DOM, so the stored Offer adopts the DOM's strings instead of a
+// second copy. Parsing still allocates the DOM and the parser's token
+// buffers, which is most of an offer's allocations. j is left holding
+// empty strings.
+inline std::string takeString(nlohmann::json &j, const char *key, const char *defaultValue = "")
+{
+    auto it = j.find(key);
+    if (it == j.end() || it->is_null())
+        return defaultValue;
+    return std::move(it->get_ref<std::string &>());
+}
+
+inline OfferRequest takeOfferRequest(nlohmann::json &j)
+{
+    if (!j.is_object())
+        throw std::invalid_argument("offer must be a JSON object");
+
+    OfferRequest req;
+    req.offerId = takeString(j, "offerId", "unknown_offer");
+    req.offer.title = takeString(j, "title");
+    auto keywords = j.find("verifiedKeywords");
+    if (keywords != j.end() && !keywords->is_null())
+    {
+        auto &arr = keywords->get_ref<nlohmann::json::array_t &>();
+        req.offer.verifiedKeywords.reserve(arr.size());
+        for (auto &kw : arr)
+        {
+            req.offer.verifiedKeywords.push_back(std::move(kw.get_ref<std::string &>()));
+        }
+    }
+    req.offer.unverifiedText = takeString(j, "unverifiedText");
+    req.offer.reservePrice = j.value("reservePrice", 0.0);
+    req.offer.preferredNumberOfBuyers = j.value("preferredBuyers", 0);
+    req.offer.expiryDays = j.value("expiryDays", 0);
+    req.offer.cooldownMonths = j.value("cooldownMonths", 0);
+    req.offer.publicVerificationKeyFDE = takeString(j, "publicVerificationKeyFDE");
+    req.offer.encryptedPlaintext = takeString(j, "encryptedPlaintext");
+    req.offer.nullifier = takeString(j, "nullifier");
+    req.offer.sellerPublicKey = takeString(j, "sellerPublicKey");
+    req.proofPath = takeString(j, "proofPath");
+    req.publicInputsPath = takeString(j, "publicInputsPath");
+    return req;
+}
+
+#endif // OFFERJSON_HPP
@@ -1,13 +1,23 @@
 #include "OfferValidator.hpp"
+#include "Logger.hpp"
+#include "Metrics.hpp"
 #include <fstream>
 #include <nlohmann/json.hpp>
-#include <iostream>
 #include <stdexcept>
 
 using namespace libsnark;
 using curve_pp = default_r1cs_ppzksnark_pp;
 using json = nlohmann::json;
 
+static LatencyHistogram &proofLoadLatency = MetricsRegistry::instance().histogram(
+    "tee_proof_load_seconds", "Time to read and parse a proof and its public inputs.");
+static LatencyHistogram &proofVerifyLatency = MetricsRegistry::instance().histogram(
+    "tee_proof_verify_seconds", "Time spent in the pairing check of a proof.");
+static MetricCounter &proofErrors = MetricsRegistry::instance().counter(
+    "tee_proof_errors_total", "Proofs that could not be loaded or verified.");
+static MetricCounter &bindingMismatches = MetricsRegistry::instance().counter(
+    "tee_input_binding_mismatches_total", "Offers whose keywords or nullifier disagree with their proof's public signals.");
+
 /*************************
  * Helper Functions
  ************************/
@@ -35,8 +45,7 @@ static r1cs_ppzksnark_proof<curve_pp> loadProof(const std::string &file_path)
     return proof;
 }
 
-static std::vector<r1cs_ppzksnark_primary_input<curve_pp>>
-loadPublicInputs(const std::string &file_path)
+static std::vector<std::string> loadPublicSignals(const std::string &file_path)
 {
     std::ifstream input_file(file_path);
     if (!input_file)
@@ -46,12 +55,22 @@ loadPublicInputs(const std::string &file_path)
     input_file >> input_json;
     input_file.close();
 
-    std::vector<r1cs_ppzksnark_primary_input<curve_pp>> public_inputs;
+    std::vector<std::string> signals;
+    signals.reserve(input_json.size());
     for (const auto &signal : input_json)
+        signals.push_back(signal.get<std::string>());
+    return signals;
+}
+
+static std::vector<r1cs_ppzksnark_primary_input<curve_pp>>
+toPrimaryInputs(const std::vector<std::string> &signals)
+{
+    std::vector<r1cs_ppzksnark_primary_input<curve_pp>> public_inputs;
+    for (const auto &signal : signals)
     {
         r1cs_ppzksnark_primary_input<curve_pp> pi;
         pi.emplace_back(
-            bigint<libff::Fr<curve_pp>::num_limbs>(signal.get<std::string>().c_str()));
+            bigint<libff::Fr<curve_pp>::num_limbs>(signal.c_str()));
         public_inputs.push_back(pi);
     }
     return public_inputs;
@@ -78,17 +97,35 @@ OfferValidator::OfferValidator(const std::string &vkFilePath)
 }
 
 bool OfferValidator::validateOfferProof(const std::string &proofPath,
-                                        const std::string &publicInputsPath)
+                                        const std::string &publicInputsPath,
+                                        const OfferBinding &binding,
+                                        std::string &error)
 {
     try
     {
+        auto start = std::chrono::steady_clock::now();
+        auto signals = loadPublicSignals(publicInputsPath);
+        if (!checkBinding(signals, layout_, binding, error))
+        {
+            bindingMismatches.add();
+            return false;
+        }
         auto proof = loadProof(proofPath);
-        auto pubInputs = loadPublicInputs(publicInputsPath);
-        return verifyProof(vk_, proof, pubInputs);
+        auto pubInputs = toPrimaryInputs(signals);
+        auto loaded = std::chrono::steady_clock::now();
+        proofLoadLatency.record(loaded - start);
+
+        bool valid = verifyProof(vk_, proof, pubInputs);
+        proofVerifyLatency.record(std::chrono::steady_clock::now() - loaded);
+        if (!valid)
+            error = "Proof invalid.";
+        return valid;
     }
     catch (const std::exception &e)
     {
-        std::cerr << "Error during proof validation: " << e.what() << std::endl;
+        proofErrors.add();
+        TEE_LOG_ERROR("OfferValidator", "Error during proof validation: {}", e.what());
+        error = "Proof invalid.";
         return false;
     }
 }
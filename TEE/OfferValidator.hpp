@@ -2,6 +2,7 @@
 #define OFFERVALIDATOR_HPP
 
 #include <string>
+#include "InputBinding.hpp"
 #include <libsnark/common/default_types/r1cs_ppzksnark_pp.hpp>
 #include <libsnark/zk_proof_systems/ppzksnark/r1cs_ppzksnark/r1cs_ppzksnark.hpp>
 
@@ -10,13 +11,21 @@ class OfferValidator
 private:
     libsnark::r1cs_ppzksnark_verification_key<
         libsnark::default_r1cs_ppzksnark_pp> vk_;
+    CircuitLayout layout_;
 
 public:
     explicit OfferValidator(const std::string &vkFilePath);
 
+    void setCircuitLayout(const CircuitLayout &layout) { layout_ = layout; }
+    const CircuitLayout &circuitLayout() const { return layout_; }
+
+    // Checks the public inputs against binding (see InputBinding.hpp) before
+    // the pairing; error says which check failed.
     bool validateOfferProof(
         const std::string &proofPath,
-        const std::string &publicInputsPath);
+        const std::string &publicInputsPath,
+        const OfferBinding &binding,
+        std::string &error);
 };
 
 #endif // OFFERVALIDATOR_HPP
@@ -1,4 +1,278 @@
 #include "OnChainPoster.hpp"
+#include "Logger.hpp"
+#include "Metrics.hpp"
+#include <algorithm>
+#include <iterator>
+#include <nlohmann/json.hpp>
+#include <random>
+
+using json = nlohmann::json;
+
+static LatencyHistogram &postLatency = MetricsRegistry::instance().histogram(
+    "tee_onchain_post_seconds", "Time to submit one batch transaction on chain.");
+static LatencyHistogram &inclusionLatency = MetricsRegistry::instance().histogram(
+    "tee_onchain_inclusion_seconds", "Time from queueing an offer's details until its batch is included.");
+static MetricCounter &postedOffers = MetricsRegistry::instance().counter(
+    "tee_onchain_posted_offers_total", "Offers whose financial details were posted on chain.");
+static MetricCounter &postedBatches = MetricsRegistry::instance().counter(
+    "tee_onchain_transactions_total", "Batch transactions submitted on chain.");
+static MetricCounter &failedBatches = MetricsRegistry::instance().counter(
+    "tee_onchain_failed_transactions_total", "Batch transactions the chain refused for good.");
+static MetricCounter &retriedBatches = MetricsRegistry::instance().counter(
+    "tee_onchain_retries_total", "Batch submissions refused as retryable and scheduled again.");
+
+static json detailsToJson(const FinancialDetails &details)
+{
+    return json{
+        {"offerId", details.offerId},
+        {"price", details.price},
+        {"preferredBuyers", details.preferredBuyers},
+        {"expiryDays", details.expiryDays},
+        {"cooldownMonths", details.cooldownMonths},
+        {"fdePublicKey", details.fdePublicKey}};
+}
+
+static FinancialDetails detailsFromJson(const json &j)
+{
+    return FinancialDetails{
+        j.at("offerId").get<std::string>(),
+        j.at("price").get<double>(),
+        j.at("preferredBuyers").get<int>(),
+        j.at("expiryDays").get<int>(),
+        j.at("cooldownMonths").get<int>(),
+        j.at("fdePublicKey").get<std::string>()};
+}
+
+std::string encodeFinancialDetails(const FinancialDetails &details)
+{
+    // Object keys are sorted, so the text is canonical.
+    return detailsToJson(details).dump();
+}
+
+/************************* Outbox records ************************/
+// One JSON object per line:
+//   state  - id and nonce counters, written when the outbox is rewritten
+//   offer  - details queued for a batch
+//   batch  - the oldest `count` queued offers were cut into batch `id`,
+//            with the catalog commitment it publishes, if any
+//   done   - batch `id` was included or refused for good
+
+static std::string stateRecord(std::uint64_t nextBatchId, std::uint64_t nextNonce)
+{
+    return json{{"op", "state"}, {"nextBatchId", nextBatchId}, {"nextNonce", nextNonce}}.dump() + "\n";
+}
+
+// Spliced by hand: the canonical details are already JSON, and keys stay sorted.
+static void appendOfferRecord(std::string &out, const std::string &encodedDetails)
+{
+    out += "{\"details\":";
+    out += encodedDetails;
+    out += ",\"op\":\"offer\"}\n";
+}
+
+static json catalogToJson(const CatalogCommitment &catalog)
+{
+    return json{{"root", toHex(catalog.root)}, {"leafCount", catalog.leafCount}, {"seq", catalog.seq}};
+}
+
+static std::optional<CatalogCommitment> catalogFromJson(const json &record)
+{
+    auto it = record.find("catalog");
+    if (it == record.end())
+        return std::nullopt;
+    CatalogCommitment catalog;
+    if (!fromHex(it->at("root").get<std::string>(), catalog.root))
+        throw std::invalid_argument("bad catalog root");
+    catalog.leafCount = it->at("leafCount").get<std::size_t>();
+    catalog.seq = it->at("seq").get<std::uint64_t>();
+    return catalog;
+}
+
+static std::string batchRecord(std::uint64_t id, std::uint64_t nonce, std::size_t count, BatchEncoding encoding,
+                               const std::optional<CatalogCommitment> &catalog)
+{
+    json record{{"op", "batch"}, {"id", id}, {"nonce", nonce}, {"count", count},
+                {"encoding", encoding == BatchEncoding::Packed ? "packed" : "merkle"}};
+    if (catalog)
+        record["catalog"] = catalogToJson(*catalog);
+    return record.dump() + "\n";
+}
+
+static std::string doneRecord(std::uint64_t id)
+{
+    return json{{"op", "done"}, {"id", id}}.dump() + "\n";
+}
+
+/************************* Lifecycle ************************/
+
+OnChainPoster::OnChainPoster() : chain_(std::make_shared<LoggingChainClient>())
+{
+}
+
+OnChainPoster::~OnChainPoster()
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    if (flusher_.joinable())
+        flusher_.join();
+
+    // Every offer is in a batch now; submitters leave once none is ready.
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        submittersStopping_ = true;
+    }
+    submitCv_.notify_all();
+    for (auto &submitter : submitters_)
+        submitter.join();
+
+    if (!outbox_.empty())
+    {
+        if (log_.isOpen())
+            TEE_LOG_WARN("OnChainPoster", "{} batches left in the outbox for the next start", outbox_.size());
+        else
+            TEE_LOG_ERROR("OnChainPoster", "Dropping {} undelivered batches (no outbox configured)", outbox_.size());
+    }
+}
+
+void OnChainPoster::configure(const PosterConfig &config, std::shared_ptr<ChainClient> chain)
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    config_ = config;
+    if (config_.maxBatch == 0)
+        config_.maxBatch = 1;
+    if (config_.pipelineDepth == 0)
+        config_.pipelineDepth = 1;
+    if (chain)
+        chain_ = std::move(chain);
+
+    if (!config_.outboxPath.empty() && !started_)
+    {
+        std::vector<std::string> records;
+        if (log_.open(config_.outboxPath, records))
+            restoreLocked(records);
+    }
+    startLocked();
+}
+
+void OnChainPoster::setCatalogSource(std::function<CatalogCommitment()> source)
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    catalogSource_ = std::move(source);
+}
+
+void OnChainPoster::startLocked()
+{
+    if (started_)
+        return;
+    started_ = true;
+    flusher_ = std::thread(&OnChainPoster::flushLoop, this);
+    for (std::size_t i = 0; i < config_.pipelineDepth; ++i)
+        submitters_.emplace_back(&OnChainPoster::submitLoop, this);
+}
+
+void OnChainPoster::restoreLocked(const std::vector<std::string> &records)
+{
+    std::vector<FinancialDetails> queued;
+    std::size_t consumed = 0; // queued offers already cut into batches
+    std::map<std::uint64_t, std::shared_ptr<Batch>> owed;
+    std::size_t line = 0;
+    try
+    {
+        for (; line < records.size(); ++line)
+        {
+            json record = json::parse(records[line]);
+            std::string op = record.at("op").get<std::string>();
+            if (op == "state")
+            {
+                nextBatchId_ = std::max(nextBatchId_, record.at("nextBatchId").get<std::uint64_t>());
+                nextNonce_ = std::max(nextNonce_, record.at("nextNonce").get<std::uint64_t>());
+            }
+            else if (op == "offer")
+            {
+                queued.push_back(detailsFromJson(record.at("details")));
+            }
+            else if (op == "batch")
+            {
+                std::uint64_t id = record.at("id").get<std::uint64_t>();
+                std::uint64_t nonce = record.at("nonce").get<std::uint64_t>();
+                std::size_t count = std::min(record.at("count").get<std::size_t>(), queued.size() - consumed);
+                BatchEncoding encoding =
+                    record.value("encoding", "packed") == "merkle" ? BatchEncoding::MerkleRoot : BatchEncoding::Packed;
+                std::vector<FinancialDetails> details(queued.begin() + static_cast<std::ptrdiff_t>(consumed),
+                                                      queued.begin() + static_cast<std::ptrdiff_t>(consumed + count));
+                consumed += count;
+                owed[id] = makeBatch(id, nonce, encoding, details, catalogFromJson(record));
+                nextBatchId_ = std::max(nextBatchId_, id + 1);
+                nextNonce_ = std::max(nextNonce_, nonce + 1);
+            }
+            else if (op == "done")
+            {
+                owed.erase(record.at("id").get<std::uint64_t>());
+            }
+        }
+    }
+    catch (const std::exception &e)
+    {
+        TEE_LOG_ERROR("OnChainPoster", "Outbox record {} is corrupt ({}); ignoring the rest", line + 1, e.what());
+    }
+
+    // A chain that is behind every batch we still owe has lost them (a
+    // fresh local ledger, say): renumber from its nonce so they do not wait
+    // on a gap forever. Otherwise keep the nonces; the idempotency key
+    // catches batches that were included before the restart.
+    std::optional<std::uint64_t> chainNonce = chain_->nextNonce();
+    std::uint64_t lowestOwed = owed.empty() ? nextNonce_ : owed.begin()->second->nonce;
+    if (chainNonce && *chainNonce < lowestOwed)
+    {
+        TEE_LOG_WARN("OnChainPoster", "Chain is at nonce {} but the outbox continues from {}; renumbering",
+                     *chainNonce, lowestOwed);
+        nextNonce_ = *chainNonce;
+        for (auto &entry : owed)
+            entry.second->nonce = nextNonce_++;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    for (auto &entry : owed)
+    {
+        for (const auto &offerId : entry.second->offerIds)
+            placements_[offerId].batchId = entry.first;
+        queuedCount_ += entry.second->offerIds.size();
+        entry.second->queuedAt = now;
+        enqueueLocked(entry.second);
+    }
+    for (std::size_t i = consumed; i < queued.size(); ++i)
+    {
+        placements_[queued[i].offerId].queued++;
+        waiting_.push_back(std::move(queued[i]));
+    }
+    queuedCount_ += waiting_.size();
+    oldestWaiting_ = now;
+
+    TEE_LOG_INFO("OnChainPoster", "Outbox {}: {} undelivered batches, {} queued offers, next nonce {}",
+                 config_.outboxPath, outbox_.size(), waiting_.size(), nextNonce_);
+    compactLocked();
+}
+
+// Rewrites the outbox with only what is still owed.
+void OnChainPoster::compactLocked()
+{
+    std::string records = stateRecord(nextBatchId_, nextNonce_);
+    for (const auto &entry : outbox_)
+    {
+        const Batch &batch = *entry.second;
+        for (const auto &leafText : batch.leafTexts)
+            appendOfferRecord(records, leafText);
+        records += batchRecord(batch.id, batch.nonce, batch.offerIds.size(), batch.encoding, batch.catalog);
+    }
+    for (const auto &details : waiting_)
+        appendOfferRecord(records, encodeFinancialDetails(details));
+    log_.rewrite(records);
+}
+
+/************************* Posting ************************/
 
 void OnChainPoster::postFinancialDetails(
     const std::string &offerId,
@@ -8,12 +282,343 @@ void OnChainPoster::postFinancialDetails(
     int cooldownMonths,
     const std::string &fdePublicKey)
 {
-    std::cout << "=== OnChain Poster ===\n";
-    std::cout << "Posting Offer [" << offerId << "] on chain with:\n"
-              << "  Reserve Price: " << price << "\n"
-              << "  Number of Buyers: " << preferredBuyers << "\n"
-              << "  Expiry (days): " << expiryDays << "\n"
-              << "  Cooldown (months): " << cooldownMonths << "\n"
-              << "  FDE Public Key: " << fdePublicKey << "\n"
-              << "== End OnChain Post ==\n\n";
+    postFinancialDetailsBatch({FinancialDetails{offerId, price, preferredBuyers, expiryDays, cooldownMonths, fdePublicKey}});
+}
+
+void OnChainPoster::postFinancialDetailsBatch(const std::vector<FinancialDetails> &batch)
+{
+    if (batch.empty())
+        return;
+
+    std::string records;
+    if (log_.isOpen())
+    {
+        for (const auto &d : batch)
+            appendOfferRecord(records, encodeFinancialDetails(d));
+    }
+
+    bool wake;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        startLocked();
+        // Appended under the lock so batch records consume offers in order.
+        if (!records.empty())
+            log_.append(records);
+        // The flusher sleeps until the first offer arrives or the batch fills.
+        wake = waiting_.empty();
+        if (wake)
+            oldestWaiting_ = std::chrono::steady_clock::now();
+        for (const auto &d : batch)
+        {
+            waiting_.push_back(d);
+            placements_[d.offerId].queued++;
+        }
+        queuedCount_ += batch.size();
+        wake = wake || waiting_.size() >= config_.maxBatch;
+    }
+    if (wake)
+        cv_.notify_one();
+}
+
+void OnChainPoster::flush()
+{
+    std::unique_lock<std::mutex> lock(mtx_);
+    std::uint64_t target = queuedCount_;
+    flushRequested_ = true;
+    cv_.notify_one();
+    flushedCv_.wait(lock, [&] { return resolvedCount_ >= target; });
+}
+
+void OnChainPoster::flushLoop()
+{
+    std::unique_lock<std::mutex> lock(mtx_);
+    while (true)
+    {
+        if (waiting_.empty())
+        {
+            flushRequested_ = false;
+            if (stopping_)
+                return;
+            cv_.wait(lock);
+            continue;
+        }
+
+        auto due = oldestWaiting_ + config_.window;
+        bool ready = stopping_ || flushRequested_ || waiting_.size() >= config_.maxBatch ||
+                     std::chrono::steady_clock::now() >= due;
+        if (!ready)
+        {
+            cv_.wait_until(lock, due);
+            continue;
+        }
+
+        std::vector<FinancialDetails> details;
+        if (waiting_.size() <= config_.maxBatch)
+        {
+            details.swap(waiting_);
+        }
+        else
+        {
+            auto cut = waiting_.begin() + static_cast<std::ptrdiff_t>(config_.maxBatch);
+            details.assign(std::make_move_iterator(waiting_.begin()), std::make_move_iterator(cut));
+            waiting_.erase(waiting_.begin(), cut);
+        }
+        auto queuedAt = oldestWaiting_;
+        oldestWaiting_ = std::chrono::steady_clock::now();
+        std::uint64_t id = nextBatchId_++;
+        std::uint64_t nonce = nextNonce_++;
+        BatchEncoding encoding = config_.encoding;
+        std::function<CatalogCommitment()> catalogSource = catalogSource_;
+        std::size_t payloadLimit = chain_->maxPayloadBytes();
+
+        lock.unlock();
+        std::optional<CatalogCommitment> catalog;
+        if (catalogSource)
+            catalog = catalogSource();
+        auto batch = makeBatch(id, nonce, encoding, details, catalog);
+        // Halve until the payload fits the chain; the rest goes back to the
+        // front of the queue, where the journal replay expects it too.
+        std::vector<FinancialDetails> putBack;
+        while (payloadLimit > 0 && batch->payload.size() > payloadLimit && details.size() > 1)
+        {
+            std::size_t keep = details.size() / 2;
+            putBack.insert(putBack.begin(), std::make_move_iterator(details.begin() + static_cast<std::ptrdiff_t>(keep)),
+                           std::make_move_iterator(details.end()));
+            details.resize(keep);
+            batch = makeBatch(id, nonce, encoding, details, catalog);
+        }
+        batch->queuedAt = queuedAt;
+        lock.lock();
+
+        if (!putBack.empty())
+        {
+            TEE_LOG_DEBUG("OnChainPoster", "Batch {} cut to {} offers to fit {} bytes", id, details.size(), payloadLimit);
+            waiting_.insert(waiting_.begin(), std::make_move_iterator(putBack.begin()),
+                            std::make_move_iterator(putBack.end()));
+            oldestWaiting_ = queuedAt;
+        }
+
+        // This thread writes every batch record, so records stay in cut order.
+        log_.append(batchRecord(id, nonce, details.size(), encoding, catalog));
+        for (const auto &offerId : batch->offerIds)
+        {
+            Placement &placement = placements_[offerId];
+            placement.batchId = id;
+            placement.queued--;
+        }
+        enqueueLocked(std::move(batch));
+
+        // Group commit: the offers and the batch reach the disk together.
+        lock.unlock();
+        log_.sync();
+        lock.lock();
+    }
+}
+
+std::shared_ptr<OnChainPoster::Batch> OnChainPoster::makeBatch(
+    std::uint64_t id, std::uint64_t nonce, BatchEncoding encoding, const std::vector<FinancialDetails> &details,
+    const std::optional<CatalogCommitment> &catalog) const
+{
+    auto batch = std::make_shared<Batch>();
+    batch->id = id;
+    batch->nonce = nonce;
+    batch->encoding = encoding;
+    batch->catalog = catalog;
+
+    json offers = json::array();
+    batch->offerIds.reserve(details.size());
+    batch->leaves.reserve(details.size());
+    batch->leafTexts.reserve(details.size());
+    for (const auto &d : details)
+    {
+        std::string leaf = encodeFinancialDetails(d);
+        batch->offerIds.push_back(d.offerId);
+        batch->leaves.push_back(merkleLeafHash(leaf));
+        if (encoding == BatchEncoding::Packed)
+            offers.push_back(leaf);
+        batch->leafTexts.push_back(std::move(leaf));
+    }
+    batch->root = merkleRoot(batch->leaves);
+
+    json tx{{"batch", id}, {"count", details.size()}, {"root", toHex(batch->root)}};
+    if (encoding == BatchEncoding::Packed)
+        tx["offers"] = std::move(offers);
+    if (catalog)
+        tx["catalog"] = catalogToJson(*catalog);
+    batch->payload = tx.dump();
+    // The payload never changes, so neither does the key, across retries and restarts.
+    batch->idempotencyKey = toHex(merkleLeafHash(batch->payload));
+    return batch;
+}
+
+void OnChainPoster::enqueueLocked(std::shared_ptr<Batch> batch)
+{
+    batch->nextAttempt = std::chrono::steady_clock::time_point::min();
+    outbox_.emplace(batch->id, std::move(batch));
+    submitCv_.notify_one();
+}
+
+/************************* Submission ************************/
+
+std::chrono::milliseconds OnChainPoster::backoff(unsigned attempts) const
+{
+    thread_local std::mt19937 rng{std::random_device{}()};
+    std::chrono::milliseconds delay = config_.retryBackoff * (1L << std::min(attempts - 1, 20u));
+    delay = std::min(delay, config_.maxRetryBackoff);
+    // Jitter over the upper half, so pipelined retries spread out.
+    std::uniform_int_distribution<std::chrono::milliseconds::rep> jitter(delay.count() / 2, delay.count());
+    return std::chrono::milliseconds(jitter(rng));
+}
+
+void OnChainPoster::submitLoop()
+{
+    std::unique_lock<std::mutex> lock(mtx_);
+    while (true)
+    {
+        // Oldest ready batch first, so nonces reach the chain roughly in order.
+        auto now = std::chrono::steady_clock::now();
+        std::shared_ptr<Batch> batch;
+        auto wake = std::chrono::steady_clock::time_point::max();
+        for (const auto &entry : outbox_)
+        {
+            if (entry.second->inFlight)
+                continue;
+            if (entry.second->nextAttempt <= now)
+            {
+                batch = entry.second;
+                break;
+            }
+            wake = std::min(wake, entry.second->nextAttempt);
+        }
+
+        if (!batch)
+        {
+            if (submittersStopping_)
+                return;
+            if (wake == std::chrono::steady_clock::time_point::max())
+                submitCv_.wait(lock);
+            else
+                submitCv_.wait_until(lock, wake);
+            continue;
+        }
+
+        batch->inFlight = true;
+        batch->attempts++;
+        std::shared_ptr<ChainClient> chain = chain_;
+        ChainTransaction tx{batch->payload, batch->nonce, batch->idempotencyKey};
+        lock.unlock();
+
+        ChainReceipt receipt;
+        {
+            ScopedLatency timer(postLatency);
+            receipt = chain->submit(tx);
+        }
+        postedBatches.add();
+
+        lock.lock();
+        batch->inFlight = false;
+        if (!receipt.accepted && receipt.retryable)
+        {
+            auto delay = backoff(batch->attempts);
+            batch->nextAttempt = std::chrono::steady_clock::now() + delay;
+            retriedBatches.add();
+            TEE_LOG_WARN("OnChainPoster", "Batch {} (nonce {}) attempt {} refused: {}; retrying in {} ms",
+                         batch->id, batch->nonce, batch->attempts, receipt.error, delay.count());
+            continue;
+        }
+        resolveLocked(batch, receipt);
+    }
+}
+
+void OnChainPoster::resolveLocked(const std::shared_ptr<Batch> &batch, const ChainReceipt &receipt)
+{
+    batch->receipt = receipt;
+    std::size_t count = batch->offerIds.size();
+    if (receipt.accepted)
+    {
+        batch->state = InclusionState::Included;
+        postedOffers.add(count);
+        TEE_LOG_INFO("OnChainPoster", "Posted batch {} ({} offers, root {}) in tx {} block {}",
+                     batch->id, count, toHex(batch->root), receipt.txHash, receipt.blockNumber);
+    }
+    else
+    {
+        batch->state = InclusionState::Failed;
+        failedBatches.add();
+        TEE_LOG_ERROR("OnChainPoster", "Chain refused batch {} ({} offers): {}", batch->id, count, receipt.error);
+    }
+    inclusionLatency.record(std::chrono::steady_clock::now() - batch->queuedAt);
+
+    log_.append(doneRecord(batch->id));
+    outbox_.erase(batch->id);
+    batches_.emplace(batch->id, batch);
+    while (batches_.size() > kRetainedBatches)
+    {
+        const Batch &oldest = *batches_.begin()->second;
+        for (const auto &offerId : oldest.offerIds)
+        {
+            auto it = placements_.find(offerId);
+            if (it != placements_.end() && it->second.batchId == oldest.id && it->second.queued == 0)
+                placements_.erase(it);
+        }
+        batches_.erase(batches_.begin());
+    }
+
+    if (outbox_.empty() && waiting_.empty() && log_.bytes() > kOutboxCompactBytes)
+        compactLocked();
+
+    resolvedCount_ += count;
+    flushedCv_.notify_all();
+}
+
+/************************* Queries ************************/
+
+std::optional<InclusionReceipt> OnChainPoster::inclusionReceipt(const std::string &offerId)
+{
+    std::shared_ptr<const Batch> batch;
+    InclusionReceipt receipt;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        auto it = placements_.find(offerId);
+        if (it == placements_.end())
+            return std::nullopt;
+        // A newer post of the offer is still waiting for its batch.
+        if (it->second.queued > 0)
+            return InclusionReceipt{};
+        auto found = outbox_.find(it->second.batchId);
+        if (found == outbox_.end())
+        {
+            found = batches_.find(it->second.batchId);
+            if (found == batches_.end())
+                return InclusionReceipt{};
+        }
+        batch = found->second;
+        receipt.state = batch->state;
+        receipt.txHash = batch->receipt.txHash;
+        receipt.blockNumber = batch->receipt.blockNumber;
+        receipt.error = batch->receipt.error;
+    }
+
+    // Ids, leaves and root are fixed when the batch is cut.
+    receipt.batchId = batch->id;
+    receipt.batchSize = batch->leaves.size();
+    receipt.root = batch->root;
+    // The same offer can appear twice in one batch; the last entry wins.
+    for (std::size_t i = batch->offerIds.size(); i-- > 0;)
+    {
+        if (batch->offerIds[i] == offerId)
+        {
+            receipt.leafIndex = i;
+            break;
+        }
+    }
+    receipt.leaf = batch->leaves[receipt.leafIndex];
+    receipt.proof = merkleProof(batch->leaves, receipt.leafIndex);
+    return receipt;
+}
+
+PosterBacklog OnChainPoster::backlog()
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    return PosterBacklog{waiting_.size(), outbox_.size()};
 }
@@ -1,12 +1,175 @@
 #ifndef ONCHAINPOSTER_HPP
 #define ONCHAINPOSTER_HPP
 
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
-#include <iostream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "ChainClient.hpp"
+#include "Merkle.hpp"
+#include "OutboxLog.hpp"
+#include "TEEStorage.hpp"
 
+struct FinancialDetails
+{
+    std::string offerId;
+    double price;
+    int preferredBuyers;
+    int expiryDays;
+    int cooldownMonths;
+    std::string fdePublicKey;
+};
+
+// Canonical encoding of one offer's details; its merkleLeafHash is the batch leaf.
+std::string encodeFinancialDetails(const FinancialDetails &details);
+
+enum class BatchEncoding
+{
+    Packed,    // the transaction carries every offer's details plus the root
+    MerkleRoot // the transaction carries only the root and the offer count
+};
+
+struct PosterConfig
+{
+    std::size_t maxBatch = 64;                        // submit once this many offers wait...
+    std::chrono::milliseconds window{200};            // ...or once the oldest has waited this long
+    BatchEncoding encoding = BatchEncoding::Packed;
+    std::string outboxPath;                           // journal of undelivered work; empty = memory only
+    std::size_t pipelineDepth = 4;                    // batch transactions in flight at once
+    std::chrono::milliseconds retryBackoff{100};      // first retry delay, doubled per attempt...
+    std::chrono::milliseconds maxRetryBackoff{30000}; // ...up to this
+};
+
+enum class InclusionState
+{
+    Queued, // waiting for its batch to be cut, submitted or retried
+    Included,
+    Failed
+};
+
+// Where an offer's financial details ended up: batch, transaction and the
+// Merkle path from its leaf (see encodeFinancialDetails) to the batch root.
+struct InclusionReceipt
+{
+    InclusionState state = InclusionState::Queued;
+    std::uint64_t batchId = 0;
+    std::string txHash;
+    std::uint64_t blockNumber = 0;
+    std::size_t leafIndex = 0;
+    std::size_t batchSize = 0;
+    MerkleHash leaf{};
+    MerkleHash root{};
+    std::vector<MerkleHash> proof;
+    std::string error;
+};
+
+struct PosterBacklog
+{
+    std::size_t waitingOffers = 0;      // not yet cut into a batch
+    std::size_t undeliveredBatches = 0; // cut, not yet included or refused for good
+};
+
+// Accumulates financial details and posts them as one transaction per
+// batch. Posting only queues (and appends to the outbox); a flusher thread
+// cuts batches and a pool of submitters sends them to the ChainClient with
+// their own nonce and idempotency key, retrying with exponential backoff,
+// so ingest never waits on the chain. With an outbox configured, queued
+// offers and undelivered batches are replayed on the next start.
 class OnChainPoster
 {
+private:
+    struct Batch
+    {
+        std::uint64_t id = 0;
+        std::uint64_t nonce = 0;
+        BatchEncoding encoding = BatchEncoding::Packed;
+        std::string payload;
+        std::string idempotencyKey;
+        InclusionState state = InclusionState::Queued;
+        ChainReceipt receipt;
+        std::vector<std::string> offerIds;
+        std::vector<std::string> leafTexts; // encodeFinancialDetails of each offer
+        std::vector<MerkleHash> leaves;
+        MerkleHash root{};
+        std::optional<CatalogCommitment> catalog; // published alongside, if a source is set
+        // Submission bookkeeping, guarded by mtx_.
+        unsigned attempts = 0;
+        bool inFlight = false;
+        std::chrono::steady_clock::time_point nextAttempt;
+        std::chrono::steady_clock::time_point queuedAt;
+    };
+
+    struct Placement
+    {
+        std::uint64_t batchId = 0; // latest submitted batch holding the offer
+        std::uint32_t queued = 0;  // posts of it still waiting
+    };
+
+    // Receipts are kept for the most recent batches only.
+    static constexpr std::size_t kRetainedBatches = 4096;
+    // A drained outbox is truncated once it grows past this.
+    static constexpr std::uint64_t kOutboxCompactBytes = 4 << 20;
+
+    PosterConfig config_;
+    std::shared_ptr<ChainClient> chain_;
+    std::function<CatalogCommitment()> catalogSource_;
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::condition_variable submitCv_;
+    std::condition_variable flushedCv_;
+    std::vector<FinancialDetails> waiting_;
+    std::chrono::steady_clock::time_point oldestWaiting_;
+    std::uint64_t queuedCount_ = 0;
+    std::uint64_t resolvedCount_ = 0; // included or refused for good
+    bool flushRequested_ = false;
+    bool stopping_ = false;
+    bool submittersStopping_ = false;
+    bool started_ = false;
+    std::uint64_t nextBatchId_ = 1;
+    std::uint64_t nextNonce_ = 0;
+    std::unordered_map<std::string, Placement> placements_;
+    std::map<std::uint64_t, std::shared_ptr<Batch>> outbox_;  // undelivered, by id
+    std::map<std::uint64_t, std::shared_ptr<Batch>> batches_; // delivered, by id
+    OutboxLog log_;
+    std::thread flusher_;
+    std::vector<std::thread> submitters_;
+
+    void startLocked();
+    void restoreLocked(const std::vector<std::string> &records);
+    void compactLocked();
+    void flushLoop();
+    void submitLoop();
+    std::shared_ptr<Batch> makeBatch(std::uint64_t id, std::uint64_t nonce, BatchEncoding encoding,
+                                     const std::vector<FinancialDetails> &details,
+                                     const std::optional<CatalogCommitment> &catalog) const;
+    void enqueueLocked(std::shared_ptr<Batch> batch);
+    void resolveLocked(const std::shared_ptr<Batch> &batch, const ChainReceipt &receipt);
+    std::chrono::milliseconds backoff(unsigned attempts) const;
+
 public:
+    OnChainPoster();
+    // Cuts whatever is still waiting into batches and submits what the chain
+    // takes; batches backing off stay in the outbox for the next start.
+    ~OnChainPoster();
+
+    OnChainPoster(const OnChainPoster &) = delete;
+    OnChainPoster &operator=(const OnChainPoster &) = delete;
+
+    // Call before posting; defaults are PosterConfig{} and a LoggingChainClient.
+    // Replays config.outboxPath, if set, and starts the submitters.
+    void configure(const PosterConfig &config, std::shared_ptr<ChainClient> chain);
+
+    // Each batch cut afterwards also carries the catalog root of the moment.
+    void setCatalogSource(std::function<CatalogCommitment()> source);
+
     void postFinancialDetails(
         const std::string &offerId,
         double price,
@@ -14,6 +177,15 @@ public:
         int expiryDays,
         int cooldownMonths,
         const std::string &fdePublicKey);
+
+    // Queues several offers at once; they share a batch when they fit.
+    void postFinancialDetailsBatch(const std::vector<FinancialDetails> &batch);
+
+    // Blocks until everything queued so far is included or refused for good.
+    void flush();
+
+    std::optional<InclusionReceipt> inclusionReceipt(const std::string &offerId);
+    PosterBacklog backlog();
 };
 
 #endif // ONCHAINPOSTER_HPP
@@ -0,0 +1,119 @@
+#include "OutboxLog.hpp"
+#include "Logger.hpp"
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+static bool writeAll(int fd, const std::string &data)
+{
+    std::size_t written = 0;
+    while (written < data.size())
+    {
+        ssize_t n = ::write(fd, data.data() + written, data.size() - written);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        written += static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+OutboxLog::~OutboxLog()
+{
+    if (fd_ >= 0)
+        ::close(fd_);
+}
+
+bool OutboxLog::open(const std::string &path, std::vector<std::string> &records)
+{
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0600);
+    if (fd < 0)
+    {
+        TEE_LOG_ERROR("OutboxLog", "Cannot open outbox {}: errno {}", path, errno);
+        return false;
+    }
+
+    std::string contents;
+    char buf[64 * 1024];
+    while (true)
+    {
+        ssize_t n = ::read(fd, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+        {
+            TEE_LOG_ERROR("OutboxLog", "Cannot read outbox {}: errno {}", path, errno);
+            ::close(fd);
+            return false;
+        }
+        if (n == 0)
+            break;
+        contents.append(buf, static_cast<std::size_t>(n));
+    }
+
+    std::size_t start = 0;
+    for (std::size_t end = contents.find('\n'); end != std::string::npos; end = contents.find('\n', start))
+    {
+        records.emplace_back(contents, start, end - start);
+        start = end + 1;
+    }
+    if (start < contents.size())
+    {
+        TEE_LOG_WARN("OutboxLog", "Dropping torn record ({} bytes) at the end of {}", contents.size() - start, path);
+        if (::ftruncate(fd, static_cast<off_t>(start)) != 0)
+            TEE_LOG_WARN("OutboxLog", "Cannot truncate outbox {}: errno {}", path, errno);
+    }
+
+    if (fd_ >= 0)
+        ::close(fd_);
+    fd_ = fd;
+    path_ = path;
+    bytes_ = start;
+    return true;
+}
+
+bool OutboxLog::append(const std::string &records)
+{
+    if (fd_ < 0)
+        return false;
+    if (!writeAll(fd_, records))
+    {
+        TEE_LOG_ERROR("OutboxLog", "Append to outbox {} failed: errno {}", path_, errno);
+        return false;
+    }
+    bytes_ += records.size();
+    return true;
+}
+
+bool OutboxLog::sync()
+{
+    return fd_ >= 0 && ::fdatasync(fd_) == 0;
+}
+
+bool OutboxLog::rewrite(const std::string &records)
+{
+    if (fd_ < 0)
+        return false;
+
+    std::string tmpPath = path_ + ".tmp";
+    int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0600);
+    if (fd < 0)
+        return false;
+    bool ok = writeAll(fd, records) && ::fsync(fd) == 0;
+    ok = ok && ::rename(tmpPath.c_str(), path_.c_str()) == 0;
+    if (!ok)
+    {
+        TEE_LOG_ERROR("OutboxLog", "Rewriting outbox {} failed: errno {}", path_, errno);
+        ::close(fd);
+        ::unlink(tmpPath.c_str());
+        return false;
+    }
+
+    ::close(fd_);
+    fd_ = fd;
+    bytes_ = records.size();
+    return true;
+}
@@ -0,0 +1,41 @@
+#ifndef OUTBOXLOG_HPP
+#define OUTBOXLOG_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Append-only file of newline-terminated records; OnChainPoster keeps its
+// undelivered work here so it survives restarts. Not synchronized: the owner
+// serializes append() and rewrite(), while sync() may run alongside them.
+class OutboxLog
+{
+private:
+    std::string path_;
+    int fd_ = -1;
+    std::uint64_t bytes_ = 0;
+
+public:
+    OutboxLog() = default;
+    ~OutboxLog();
+
+    OutboxLog(const OutboxLog &) = delete;
+    OutboxLog &operator=(const OutboxLog &) = delete;
+
+    // Opens (or creates) the file and returns its complete records; a torn
+    // last record, left by a crash mid-append, is dropped.
+    bool open(const std::string &path, std::vector<std::string> &records);
+    bool isOpen() const { return fd_ >= 0; }
+
+    // Appends one or more records, each ending in '\n'. Reaches the page
+    // cache only; call sync() for it to survive a power loss.
+    bool append(const std::string &records);
+    bool sync();
+
+    // Atomically replaces the whole file (temporary file, fsync, rename).
+    bool rewrite(const std::string &records);
+
+    std::uint64_t bytes() const { return bytes_; }
+};
+
+#endif // OUTBOXLOG_HPP
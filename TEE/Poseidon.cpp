@@ -0,0 +1,566 @@
+#include "Poseidon.hpp"
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+
+using Limbs = std::array<std::uint64_t, 4>;
+using u128 = unsigned __int128;
+
+/*************************
+ * BN254 scalar field
+ ************************/
+// p = 21888242871839275222246405745257275088548364400416034343698204186575808495617
+static constexpr Limbs kModulus = {0x43e1f593f0000001ULL, 0x2833e84879b97091ULL,
+                                   0xb85045b68181585dULL, 0x30644e72e131a029ULL};
+
+// -p^-1 mod 2^64, by Newton's iteration.
+static constexpr std::uint64_t montgomeryInverse()
+{
+    std::uint64_t inv = 1;
+    for (int i = 0; i < 6; ++i)
+        inv *= 2 - kModulus[0] * inv;
+    return ~inv + 1;
+}
+static constexpr std::uint64_t kInv = montgomeryInverse();
+
+static constexpr bool geq(const Limbs &a, const Limbs &b)
+{
+    for (int i = 3; i >= 0; --i)
+    {
+        if (a[i] != b[i])
+            return a[i] > b[i];
+    }
+    return true;
+}
+
+static constexpr Limbs sub(const Limbs &a, const Limbs &b)
+{
+    Limbs r{};
+    std::uint64_t borrow = 0;
+    #pragma GCC unroll 4
+    for (int i = 0; i < 4; ++i)
+    {
+        u128 d = static_cast<u128>(a[i]) - b[i] - borrow;
+        r[i] = static_cast<std::uint64_t>(d);
+        borrow = static_cast<std::uint64_t>(d >> 64) & 1;
+    }
+    return r;
+}
+
+// r - p when r >= p, else r; r < 2p. Branch-free: the comparison is a coin
+// flip on hash data and mispredicting it costs more than the subtraction.
+static constexpr Limbs reduceOnce(const Limbs &r)
+{
+    Limbs d{};
+    std::uint64_t borrow = 0;
+    #pragma GCC unroll 4
+    for (int i = 0; i < 4; ++i)
+    {
+        u128 diff = static_cast<u128>(r[i]) - kModulus[i] - borrow;
+        d[i] = static_cast<std::uint64_t>(diff);
+        borrow = static_cast<std::uint64_t>(diff >> 64) & 1;
+    }
+    std::uint64_t keep = 0 - borrow; // all ones when r < p
+    #pragma GCC unroll 4
+    for (int i = 0; i < 4; ++i)
+        d[i] = (r[i] & keep) | (d[i] & ~keep);
+    return d;
+}
+
+// Both operands below p < 2^254, so the sum never leaves four limbs.
+static constexpr Limbs addMod(const Limbs &a, const Limbs &b)
+{
+    Limbs r{};
+    u128 carry = 0;
+    #pragma GCC unroll 4
+    for (int i = 0; i < 4; ++i)
+    {
+        carry += static_cast<u128>(a[i]) + b[i];
+        r[i] = static_cast<std::uint64_t>(carry);
+        carry >>= 64;
+    }
+    return reduceOnce(r);
+}
+
+static constexpr Limbs subMod(const Limbs &a, const Limbs &b)
+{
+    Limbs r{};
+    std::uint64_t borrow = 0;
+    #pragma GCC unroll 4
+    for (int i = 0; i < 4; ++i)
+    {
+        u128 d = static_cast<u128>(a[i]) - b[i] - borrow;
+        r[i] = static_cast<std::uint64_t>(d);
+        borrow = static_cast<std::uint64_t>(d >> 64) & 1;
+    }
+    std::uint64_t wrap = 0 - borrow;
+    u128 carry = 0;
+    #pragma GCC unroll 4
+    for (int i = 0; i < 4; ++i)
+    {
+        carry += static_cast<u128>(r[i]) + (kModulus[i] & wrap);
+        r[i] = static_cast<std::uint64_t>(carry);
+        carry >>= 64;
+    }
+    return r;
+}
+
+// a * b / 2^256 mod p: CIOS, without the extra carry words, which the top
+// limb of p (below 2^62) makes unnecessary.
+static constexpr Limbs mulMont(const Limbs &a, const Limbs &b)
+{
+    std::uint64_t t[4] = {0, 0, 0, 0};
+    #pragma GCC unroll 4
+    for (int i = 0; i < 4; ++i)
+    {
+        u128 A = static_cast<u128>(a[0]) * b[i] + t[0];
+        t[0] = static_cast<std::uint64_t>(A);
+        std::uint64_t m = t[0] * kInv;
+        u128 C = (static_cast<u128>(m) * kModulus[0] + t[0]) >> 64;
+        A >>= 64;
+        #pragma GCC unroll 4
+        for (int j = 1; j < 4; ++j)
+        {
+            A += static_cast<u128>(a[j]) * b[i] + t[j];
+            t[j] = static_cast<std::uint64_t>(A);
+            A >>= 64;
+            C += static_cast<u128>(m) * kModulus[j] + t[j];
+            t[j - 1] = static_cast<std::uint64_t>(C);
+            C >>= 64;
+        }
+        t[3] = static_cast<std::uint64_t>(A) + static_cast<std::uint64_t>(C);
+    }
+    return reduceOnce(Limbs{t[0], t[1], t[2], t[3]});
+}
+
+// 2^512 mod p, to move integers into Montgomery form.
+static constexpr Limbs computeR2()
+{
+    Limbs x = {1, 0, 0, 0};
+    for (int i = 0; i < 512; ++i)
+        x = addMod(x, x);
+    return x;
+}
+static constexpr Limbs kR2 = computeR2();
+
+static Limbs toMontgomery(const Limbs &canonical) { return mulMont(canonical, kR2); }
+static Limbs fromMontgomery(const Limbs &x) { return mulMont(x, Limbs{1, 0, 0, 0}); }
+
+static Limbs pow5(const Limbs &a)
+{
+    Limbs a2 = mulMont(a, a);
+    Limbs a4 = mulMont(a2, a2);
+    return mulMont(a4, a);
+}
+
+// a^(p-2); a must be nonzero.
+static Limbs inverse(const Limbs &a)
+{
+    Limbs exponent = sub(kModulus, Limbs{2, 0, 0, 0});
+    Limbs result = toMontgomery(Limbs{1, 0, 0, 0});
+    for (int i = 3; i >= 0; --i)
+    {
+        for (int bit = 63; bit >= 0; --bit)
+        {
+            result = mulMont(result, result);
+            if ((exponent[i] >> bit) & 1)
+                result = mulMont(result, a);
+        }
+    }
+    return result;
+}
+
+FieldElement fieldFromUint(std::uint64_t value)
+{
+    return FieldElement{toMontgomery(Limbs{value, 0, 0, 0})};
+}
+
+FieldElement fieldFromBytes(const unsigned char *bytes, std::size_t len)
+{
+    Limbs canonical{};
+    for (std::size_t i = 0; i < std::min<std::size_t>(len, 31); ++i)
+        canonical[i / 8] |= static_cast<std::uint64_t>(bytes[i]) << (8 * (i % 8));
+    return FieldElement{toMontgomery(canonical)};
+}
+
+bool parseFieldElement(const std::string &decimal, FieldElement &out)
+{
+    if (decimal.empty() || decimal.size() > 78 || (decimal.size() > 1 && decimal[0] == '0'))
+        return false;
+    Limbs x{};
+    for (char c : decimal)
+    {
+        if (c < '0' || c > '9')
+            return false;
+        u128 carry = static_cast<u128>(c - '0');
+        for (int i = 0; i < 4; ++i)
+        {
+            carry += static_cast<u128>(x[i]) * 10;
+            x[i] = static_cast<std::uint64_t>(carry);
+            carry >>= 64;
+        }
+        if (carry != 0)
+            return false;
+    }
+    if (geq(x, kModulus))
+        return false;
+    out.limbs = toMontgomery(x);
+    return true;
+}
+
+std::string toDecimal(const FieldElement &x)
+{
+    static constexpr std::uint64_t kChunk = 10000000000000000000ULL; // 10^19
+    Limbs n = fromMontgomery(x.limbs);
+    std::string digits;
+    while (n[0] || n[1] || n[2] || n[3])
+    {
+        u128 rem = 0;
+        for (int i = 3; i >= 0; --i)
+        {
+            u128 cur = (rem << 64) | n[i];
+            n[i] = static_cast<std::uint64_t>(cur / kChunk);
+            rem = cur % kChunk;
+        }
+        std::uint64_t chunk = static_cast<std::uint64_t>(rem);
+        bool last = !(n[0] || n[1] || n[2] || n[3]);
+        for (int d = 0; d < 19 && (!last || chunk != 0); ++d)
+        {
+            digits.push_back(static_cast<char>('0' + chunk % 10));
+            chunk /= 10;
+        }
+    }
+    if (digits.empty())
+        return "0";
+    std::reverse(digits.begin(), digits.end());
+    return digits;
+}
+
+FieldElement fieldAdd(const FieldElement &a, const FieldElement &b)
+{
+    return FieldElement{addMod(a.limbs, b.limbs)};
+}
+
+FieldElement fieldMul(const FieldElement &a, const FieldElement &b)
+{
+    return FieldElement{mulMont(a.limbs, b.limbs)};
+}
+
+/*************************
+ * Parameters
+ ************************/
+static constexpr std::size_t kMaxWidth = kPoseidonMaxInputs + 1;
+static constexpr std::size_t kFullRounds = 8;
+// By width 2..17; the paper's recommendation rounded up as circomlib does.
+static constexpr std::size_t kPartialRounds[kPoseidonMaxInputs] = {56, 57, 56, 60, 60, 63, 64, 63,
+                                                                    60, 66, 60, 65, 70, 60, 64, 68};
+
+// The permutation in the form the reference implementations evaluate (see
+// generateParams): partial-round constants moved onto element 0 and each
+// partial round's MDS multiply replaced by a sparse one, 2t - 1 products
+// instead of t^2.
+struct PoseidonParams
+{
+    std::size_t width = 0;
+    std::size_t partialRounds = 0;
+    std::vector<Limbs> roundConstants;   // one row of width per round; partial rows unused
+    std::vector<Limbs> partialConstants; // per partial round, added to element 0
+    std::vector<Limbs> mds;              // width x width, row-major
+    std::vector<Limbs> sparse;           // per partial round: m00, row m0j (width - 1), column w (width - 1)
+    std::vector<Limbs> partialExit;      // width x width, applied once after the partial rounds
+};
+
+// The self-shrinking Grain LFSR of the Poseidon reference scripts
+// (generate_parameters_grain.sage), seeded with the instance parameters.
+class GrainGenerator
+{
+private:
+    std::array<std::uint8_t, 80> bits_{};
+    std::size_t head_ = 0; // bits_[head_] is the oldest bit
+
+    std::uint8_t at(std::size_t i) const { return bits_[(head_ + i) % 80]; }
+
+    std::uint8_t step()
+    {
+        std::uint8_t bit = at(62) ^ at(51) ^ at(38) ^ at(23) ^ at(13) ^ at(0);
+        bits_[head_] = bit;
+        head_ = (head_ + 1) % 80;
+        return bit;
+    }
+
+    std::uint8_t nextBit()
+    {
+        while (step() == 0)
+            step();
+        return step();
+    }
+
+public:
+    GrainGenerator(std::size_t width, std::size_t fullRounds, std::size_t partialRounds)
+    {
+        std::size_t pos = 0;
+        auto push = [&](std::uint64_t value, int count) {
+            for (int i = count - 1; i >= 0; --i)
+                bits_[pos++] = static_cast<std::uint8_t>((value >> i) & 1);
+        };
+        push(1, 2);   // prime field
+        push(0, 4);   // x^alpha S-box
+        push(254, 12); // field size in bits
+        push(width, 12);
+        push(fullRounds, 10);
+        push(partialRounds, 10);
+        push((1ULL << 30) - 1, 30);
+        for (int i = 0; i < 160; ++i)
+            step();
+    }
+
+    // A 254-bit integer, most significant bit first.
+    Limbs next254()
+    {
+        Limbs x{};
+        for (int i = 253; i >= 0; --i)
+            x[i / 64] |= static_cast<std::uint64_t>(nextBit()) << (i % 64);
+        return x;
+    }
+};
+
+using Matrix = std::vector<Limbs>; // square, row-major
+
+static Matrix multiply(const Matrix &a, const Matrix &b, std::size_t n)
+{
+    Matrix r(n * n);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        for (std::size_t j = 0; j < n; ++j)
+        {
+            Limbs acc{};
+            for (std::size_t k = 0; k < n; ++k)
+                acc = addMod(acc, mulMont(a[i * n + k], b[k * n + j]));
+            r[i * n + j] = acc;
+        }
+    }
+    return r;
+}
+
+// Gauss-Jordan; false when m is singular.
+static bool invert(Matrix m, std::size_t n, Matrix &inv)
+{
+    const Limbs one = toMontgomery(Limbs{1, 0, 0, 0});
+    inv.assign(n * n, Limbs{});
+    for (std::size_t i = 0; i < n; ++i)
+        inv[i * n + i] = one;
+    for (std::size_t col = 0; col < n; ++col)
+    {
+        std::size_t pivot = col;
+        while (pivot < n && m[pivot * n + col] == Limbs{})
+            ++pivot;
+        if (pivot == n)
+            return false;
+        for (std::size_t k = 0; k < n; ++k)
+        {
+            std::swap(m[pivot * n + k], m[col * n + k]);
+            std::swap(inv[pivot * n + k], inv[col * n + k]);
+        }
+        Limbs scale = inverse(m[col * n + col]);
+        for (std::size_t k = 0; k < n; ++k)
+        {
+            m[col * n + k] = mulMont(m[col * n + k], scale);
+            inv[col * n + k] = mulMont(inv[col * n + k], scale);
+        }
+        for (std::size_t row = 0; row < n; ++row)
+        {
+            Limbs factor = m[row * n + col];
+            if (row == col || factor == Limbs{})
+                continue;
+            for (std::size_t k = 0; k < n; ++k)
+            {
+                m[row * n + k] = subMod(m[row * n + k], mulMont(factor, m[col * n + k]));
+                inv[row * n + k] = subMod(inv[row * n + k], mulMont(factor, inv[col * n + k]));
+            }
+        }
+    }
+    return true;
+}
+
+// Round constants are sampled below p by rejection; the MDS matrix is the
+// Cauchy matrix 1 / (x_i + y_j) over the next 2 * width samples. The
+// reference script's security checks accept that first candidate for
+// every width here, so no resampling is needed (the results match
+// circomlib's poseidon_constants).
+//
+// Then the partial rounds are rewritten (Poseidon paper, appendix B):
+// - a partial round's constants for elements 1.. pass through its S-box
+//   untouched, so they are pushed through the MDS matrix into the next
+//   round, leaving one constant per partial round;
+// - the round's linear layer A is split as A = [1 0; 0 Â] * [a00 r; Â^-1 c I]
+//   (r, c: A's first row and column). The dense left factor leaves element
+//   0 alone, so it commutes with the next round's S-box and constant and is
+//   folded into that round's matrix; after the last partial round it is
+//   applied once.
+static PoseidonParams generateParams(std::size_t width)
+{
+    PoseidonParams params;
+    const std::size_t t = width;
+    params.width = t;
+    params.partialRounds = kPartialRounds[t - 2];
+    GrainGenerator grain(t, kFullRounds, params.partialRounds);
+
+    std::size_t constants = (kFullRounds + params.partialRounds) * t;
+    params.roundConstants.reserve(constants);
+    while (params.roundConstants.size() < constants)
+    {
+        Limbs c = grain.next254();
+        if (!geq(c, kModulus))
+            params.roundConstants.push_back(toMontgomery(c));
+    }
+
+    std::vector<Limbs> samples(2 * t);
+    for (auto &s : samples)
+    {
+        Limbs x = grain.next254();
+        s = toMontgomery(geq(x, kModulus) ? sub(x, kModulus) : x);
+    }
+    params.mds.resize(t * t);
+    for (std::size_t i = 0; i < t; ++i)
+    {
+        for (std::size_t j = 0; j < t; ++j)
+            params.mds[i * t + j] = inverse(addMod(samples[i], samples[t + j]));
+    }
+
+    const std::size_t firstPartial = kFullRounds / 2;
+    for (std::size_t k = 0; k < params.partialRounds; ++k)
+    {
+        Limbs *c = &params.roundConstants[(firstPartial + k) * t];
+        Limbs *next = c + t;
+        for (std::size_t i = 0; i < t; ++i)
+        {
+            for (std::size_t j = 1; j < t; ++j)
+                next[i] = addMod(next[i], mulMont(params.mds[i * t + j], c[j]));
+        }
+        params.partialConstants.push_back(c[0]);
+    }
+
+    const std::size_t h = t - 1;
+    Matrix carried; // dense factor left over from the previous round
+    for (std::size_t k = 0; k < params.partialRounds; ++k)
+    {
+        Matrix a = k == 0 ? params.mds : multiply(params.mds, carried, t);
+        Matrix hat(h * h), hatInv;
+        for (std::size_t i = 0; i < h; ++i)
+            std::copy(&a[(i + 1) * t + 1], &a[(i + 1) * t + t], &hat[i * h]);
+        if (!invert(hat, h, hatInv))
+            throw std::runtime_error("Poseidon: singular MDS submatrix");
+
+        params.sparse.push_back(a[0]);
+        params.sparse.insert(params.sparse.end(), &a[1], &a[t]);
+        for (std::size_t i = 0; i < h; ++i)
+        {
+            Limbs w{};
+            for (std::size_t j = 0; j < h; ++j)
+                w = addMod(w, mulMont(hatInv[i * h + j], a[(j + 1) * t]));
+            params.sparse.push_back(w);
+        }
+
+        carried.assign(t * t, Limbs{});
+        carried[0] = toMontgomery(Limbs{1, 0, 0, 0});
+        for (std::size_t i = 0; i < h; ++i)
+            std::copy(&hat[i * h], &hat[i * h + h], &carried[(i + 1) * t + 1]);
+    }
+    params.partialExit = std::move(carried);
+    return params;
+}
+
+static const PoseidonParams &poseidonParams(std::size_t width)
+{
+    static std::once_flag generated[kPoseidonMaxInputs];
+    static PoseidonParams params[kPoseidonMaxInputs];
+    std::size_t k = width - 2;
+    std::call_once(generated[k], [&] { params[k] = generateParams(width); });
+    return params[k];
+}
+
+/*************************
+ * Permutation
+ ************************/
+// state = matrix * state.
+static void mix(const Limbs *matrix, std::size_t t, Limbs (&state)[kMaxWidth])
+{
+    Limbs mixed[kMaxWidth];
+    for (std::size_t i = 0; i < t; ++i)
+    {
+        const Limbs *row = &matrix[i * t];
+        Limbs acc{};
+        for (std::size_t j = 0; j < t; ++j)
+            acc = addMod(acc, mulMont(row[j], state[j]));
+        mixed[i] = acc;
+    }
+    std::copy(mixed, mixed + t, state);
+}
+
+static void fullRound(const PoseidonParams &params, std::size_t r, Limbs (&state)[kMaxWidth])
+{
+    const std::size_t t = params.width;
+    const Limbs *c = &params.roundConstants[r * t];
+    for (std::size_t i = 0; i < t; ++i)
+        state[i] = pow5(addMod(state[i], c[i]));
+    mix(params.mds.data(), t, state);
+}
+
+static void permute(const PoseidonParams &params, Limbs (&state)[kMaxWidth])
+{
+    const std::size_t t = params.width;
+    const std::size_t half = kFullRounds / 2;
+
+    for (std::size_t r = 0; r < half; ++r)
+        fullRound(params, r, state);
+
+    for (std::size_t k = 0; k < params.partialRounds; ++k)
+    {
+        const Limbs *m = &params.sparse[k * (2 * t - 1)];
+        const Limbs *w = m + t;
+        Limbs x0 = pow5(addMod(state[0], params.partialConstants[k]));
+        Limbs out0 = mulMont(m[0], x0);
+        for (std::size_t j = 1; j < t; ++j)
+        {
+            out0 = addMod(out0, mulMont(m[j], state[j]));
+            state[j] = addMod(state[j], mulMont(w[j - 1], x0));
+        }
+        state[0] = out0;
+    }
+    mix(params.partialExit.data(), t, state);
+
+    for (std::size_t r = half + params.partialRounds; r < kFullRounds + params.partialRounds; ++r)
+        fullRound(params, r, state);
+}
+
+static FieldElement hashOne(const PoseidonParams &params, const FieldElement *inputs)
+{
+    const std::size_t n = params.width - 1;
+    Limbs state[kMaxWidth];
+    state[0] = Limbs{};
+    for (std::size_t i = 0; i < n; ++i)
+        state[i + 1] = inputs[i].limbs;
+    permute(params, state);
+    return FieldElement{state[0]};
+}
+
+FieldElement poseidonHash(const FieldElement *inputs, std::size_t n)
+{
+    if (n == 0 || n > kPoseidonMaxInputs)
+        return FieldElement{};
+    return hashOne(poseidonParams(n + 1), inputs);
+}
+
+FieldElement poseidonHash(const std::vector<FieldElement> &inputs)
+{
+    return poseidonHash(inputs.data(), inputs.size());
+}
+
+void poseidonHashBatch(const FieldElement *inputs, std::size_t n, std::size_t count, FieldElement *out)
+{
+    if (n == 0 || n > kPoseidonMaxInputs)
+        return;
+    const PoseidonParams &params = poseidonParams(n + 1);
+    for (std::size_t k = 0; k < count; ++k)
+        out[k] = hashOne(params, inputs + k * n);
+}
@@ -0,0 +1,43 @@
+#ifndef POSEIDON_HPP
+#define POSEIDON_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Element of the BN254 scalar field, the field circom circuits compute in.
+// Kept in Montgomery form, so limbs are not the canonical integer; compare
+// elements with ==, convert with parseFieldElement / toDecimal.
+struct FieldElement
+{
+    std::array<std::uint64_t, 4> limbs{}; // little-endian
+
+    bool operator==(const FieldElement &other) const { return limbs == other.limbs; }
+    bool operator!=(const FieldElement &other) const { return limbs != other.limbs; }
+};
+
+FieldElement fieldFromUint(std::uint64_t value);
+// Up to 31 bytes read as a little-endian integer (circom's byte packing).
+FieldElement fieldFromBytes(const unsigned char *bytes, std::size_t len);
+// Canonical decimal only: digits, no leading zeros, below the modulus.
+bool parseFieldElement(const std::string &decimal, FieldElement &out);
+std::string toDecimal(const FieldElement &x);
+
+FieldElement fieldAdd(const FieldElement &a, const FieldElement &b);
+FieldElement fieldMul(const FieldElement &a, const FieldElement &b);
+
+constexpr std::size_t kPoseidonMaxInputs = 16;
+
+// circomlib's Poseidon(n), 1 <= n <= 16 (x^5 S-box, 8 full rounds, width
+// n + 1). Round constants and MDS matrices are derived on first use of a
+// width with the reference Grain generator, the same way circomlib's were.
+FieldElement poseidonHash(const FieldElement *inputs, std::size_t n);
+FieldElement poseidonHash(const std::vector<FieldElement> &inputs);
+
+// count independent hashes of n inputs each: inputs[k * n, k * n + n) -> out[k].
+// The parameters are looked up once for the whole batch.
+void poseidonHashBatch(const FieldElement *inputs, std::size_t n, std::size_t count, FieldElement *out);
+
+#endif // POSEIDON_HPP
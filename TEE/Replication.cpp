@@ -0,0 +1,327 @@
+#include "Replication.hpp"
+#include "LocalSocket.hpp"
+#include "OfferJson.hpp"
+#include "Logger.hpp"
+#include <chrono>
+#include <nlohmann/json.hpp>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using json = nlohmann::json;
+
+static constexpr std::size_t kChangeBatch = 256;
+static constexpr int kHeartbeatMs = 250;
+static constexpr int kFollowerTimeoutMs = 5000;
+static constexpr int kReconnectDelayMs = 1000;
+
+static std::int64_t nowMicros()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+/*************************
+ * ReplicationPrimary
+ ************************/
+ReplicationPrimary::ReplicationPrimary(TEEStorage &storage, const std::string &socketPath)
+    : storage_(storage), socketPath_(socketPath)
+{
+}
+
+ReplicationPrimary::~ReplicationPrimary()
+{
+    stop();
+}
+
+void ReplicationPrimary::start()
+{
+    listenFd_ = listenUnixSocket(socketPath_);
+    running_ = true;
+    acceptThread_ = std::thread(&ReplicationPrimary::acceptLoop, this);
+    TEE_LOG_INFO("ReplicationPrimary", "Publishing change log on {}", socketPath_);
+}
+
+void ReplicationPrimary::stop()
+{
+    if (!running_.exchange(false))
+        return;
+
+    if (acceptThread_.joinable())
+        acceptThread_.join();
+    ::close(listenFd_);
+    ::unlink(socketPath_.c_str());
+
+    {
+        std::lock_guard<std::mutex> lock(followersMtx_);
+        for (auto &follower : followers_)
+        {
+            if (follower.fd >= 0)
+                ::shutdown(follower.fd, SHUT_RDWR);
+        }
+    }
+    // Unlocked: each thread takes followersMtx_ to close its fd on the way out.
+    for (auto &follower : followers_)
+        follower.thread.join();
+    followers_.clear();
+}
+
+// Joins followers whose thread has closed its fd, so a follower that keeps
+// reconnecting does not pile up threads.
+void ReplicationPrimary::reapFollowersLocked()
+{
+    for (auto it = followers_.begin(); it != followers_.end();)
+    {
+        if (it->fd >= 0)
+        {
+            ++it;
+            continue;
+        }
+        it->thread.join();
+        it = followers_.erase(it);
+    }
+}
+
+void ReplicationPrimary::acceptLoop()
+{
+    while (running_)
+    {
+        pollfd pfd{listenFd_, POLLIN, 0};
+        if (::poll(&pfd, 1, kHeartbeatMs) <= 0)
+            continue;
+
+        int fd = ::accept(listenFd_, nullptr, nullptr);
+        if (fd < 0)
+            continue;
+
+        std::lock_guard<std::mutex> lock(followersMtx_);
+        reapFollowersLocked();
+        Follower &follower = followers_.emplace_back();
+        follower.fd = fd;
+        follower.thread = std::thread([this, &follower, fd] {
+            serveFollower(fd);
+            std::lock_guard<std::mutex> lock(followersMtx_);
+            ::close(fd);
+            follower.fd = -1;
+        });
+    }
+}
+
+bool ReplicationPrimary::sendSnapshot(int fd, std::uint64_t &seq)
+{
+    std::vector<std::pair<std::string, Offer>> offers;
+    std::vector<std::int64_t> storedAtUs;
+    seq = storage_.snapshot(offers, &storedAtUs);
+
+    json msg;
+    msg["type"] = "snapshot";
+    msg["seq"] = seq;
+    msg["offers"] = json::array();
+    for (std::size_t i = 0; i < offers.size(); ++i)
+    {
+        msg["offers"].push_back({{"offerId", offers[i].first}, {"offer", offers[i].second}, {"storedAtUs", storedAtUs[i]}});
+    }
+    return sendLine(fd, msg.dump());
+}
+
+void ReplicationPrimary::serveFollower(int fd)
+{
+    LineReader reader(fd);
+    std::string hello;
+    bool timedOut = false;
+    if (!reader.readLine(hello, kFollowerTimeoutMs, timedOut))
+        return;
+
+    std::uint64_t seq = 0;
+    try
+    {
+        seq = json::parse(hello).value("since", std::uint64_t{0});
+    }
+    catch (...)
+    {
+        TEE_LOG_WARN("ReplicationPrimary", "Invalid hello from follower.");
+        return;
+    }
+
+    // A follower ahead of us was fed by an earlier incarnation of this primary.
+    bool ok = true;
+    if (seq > storage_.headSequence())
+        ok = sendSnapshot(fd, seq);
+
+    std::vector<StorageChange> batch;
+    while (ok && running_)
+    {
+        batch.clear();
+        if (!storage_.changesSince(seq, kChangeBatch, batch))
+        {
+            ok = sendSnapshot(fd, seq);
+            continue;
+        }
+
+        if (batch.empty())
+        {
+            if (!storage_.waitForChanges(seq, std::chrono::milliseconds(kHeartbeatMs)))
+            {
+                json hb{{"type", "heartbeat"}, {"head", storage_.headSequence()}, {"timeUs", nowMicros()}};
+                ok = sendLine(fd, hb.dump());
+            }
+            continue;
+        }
+
+        std::uint64_t head = storage_.headSequence();
+        for (const auto &change : batch)
+        {
+            json msg{
+                {"type", "change"},
+                {"seq", change.seq},
+                {"head", head},
+                {"timeUs", change.commitTimeUs},
+                {"offerId", change.offerId},
+                {"kind", changeKindName(change.kind)}};
+            if (change.hasOffer)
+            {
+                msg["offer"] = change.offer;
+                msg["storedAtUs"] = change.storedAtUs;
+            }
+            if (!(ok = sendLine(fd, msg.dump())))
+                break;
+        }
+        seq = batch.back().seq;
+    }
+}
+
+/*************************
+ * ReplicationFollower
+ ************************/
+ReplicationFollower::ReplicationFollower(TEEStorage &storage, const std::string &socketPath)
+    : storage_(storage), socketPath_(socketPath)
+{
+}
+
+ReplicationFollower::~ReplicationFollower()
+{
+    stop();
+}
+
+void ReplicationFollower::start()
+{
+    running_ = true;
+    thread_ = std::thread(&ReplicationFollower::run, this);
+}
+
+void ReplicationFollower::stop()
+{
+    if (!running_.exchange(false))
+        return;
+
+    int fd = fd_.load();
+    if (fd >= 0)
+        ::shutdown(fd, SHUT_RDWR);
+    if (thread_.joinable())
+        thread_.join();
+}
+
+ReplicationStatus ReplicationFollower::status()
+{
+    ReplicationStatus st;
+    st.connected = connected_;
+    st.appliedSeq = storage_.headSequence();
+    st.primaryHeadSeq = primaryHeadSeq_;
+    st.lagRecords = st.primaryHeadSeq > st.appliedSeq ? st.primaryHeadSeq - st.appliedSeq : 0;
+    st.lagMicros = lagMicros_;
+    st.snapshotsLoaded = snapshotsLoaded_;
+    return st;
+}
+
+void ReplicationFollower::run()
+{
+    while (running_)
+    {
+        int fd = -1;
+        try
+        {
+            fd = connectUnixSocket(socketPath_);
+        }
+        catch (const std::exception &e)
+        {
+            TEE_LOG_WARN("ReplicationFollower", "{}", e.what());
+            std::this_thread::sleep_for(std::chrono::milliseconds(kReconnectDelayMs));
+            continue;
+        }
+
+        fd_ = fd;
+        connected_ = true;
+        TEE_LOG_INFO("ReplicationFollower", "Connected to primary at {}", socketPath_);
+        tail(fd);
+        connected_ = false;
+        fd_ = -1;
+        ::close(fd);
+
+        if (running_)
+        {
+            TEE_LOG_WARN("ReplicationFollower", "Lost primary, reconnecting.");
+            std::this_thread::sleep_for(std::chrono::milliseconds(kReconnectDelayMs));
+        }
+    }
+}
+
+void ReplicationFollower::tail(int fd)
+{
+    json hello{{"since", storage_.headSequence()}};
+    if (!sendLine(fd, hello.dump()))
+        return;
+
+    LineReader reader(fd);
+    std::string line;
+    bool timedOut = false;
+    while (running_ && reader.readLine(line, kFollowerTimeoutMs, timedOut))
+    {
+        try
+        {
+            json msg = json::parse(line);
+            std::string type = msg.value("type", "");
+            if (type == "change")
+            {
+                StorageChange change;
+                change.seq = msg.value("seq", std::uint64_t{0});
+                change.commitTimeUs = msg.value("timeUs", std::int64_t{0});
+                change.offerId = msg.value("offerId", "");
+                change.kind = parseChangeKind(msg.value("kind", "")).value_or(ChangeKind::Updated);
+                change.hasOffer = msg.contains("offer");
+                if (change.hasOffer)
+                    change.offer = msg.at("offer").get<Offer>();
+                change.storedAtUs = msg.value("storedAtUs", std::int64_t{0});
+                storage_.applyChange(change);
+                primaryHeadSeq_ = msg.value("head", change.seq);
+                lagMicros_ = nowMicros() - change.commitTimeUs;
+            }
+            else if (type == "snapshot")
+            {
+                std::vector<std::pair<std::string, Offer>> offers;
+                std::vector<std::int64_t> storedAtUs;
+                for (const auto &entry : msg.at("offers"))
+                {
+                    offers.emplace_back(entry.value("offerId", ""), entry.at("offer").get<Offer>());
+                    storedAtUs.push_back(entry.value("storedAtUs", std::int64_t{0}));
+                }
+                std::uint64_t seq = msg.value("seq", std::uint64_t{0});
+                storage_.loadSnapshot(seq, std::move(offers), std::move(storedAtUs));
+                primaryHeadSeq_ = seq;
+                lagMicros_ = 0;
+                ++snapshotsLoaded_;
+            }
+            else if (type == "heartbeat")
+            {
+                primaryHeadSeq_ = msg.value("head", std::uint64_t{0});
+                if (storage_.headSequence() >= primaryHeadSeq_)
+                    lagMicros_ = 0;
+            }
+        }
+        catch (const std::exception &e)
+        {
+            TEE_LOG_ERROR("ReplicationFollower", "Invalid record from primary: {}", e.what());
+            return;
+        }
+    }
+}
@@ -0,0 +1,85 @@
+#ifndef REPLICATION_HPP
+#define REPLICATION_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "TEEStorage.hpp"
+
+// Log-shipping replication of TEEStorage over a Unix domain socket.
+//
+// Wire format is one JSON object per line. The follower opens with
+// {"since": N}; the primary answers with a "snapshot" when N is no longer
+// in its change log, then streams "change" records and, while idle,
+// "heartbeat" records carrying its head sequence.
+
+struct ReplicationStatus
+{
+    bool connected = false;
+    std::uint64_t appliedSeq = 0;
+    std::uint64_t primaryHeadSeq = 0;
+    std::uint64_t lagRecords = 0;
+    std::int64_t lagMicros = 0; // primary commit -> follower apply, for the last applied change
+    std::uint64_t snapshotsLoaded = 0;
+};
+
+class ReplicationPrimary
+{
+private:
+    TEEStorage &storage_;
+    std::string socketPath_;
+    int listenFd_ = -1;
+    std::atomic<bool> running_{false};
+    std::thread acceptThread_;
+    struct Follower
+    {
+        int fd = -1; // closed and set to -1 under followersMtx_ when its thread is done
+        std::thread thread;
+    };
+    std::mutex followersMtx_;
+    std::list<Follower> followers_;
+
+    void acceptLoop();
+    void reapFollowersLocked();
+    void serveFollower(int fd);
+    bool sendSnapshot(int fd, std::uint64_t &seq);
+
+public:
+    ReplicationPrimary(TEEStorage &storage, const std::string &socketPath);
+    ~ReplicationPrimary();
+
+    void start();
+    void stop();
+};
+
+class ReplicationFollower
+{
+private:
+    TEEStorage &storage_;
+    std::string socketPath_;
+    std::atomic<bool> running_{false};
+    std::atomic<bool> connected_{false};
+    std::atomic<int> fd_{-1};
+    std::atomic<std::uint64_t> primaryHeadSeq_{0};
+    std::atomic<std::int64_t> lagMicros_{0};
+    std::atomic<std::uint64_t> snapshotsLoaded_{0};
+    std::thread thread_;
+
+    void run();
+    void tail(int fd);
+
+public:
+    ReplicationFollower(TEEStorage &storage, const std::string &socketPath);
+    ~ReplicationFollower();
+
+    void start();
+    void stop();
+
+    ReplicationStatus status();
+};
+
+#endif // REPLICATION_HPP
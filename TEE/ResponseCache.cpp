@@ -0,0 +1,137 @@
+#include "ResponseCache.hpp"
+#include "Metrics.hpp"
+
+static MetricCounter &cacheHits = MetricsRegistry::instance().counter(
+    "tee_response_cache_hits_total", "Reads answered with cached response bytes.");
+static MetricCounter &cacheMisses = MetricsRegistry::instance().counter(
+    "tee_response_cache_misses_total", "Reads that loaded and rendered the response themselves.");
+static MetricCounter &cacheCoalesced = MetricsRegistry::instance().counter(
+    "tee_response_cache_coalesced_total", "Reads that waited for an identical read already in flight.");
+static MetricCounter &cacheEvictions = MetricsRegistry::instance().counter(
+    "tee_response_cache_evictions_total", "Cached responses dropped to stay within capacity.");
+
+// Larger responses are served but not kept, so one blob cannot flush the cache.
+static constexpr std::size_t kMaxEntryShare = 8;
+
+ResponseCache::ResponseCache(std::size_t capacityBytes) : capacityBytes_(capacityBytes)
+{
+}
+
+void ResponseCache::setCapacity(std::size_t capacityBytes)
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    capacityBytes_ = capacityBytes;
+    evictLocked(capacityBytes_);
+}
+
+ResponseCache::Bytes ResponseCache::get(const std::string &key, const Loader &load)
+{
+    std::shared_ptr<Flight> flight;
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        auto it = entries_.find(key);
+        if (it != entries_.end() && it->second.bytes)
+        {
+            lru_.splice(lru_.begin(), lru_, it->second.lru);
+            cacheHits.add();
+            return it->second.bytes;
+        }
+        if (it != entries_.end())
+        {
+            // Hold the flight itself: the entry may be invalidated meanwhile.
+            std::shared_ptr<Flight> leader = it->second.flight;
+            cacheCoalesced.add();
+            loaded_.wait(lock, [&] { return leader->done; });
+            return leader->bytes;
+        }
+        flight = std::make_shared<Flight>();
+        entries_[key].flight = flight;
+        cacheMisses.add();
+    }
+
+    Bytes bytes;
+    try
+    {
+        bytes = load();
+    }
+    catch (...)
+    {
+        finish(key, flight, nullptr);
+        throw;
+    }
+    finish(key, flight, bytes);
+    return bytes;
+}
+
+void ResponseCache::finish(const std::string &key, const std::shared_ptr<Flight> &flight, Bytes bytes)
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        flight->done = true;
+        flight->bytes = bytes;
+        auto it = entries_.find(key);
+        if (it != entries_.end() && it->second.flight == flight)
+        {
+            if (bytes && bytes->size() <= capacityBytes_ / kMaxEntryShare)
+            {
+                it->second.flight.reset();
+                it->second.bytes = std::move(bytes);
+                it->second.lru = lru_.insert(lru_.begin(), key);
+                bytes_ += it->second.bytes->size();
+                evictLocked(capacityBytes_);
+            }
+            else
+            {
+                entries_.erase(it);
+            }
+        }
+    }
+    loaded_.notify_all();
+}
+
+void ResponseCache::eraseLocked(std::unordered_map<std::string, Entry>::iterator it)
+{
+    if (it->second.bytes)
+    {
+        bytes_ -= it->second.bytes->size();
+        lru_.erase(it->second.lru);
+    }
+    entries_.erase(it);
+}
+
+void ResponseCache::evictLocked(std::size_t maxBytes)
+{
+    while (bytes_ > maxBytes && !lru_.empty())
+    {
+        eraseLocked(entries_.find(lru_.back()));
+        cacheEvictions.add();
+    }
+}
+
+void ResponseCache::invalidate(const std::string &key)
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto it = entries_.find(key);
+    if (it != entries_.end())
+        eraseLocked(it);
+}
+
+void ResponseCache::trim(std::size_t maxBytes)
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    evictLocked(maxBytes);
+}
+
+void ResponseCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    entries_.clear();
+    lru_.clear();
+    bytes_ = 0;
+}
+
+ResponseCache::Stats ResponseCache::stats()
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    return Stats{entries_.size(), bytes_, capacityBytes_};
+}
@@ -0,0 +1,78 @@
+#ifndef RESPONSECACHE_HPP
+#define RESPONSECACHE_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Serialized responses by key, for reads that many clients repeat.
+//
+// A miss is filled by one loader call however many readers ask at once:
+// the first becomes the leader and the others wait for its bytes. Entries
+// are immutable shared buffers, so a hit is a lookup and a refcount bump.
+// invalidate() drops the entry and detaches a load in flight, whose bytes
+// still go to its waiters but are not kept, so nothing read before a change
+// is served after it. Least recently used entries go beyond the capacity.
+class ResponseCache
+{
+public:
+    using Bytes = std::shared_ptr<const std::string>;
+    using Loader = std::function<Bytes()>;
+
+    struct Stats
+    {
+        std::size_t entries = 0;
+        std::size_t bytes = 0;
+        std::size_t capacityBytes = 0;
+    };
+
+private:
+    struct Flight
+    {
+        bool done = false;
+        Bytes bytes;
+    };
+
+    struct Entry
+    {
+        Bytes bytes;                    // null while the first load runs
+        std::shared_ptr<Flight> flight; // set while loading
+        std::list<std::string>::iterator lru;
+    };
+
+    std::mutex mtx_;
+    std::condition_variable loaded_;
+    std::unordered_map<std::string, Entry> entries_;
+    std::list<std::string> lru_; // keys of entries holding bytes, most recent first
+    std::size_t capacityBytes_;
+    std::size_t bytes_ = 0;
+
+    void finish(const std::string &key, const std::shared_ptr<Flight> &flight, Bytes bytes);
+    void eraseLocked(std::unordered_map<std::string, Entry>::iterator it);
+    void evictLocked(std::size_t maxBytes);
+
+public:
+    explicit ResponseCache(std::size_t capacityBytes = 64u << 20);
+
+    // 0 keeps nothing, but concurrent misses are still coalesced.
+    void setCapacity(std::size_t capacityBytes);
+
+    // The cached bytes for key, else what load returns. A null result is
+    // handed to the waiters but not cached; if load throws, the waiters get
+    // null and the exception reaches the leader.
+    Bytes get(const std::string &key, const Loader &load);
+
+    void invalidate(const std::string &key);
+    void clear();
+    // Evicts least recently used entries down to maxBytes.
+    void trim(std::size_t maxBytes);
+
+    Stats stats();
+};
+
+#endif // RESPONSECACHE_HPP
@@ -0,0 +1,571 @@
+#ifdef USE_BOOST_BEAST
+
+#include "Router.hpp"
+#include "Logger.hpp"
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <unordered_set>
+
+using json = nlohmann::json;
+
+/*************************
+ * ShardClient
+ ************************/
+ShardClient::ShardClient(boost::asio::io_context &ioc, const ShardEndpoint &endpoint)
+    : ioc_(ioc), endpoint_(endpoint)
+{
+}
+
+void ShardClient::connect()
+{
+    tcp::resolver resolver(ioc_);
+    auto results = resolver.resolve(endpoint_.host, endpoint_.port);
+    auto ws = std::make_unique<websocket::stream<tcp::socket>>(ioc_);
+    boost::asio::connect(ws->next_layer(), results.begin(), results.end());
+    ws->handshake(endpoint_.host + ":" + endpoint_.port, "/");
+    ws->text(true);
+    ws_ = std::move(ws);
+}
+
+std::optional<json> ShardClient::request(const json &msg)
+{
+    // One retry covers a backend that restarted since the last request.
+    for (int attempt = 0; attempt < 2; ++attempt)
+    {
+        try
+        {
+            if (!ws_)
+                connect();
+            ws_->write(boost::asio::buffer(msg.dump()));
+            boost::beast::flat_buffer buffer;
+            ws_->read(buffer);
+            return json::parse(boost::beast::buffers_to_string(buffer.data()));
+        }
+        catch (const json::exception &e)
+        {
+            TEE_LOG_WARN("Router", "Invalid reply from shard {}: {}", endpoint_.name(), e.what());
+            return std::nullopt;
+        }
+        catch (const std::exception &e)
+        {
+            TEE_LOG_WARN("Router", "Shard {} unreachable: {}", endpoint_.name(), e.what());
+            ws_.reset();
+        }
+    }
+    return std::nullopt;
+}
+
+/*************************
+ * Router
+ ************************/
+Router::Router(boost::asio::io_context &ioc, tcp::endpoint endpoint, const std::vector<ShardEndpoint> &shards)
+    : ioc_(ioc), acceptor_(ioc)
+{
+    auto topo = std::make_shared<RouterTopology>();
+    for (const auto &shard : shards)
+    {
+        topo->shards.push_back(shard);
+        topo->ring.addShard(shard.name());
+    }
+    topology_ = topo;
+
+    acceptor_.open(endpoint.protocol());
+    acceptor_.set_option(boost::asio::socket_base::reuse_address(true));
+    acceptor_.bind(endpoint);
+    acceptor_.listen(boost::asio::socket_base::max_listen_connections);
+}
+
+std::shared_ptr<const RouterTopology> Router::topology()
+{
+    std::lock_guard<std::mutex> lock(topologyMtx_);
+    return topology_;
+}
+
+void Router::addShard(const ShardEndpoint &shard)
+{
+    std::lock_guard<std::mutex> lock(topologyMtx_);
+    auto next = std::make_shared<RouterTopology>(*topology_);
+    next->previous = topology_;
+    next->shards.push_back(shard);
+    next->ring.addShard(shard.name());
+    topology_ = next;
+    TEE_LOG_INFO("Router", "Added shard {} ({} shards)", shard.name(), next->shards.size());
+}
+
+void Router::run()
+{
+    while (true)
+    {
+        tcp::socket socket(ioc_);
+        boost::system::error_code ec;
+        acceptor_.accept(socket, ec);
+        if (ec)
+        {
+            TEE_LOG_WARN("Router", "Accept error: {}", ec.message());
+            continue;
+        }
+        std::thread(&Router::serveClient, this, std::move(socket)).detach();
+    }
+}
+
+void Router::serveClient(tcp::socket socket)
+{
+    boost::asio::io_context clientIoc;
+    std::vector<std::unique_ptr<ShardClient>> clients;
+    bool fromLoopback = false;
+
+    try
+    {
+        fromLoopback = socket.remote_endpoint().address().is_loopback();
+        websocket::stream<tcp::socket> ws(std::move(socket));
+        ws.accept();
+        ws.text(true);
+
+        while (true)
+        {
+            boost::beast::flat_buffer buffer;
+            ws.read(buffer);
+
+            json response;
+            try
+            {
+                auto msg = json::parse(boost::beast::buffers_to_string(buffer.data()));
+                response = route(msg, fromLoopback, clientIoc, clients);
+            }
+            catch (const json::exception &)
+            {
+                response["status"] = "ERROR";
+                response["message"] = "Invalid JSON.";
+            }
+            ws.write(boost::asio::buffer(response.dump()));
+        }
+    }
+    catch (const std::exception &e)
+    {
+        // Client closed the connection or the socket failed.
+    }
+}
+
+// The offer a message is about. updateOffer and clearAuction carry it only
+// inside their signed payload, which the backend checks against the signature.
+static bool routingOfferId(const json &msg, const std::string &type, std::string &offerId)
+{
+    if (type == "updateOffer" || type == "clearAuction")
+    {
+        auto payload = msg.find("payload");
+        if (payload == msg.end() || !payload->is_string())
+            return false;
+        auto inner = json::parse(payload->get_ref<const std::string &>(), nullptr, false);
+        if (!inner.is_object() || !inner.contains("offerId") || !inner["offerId"].is_string())
+            return false;
+        offerId = inner["offerId"].get<std::string>();
+        return true;
+    }
+    auto id = msg.find("offerId");
+    if (id == msg.end() || !id->is_string())
+        return false;
+    offerId = id->get<std::string>();
+    return true;
+}
+
+json Router::route(const json &msg, bool fromLoopback,
+                   boost::asio::io_context &clientIoc,
+                   std::vector<std::unique_ptr<ShardClient>> &clients)
+{
+    std::string type = msg.value("type", "submitOffer");
+
+    if (type == "listOfferIds")
+        return fanOutListOfferIds(clientIoc, clients);
+
+    if (type == "searchOffers")
+        return fanOutSearch(msg, clientIoc, clients);
+
+    if (type == "getOffers")
+        return splitGetOffers(msg, clientIoc, clients);
+
+    if (type == "submitOffers")
+        return splitSubmitOffers(msg, clientIoc, clients);
+
+    if (type == "addShard")
+    {
+        json response;
+        if (!fromLoopback)
+        {
+            response["status"] = "ERROR";
+            response["message"] = "addShard is only accepted from localhost.";
+            return response;
+        }
+        addShard(ShardEndpoint{msg.value("host", "127.0.0.1"), msg.value("port", "")});
+        response["status"] = "OK";
+        response["shardCount"] = topology()->shards.size();
+        return response;
+    }
+
+    std::string offerId;
+    if (!routingOfferId(msg, type, offerId))
+    {
+        json response;
+        response["status"] = "ERROR";
+        response["message"] = "Message type " + type + " cannot be routed without an offerId.";
+        return response;
+    }
+
+    auto topo = topology();
+    std::size_t owner = topo->ring.shardFor(offerId);
+    json response = forward(msg, owner, clientIoc, clients);
+
+    // An offer stored before its shard was added still lives on its previous owner.
+    bool followsOffer = type == "getOffer" || type == "updateOffer" || type == "clearAuction";
+    if (followsOffer && response.value("status", "") != "OK")
+    {
+        for (auto prev = topo->previous; prev; prev = prev->previous)
+        {
+            std::size_t prevOwner = prev->ring.shardFor(offerId);
+            if (prevOwner == owner)
+                continue;
+            json fallback = forward(msg, prevOwner, clientIoc, clients);
+            if (fallback.value("status", "") == "OK")
+                return fallback;
+            owner = prevOwner;
+        }
+    }
+    return response;
+}
+
+json Router::forward(const json &msg, std::size_t shard,
+                     boost::asio::io_context &clientIoc,
+                     std::vector<std::unique_ptr<ShardClient>> &clients)
+{
+    auto topo = topology();
+    // Shards are only ever appended, so indices stay valid across topologies.
+    while (clients.size() < topo->shards.size())
+    {
+        clients.push_back(std::make_unique<ShardClient>(clientIoc, topo->shards[clients.size()]));
+    }
+
+    auto reply = clients[shard]->request(msg);
+    if (reply.has_value())
+        return *reply;
+
+    json response;
+    response["status"] = "ERROR";
+    response["message"] = "Shard " + topo->shards[shard].name() + " unavailable.";
+    return response;
+}
+
+std::vector<std::optional<json>> Router::scatter(const std::vector<json> &requests,
+                                                 boost::asio::io_context &clientIoc,
+                                                 std::vector<std::unique_ptr<ShardClient>> &clients)
+{
+    auto topo = topology();
+    while (clients.size() < topo->shards.size())
+    {
+        clients.push_back(std::make_unique<ShardClient>(clientIoc, topo->shards[clients.size()]));
+    }
+
+    // Each ShardClient is only touched by its own task, so the requests run in parallel.
+    std::vector<std::future<std::optional<json>>> futures(requests.size());
+    for (std::size_t s = 0; s < requests.size(); ++s)
+    {
+        if (!requests[s].is_null())
+            futures[s] = std::async(std::launch::async, [&, s] { return clients[s]->request(requests[s]); });
+    }
+    std::vector<std::optional<json>> replies(requests.size());
+    for (std::size_t s = 0; s < requests.size(); ++s)
+    {
+        if (futures[s].valid())
+            replies[s] = futures[s].get();
+    }
+    return replies;
+}
+
+json Router::fanOutListOfferIds(boost::asio::io_context &clientIoc,
+                                std::vector<std::unique_ptr<ShardClient>> &clients)
+{
+    auto topo = topology();
+    auto replies = scatter(std::vector<json>(topo->shards.size(), json{{"type", "listOfferIds"}}), clientIoc, clients);
+
+    std::vector<std::string> ids;
+    json failedShards = json::array();
+    for (std::size_t i = 0; i < replies.size(); ++i)
+    {
+        const auto &reply = replies[i];
+        if (!reply.has_value() || reply->value("status", "") != "OK")
+        {
+            failedShards.push_back(topo->shards[i].name());
+            continue;
+        }
+        for (const auto &id : reply->value("offerIds", json::array()))
+        {
+            ids.push_back(id.get<std::string>());
+        }
+    }
+
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+    json response;
+    response["status"] = "OK";
+    response["offerIds"] = ids;
+    if (!failedShards.empty())
+    {
+        response["partial"] = true;
+        response["failedShards"] = failedShards;
+    }
+    return response;
+}
+
+// Every shard returns its own best limit hits, so the best limit overall are
+// among them. Ties rank by offerId, since document numbers are per shard.
+json Router::fanOutSearch(const json &msg, boost::asio::io_context &clientIoc,
+                          std::vector<std::unique_ptr<ShardClient>> &clients)
+{
+    static constexpr std::int64_t kDefaultSearchLimit = 20; // as tee_service
+
+    json response;
+    auto rankField = msg.find("rank");
+    auto limitField = msg.find("limit");
+    std::string rank = rankField != msg.end() && rankField->is_string() ? rankField->get<std::string>() : "recent";
+    if ((rankField != msg.end() && !rankField->is_string()) || (rank != "recent" && rank != "price" && rank != "price_desc"))
+    {
+        response["status"] = "ERROR";
+        response["message"] = "rank must be recent, price or price_desc.";
+        return response;
+    }
+    if (limitField != msg.end() && !limitField->is_number_integer())
+    {
+        response["status"] = "ERROR";
+        response["message"] = "limit must be an integer.";
+        return response;
+    }
+    std::int64_t limit = limitField != msg.end() ? limitField->get<std::int64_t>() : kDefaultSearchLimit;
+
+    auto start = std::chrono::steady_clock::now();
+    auto topo = topology();
+    auto replies = scatter(std::vector<json>(topo->shards.size(), msg), clientIoc, clients);
+
+    std::vector<json> hits;
+    std::uint64_t total = 0;
+    json failedShards = json::array();
+    for (std::size_t i = 0; i < replies.size(); ++i)
+    {
+        const auto &reply = replies[i];
+        if (!reply.has_value())
+        {
+            failedShards.push_back(topo->shards[i].name());
+            continue;
+        }
+        // A bad query fails the same way on every shard; pass the reason on.
+        if (reply->value("status", "") != "OK")
+            return *reply;
+        total += reply->value("total", std::uint64_t{0});
+        for (const auto &hit : reply->value("offers", json::array()))
+            hits.push_back(hit);
+    }
+
+    auto key = [&](const json &hit) {
+        if (rank == "recent")
+            return static_cast<double>(hit.value("storedAtUs", std::int64_t{0}));
+        double price = hit.value("reservePrice", 0.0);
+        return rank == "price" ? -price : price;
+    };
+    std::sort(hits.begin(), hits.end(), [&](const json &a, const json &b) {
+        double ka = key(a), kb = key(b);
+        return ka > kb || (ka == kb && a.value("offerId", "") < b.value("offerId", ""));
+    });
+    // An offer resubmitted after an addShard may briefly live on two shards.
+    json offers = json::array();
+    std::unordered_set<std::string> seen;
+    for (auto &hit : hits)
+    {
+        if (static_cast<std::int64_t>(offers.size()) >= std::max<std::int64_t>(0, limit))
+            break;
+        if (seen.insert(hit.value("offerId", "")).second)
+            offers.push_back(std::move(hit));
+    }
+
+    response["status"] = "OK";
+    response["total"] = total;
+    response["offers"] = std::move(offers);
+    response["tookUs"] = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    if (!failedShards.empty())
+    {
+        response["partial"] = true;
+        response["failedShards"] = failedShards;
+    }
+    return response;
+}
+
+// Asks each id's owner, then the previous owners of ids still not found,
+// as route() does for a single getOffer.
+json Router::splitGetOffers(const json &msg, boost::asio::io_context &clientIoc,
+                            std::vector<std::unique_ptr<ShardClient>> &clients)
+{
+    static constexpr std::size_t kMaxIds = 1000; // as tee_service
+
+    json response;
+    auto ids = msg.find("offerIds");
+    if (ids == msg.end() || !ids->is_array() || ids->size() > kMaxIds)
+    {
+        response["status"] = "ERROR";
+        response["message"] = "getOffers requires an offerIds array of at most " + std::to_string(kMaxIds) + " ids.";
+        return response;
+    }
+
+    std::vector<std::string> offerIds;
+    for (const auto &id : *ids)
+    {
+        offerIds.push_back(id.is_string() ? id.get<std::string>() : std::string());
+    }
+
+    json offers = json::array();
+    std::vector<std::size_t> unresolved;
+    std::vector<std::size_t> lastOwner(offerIds.size(), static_cast<std::size_t>(-1));
+    for (std::size_t i = 0; i < offerIds.size(); ++i)
+    {
+        offers.push_back({{"offerId", offerIds[i]}, {"found", false}});
+        unresolved.push_back(i);
+    }
+
+    for (auto topo = topology(); topo && !unresolved.empty(); topo = topo->previous)
+    {
+        std::vector<json> batches(topo->shards.size());
+        std::vector<std::vector<std::size_t>> positions(topo->shards.size());
+        for (std::size_t i : unresolved)
+        {
+            std::size_t owner = topo->ring.shardFor(offerIds[i]);
+            if (owner == lastOwner[i])
+                continue;
+            lastOwner[i] = owner;
+            if (positions[owner].empty())
+            {
+                batches[owner] = msg;
+                batches[owner]["offerIds"] = json::array();
+            }
+            positions[owner].push_back(i);
+            batches[owner]["offerIds"].push_back(offerIds[i]);
+        }
+
+        // Earlier topologies have fewer shards, whose indices are unchanged.
+        auto replies = scatter(batches, clientIoc, clients);
+        for (std::size_t s = 0; s < positions.size(); ++s)
+        {
+            if (positions[s].empty())
+                continue;
+            const auto &reply = replies[s];
+            const json *entries = nullptr;
+            if (reply.has_value() && reply->value("status", "") == "OK")
+            {
+                auto it = reply->find("offers");
+                if (it != reply->end() && it->is_array() && it->size() == positions[s].size())
+                    entries = &*it;
+            }
+            for (std::size_t k = 0; k < positions[s].size(); ++k)
+            {
+                std::size_t i = positions[s][k];
+                if (entries && (*entries)[k].contains("offer"))
+                {
+                    offers[i] = (*entries)[k];
+                    continue;
+                }
+                if (!entries)
+                {
+                    // A refused request (bad fields) fails the same way everywhere.
+                    if (reply.has_value() && reply->value("status", "") != "OK")
+                        return *reply;
+                    offers[i]["message"] = "Shard " + topo->shards[s].name() + " unavailable.";
+                }
+            }
+        }
+        unresolved.erase(std::remove_if(unresolved.begin(), unresolved.end(),
+                                        [&](std::size_t i) { return offers[i].contains("offer"); }),
+                         unresolved.end());
+    }
+
+    response["status"] = "OK";
+    response["offers"] = std::move(offers);
+    return response;
+}
+
+json Router::splitSubmitOffers(const json &msg, boost::asio::io_context &clientIoc,
+                               std::vector<std::unique_ptr<ShardClient>> &clients)
+{
+    json response;
+    auto offers = msg.find("offers");
+    if (offers == msg.end() || !offers->is_array())
+    {
+        response["status"] = "ERROR";
+        response["message"] = "submitOffers requires an offers array.";
+        return response;
+    }
+
+    // Each shard gets the offers it owns, in batch order, with the other fields kept.
+    auto topo = topology();
+    json results = json::array();
+    std::vector<std::vector<std::size_t>> positions(topo->shards.size());
+    std::vector<json> batches(topo->shards.size());
+    for (std::size_t i = 0; i < offers->size(); ++i)
+    {
+        const json &offer = (*offers)[i];
+        auto id = offer.is_object() ? offer.find("offerId") : offer.end();
+        if (!offer.is_object() || id == offer.end() || !id->is_string())
+        {
+            results.push_back({{"offerId", "unknown_offer"}, {"status", "ERROR"},
+                               {"message", "Offer cannot be routed without an offerId."}});
+            continue;
+        }
+        results.push_back(nullptr);
+        std::size_t shard = topo->ring.shardFor(id->get<std::string>());
+        if (positions[shard].empty())
+        {
+            batches[shard] = msg;
+            batches[shard]["offers"] = json::array();
+        }
+        positions[shard].push_back(i);
+        batches[shard]["offers"].push_back(offer);
+    }
+
+    auto replies = scatter(batches, clientIoc, clients);
+    for (std::size_t s = 0; s < topo->shards.size(); ++s)
+    {
+        if (positions[s].empty())
+            continue;
+        const auto &reply = replies[s];
+        const json *shardResults = nullptr;
+        if (reply.has_value() && reply->value("status", "") == "OK")
+        {
+            auto it = reply->find("results");
+            if (it != reply->end() && it->is_array() && it->size() == positions[s].size())
+                shardResults = &*it;
+        }
+
+        for (std::size_t k = 0; k < positions[s].size(); ++k)
+        {
+            std::size_t i = positions[s][k];
+            if (shardResults)
+            {
+                results[i] = (*shardResults)[k];
+                continue;
+            }
+            // A refused or lost sub-batch fails each of its offers with the shard's
+            // status and reason, so BUSY and RATE_LIMITED offers can be retried.
+            std::string status = reply.has_value() ? reply->value("status", "ERROR") : "ERROR";
+            json item{{"offerId", (*offers)[i]["offerId"]}, {"status", status == "OK" ? "ERROR" : status}};
+            if (!reply.has_value())
+                item["message"] = "Shard " + topo->shards[s].name() + " unavailable.";
+            else
+                item["message"] = reply->value("message", "Shard " + topo->shards[s].name() + " rejected the batch.");
+            if (reply.has_value() && reply->contains("retryAfterMs"))
+                item["retryAfterMs"] = (*reply)["retryAfterMs"];
+            results[i] = std::move(item);
+        }
+    }
+
+    response["status"] = "OK";
+    response["results"] = std::move(results);
+    return response;
+}
+
+#endif // USE_BOOST_BEAST
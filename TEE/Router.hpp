@@ -0,0 +1,98 @@
+#ifndef ROUTER_HPP
+#define ROUTER_HPP
+
+#ifdef USE_BOOST_BEAST
+
+#include <boost/asio.hpp>
+#include <boost/beast.hpp>
+#include <boost/beast/websocket.hpp>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "ConsistentHashRing.hpp"
+
+using tcp = boost::asio::ip::tcp;
+namespace websocket = boost::beast::websocket;
+
+struct ShardEndpoint
+{
+    std::string host;
+    std::string port;
+
+    std::string name() const { return host + ":" + port; }
+};
+
+// Immutable view of the shard set. Each addShard publishes a new topology
+// that keeps the one it replaced, so lookups can fall back to a key's
+// previous owner until the offer is resubmitted there.
+struct RouterTopology
+{
+    std::vector<ShardEndpoint> shards;
+    ConsistentHashRing ring;
+    std::shared_ptr<const RouterTopology> previous;
+};
+
+// Blocking WebSocket client for one backend tee_service, owned by one router session.
+class ShardClient
+{
+private:
+    boost::asio::io_context &ioc_;
+    ShardEndpoint endpoint_;
+    std::unique_ptr<websocket::stream<tcp::socket>> ws_;
+
+    void connect();
+
+public:
+    ShardClient(boost::asio::io_context &ioc, const ShardEndpoint &endpoint);
+
+    // Returns std::nullopt if the backend cannot be reached or replies with invalid JSON.
+    std::optional<nlohmann::json> request(const nlohmann::json &msg);
+};
+
+// Front router: consistent-hashes offerId onto backend TEE instances,
+// forwards per-offer messages, splits getOffers and submitOffers batches by
+// owner and fans out listOfferIds and searchOffers with a merge.
+class Router
+{
+private:
+    boost::asio::io_context &ioc_;
+    tcp::acceptor acceptor_;
+    std::mutex topologyMtx_;
+    std::shared_ptr<const RouterTopology> topology_;
+
+    void serveClient(tcp::socket socket);
+    nlohmann::json route(const nlohmann::json &msg, bool fromLoopback,
+                         boost::asio::io_context &clientIoc,
+                         std::vector<std::unique_ptr<ShardClient>> &clients);
+    nlohmann::json forward(const nlohmann::json &msg, std::size_t shard,
+                           boost::asio::io_context &clientIoc,
+                           std::vector<std::unique_ptr<ShardClient>> &clients);
+    // Sends requests[s] to shard s, skipping nulls, all in parallel.
+    std::vector<std::optional<nlohmann::json>> scatter(const std::vector<nlohmann::json> &requests,
+                                                       boost::asio::io_context &clientIoc,
+                                                       std::vector<std::unique_ptr<ShardClient>> &clients);
+    nlohmann::json fanOutListOfferIds(boost::asio::io_context &clientIoc,
+                                      std::vector<std::unique_ptr<ShardClient>> &clients);
+    nlohmann::json fanOutSearch(const nlohmann::json &msg, boost::asio::io_context &clientIoc,
+                                std::vector<std::unique_ptr<ShardClient>> &clients);
+    nlohmann::json splitGetOffers(const nlohmann::json &msg, boost::asio::io_context &clientIoc,
+                                  std::vector<std::unique_ptr<ShardClient>> &clients);
+    nlohmann::json splitSubmitOffers(const nlohmann::json &msg, boost::asio::io_context &clientIoc,
+                                     std::vector<std::unique_ptr<ShardClient>> &clients);
+
+public:
+    Router(boost::asio::io_context &ioc, tcp::endpoint endpoint, const std::vector<ShardEndpoint> &shards);
+
+    void addShard(const ShardEndpoint &shard);
+    std::shared_ptr<const RouterTopology> topology();
+
+    // Accepts clients forever, one thread per connection.
+    void run();
+};
+
+#endif // USE_BOOST_BEAST
+
+#endif // ROUTER_HPP
@@ -0,0 +1,64 @@
+#include "SellerSignature.hpp"
+#include <memory>
+#include <openssl/evp.h>
+
+static constexpr std::size_t kPublicKeyBytes = 32;
+static constexpr std::size_t kSignatureBytes = 64;
+
+static int hexValue(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+bool decodeHex(const std::string &hex, std::string &out)
+{
+    std::size_t start = hex.compare(0, 2, "0x") == 0 ? 2 : 0;
+    if ((hex.size() - start) % 2 != 0)
+        return false;
+
+    out.clear();
+    out.reserve((hex.size() - start) / 2);
+    for (std::size_t i = start; i < hex.size(); i += 2)
+    {
+        int hi = hexValue(hex[i]);
+        int lo = hexValue(hex[i + 1]);
+        if (hi < 0 || lo < 0)
+            return false;
+        out.push_back(static_cast<char>(hi << 4 | lo));
+    }
+    return true;
+}
+
+bool isValidSellerPublicKey(const std::string &publicKeyHex)
+{
+    std::string key;
+    return decodeHex(publicKeyHex, key) && key.size() == kPublicKeyBytes;
+}
+
+bool verifySellerSignature(const std::string &publicKeyHex, const std::string &message, const std::string &signatureHex)
+{
+    std::string key;
+    std::string signature;
+    if (!decodeHex(publicKeyHex, key) || key.size() != kPublicKeyBytes ||
+        !decodeHex(signatureHex, signature) || signature.size() != kSignatureBytes)
+        return false;
+
+    std::unique_ptr<EVP_PKEY, decltype(&EVP_PKEY_free)> pkey(
+        EVP_PKEY_new_raw_public_key(EVP_PKEY_ED25519, nullptr,
+                                    reinterpret_cast<const unsigned char *>(key.data()), key.size()),
+        &EVP_PKEY_free);
+    std::unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)> ctx(EVP_MD_CTX_new(), &EVP_MD_CTX_free);
+    if (!pkey || !ctx || EVP_DigestVerifyInit(ctx.get(), nullptr, nullptr, nullptr, pkey.get()) != 1)
+        return false;
+
+    // Ed25519 is one-shot: the whole message goes through EVP_DigestVerify.
+    return EVP_DigestVerify(ctx.get(),
+                            reinterpret_cast<const unsigned char *>(signature.data()), signature.size(),
+                            reinterpret_cast<const unsigned char *>(message.data()), message.size()) == 1;
+}
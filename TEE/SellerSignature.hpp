@@ -0,0 +1,13 @@
+#ifndef SELLERSIGNATURE_HPP
+#define SELLERSIGNATURE_HPP
+
+#include <string>
+
+// Ed25519 signatures made by a seller over an offer update. The seller's
+// public key (32 bytes) and signatures (64 bytes) travel as hex. A check
+// takes tens of microseconds, against milliseconds for a proof.
+bool decodeHex(const std::string &hex, std::string &out);
+bool isValidSellerPublicKey(const std::string &publicKeyHex);
+bool verifySellerSignature(const std::string &publicKeyHex, const std::string &message, const std::string &signatureHex);
+
+#endif // SELLERSIGNATURE_HPP
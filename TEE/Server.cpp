@@ -1,112 +1,1092 @@
 #ifdef USE_BOOST_BEAST
 
 #include "WebSocketServer.hpp"
+#include "OfferJson.hpp"
+#include "Logger.hpp"
+#include "Metrics.hpp"
 #include <boost/asio/strand.hpp>
-#include <nlohmann/json.hpp>
-#include <iostream>
+#include <algorithm>
+#include <cctype>
 
 using json = nlohmann::json;
+namespace http = boost::beast::http;
 
-Session::Session(tcp::socket socket, TEEEngine &engine)
-    : ws_(std::move(socket)), engine_(engine)
+static LatencyHistogram &dispatchLatency = MetricsRegistry::instance().histogram(
+    "tee_ws_dispatch_seconds", "Time to parse and dispatch one WebSocket message on the I/O thread.");
+static LatencyHistogram &writeLatency = MetricsRegistry::instance().histogram(
+    "tee_ws_write_seconds", "Time from queueing a WebSocket response to its write completing.");
+static MetricCounter &messagesRead = MetricsRegistry::instance().counter(
+    "tee_ws_messages_read_total", "WebSocket messages received.");
+static MetricCounter &bytesRead = MetricsRegistry::instance().counter(
+    "tee_ws_read_bytes_total", "WebSocket payload bytes received.");
+static MetricCounter &bytesWritten = MetricsRegistry::instance().counter(
+    "tee_ws_written_bytes_total", "WebSocket payload bytes sent.");
+static MetricCounter &notificationsDropped = MetricsRegistry::instance().counter(
+    "tee_ws_notifications_dropped_total", "offerMatched messages dropped for a connection too far behind.");
+
+// A connection with this many writes queued gets no more notifications
+// until it catches up; responses are always queued.
+static constexpr std::size_t kMaxQueuedNotificationWrites = 1024;
+
+// Replies to refused messages carry the earliest time a retry can succeed.
+static json retryLater(const char *status, std::int64_t retryAfterMs, const std::string &message)
+{
+    json response;
+    response["status"] = status;
+    response["retryAfterMs"] = retryAfterMs;
+    response["message"] = message;
+    return response;
+}
+
+// Read-only requests, rate limited separately from offer submissions.
+static bool isQueryMessage(const std::string &type)
+{
+    return type == "getOffer" || type == "getOffers" || type == "listOfferIds" || type == "replicationStatus" ||
+           type == "checkpoint" || type == "memoryUsage" || type == "changesSince" ||
+           type == "pipelineMetrics" || type == "postingReceipt" || type == "catalogRoot" || type == "catalogProof" ||
+           type == "slotStatus" || type == "auctionResult" || type == "searchOffers";
+}
+
+// Buyer-side messages; like queries they cost one token each.
+static bool isPurchaseMessage(const std::string &type)
+{
+    return type == "reserveSlot" || type == "confirmPurchase" || type == "releaseSlot" || type == "submitBid" ||
+           type == "clearAuction" || type == "subscribe" || type == "unsubscribe";
+}
+
+static constexpr std::size_t kDefaultSearchLimit = 20;
+
+// Shared by the searchOffers message and GET /offers/search.
+static json searchResponse(TEEEngine &engine, const std::string &query, const std::string &rankName, std::int64_t limit)
+{
+    json response;
+    QueryRank rank;
+    if (!parseQueryRank(rankName, rank))
+    {
+        response["status"] = "ERROR";
+        response["message"] = "rank must be recent, price or price_desc.";
+        return response;
+    }
+    QueryResult result;
+    std::string error;
+    auto start = std::chrono::steady_clock::now();
+    if (!engine.searchOffers(query, rank, static_cast<std::size_t>(std::max<std::int64_t>(0, limit)), result, error))
+    {
+        response["status"] = "ERROR";
+        response["message"] = error;
+        return response;
+    }
+    json offers = json::array();
+    for (const auto &hit : result.hits)
+        offers.push_back({{"offerId", hit.offerId}, {"reservePrice", hit.reservePrice}, {"storedAtUs", hit.storedAtUs}});
+    response["status"] = "OK";
+    response["total"] = result.total;
+    response["offers"] = std::move(offers);
+    response["tookUs"] = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    return response;
+}
+
+// Decodes one query-string component (%XX escapes, '+' as space).
+static std::string percentDecode(boost::beast::string_view in)
 {
+    std::string out;
+    out.reserve(in.size());
+    for (std::size_t i = 0; i < in.size(); ++i)
+    {
+        if (in[i] == '+')
+            out += ' ';
+        else if (in[i] == '%' && i + 2 < in.size() && std::isxdigit(static_cast<unsigned char>(in[i + 1])) &&
+                 std::isxdigit(static_cast<unsigned char>(in[i + 2])))
+        {
+            out += static_cast<char>(std::stoi(std::string(in.substr(i + 1, 2)), nullptr, 16));
+            i += 2;
+        }
+        else
+            out += in[i];
+    }
+    return out;
+}
+
+Session::Session(tcp::socket socket, TEEEngine &engine, AdmissionController &admission)
+    : ws_(std::move(socket)), engine_(engine), admission_(admission), buckets_(admission.connectionBuckets())
+{
+    boost::system::error_code ec;
+    auto endpoint = ws_.next_layer().remote_endpoint(ec);
+    remoteAddress_ = ec ? "unknown" : endpoint.address().to_string();
+    fromLoopback_ = !ec && endpoint.address().is_loopback();
 }
 
 void Session::run()
 {
+    // Read the HTTP request ourselves so plain GETs (GET /metrics) can be
+    // answered on the same port as WebSocket upgrades.
     auto self = shared_from_this();
-    ws_.async_accept([self](boost::beast::error_code ec) {
-        if (!ec) self->doRead();
+    http::async_read(ws_.next_layer(), buffer_, request_, [self](boost::beast::error_code ec, std::size_t) {
+        if (ec)
+            return;
+        if (!websocket::is_upgrade(self->request_))
+        {
+            self->serveHttp();
+            return;
+        }
+        self->ws_.async_accept(self->request_, [self](boost::beast::error_code ec) {
+            if (!ec) self->doRead();
+        });
+    });
+}
+
+void Session::serveHttp()
+{
+    auto response = std::make_shared<http::response<http::string_body>>();
+    response->version(request_.version());
+    response->keep_alive(false);
+    boost::beast::string_view target = request_.target();
+    boost::beast::string_view path = target.substr(0, target.find('?'));
+    if (request_.method() == http::verb::get && path == "/offers/search")
+    {
+        // GET /offers/search?q=<query>&rank=recent|price|price_desc&limit=N
+        std::string query, rank = "recent";
+        std::int64_t limit = kDefaultSearchLimit;
+        boost::beast::string_view params = path.size() < target.size() ? target.substr(path.size() + 1) : "";
+        while (!params.empty())
+        {
+            boost::beast::string_view param = params.substr(0, params.find('&'));
+            params = param.size() < params.size() ? params.substr(param.size() + 1) : "";
+            std::size_t eq = param.find('=');
+            if (eq == boost::beast::string_view::npos)
+                continue;
+            boost::beast::string_view key = param.substr(0, eq);
+            std::string value = percentDecode(param.substr(eq + 1));
+            if (key == "q")
+                query = value;
+            else if (key == "rank")
+                rank = value;
+            else if (key == "limit")
+                limit = std::strtoll(value.c_str(), nullptr, 10);
+        }
+
+        response->set(http::field::content_type, "application/json");
+        AdmissionDecision decision = admission_.admit(buckets_, remoteAddress_, AdmissionClass::Query, 1);
+        if (!decision.admitted)
+        {
+            response->result(http::status::too_many_requests);
+            response->set(http::field::retry_after, std::to_string((decision.retryAfterMs + 999) / 1000));
+            response->body() = retryLater("RATE_LIMITED", decision.retryAfterMs, decision.reason).dump();
+        }
+        else
+        {
+            json result = searchResponse(engine_, query, rank, limit);
+            response->result(result["status"] == "OK" ? http::status::ok : http::status::bad_request);
+            response->body() = result.dump();
+        }
+    }
+    else if (request_.method() == http::verb::get && target == "/metrics")
+    {
+        response->result(http::status::ok);
+        response->set(http::field::content_type, "text/plain; version=0.0.4");
+        engine_.renderMetrics(response->body());
+        appendMetricHeader(response->body(), "tee_admission_inflight_verifications",
+                           "Offers admitted and not yet finished.", "gauge");
+        appendMetricSample(response->body(), "tee_admission_inflight_verifications",
+                           static_cast<double>(admission_.inFlightVerifications()));
+    }
+    else
+    {
+        response->result(http::status::not_found);
+        response->set(http::field::content_type, "text/plain");
+        response->body() = "Not found\n";
+    }
+    response->prepare_payload();
+
+    auto self = shared_from_this();
+    http::async_write(ws_.next_layer(), *response, [self, response](boost::beast::error_code, std::size_t) {
+        boost::beast::error_code ignored;
+        self->ws_.next_layer().shutdown(tcp::socket::shutdown_send, ignored);
     });
 }
 
 void Session::doRead()
 {
     auto self = shared_from_this();
-    boost::beast::flat_buffer buffer;
-    ws_.async_read(buffer, [self, &buffer](boost::beast::error_code ec, std::size_t bytes_transferred) {
-        boost::ignore_unused(bytes_transferred);
+    buffer_.clear();
+    ws_.async_read(buffer_, [self](boost::beast::error_code ec, std::size_t bytes_transferred) {
         if (ec)
         {
-            std::cerr << "WebSocket read error: " << ec.message() << std::endl;
+            TEE_LOG_DEBUG("Session", "WebSocket read error: {}", ec.message());
+            self->cancel_->cancel();
+            if (self->subscriberId_ != 0)
+                self->engine_.removeSubscriber(self->subscriberId_);
             return;
         }
 
-        auto data = boost::beast::buffers_to_string(buffer.data());
+        ScopedLatency timer(dispatchLatency);
+        messagesRead.add();
+        bytesRead.add(bytes_transferred);
+
+        // Parse straight out of the frame buffer; offer strings are later
+        // moved out of the DOM rather than copied again (see takeOfferRequest).
+        auto frame = self->buffer_.cdata();
+        const char *begin = static_cast<const char *>(frame.data());
         json j;
         try
         {
-            j = json::parse(data);
+            j = json::parse(begin, begin + frame.size());
         }
         catch (...)
         {
-            std::cerr << "Invalid JSON received.\n";
+            TEE_LOG_WARN("Session", "Invalid JSON received.");
+            json response;
+            response["status"] = "ERROR";
+            response["message"] = "Invalid JSON.";
+            self->sendResponse(response);
+            self->doRead();
             return;
         }
 
-        // Minimal handling of the fields
-        std::string offerId = j.value("offerId", "unknown_offer");
-        std::string title = j.value("title", "");
-        auto verifiedKeywordsJson = j.value("verifiedKeywords", std::vector<std::string>{});
-        std::string unverifiedText = j.value("unverifiedText", "");
-        double reservePrice = j.value("reservePrice", 0.0);
-        int buyers = j.value("preferredBuyers", 0);
-        int expiryDays = j.value("expiryDays", 0);
-        int cooldownMonths = j.value("cooldownMonths", 0);
-        std::string pvkFDE = j.value("publicVerificationKeyFDE", "");
-        std::string encPlaintext = j.value("encryptedPlaintext", "");
-        std::string nullifier = j.value("nullifier", "");
-        std::string proofPath = j.value("proofPath", "");
-        std::string publicInputsPath = j.value("publicInputsPath", "");
-
-        std::vector<std::string> verifiedKeywords;
-        for (auto &kw : verifiedKeywordsJson)
-        {
-            verifiedKeywords.push_back(kw);
-        }
-
-        bool success = self->engine_.processOffer(
-            offerId,
-            title,
-            verifiedKeywords,
-            unverifiedText,
-            reservePrice,
-            buyers,
-            expiryDays,
-            cooldownMonths,
-            pvkFDE,
-            encPlaintext,
-            nullifier,
-            proofPath,
-            publicInputsPath);
+        // A mistyped field throws from the typed json accessors; answer it
+        // rather than let the exception unwind out of the io_context.
+        try
+        {
+            self->dispatch(std::move(j));
+        }
+        catch (const std::exception &e)
+        {
+            TEE_LOG_WARN("Session", "Malformed request: {}", e.what());
+            json response;
+            response["status"] = "ERROR";
+            response["message"] = std::string("Malformed request: ") + e.what();
+            self->sendResponse(response);
+        }
+        self->doRead();
+    });
+}
+
+void Session::dispatch(json j)
+{
+    // Messages without a type are offer submissions.
+    std::string type = j.value("type", "submitOffer");
+    if (!admit(type, j))
+        return;
+
+    json response;
+    if (type == "getOffer")
+    {
+        // Whole offers go out as the engine's shared pre-rendered bytes.
+        if (auto rendered = renderedOffer(j))
+        {
+            sendResponse(std::move(rendered));
+            return;
+        }
+        response = handleGetOffer(j);
+    }
+    else if (type == "getOffers")
+        response = handleGetOffers(j);
+    else if (type == "updateOffer")
+        response = handleUpdateOffer(j);
+    else if (type == "listOfferIds")
+        response = handleListOfferIds();
+    else if (type == "replicationStatus")
+        response = handleReplicationStatus();
+    else if (type == "checkpoint")
+        response = handleCheckpoint();
+    else if (type == "memoryUsage")
+        response = handleMemoryUsage();
+    else if (type == "changesSince")
+        response = handleChangesSince(j);
+    else if (type == "pipelineMetrics")
+        response = handlePipelineMetrics();
+    else if (type == "postingReceipt")
+        response = handlePostingReceipt(j);
+    else if (type == "catalogRoot")
+        response = handleCatalogRoot();
+    else if (type == "catalogProof")
+        response = handleCatalogProof(j);
+    else if (type == "reserveSlot")
+        response = handleReserveSlot(j);
+    else if (type == "confirmPurchase")
+        response = handleConfirmPurchase(j);
+    else if (type == "releaseSlot")
+        response = handleReleaseSlot(j);
+    else if (type == "slotStatus")
+        response = handleSlotStatus(j);
+    else if (type == "submitBid")
+        response = handleSubmitBid(j);
+    else if (type == "clearAuction")
+        response = handleClearAuction(j);
+    else if (type == "auctionResult")
+        response = handleAuctionResult(j);
+    else if (type == "subscribe")
+        response = handleSubscribe(j);
+    else if (type == "unsubscribe")
+        response = handleUnsubscribe(j);
+    else if (type == "searchOffers")
+        response = handleSearchOffers(j);
+    else if (type == "submitOffers")
+    {
+        submitOffers(std::move(j));
+        return;
+    }
+    else
+    {
+        // Answered asynchronously once the ingest pipeline is done with it.
+        submitOffer(std::move(j));
+        return;
+    }
+
+    sendResponse(response);
+}
+
+bool Session::admit(const std::string &type, const json &j)
+{
+    AdmissionClass admissionClass =
+        isQueryMessage(type) || isPurchaseMessage(type) ? AdmissionClass::Query : AdmissionClass::Ingest;
+    std::size_t cost = 1;
+    if (type == "submitOffers")
+    {
+        auto offers = j.find("offers");
+        if (offers != j.end() && offers->is_array())
+            cost = offers->size();
+    }
+
+    AdmissionDecision decision = admission_.admit(buckets_, remoteAddress_, admissionClass, cost);
+    if (decision.admitted)
+        return true;
+
+    json response = retryLater("RATE_LIMITED", decision.retryAfterMs, decision.reason);
+    if (admissionClass == AdmissionClass::Ingest && type != "submitOffers")
+        response["offerId"] = j.value("offerId", "unknown_offer");
+    sendResponse(response);
+    return false;
+}
+
+void Session::sendResponse(const json &response)
+{
+    sendResponse(std::make_shared<const std::string>(response.dump()));
+}
+
+void Session::sendResponse(std::shared_ptr<const std::string> payload)
+{
+    writeQueue_.push_back(PendingWrite{std::move(payload), std::chrono::steady_clock::now()});
+    if (writeQueue_.size() == 1)
+        doWrite();
+}
+
+void Session::pushNotification(std::shared_ptr<const std::string> message)
+{
+    if (writeQueue_.size() >= kMaxQueuedNotificationWrites)
+    {
+        notificationsDropped.add();
+        return;
+    }
+    writeQueue_.push_back(PendingWrite{std::move(message), std::chrono::steady_clock::now()});
+    if (writeQueue_.size() == 1)
+        doWrite();
+}
+
+void Session::doWrite()
+{
+    auto self = shared_from_this();
+    ws_.text(true);
+    ws_.async_write(
+        boost::asio::buffer(*writeQueue_.front().payload),
+        [self](boost::beast::error_code ec, std::size_t)
+        {
+            if (ec)
+            {
+                TEE_LOG_WARN("Session", "WebSocket write error: {}", ec.message());
+                self->cancel_->cancel();
+                self->writeQueue_.clear();
+                return;
+            }
+            bytesWritten.add(self->writeQueue_.front().payload->size());
+            writeLatency.record(std::chrono::steady_clock::now() - self->writeQueue_.front().queuedAt);
+            self->writeQueue_.pop_front();
+            if (!self->writeQueue_.empty())
+                self->doWrite();
+        });
+}
+
+void Session::submitOffer(json j)
+{
+    auto self = shared_from_this();
+    std::string offerId = j.value("offerId", "unknown_offer");
+    // Optional "deadlineMs": how long the client is willing to wait for verification.
+    // Read before taking a slot, since a mistyped value throws.
+    auto ticket = engine_.verificationTicket(cancel_, j.value("deadlineMs", 0));
+    AdmissionDecision slot = admission_.acquireVerifications(1);
+    if (!slot.admitted)
+    {
+        json response = retryLater("BUSY", slot.retryAfterMs, slot.reason);
+        response["offerId"] = offerId;
+        sendResponse(response);
+        return;
+    }
 
+    bool queued = engine_.submitOffer(std::move(j), [self](const IngestResult &result) {
+        self->admission_.releaseVerifications(1);
         json response;
-        if (success)
+        if (result.accepted)
+        {
+            // PENDING: stored but hidden until the proof verifies; purged if it does not.
+            response["status"] = result.pending ? "PENDING" : "OK";
+            response["offerId"] = result.offerId;
+        }
+        else
+        {
+            response["status"] = "ERROR";
+            response["offerId"] = result.offerId;
+            response["message"] = result.message.empty() ? "Proof invalid or other error." : result.message;
+        }
+        // Pipeline workers complete jobs; hop back onto the session's executor to write.
+        boost::asio::post(self->ws_.get_executor(), [self, response] { self->sendResponse(response); });
+    }, std::move(ticket));
+
+    if (!queued)
+    {
+        admission_.releaseVerifications(1);
+        json response = retryLater("BUSY", AdmissionController::kVerificationRetryAfterMs, "Ingest queue full, retry later.");
+        response["offerId"] = offerId;
+        sendResponse(response);
+    }
+}
+
+void Session::submitOffers(json j)
+{
+    json response;
+    std::vector<OfferRequest> requests;
+    try
+    {
+        auto &offers = j.at("offers").get_ref<json::array_t &>();
+        requests.reserve(offers.size());
+        for (auto &offer : offers)
+        {
+            requests.push_back(takeOfferRequest(offer));
+        }
+    }
+    catch (const std::exception &e)
+    {
+        response["status"] = "ERROR";
+        response["message"] = std::string("Malformed offers batch: ") + e.what();
+        sendResponse(response);
+        return;
+    }
+
+    std::size_t count = requests.size();
+    auto ticket = engine_.verificationTicket(cancel_, j.value("deadlineMs", 0));
+    AdmissionDecision slot = admission_.acquireVerifications(count);
+    if (!slot.admitted)
+    {
+        sendResponse(retryLater("BUSY", slot.retryAfterMs, slot.reason));
+        return;
+    }
+
+    auto self = shared_from_this();
+    bool queued = engine_.submitOffers(std::move(requests), [self, count](std::vector<IngestResult> results) {
+        self->admission_.releaseVerifications(count);
+        json response;
+        response["status"] = "OK";
+        response["results"] = json::array();
+        for (const auto &result : results)
+        {
+            json item{{"offerId", result.offerId}, {"status", result.accepted ? "OK" : "ERROR"}};
+            if (!result.accepted)
+                item["message"] = result.message;
+            response["results"].push_back(std::move(item));
+        }
+        boost::asio::post(self->ws_.get_executor(), [self, response] { self->sendResponse(response); });
+    }, std::move(ticket));
+
+    if (!queued)
+    {
+        admission_.releaseVerifications(count);
+        sendResponse(retryLater("BUSY", AdmissionController::kVerificationRetryAfterMs, "Too many batches queued, retry later."));
+    }
+}
+
+json Session::handleUpdateOffer(const json &j)
+{
+    std::string offerId;
+    std::string error;
+    json response;
+    if (engine_.updateOffer(j.value("payload", ""), j.value("signature", ""), offerId, error))
+    {
+        response["status"] = "OK";
+    }
+    else
+    {
+        response["status"] = "ERROR";
+        response["message"] = error;
+    }
+    response["offerId"] = offerId;
+    return response;
+}
+
+// Reads the optional "fields" array of a read request; absent means every field.
+static bool requestedFields(const json &j, OfferFieldMask &mask, json &error)
+{
+    mask = kOfferFieldsAll;
+    auto fields = j.find("fields");
+    if (fields == j.end())
+        return true;
+
+    std::string unknown;
+    if (parseOfferFields(*fields, mask, unknown))
+        return true;
+    error["status"] = "ERROR";
+    error["message"] = "Unknown offer field: " + unknown;
+    return false;
+}
+
+// Null unless the request is for a whole stored offer.
+std::shared_ptr<const std::string> Session::renderedOffer(const json &j)
+{
+    auto offerId = j.find("offerId");
+    if (offerId == j.end() || !offerId->is_string() || j.contains("fields"))
+        return nullptr;
+    return engine_.offerResponse(offerId->get_ref<const std::string &>());
+}
+
+json Session::handleGetOffer(const json &j)
+{
+    std::string offerId = j.value("offerId", "");
+    json response;
+    OfferFieldMask mask;
+    if (!requestedFields(j, mask, response))
+        return response;
+
+    if (mask == kOfferFieldsAll)
+    {
+        auto maybeOffer = engine_.findOffer(offerId);
+        if (maybeOffer.has_value())
+        {
+            response["status"] = "OK";
+            response["offerId"] = offerId;
+            response["offer"] = maybeOffer.value();
+            return response;
+        }
+    }
+    else
+    {
+        auto projection = engine_.projectOffer(offerId, mask);
+        if (projection.has_value())
         {
             response["status"] = "OK";
             response["offerId"] = offerId;
+            projectionToJson(response["offer"], projection.value(), mask);
+            return response;
         }
+    }
+    response["status"] = "ERROR";
+    response["message"] = "Offer not found.";
+    return response;
+}
+
+json Session::handleGetOffers(const json &j)
+{
+    static constexpr std::size_t kMaxIds = 1000;
+
+    json response;
+    OfferFieldMask mask;
+    if (!requestedFields(j, mask, response))
+        return response;
+
+    auto ids = j.find("offerIds");
+    if (ids == j.end() || !ids->is_array() || ids->size() > kMaxIds)
+    {
+        response["status"] = "ERROR";
+        response["message"] = "getOffers requires an offerIds array of at most " + std::to_string(kMaxIds) + " ids.";
+        return response;
+    }
+
+    std::vector<std::string> offerIds;
+    offerIds.reserve(ids->size());
+    for (const auto &id : *ids)
+    {
+        offerIds.push_back(id.is_string() ? id.get<std::string>() : std::string());
+    }
+
+    auto projections = engine_.projectOffers(offerIds, mask);
+    json offers = json::array();
+    for (std::size_t i = 0; i < offerIds.size(); ++i)
+    {
+        json entry;
+        entry["offerId"] = offerIds[i];
+        if (projections[i].has_value())
+            projectionToJson(entry["offer"], projections[i].value(), mask);
         else
+            entry["found"] = false;
+        offers.push_back(std::move(entry));
+    }
+    response["status"] = "OK";
+    response["offers"] = std::move(offers);
+    return response;
+}
+
+json Session::handleListOfferIds()
+{
+    json response;
+    response["status"] = "OK";
+    response["offerIds"] = engine_.listOfferIds();
+    return response;
+}
+
+json Session::handleReplicationStatus()
+{
+    json response;
+    auto status = engine_.replicationStatus();
+    if (!status.has_value())
+    {
+        response["status"] = "OK";
+        response["role"] = "primary";
+        return response;
+    }
+
+    response["status"] = "OK";
+    response["role"] = "follower";
+    response["connected"] = status->connected;
+    response["appliedSeq"] = status->appliedSeq;
+    response["primaryHeadSeq"] = status->primaryHeadSeq;
+    response["lagRecords"] = status->lagRecords;
+    response["lagMicros"] = status->lagMicros;
+    response["snapshotsLoaded"] = status->snapshotsLoaded;
+    return response;
+}
+
+json Session::handleCheckpoint()
+{
+    json response;
+    if (!fromLoopback_)
+    {
+        response["status"] = "ERROR";
+        response["message"] = "checkpoint is only accepted from localhost.";
+        return response;
+    }
+    auto last = engine_.checkpointStats();
+    if (!last.has_value())
+    {
+        response["status"] = "ERROR";
+        response["message"] = "Checkpoints are not enabled.";
+        return response;
+    }
+
+    response["status"] = "OK";
+    response["started"] = engine_.checkpointNow();
+    response["last"] = {
+        {"ok", last->ok},
+        {"seq", last->seq},
+        {"offers", last->offers},
+        {"bytesWritten", last->bytesWritten},
+        {"stallMicros", last->stallMicros},
+        {"durationMicros", last->durationMicros},
+        {"cowBytes", last->cowBytes}};
+    return response;
+}
+
+json Session::handleMemoryUsage()
+{
+    auto usage = engine_.memoryUsage();
+    json response;
+    response["status"] = "OK";
+    response["budgetBytes"] = usage.budgetBytes;
+    response["totalBytes"] = usage.totalBytes;
+    response["offersBytes"] = usage.offersBytes;
+    response["changeLogBytes"] = usage.changeLogBytes;
+    response["offerCount"] = usage.offerCount;
+    response["spilledCount"] = usage.spilledCount;
+    response["spilledBytes"] = usage.spilledBytes;
+    response["expiredEvictions"] = usage.expiredEvictions;
+    response["spills"] = usage.spills;
+    response["rejectedStores"] = usage.rejectedStores;
+    response["pendingCount"] = usage.pendingCount;
+    response["pendingBytes"] = usage.pendingBytes;
+    response["responseCacheBytes"] = usage.responseCacheBytes;
+    return response;
+}
+
+json Session::handleChangesSince(const json &j)
+{
+    std::uint64_t since = j.value("since", std::uint64_t{0});
+    std::size_t limit = std::min<std::size_t>(j.value("limit", std::size_t{1000}), 10000);
+
+    json response;
+    response["status"] = "OK";
+    auto page = engine_.changesSince(since, limit);
+    if (page.snapshotRequired)
+    {
+        // The client's position aged out of the ring: resync from a full snapshot.
+        std::vector<std::pair<std::string, Offer>> offers;
+        response["snapshot"] = true;
+        response["seq"] = engine_.snapshotOffers(offers);
+        response["offers"] = json::array();
+        for (const auto &kv : offers)
         {
-            response["status"] = "ERROR";
-            response["message"] = "Proof invalid or other error.";
+            response["offers"].push_back({{"offerId", kv.first}, {"offer", kv.second}});
         }
+        return response;
+    }
 
-        self->ws_.text(true);
-        self->ws_.async_write(
-            boost::asio::buffer(response.dump()),
-            [self](boost::beast::error_code ec, std::size_t)
-            {
-                if (ec)
-                    std::cerr << "WebSocket write error: " << ec.message() << std::endl;
+    response["snapshot"] = false;
+    response["headSeq"] = page.headSeq;
+    response["nextSeq"] = page.nextSeq;
+    response["events"] = json::array();
+    for (const auto &change : page.changes)
+    {
+        json event{
+            {"seq", change.seq},
+            {"timeUs", change.commitTimeUs},
+            {"kind", changeKindName(change.kind)},
+            {"offerId", change.offerId}};
+        if (change.hasOffer)
+            event["offer"] = change.offer;
+        response["events"].push_back(std::move(event));
+    }
+    return response;
+}
+
+json Session::handlePipelineMetrics()
+{
+    json response;
+    response["status"] = "OK";
+    response["stages"] = json::array();
+    for (const auto &m : engine_.pipelineMetrics())
+    {
+        response["stages"].push_back({
+            {"name", m.name},
+            {"workers", m.workers},
+            {"queueCapacity", m.queueCapacity},
+            {"queueDepth", m.queueDepth},
+            {"processed", m.processed},
+            {"rejected", m.rejected},
+            {"avgServiceUs", m.avgServiceUs},
+            {"maxServiceUs", m.maxServiceUs},
+            {"avgQueueWaitUs", m.avgQueueWaitUs}});
+    }
+    return response;
+}
+
+json Session::handlePostingReceipt(const json &j)
+{
+    static const char *states[] = {"queued", "included", "failed"};
+
+    std::string offerId = j.value("offerId", "");
+    auto receipt = engine_.inclusionReceipt(offerId);
+    json response;
+    response["offerId"] = offerId;
+    if (!receipt)
+    {
+        response["status"] = "ERROR";
+        response["message"] = "No on-chain posting known for this offer.";
+        return response;
+    }
+
+    response["status"] = "OK";
+    response["state"] = states[static_cast<int>(receipt->state)];
+    if (receipt->state == InclusionState::Queued)
+        return response;
+
+    json proof = json::array();
+    for (const auto &sibling : receipt->proof)
+        proof.push_back(toHex(sibling));
+    response["batchId"] = receipt->batchId;
+    response["txHash"] = receipt->txHash;
+    response["blockNumber"] = receipt->blockNumber;
+    response["leafIndex"] = receipt->leafIndex;
+    response["batchSize"] = receipt->batchSize;
+    response["leaf"] = toHex(receipt->leaf);
+    response["root"] = toHex(receipt->root);
+    response["proof"] = std::move(proof);
+    if (!receipt->error.empty())
+        response["message"] = receipt->error;
+    return response;
+}
+
+json Session::handleCatalogRoot()
+{
+    CatalogCommitment commitment = engine_.catalogCommitment();
+    json response;
+    response["status"] = "OK";
+    response["root"] = toHex(commitment.root);
+    response["leafCount"] = commitment.leafCount;
+    response["seq"] = commitment.seq;
+    return response;
+}
+
+json Session::handleCatalogProof(const json &j)
+{
+    std::string offerId = j.value("offerId", "");
+    auto proof = engine_.catalogProof(offerId);
+    json response;
+    response["offerId"] = offerId;
+    if (!proof)
+    {
+        response["status"] = "ERROR";
+        response["message"] = "Offer not found.";
+        return response;
+    }
+
+    json siblings = json::array();
+    for (const auto &sibling : proof->proof)
+        siblings.push_back(toHex(sibling));
+    response["status"] = "OK";
+    response["root"] = toHex(proof->commitment.root);
+    response["leafCount"] = proof->commitment.leafCount;
+    response["seq"] = proof->commitment.seq;
+    response["leafIndex"] = proof->leafIndex;
+    response["leaf"] = toHex(proof->leaf);
+    response["leafData"] = proof->leafData;
+    response["proof"] = std::move(siblings);
+    return response;
+}
+
+json Session::handleReserveSlot(const json &j)
+{
+    std::string offerId = j.value("offerId", "");
+    ReservationResult result;
+    std::string error;
+    json response;
+    response["offerId"] = offerId;
+    if (!engine_.reserveSlot(offerId, j.value("buyer", ""), result, error))
+    {
+        response["status"] = "ERROR";
+        response["message"] = error;
+        return response;
+    }
+
+    switch (result.status)
+    {
+    case ReserveStatus::Reserved:
+        response["status"] = "OK";
+        response["reservationId"] = result.reservationId;
+        response["expiresInMs"] = result.expiresInMs;
+        break;
+    case ReserveStatus::Full:
+        response = retryLater("FULL", result.retryAfterMs, "Every slot is reserved; one may free up.");
+        response["offerId"] = offerId;
+        break;
+    case ReserveStatus::SoldOut:
+        response["status"] = "SOLD_OUT";
+        break;
+    case ReserveStatus::UnknownOffer:
+        response["status"] = "ERROR";
+        response["message"] = "Offer not found.";
+        break;
+    }
+    return response;
+}
+
+json Session::handleConfirmPurchase(const json &j)
+{
+    std::string offerId = j.value("offerId", "");
+    std::string reservationId = j.value("reservationId", "");
+    ConfirmStatus status;
+    std::string buyer;
+    std::string error;
+    json response;
+    response["offerId"] = offerId;
+    response["reservationId"] = reservationId;
+    if (!engine_.confirmPurchase(offerId, reservationId, status, buyer, error))
+    {
+        response["status"] = "ERROR";
+        response["message"] = error;
+        return response;
+    }
+
+    // A repeated confirmation is answered like the first, flagged as a repeat.
+    bool confirmed = status == ConfirmStatus::Confirmed || status == ConfirmStatus::AlreadyConfirmed;
+    response["status"] = confirmed ? "OK" : "ERROR";
+    if (confirmed)
+    {
+        response["buyer"] = buyer;
+        response["duplicate"] = status == ConfirmStatus::AlreadyConfirmed;
+    }
+    else
+        response["message"] = status == ConfirmStatus::Expired ? "Reservation expired or unknown." : "Offer not found.";
+    return response;
+}
+
+json Session::handleReleaseSlot(const json &j)
+{
+    std::string offerId = j.value("offerId", "");
+    std::string error;
+    json response;
+    response["offerId"] = offerId;
+    if (engine_.releaseSlot(offerId, j.value("reservationId", ""), error))
+    {
+        response["status"] = "OK";
+    }
+    else
+    {
+        response["status"] = "ERROR";
+        response["message"] = error;
+    }
+    return response;
+}
+
+json Session::handleSlotStatus(const json &j)
+{
+    std::string offerId = j.value("offerId", "");
+    json response;
+    response["offerId"] = offerId;
+    auto counts = engine_.slotCounts(offerId);
+    if (!counts)
+    {
+        response["status"] = "ERROR";
+        response["message"] = engine_.isFollower() ? "Slots are tracked by the primary." : "Offer not found.";
+        return response;
+    }
+    response["status"] = "OK";
+    response["capacity"] = counts->capacity;
+    response["reserved"] = counts->reserved;
+    response["confirmed"] = counts->confirmed;
+    response["available"] = counts->capacity > counts->reserved + counts->confirmed
+                                ? counts->capacity - counts->reserved - counts->confirmed
+                                : 0;
+    return response;
+}
+
+json Session::handleSubmitBid(const json &j)
+{
+    std::string offerId = j.value("offerId", "");
+    auto amount = j.find("amount");
+    std::string error;
+    json response;
+    response["offerId"] = offerId;
+    if (amount == j.end() || !amount->is_number())
+        error = "submitBid requires a numeric amount.";
+    else if (engine_.submitBid(offerId, j.value("bidder", ""), amount->get<double>(), error))
+    {
+        response["status"] = "OK";
+        return response;
+    }
+    response["status"] = "ERROR";
+    response["message"] = error;
+    return response;
+}
+
+static json auctionResultToJson(const AuctionResult &result)
+{
+    json winners = json::array();
+    for (const auto &winner : result.winners)
+        winners.push_back({{"bidder", winner.bidder}, {"bid", winner.bid}});
+    return json{
+        {"rule", clearingRuleName(result.rule)},
+        {"reservePrice", result.terms.reservePrice},
+        {"units", result.terms.units},
+        {"price", result.price},
+        {"winners", std::move(winners)},
+        {"bids", result.bids},
+        {"clearedAtUs", result.clearedAtUs}};
+}
+
+json Session::handleClearAuction(const json &j)
+{
+    std::string offerId;
+    AuctionResult result;
+    std::string error;
+    json response;
+    if (engine_.clearAuction(j.value("payload", ""), j.value("signature", ""), offerId, result, error))
+    {
+        response["status"] = "OK";
+        response["result"] = auctionResultToJson(result);
+    }
+    else
+    {
+        response["status"] = "ERROR";
+        response["message"] = error;
+    }
+    response["offerId"] = offerId;
+    return response;
+}
+
+json Session::handleAuctionResult(const json &j)
+{
+    std::string offerId = j.value("offerId", "");
+    json response;
+    response["offerId"] = offerId;
+    auto result = engine_.auctionResult(offerId);
+    if (!result)
+    {
+        response["status"] = "ERROR";
+        response["message"] = "No auction known for this offer.";
+    }
+    else if (result->clearedAtUs == 0)
+    {
+        response["status"] = "OPEN";
+        response["reservePrice"] = result->terms.reservePrice;
+        response["units"] = result->terms.units;
+    }
+    else
+    {
+        response["status"] = "OK";
+        response["result"] = auctionResultToJson(*result);
+    }
+    return response;
+}
+
+json Session::handleSearchOffers(const json &j)
+{
+    return searchResponse(engine_, j.value("query", ""), j.value("rank", "recent"),
+                          j.value("limit", static_cast<std::int64_t>(kDefaultSearchLimit)));
+}
+
+json Session::handleSubscribe(const json &j)
+{
+    json response;
+    auto list = j.find("keywords");
+    if (list == j.end() || !list->is_array() ||
+        !std::all_of(list->begin(), list->end(), [](const json &k) { return k.is_string(); }))
+    {
+        response["status"] = "ERROR";
+        response["message"] = "keywords must be an array of strings.";
+        return response;
+    }
+    auto keywords = list->get<std::vector<std::string>>();
+
+    // Matches are found on ingest threads; the shared message is queued
+    // on this connection's I/O thread, if it is still open.
+    if (subscriberId_ == 0)
+    {
+        std::weak_ptr<Session> weak = shared_from_this();
+        auto executor = ws_.get_executor();
+        subscriberId_ = engine_.addSubscriber([weak, executor](const std::shared_ptr<const std::string> &message) {
+            boost::asio::post(executor, [weak, message] {
+                if (auto self = weak.lock())
+                    self->pushNotification(message);
             });
+        });
+    }
 
-        self->doRead();
-    });
+    std::uint64_t subscriptionId = 0;
+    std::string error;
+    if (!engine_.subscribe(subscriberId_, keywords, subscriptionId, error))
+    {
+        response["status"] = "ERROR";
+        response["message"] = error;
+        return response;
+    }
+    response["status"] = "OK";
+    response["subscriptionId"] = subscriptionId;
+    return response;
+}
+
+json Session::handleUnsubscribe(const json &j)
+{
+    std::uint64_t subscriptionId = j.value("subscriptionId", std::uint64_t{0});
+    std::string error;
+    json response;
+    response["subscriptionId"] = subscriptionId;
+    if (!engine_.unsubscribe(subscriberId_, subscriptionId, error))
+    {
+        response["status"] = "ERROR";
+        response["message"] = error;
+        return response;
+    }
+    response["status"] = "OK";
+    return response;
 }
 
-Listener::Listener(boost::asio::io_context &ioc, tcp::endpoint endpoint, TEEEngine &engine)
-    : acceptor_(ioc), socket_(ioc), engine_(engine)
+Listener::Listener(boost::asio::io_context &ioc, tcp::endpoint endpoint, TEEEngine &engine, AdmissionController &admission)
+    : acceptor_(ioc), engine_(engine), admission_(admission)
 {
     boost::system::error_code ec;
     acceptor_.open(endpoint.protocol(), ec);
@@ -122,11 +1102,13 @@ void Listener::run()
 
 void Listener::doAccept()
 {
+    // Each connection runs on its own strand, so with several I/O threads
+    // its handlers still never run concurrently.
     auto self = shared_from_this();
-    acceptor_.async_accept(socket_, [self](boost::system::error_code ec) {
+    acceptor_.async_accept(boost::asio::make_strand(acceptor_.get_executor()), [self](boost::system::error_code ec, tcp::socket socket) {
         if (!ec)
         {
-            std::make_shared<Session>(std::move(self->socket_), self->engine_)->run();
+            std::make_shared<Session>(std::move(socket), self->engine_, self->admission_)->run();
         }
         self->doAccept();
     });
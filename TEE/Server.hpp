@@ -6,10 +6,14 @@
 #include <boost/asio.hpp>
 #include <boost/beast.hpp>
 #include <boost/beast/websocket.hpp>
+#include <chrono>
+#include <deque>
 #include <memory>
 #include <string>
 #include <vector>
+#include <nlohmann/json.hpp>
 #include "TEEEngine.hpp"
+#include "AdmissionControl.hpp"
 
 using tcp = boost::asio::ip::tcp;
 namespace websocket = boost::beast::websocket;
@@ -18,12 +22,61 @@ class Session : public std::enable_shared_from_this<Session>
 {
 private:
     websocket::stream<tcp::socket> ws_;
+    boost::beast::flat_buffer buffer_;
+    boost::beast::http::request<boost::beast::http::string_body> request_; // upgrade or plain HTTP GET
     TEEEngine &engine_;
+    AdmissionController &admission_;
+    ConnectionBuckets buckets_;
+    std::string remoteAddress_;
+    bool fromLoopback_ = false; // admin messages (checkpoint) are only taken from localhost
+    // Cancelled when the connection drops, so its queued proof checks are skipped.
+    std::shared_ptr<CancellationToken> cancel_ = std::make_shared<CancellationToken>();
+    struct PendingWrite
+    {
+        std::shared_ptr<const std::string> payload; // notifications and cached reads share one buffer across sessions
+        std::chrono::steady_clock::time_point queuedAt;
+    };
+    std::deque<PendingWrite> writeQueue_; // responses may complete out of order; one write at a time
+    std::uint64_t subscriberId_ = 0;      // registered on the first subscribe
 
+    void serveHttp();
+    bool admit(const std::string &type, const nlohmann::json &j);
     void doRead();
+    // Handles one parsed message; may throw on mistyped fields.
+    void dispatch(nlohmann::json j);
+    void doWrite();
+    void sendResponse(const nlohmann::json &response);
+    void sendResponse(std::shared_ptr<const std::string> payload);
+    void pushNotification(std::shared_ptr<const std::string> message);
+
+    void submitOffer(nlohmann::json j);
+    void submitOffers(nlohmann::json j);
+    nlohmann::json handleUpdateOffer(const nlohmann::json &j);
+    std::shared_ptr<const std::string> renderedOffer(const nlohmann::json &j);
+    nlohmann::json handleGetOffer(const nlohmann::json &j);
+    nlohmann::json handleGetOffers(const nlohmann::json &j);
+    nlohmann::json handleListOfferIds();
+    nlohmann::json handleReplicationStatus();
+    nlohmann::json handleCheckpoint();
+    nlohmann::json handleMemoryUsage();
+    nlohmann::json handleChangesSince(const nlohmann::json &j);
+    nlohmann::json handlePipelineMetrics();
+    nlohmann::json handlePostingReceipt(const nlohmann::json &j);
+    nlohmann::json handleCatalogRoot();
+    nlohmann::json handleCatalogProof(const nlohmann::json &j);
+    nlohmann::json handleReserveSlot(const nlohmann::json &j);
+    nlohmann::json handleConfirmPurchase(const nlohmann::json &j);
+    nlohmann::json handleReleaseSlot(const nlohmann::json &j);
+    nlohmann::json handleSlotStatus(const nlohmann::json &j);
+    nlohmann::json handleSubmitBid(const nlohmann::json &j);
+    nlohmann::json handleClearAuction(const nlohmann::json &j);
+    nlohmann::json handleAuctionResult(const nlohmann::json &j);
+    nlohmann::json handleSubscribe(const nlohmann::json &j);
+    nlohmann::json handleUnsubscribe(const nlohmann::json &j);
+    nlohmann::json handleSearchOffers(const nlohmann::json &j);
 
 public:
-    explicit Session(tcp::socket socket, TEEEngine &engine);
+    Session(tcp::socket socket, TEEEngine &engine, AdmissionController &admission);
     void run();
 };
 
@@ -31,13 +84,13 @@ class Listener : public std::enable_shared_from_this<Listener>
 {
 private:
     tcp::acceptor acceptor_;
-    tcp::socket socket_;
     TEEEngine &engine_;
+    AdmissionController &admission_;
 
     void doAccept();
 
 public:
-    Listener(boost::asio::io_context &ioc, tcp::endpoint endpoint, TEEEngine &engine);
+    Listener(boost::asio::io_context &ioc, tcp::endpoint endpoint, TEEEngine &engine, AdmissionController &admission);
     void run();
 };
 
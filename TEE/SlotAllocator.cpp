@@ -0,0 +1,407 @@
+#include "SlotAllocator.hpp"
+#include "Logger.hpp"
+#include "Metrics.hpp"
+#include <openssl/rand.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+static MetricCounter &reserveAttempts = MetricsRegistry::instance().counter(
+    "tee_slot_reserve_attempts_total", "Slot reservation attempts on known offers.");
+static MetricCounter &reservationsGranted = MetricsRegistry::instance().counter(
+    "tee_slot_reservations_total", "Slot reservations granted.");
+static MetricCounter &purchasesConfirmed = MetricsRegistry::instance().counter(
+    "tee_slot_purchases_confirmed_total", "Reservations confirmed as purchases.");
+static MetricCounter &reservationsLapsed = MetricsRegistry::instance().counter(
+    "tee_slot_reservations_lapsed_total", "Reservations freed because their deadline passed unconfirmed.");
+
+static constexpr std::uint64_t kHeldMask = 0xffffffffULL;
+static constexpr std::uint64_t kConfirmedOne = 1ULL << 32;
+
+static std::int64_t ticksOf(std::chrono::steady_clock::time_point t)
+{
+    return t.time_since_epoch().count();
+}
+
+// 128 random bits in hex. Random bytes are drawn a page at a time: one
+// RAND_bytes call costs about as much as the rest of a reservation.
+static std::string newReservationId()
+{
+    struct RandomPool
+    {
+        unsigned char bytes[4096];
+        std::size_t used = sizeof(bytes);
+    };
+    thread_local RandomPool pool;
+    constexpr std::size_t kIdBytes = 16;
+    if (pool.used + kIdBytes > sizeof(pool.bytes))
+    {
+        if (RAND_bytes(pool.bytes, sizeof(pool.bytes)) != 1)
+        {
+            thread_local std::mt19937_64 rng{std::random_device{}()};
+            for (std::size_t i = 0; i < sizeof(pool.bytes); ++i)
+                pool.bytes[i] = static_cast<unsigned char>(rng());
+        }
+        pool.used = 0;
+    }
+    const unsigned char *bytes = pool.bytes + pool.used;
+    pool.used += kIdBytes;
+
+    static const char *digits = "0123456789abcdef";
+    std::string id(2 * kIdBytes, '0');
+    for (std::size_t i = 0; i < kIdBytes; ++i)
+    {
+        id[2 * i] = digits[bytes[i] >> 4];
+        id[2 * i + 1] = digits[bytes[i] & 15];
+    }
+    return id;
+}
+
+const char *reserveStatusName(ReserveStatus status)
+{
+    switch (status)
+    {
+    case ReserveStatus::Reserved: return "RESERVED";
+    case ReserveStatus::Full: return "FULL";
+    case ReserveStatus::SoldOut: return "SOLD_OUT";
+    case ReserveStatus::UnknownOffer: break;
+    }
+    return "UNKNOWN_OFFER";
+}
+
+const char *confirmStatusName(ConfirmStatus status)
+{
+    switch (status)
+    {
+    case ConfirmStatus::Confirmed: return "CONFIRMED";
+    case ConfirmStatus::AlreadyConfirmed: return "ALREADY_CONFIRMED";
+    case ConfirmStatus::Expired: return "EXPIRED";
+    case ConfirmStatus::UnknownOffer: break;
+    }
+    return "UNKNOWN_OFFER";
+}
+
+static std::uint64_t nextInstanceId()
+{
+    static std::atomic<std::uint64_t> next{1};
+    return next.fetch_add(1, std::memory_order_relaxed);
+}
+
+SlotAllocator::SlotAllocator(std::chrono::milliseconds ttl, CapacityLookup lookup)
+    : instanceId_(nextInstanceId()), ttlMs_(ttl.count()), lookup_(std::move(lookup))
+{
+}
+
+SlotAllocator::~SlotAllocator()
+{
+    {
+        std::lock_guard<std::mutex> lock(sweeperMtx_);
+        stopping_ = true;
+    }
+    sweeperCv_.notify_all();
+    if (sweeper_.joinable())
+        sweeper_.join();
+}
+
+/*************************
+ * Offer lookup
+ ************************/
+// The per-thread cache holds a reference to each entry, so the pointer
+// handed out stays valid while the caller uses it even if the offer is
+// retired concurrently. Entries are tagged with the allocator instance.
+namespace
+{
+struct CachedSlots
+{
+    std::uint64_t owner = 0;
+    std::string offerId;
+    std::shared_ptr<void> slots;
+};
+constexpr std::size_t kCachedOffers = 8;
+thread_local CachedSlots slotCache[kCachedOffers];
+}
+
+SlotAllocator::OfferSlots *SlotAllocator::cache(const std::string &offerId, std::size_t hash,
+                                                std::shared_ptr<OfferSlots> slots)
+{
+    CachedSlots &entry = slotCache[(hash / kShards) % kCachedOffers];
+    entry.owner = instanceId_;
+    entry.offerId = offerId;
+    entry.slots = std::move(slots);
+    return static_cast<OfferSlots *>(entry.slots.get());
+}
+
+SlotAllocator::OfferSlots *SlotAllocator::find(const std::string &offerId, std::size_t hash)
+{
+    CachedSlots &entry = slotCache[(hash / kShards) % kCachedOffers];
+    if (entry.owner == instanceId_ && entry.offerId == offerId)
+    {
+        auto *slots = static_cast<OfferSlots *>(entry.slots.get());
+        if (!slots->retired.load(std::memory_order_acquire))
+            return slots;
+    }
+
+    Shard &shard = shards_[hash % kShards];
+    std::shared_ptr<OfferSlots> slots;
+    {
+        std::shared_lock<std::shared_mutex> lock(shard.mtx);
+        auto it = shard.offers.find(offerId);
+        if (it == shard.offers.end())
+            return nullptr;
+        slots = it->second;
+    }
+    return cache(offerId, hash, std::move(slots));
+}
+
+SlotAllocator::OfferSlots *SlotAllocator::track(const std::string &offerId, std::size_t hash)
+{
+    if (OfferSlots *slots = find(offerId, hash))
+        return slots;
+    auto capacity = lookup_ ? lookup_(offerId) : std::nullopt;
+    if (!capacity)
+        return nullptr;
+
+    Shard &shard = shards_[hash % kShards];
+    std::shared_ptr<OfferSlots> slots;
+    {
+        std::unique_lock<std::shared_mutex> lock(shard.mtx);
+        auto &tracked = shard.offers[offerId];
+        if (!tracked)
+        {
+            tracked = std::make_shared<OfferSlots>();
+            tracked->capacity.store(*capacity, std::memory_order_relaxed);
+        }
+        slots = tracked;
+    }
+    return cache(offerId, hash, std::move(slots));
+}
+
+/*************************
+ * Reservations
+ ************************/
+void SlotAllocator::publishEarliestLocked(OfferSlots &slots)
+{
+    std::int64_t earliest = slots.lapses.empty() ? 0 : ticksOf(slots.lapses.begin()->first);
+    slots.earliestDeadline.store(earliest, std::memory_order_relaxed);
+}
+
+void SlotAllocator::releaseLocked(OfferSlots &slots, std::unordered_map<std::string, Hold>::iterator it)
+{
+    slots.lapses.erase(it->second.lapse);
+    slots.holds.erase(it);
+    slots.counts.fetch_sub(1, std::memory_order_release);
+    publishEarliestLocked(slots);
+}
+
+ReservationResult SlotAllocator::reserve(const std::string &offerId, const std::string &buyer)
+{
+    ReservationResult result;
+    std::size_t hash = std::hash<std::string>{}(offerId);
+    OfferSlots *slots = track(offerId, hash);
+    if (!slots)
+        return result;
+    reserveAttempts.add();
+
+    // Fast path: refusals are decided from loads alone, and a free slot is
+    // claimed by bumping the held count.
+    std::uint64_t word = slots->counts.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        std::uint32_t capacity = slots->capacity.load(std::memory_order_relaxed);
+        std::uint32_t held = static_cast<std::uint32_t>(word & kHeldMask);
+        std::uint32_t confirmed = static_cast<std::uint32_t>(word >> 32);
+        if (confirmed >= capacity)
+        {
+            result.status = ReserveStatus::SoldOut;
+            return result;
+        }
+        if (held >= capacity)
+        {
+            // No recorded deadline yet means a winner is still recording its hold.
+            std::int64_t earliest = slots->earliestDeadline.load(std::memory_order_relaxed);
+            std::int64_t waitMs = earliest == 0 ? 0 : std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::duration(earliest) - std::chrono::steady_clock::now().time_since_epoch()).count();
+            result.status = ReserveStatus::Full;
+            result.retryAfterMs = std::max<std::int64_t>(1, waitMs);
+            return result;
+        }
+        if (slots->counts.compare_exchange_weak(word, word + 1, std::memory_order_acquire, std::memory_order_relaxed))
+            break;
+    }
+
+    std::chrono::milliseconds ttl = this->ttl();
+    auto deadline = std::chrono::steady_clock::now() + ttl;
+    result.reservationId = newReservationId();
+    {
+        std::lock_guard<std::mutex> lock(slots->mtx);
+        auto lapse = slots->lapses.emplace(deadline, result.reservationId);
+        slots->holds.emplace(result.reservationId, Hold{buyer, deadline, false, lapse});
+        publishEarliestLocked(*slots);
+    }
+    reservationsGranted.add();
+    result.status = ReserveStatus::Reserved;
+    result.expiresInMs = ttl.count();
+    return result;
+}
+
+ConfirmStatus SlotAllocator::confirm(const std::string &offerId, const std::string &reservationId, std::string *buyer)
+{
+    OfferSlots *slots = find(offerId, std::hash<std::string>{}(offerId));
+    if (!slots)
+        return ConfirmStatus::UnknownOffer;
+
+    std::lock_guard<std::mutex> lock(slots->mtx);
+    auto it = slots->holds.find(reservationId);
+    if (it == slots->holds.end())
+        return ConfirmStatus::Expired;
+    if (buyer)
+        *buyer = it->second.buyer;
+    if (it->second.confirmed)
+        return ConfirmStatus::AlreadyConfirmed;
+    if (std::chrono::steady_clock::now() >= it->second.deadline)
+    {
+        releaseLocked(*slots, it);
+        reservationsLapsed.add();
+        return ConfirmStatus::Expired;
+    }
+
+    it->second.confirmed = true;
+    slots->lapses.erase(it->second.lapse);
+    slots->counts.fetch_add(kConfirmedOne, std::memory_order_release);
+    publishEarliestLocked(*slots);
+    purchasesConfirmed.add();
+    return ConfirmStatus::Confirmed;
+}
+
+bool SlotAllocator::release(const std::string &offerId, const std::string &reservationId)
+{
+    OfferSlots *slots = find(offerId, std::hash<std::string>{}(offerId));
+    if (!slots)
+        return false;
+
+    std::lock_guard<std::mutex> lock(slots->mtx);
+    auto it = slots->holds.find(reservationId);
+    if (it == slots->holds.end() || it->second.confirmed)
+        return false;
+    releaseLocked(*slots, it);
+    return true;
+}
+
+void SlotAllocator::setCapacity(const std::string &offerId, std::uint32_t capacity)
+{
+    if (OfferSlots *slots = find(offerId, std::hash<std::string>{}(offerId)))
+        slots->capacity.store(capacity, std::memory_order_relaxed);
+}
+
+std::optional<SlotCounts> SlotAllocator::counts(const std::string &offerId)
+{
+    OfferSlots *slots = find(offerId, std::hash<std::string>{}(offerId));
+    if (!slots)
+        return std::nullopt;
+    std::uint64_t word = slots->counts.load(std::memory_order_acquire);
+    SlotCounts counts;
+    counts.capacity = slots->capacity.load(std::memory_order_relaxed);
+    counts.confirmed = static_cast<std::uint32_t>(word >> 32);
+    counts.reserved = static_cast<std::uint32_t>(word & kHeldMask) - counts.confirmed;
+    return counts;
+}
+
+/*************************
+ * Sweeping
+ ************************/
+std::size_t SlotAllocator::sweep()
+{
+    std::vector<std::pair<std::string, std::shared_ptr<OfferSlots>>> tracked;
+    for (auto &shard : shards_)
+    {
+        std::shared_lock<std::shared_mutex> lock(shard.mtx);
+        for (const auto &kv : shard.offers)
+            tracked.emplace_back(kv.first, kv.second);
+    }
+
+    std::size_t lapsed = 0;
+    std::size_t retired = 0;
+    for (auto &kv : tracked)
+    {
+        OfferSlots &slots = *kv.second;
+        auto capacity = lookup_ ? lookup_(kv.first) : std::optional<std::uint32_t>(slots.capacity.load());
+        if (!capacity)
+        {
+            // The offer is gone: so are its reservations and purchases.
+            Shard &shard = shards_[std::hash<std::string>{}(kv.first) % kShards];
+            std::unique_lock<std::shared_mutex> lock(shard.mtx);
+            auto it = shard.offers.find(kv.first);
+            if (it != shard.offers.end() && it->second == kv.second)
+                shard.offers.erase(it);
+            slots.retired.store(true, std::memory_order_release);
+            ++retired;
+            continue;
+        }
+        slots.capacity.store(*capacity, std::memory_order_relaxed);
+
+        auto now = std::chrono::steady_clock::now();
+        std::int64_t earliest = slots.earliestDeadline.load(std::memory_order_relaxed);
+        if (earliest == 0 || earliest > ticksOf(now))
+            continue;
+        std::lock_guard<std::mutex> lock(slots.mtx);
+        std::size_t freed = 0;
+        while (!slots.lapses.empty() && slots.lapses.begin()->first <= now)
+        {
+            slots.holds.erase(slots.lapses.begin()->second);
+            slots.lapses.erase(slots.lapses.begin());
+            ++freed;
+        }
+        slots.counts.fetch_sub(freed, std::memory_order_release);
+        publishEarliestLocked(slots);
+        lapsed += freed;
+    }
+
+    reservationsLapsed.add(lapsed);
+    if (lapsed > 0 || retired > 0)
+        TEE_LOG_DEBUG("SlotAllocator", "Freed {} lapsed reservations, stopped tracking {} removed offers.", lapsed, retired);
+    return lapsed;
+}
+
+void SlotAllocator::startSweeper(std::chrono::milliseconds interval)
+{
+    if (sweeper_.joinable())
+        return;
+    sweeper_ = std::thread([this, interval] {
+        std::unique_lock<std::mutex> lock(sweeperMtx_);
+        while (!sweeperCv_.wait_for(lock, interval, [&] { return stopping_; }))
+        {
+            lock.unlock();
+            sweep();
+            lock.lock();
+        }
+    });
+}
+
+std::size_t SlotAllocator::trackedOffers()
+{
+    std::size_t n = 0;
+    for (auto &shard : shards_)
+    {
+        std::shared_lock<std::shared_mutex> lock(shard.mtx);
+        n += shard.offers.size();
+    }
+    return n;
+}
+
+SlotCounts SlotAllocator::totals()
+{
+    SlotCounts totals;
+    for (auto &shard : shards_)
+    {
+        std::shared_lock<std::shared_mutex> lock(shard.mtx);
+        for (const auto &kv : shard.offers)
+        {
+            std::uint64_t word = kv.second->counts.load(std::memory_order_relaxed);
+            std::uint32_t confirmed = static_cast<std::uint32_t>(word >> 32);
+            totals.capacity += kv.second->capacity.load(std::memory_order_relaxed);
+            totals.confirmed += confirmed;
+            totals.reserved += static_cast<std::uint32_t>(word & kHeldMask) - confirmed;
+        }
+    }
+    return totals;
+}
@@ -0,0 +1,155 @@
+#ifndef SLOTALLOCATOR_HPP
+#define SLOTALLOCATOR_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+enum class ReserveStatus
+{
+    Reserved,
+    Full,        // every slot is held; some may free up when reservations lapse
+    SoldOut,     // every slot is confirmed
+    UnknownOffer
+};
+
+enum class ConfirmStatus
+{
+    Confirmed,
+    AlreadyConfirmed, // the same reservation was confirmed before; nothing changed
+    Expired,          // unknown, released or lapsed
+    UnknownOffer
+};
+
+struct ReservationResult
+{
+    ReserveStatus status = ReserveStatus::UnknownOffer;
+    std::string reservationId;
+    std::int64_t expiresInMs = 0;
+    std::int64_t retryAfterMs = 0; // Full: until the earliest reservation lapses
+};
+
+struct SlotCounts
+{
+    std::uint32_t capacity = 0;
+    std::uint32_t reserved = 0; // held, not yet confirmed
+    std::uint32_t confirmed = 0;
+};
+
+// Buyer slots of each offer, at most preferredNumberOfBuyers of them.
+// A buyer reserves a slot for a limited time and confirms the purchase
+// within it; a reservation that is neither confirmed nor released lapses
+// and its slot becomes free again.
+//
+// Admission is one atomic word per offer (held and confirmed counts)
+// advanced by compare-and-swap, so a herd of buyers on one offer never
+// waits on a lock: once the offer is full every attempt is answered from
+// plain loads. Only the winners take the offer's own mutex, to record
+// their reservation. Offers are found through a small per-thread cache,
+// falling back to a sharded index on a miss.
+class SlotAllocator
+{
+public:
+    // Capacity of an offer, nullopt if it does not exist (any more).
+    using CapacityLookup = std::function<std::optional<std::uint32_t>(const std::string &offerId)>;
+
+private:
+    using LapseQueue = std::multimap<std::chrono::steady_clock::time_point, std::string>;
+
+    struct Hold
+    {
+        std::string buyer;
+        std::chrono::steady_clock::time_point deadline;
+        bool confirmed = false;
+        LapseQueue::iterator lapse; // while unconfirmed
+    };
+
+    struct OfferSlots
+    {
+        // Low 32 bits: slots held (reserved or confirmed). High 32: confirmed.
+        alignas(64) std::atomic<std::uint64_t> counts{0};
+        std::atomic<std::uint32_t> capacity{0};
+        std::atomic<bool> retired{false};
+        // Earliest deadline of an unconfirmed reservation, steady_clock ticks.
+        std::atomic<std::int64_t> earliestDeadline{0};
+
+        alignas(64) std::mutex mtx;
+        std::unordered_map<std::string, Hold> holds; // by reservation id
+        LapseQueue lapses;                           // unconfirmed holds by deadline
+    };
+
+    static constexpr std::size_t kShards = 64;
+    struct alignas(64) Shard
+    {
+        std::shared_mutex mtx;
+        std::unordered_map<std::string, std::shared_ptr<OfferSlots>> offers;
+    };
+
+    const std::uint64_t instanceId_;
+    std::atomic<std::int64_t> ttlMs_;
+    CapacityLookup lookup_;
+    Shard shards_[kShards];
+
+    std::mutex sweeperMtx_;
+    std::condition_variable sweeperCv_;
+    bool stopping_ = false;
+    std::thread sweeper_;
+
+    // Both return a pointer kept alive by the calling thread's cache until
+    // its next lookup; track also starts tracking an offer the lookup knows.
+    OfferSlots *find(const std::string &offerId, std::size_t hash);
+    OfferSlots *track(const std::string &offerId, std::size_t hash);
+    OfferSlots *cache(const std::string &offerId, std::size_t hash, std::shared_ptr<OfferSlots> slots);
+    void releaseLocked(OfferSlots &slots, std::unordered_map<std::string, Hold>::iterator it);
+    static void publishEarliestLocked(OfferSlots &slots);
+
+public:
+    // lookup is consulted the first time an offer is reserved and on every
+    // sweep, which picks up capacity changes and forgets removed offers.
+    SlotAllocator(std::chrono::milliseconds ttl, CapacityLookup lookup);
+    ~SlotAllocator();
+
+    ReservationResult reserve(const std::string &offerId, const std::string &buyer);
+
+    // Turns a live reservation into a purchase, exactly once: repeating the
+    // call reports AlreadyConfirmed, and a reservation past its deadline
+    // can no longer be confirmed even if the sweeper has not run yet.
+    ConfirmStatus confirm(const std::string &offerId, const std::string &reservationId, std::string *buyer = nullptr);
+
+    // Gives an unconfirmed reservation's slot back; false if there was none.
+    bool release(const std::string &offerId, const std::string &reservationId);
+
+    // Applies a capacity change at once (e.g. an updated preferredBuyers).
+    // Lowering it below the slots already held revokes nothing.
+    void setCapacity(const std::string &offerId, std::uint32_t capacity);
+
+    std::optional<SlotCounts> counts(const std::string &offerId);
+
+    // Frees lapsed reservations and refreshes every tracked offer through
+    // the lookup. Returns the number of reservations freed.
+    std::size_t sweep();
+    void startSweeper(std::chrono::milliseconds interval);
+
+    // Applies to reservations made from now on.
+    void setTtl(std::chrono::milliseconds ttl) { ttlMs_.store(ttl.count(), std::memory_order_relaxed); }
+    std::chrono::milliseconds ttl() const { return std::chrono::milliseconds(ttlMs_.load(std::memory_order_relaxed)); }
+
+    std::size_t trackedOffers();
+    // Summed over every tracked offer.
+    SlotCounts totals();
+};
+
+const char *reserveStatusName(ReserveStatus status);
+const char *confirmStatusName(ConfirmStatus status);
+
+#endif // SLOTALLOCATOR_HPP
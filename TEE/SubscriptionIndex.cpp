@@ -0,0 +1,261 @@
+#include "SubscriptionIndex.hpp"
+#include "Metrics.hpp"
+#include <algorithm>
+#include <mutex>
+
+static LatencyHistogram &matchLatency = MetricsRegistry::instance().histogram(
+    "tee_subscription_match_seconds", "Time to find the subscribers matching one offer.");
+static MetricCounter &postingsScanned = MetricsRegistry::instance().counter(
+    "tee_subscription_postings_scanned_total", "Keyword postings visited while matching offers.");
+static MetricCounter &summaryRejects = MetricsRegistry::instance().counter(
+    "tee_subscription_summary_rejects_total", "Postings skipped because the offer's Bloom summary lacks a keyword.");
+
+// Two bits per keyword out of 64.
+std::uint64_t SubscriptionIndex::keywordSummary(const std::vector<std::string> &keywords)
+{
+    std::uint64_t summary = 0;
+    for (const auto &keyword : keywords)
+    {
+        std::size_t h = std::hash<std::string>{}(keyword);
+        summary |= (1ull << (h & 63)) | (1ull << ((h >> 6) & 63));
+    }
+    return summary;
+}
+
+std::uint64_t SubscriptionIndex::addSubscriber(Sink sink)
+{
+    std::unique_lock<std::shared_mutex> lock(mtx_);
+    std::uint32_t slot;
+    if (!freeSubscribers_.empty())
+    {
+        slot = freeSubscribers_.back();
+        freeSubscribers_.pop_back();
+    }
+    else
+    {
+        slot = static_cast<std::uint32_t>(subscribers_.size());
+        subscribers_.emplace_back();
+    }
+    Subscriber &subscriber = subscribers_[slot];
+    subscriber.id = nextId_++;
+    subscriber.sink = std::make_shared<const Sink>(std::move(sink));
+    subscriberSlots_[subscriber.id] = slot;
+    return subscriber.id;
+}
+
+void SubscriptionIndex::removeSubscriber(std::uint64_t subscriberId)
+{
+    std::unique_lock<std::shared_mutex> lock(mtx_);
+    auto it = subscriberSlots_.find(subscriberId);
+    if (it == subscriberSlots_.end())
+        return;
+    Subscriber &subscriber = subscribers_[it->second];
+    for (std::uint32_t slot : subscriber.subscriptions)
+        removeLocked(slot);
+    subscriber = Subscriber();
+    freeSubscribers_.push_back(it->second);
+    subscriberSlots_.erase(it);
+}
+
+bool SubscriptionIndex::subscribe(std::uint64_t subscriberId, std::vector<std::string> keywords,
+                                  std::uint64_t &subscriptionId, std::string &error)
+{
+    std::sort(keywords.begin(), keywords.end());
+    keywords.erase(std::unique(keywords.begin(), keywords.end()), keywords.end());
+    if (keywords.empty() || keywords.size() > kMaxKeywords)
+    {
+        error = "A subscription needs 1 to " + std::to_string(kMaxKeywords) + " keywords.";
+        return false;
+    }
+    if (keywords.front().empty())
+    {
+        error = "Keywords must not be empty.";
+        return false;
+    }
+
+    std::uint64_t summary = keywordSummary(keywords);
+    std::unique_lock<std::shared_mutex> lock(mtx_);
+    auto owner = subscriberSlots_.find(subscriberId);
+    if (owner == subscriberSlots_.end())
+    {
+        error = "Unknown subscriber.";
+        return false;
+    }
+    if (subscribers_[owner->second].subscriptions.size() >= kMaxSubscriptionsPerSubscriber)
+    {
+        error = "Too many subscriptions on this connection.";
+        return false;
+    }
+
+    std::uint32_t slot;
+    if (!freeSubscriptions_.empty())
+    {
+        slot = freeSubscriptions_.back();
+        freeSubscriptions_.pop_back();
+    }
+    else
+    {
+        slot = static_cast<std::uint32_t>(subscriptions_.size());
+        subscriptions_.emplace_back();
+    }
+    Subscription &subscription = subscriptions_[slot];
+    subscription.id = nextId_++;
+    subscription.subscriber = owner->second;
+    subscription.keywords = std::move(keywords);
+    subscription.positions.clear();
+    for (const auto &keyword : subscription.keywords)
+    {
+        auto &postings = postings_[keyword];
+        subscription.positions.push_back(static_cast<std::uint32_t>(postings.size()));
+        postings.push_back(Posting{summary, slot, owner->second, static_cast<std::uint32_t>(subscription.keywords.size())});
+    }
+    subscribers_[owner->second].subscriptions.push_back(slot);
+    subscriptionSlots_[subscription.id] = slot;
+    live_.fetch_add(1, std::memory_order_relaxed);
+    subscriptionId = subscription.id;
+    return true;
+}
+
+// Unlinks a subscription from its postings, moving the last posting of each
+// keyword into the hole. The caller updates the subscriber's list.
+void SubscriptionIndex::removeLocked(std::uint32_t slot)
+{
+    Subscription &subscription = subscriptions_[slot];
+    for (std::size_t i = 0; i < subscription.keywords.size(); ++i)
+    {
+        auto it = postings_.find(subscription.keywords[i]);
+        std::vector<Posting> &postings = it->second;
+        std::uint32_t pos = subscription.positions[i];
+        postings[pos] = postings.back();
+        Subscription &moved = subscriptions_[postings[pos].subscription];
+        for (std::size_t k = 0; k < moved.keywords.size(); ++k)
+        {
+            if (moved.keywords[k] == subscription.keywords[i])
+                moved.positions[k] = pos;
+        }
+        postings.pop_back();
+        if (postings.empty())
+            postings_.erase(it);
+    }
+    subscriptionSlots_.erase(subscription.id);
+    subscription.id = 0;
+    subscription.keywords.clear();
+    subscription.positions.clear();
+    freeSubscriptions_.push_back(slot);
+    live_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+bool SubscriptionIndex::unsubscribe(std::uint64_t subscriberId, std::uint64_t subscriptionId)
+{
+    std::unique_lock<std::shared_mutex> lock(mtx_);
+    auto it = subscriptionSlots_.find(subscriptionId);
+    auto owner = subscriberSlots_.find(subscriberId);
+    if (it == subscriptionSlots_.end() || owner == subscriberSlots_.end() ||
+        subscriptions_[it->second].subscriber != owner->second)
+        return false;
+    std::uint32_t slot = it->second;
+    auto &mine = subscribers_[owner->second].subscriptions;
+    mine.erase(std::find(mine.begin(), mine.end(), slot));
+    removeLocked(slot);
+    return true;
+}
+
+// Per-thread match scratch, stamped with the match it belongs to so it
+// never needs clearing between offers.
+namespace
+{
+struct Tally
+{
+    std::uint32_t stamp = 0;
+    std::uint32_t count = 0;
+};
+
+struct MatchScratch
+{
+    std::uint32_t stamp = 0;
+    std::vector<Tally> tallies;          // per subscription slot
+    std::vector<std::uint32_t> notified; // per subscriber slot
+    std::vector<const std::string *> keywords;
+
+    void begin(std::size_t subscriptions, std::size_t subscribers)
+    {
+        if (++stamp == 0)
+        {
+            std::fill(tallies.begin(), tallies.end(), Tally());
+            std::fill(notified.begin(), notified.end(), 0);
+            stamp = 1;
+        }
+        if (tallies.size() < subscriptions)
+            tallies.resize(subscriptions);
+        if (notified.size() < subscribers)
+            notified.resize(subscribers);
+    }
+};
+}
+
+std::size_t SubscriptionIndex::match(const std::vector<std::string> &keywords,
+                                     std::vector<std::shared_ptr<const Sink>> &sinks)
+{
+    if (empty() || keywords.empty())
+        return 0;
+    ScopedLatency timer(matchLatency);
+    thread_local MatchScratch scratch;
+
+    // An offer listing a keyword twice must not count it twice.
+    scratch.keywords.clear();
+    for (const auto &keyword : keywords)
+        scratch.keywords.push_back(&keyword);
+    std::sort(scratch.keywords.begin(), scratch.keywords.end(),
+              [](const std::string *a, const std::string *b) { return *a < *b; });
+    scratch.keywords.erase(std::unique(scratch.keywords.begin(), scratch.keywords.end(),
+                                       [](const std::string *a, const std::string *b) { return *a == *b; }),
+                           scratch.keywords.end());
+    std::uint64_t summary = keywordSummary(keywords);
+
+    std::shared_lock<std::shared_mutex> lock(mtx_);
+    scratch.begin(subscriptions_.size(), subscribers_.size());
+    std::uint32_t stamp = scratch.stamp;
+    std::size_t matched = 0, scanned = 0, rejected = 0;
+    auto notify = [&](const Posting &posting) {
+        ++matched;
+        if (scratch.notified[posting.subscriber] != stamp)
+        {
+            scratch.notified[posting.subscriber] = stamp;
+            sinks.push_back(subscribers_[posting.subscriber].sink);
+        }
+    };
+    for (const std::string *keyword : scratch.keywords)
+    {
+        auto it = postings_.find(*keyword);
+        if (it == postings_.end())
+            continue;
+        scanned += it->second.size();
+        for (const Posting &posting : it->second)
+        {
+            if (posting.required == 1)
+            {
+                notify(posting);
+                continue;
+            }
+            if ((posting.summary & summary) != posting.summary)
+            {
+                ++rejected;
+                continue;
+            }
+            Tally &tally = scratch.tallies[posting.subscription];
+            if (tally.stamp != stamp)
+                tally = Tally{stamp, 0};
+            if (++tally.count == posting.required)
+                notify(posting);
+        }
+    }
+    postingsScanned.add(scanned);
+    summaryRejects.add(rejected);
+    return matched;
+}
+
+std::size_t SubscriptionIndex::subscribers() const
+{
+    std::shared_lock<std::shared_mutex> lock(mtx_);
+    return subscriberSlots_.size();
+}
@@ -0,0 +1,94 @@
+#ifndef SUBSCRIPTIONINDEX_HPP
+#define SUBSCRIPTIONINDEX_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Standing keyword interests of buyers. A subscription lists keywords and
+// matches every offer whose verifiedKeywords include all of them; a
+// subscriber (one connection) may hold many subscriptions and is told
+// about a matching offer once, however many of them match.
+//
+// Subscriptions are indexed under each of their keywords. Matching an
+// offer walks the postings of the offer's keywords and counts, per
+// subscription, how many of its keywords were seen; it matches when the
+// count reaches its keyword total. Each posting carries a 64-bit Bloom
+// summary of its subscription's keywords, so a subscription needing a
+// keyword the offer lacks is usually skipped before its counter is
+// touched. Single-keyword subscriptions match straight from the posting.
+class SubscriptionIndex
+{
+public:
+    // Delivers one serialized notification; the same buffer goes to every
+    // matching subscriber.
+    using Sink = std::function<void(const std::shared_ptr<const std::string> &message)>;
+
+    static constexpr std::size_t kMaxKeywords = 16;
+    static constexpr std::size_t kMaxSubscriptionsPerSubscriber = 256;
+
+private:
+    struct Posting
+    {
+        std::uint64_t summary; // Bloom summary of the subscription's keywords
+        std::uint32_t subscription;
+        std::uint32_t subscriber;
+        std::uint32_t required; // keywords in the subscription
+    };
+
+    struct Subscription
+    {
+        std::uint64_t id = 0; // 0 = free slot
+        std::uint32_t subscriber = 0;
+        std::vector<std::string> keywords;
+        std::vector<std::uint32_t> positions; // index of this subscription in each keyword's postings
+    };
+
+    struct Subscriber
+    {
+        std::uint64_t id = 0; // 0 = free slot
+        std::shared_ptr<const Sink> sink;
+        std::vector<std::uint32_t> subscriptions;
+    };
+
+    mutable std::shared_mutex mtx_;
+    std::unordered_map<std::string, std::vector<Posting>> postings_;
+    std::vector<Subscription> subscriptions_;
+    std::vector<std::uint32_t> freeSubscriptions_;
+    std::vector<Subscriber> subscribers_;
+    std::vector<std::uint32_t> freeSubscribers_;
+    std::unordered_map<std::uint64_t, std::uint32_t> subscriptionSlots_;
+    std::unordered_map<std::uint64_t, std::uint32_t> subscriberSlots_;
+    std::uint64_t nextId_ = 1;
+    std::atomic<std::size_t> live_{0};
+
+    void removeLocked(std::uint32_t slot);
+
+public:
+    static std::uint64_t keywordSummary(const std::vector<std::string> &keywords);
+
+    std::uint64_t addSubscriber(Sink sink);
+    // Drops the subscriber and all its subscriptions.
+    void removeSubscriber(std::uint64_t subscriberId);
+
+    // keywords: 1 to kMaxKeywords non-empty keywords, duplicates ignored.
+    bool subscribe(std::uint64_t subscriberId, std::vector<std::string> keywords, std::uint64_t &subscriptionId,
+                   std::string &error);
+    bool unsubscribe(std::uint64_t subscriberId, std::uint64_t subscriptionId);
+
+    // Appends the sink of every subscriber with a subscription matched by an
+    // offer carrying keywords, once each. Returns the number of matching
+    // subscriptions.
+    std::size_t match(const std::vector<std::string> &keywords, std::vector<std::shared_ptr<const Sink>> &sinks);
+
+    bool empty() const { return live_.load(std::memory_order_relaxed) == 0; }
+    std::size_t subscriptions() const { return live_.load(std::memory_order_relaxed); }
+    std::size_t subscribers() const;
+};
+
+#endif // SUBSCRIPTIONINDEX_HPP
@@ -1,10 +1,125 @@
 #include "TEEEngine.hpp"
-#include <iostream>
+#include "OfferJson.hpp"
+#include "Logger.hpp"
+#include "Metrics.hpp"
+#include "SellerSignature.hpp"
+#include <cmath>
 #include <optional>
 
+static LatencyHistogram &ingestLatency = MetricsRegistry::instance().histogram(
+    "tee_ingest_seconds", "End-to-end time to ingest one offer, including queueing in the pipeline.");
+static LatencyHistogram &batchIngestLatency = MetricsRegistry::instance().histogram(
+    "tee_ingest_batch_seconds", "Time to ingest one submitOffers batch.");
+static MetricCounter &offersAccepted = MetricsRegistry::instance().counter(
+    "tee_offers_accepted_total", "Offers verified, stored and posted.");
+static MetricCounter &offersRejected = MetricsRegistry::instance().counter(
+    "tee_offers_rejected_total", "Offers refused by a precheck, proof verification or the memory budget.");
+static MetricCounter &verificationsCancelled = MetricsRegistry::instance().counter(
+    "tee_verification_cancelled_total", "Proof checks skipped because the requesting client disconnected.");
+static MetricCounter &verificationsExpired = MetricsRegistry::instance().counter(
+    "tee_verification_deadline_missed_total", "Proof checks skipped because their deadline passed while queued.");
+
+// Drops work nobody is waiting for any more, before it reaches the pairing.
+static bool stillWanted(const VerificationTicket &ticket, std::string &error)
+{
+    if (ticket.cancelled())
+    {
+        verificationsCancelled.add();
+        error = "Cancelled: client disconnected.";
+        return false;
+    }
+    if (ticket.expired())
+    {
+        verificationsExpired.add();
+        error = "Deadline exceeded before verification.";
+        return false;
+    }
+    return true;
+}
+
+static LatencyHistogram &updateLatency = MetricsRegistry::instance().histogram(
+    "tee_offer_update_seconds", "Time to authenticate, apply and re-post a metadata update.");
+static MetricCounter &updatesRejected = MetricsRegistry::instance().counter(
+    "tee_offer_updates_rejected_total", "Metadata updates refused (bad signature, stale nonce, unknown offer).");
+
+static LatencyHistogram &speculativeAckLatency = MetricsRegistry::instance().histogram(
+    "tee_speculative_ack_seconds", "Time to acknowledge a speculatively accepted offer.");
+static LatencyHistogram &speculativeResolveLatency = MetricsRegistry::instance().histogram(
+    "tee_speculative_resolve_seconds", "Time from a speculative ack until the offer is promoted or purged.");
+static MetricCounter &speculativePurged = MetricsRegistry::instance().counter(
+    "tee_speculative_purged_total", "Speculatively accepted offers purged because their proof failed.");
+
+// Until configureReservations says otherwise.
+static constexpr std::chrono::minutes kDefaultReservationTtl{2};
+
+static LatencyHistogram &fanoutLatency = MetricsRegistry::instance().histogram(
+    "tee_subscription_fanout_seconds", "Time to match, serialize and hand out the notifications of one offer.");
+static LatencyHistogram &searchLatency = MetricsRegistry::instance().histogram(
+    "tee_search_seconds", "Time to parse and run one keyword query.");
+static MetricCounter &notificationsSent = MetricsRegistry::instance().counter(
+    "tee_subscription_notifications_total", "offerMatched messages handed to subscribers.");
+
+// What an offerMatched notification carries.
+static constexpr OfferFieldMask kNotifiedFields = kOfferFieldTitle | kOfferFieldVerifiedKeywords |
+                                                  kOfferFieldReservePrice | kOfferFieldPreferredBuyers |
+                                                  kOfferFieldExpiryDays;
+
 TEEEngine::TEEEngine(const std::string &vkFilePath)
-    : storage_(), validator_(vkFilePath), poster_()
+    : storage_(), validator_(vkFilePath), poster_(),
+      slots_(kDefaultReservationTtl, [this](const std::string &offerId) -> std::optional<std::uint32_t> {
+          auto offer = storage_.projectOffer(offerId, kOfferFieldPreferredBuyers);
+          if (!offer)
+              return std::nullopt;
+          return static_cast<std::uint32_t>(std::max(0, offer->preferredNumberOfBuyers));
+      }),
+      auctions_([this](const std::vector<std::string> &offerIds, std::vector<std::optional<AuctionTerms>> &terms) {
+          auto offers = storage_.projectOffers(offerIds, kOfferFieldReservePrice | kOfferFieldPreferredBuyers);
+          terms.clear();
+          for (const auto &offer : offers)
+          {
+              if (offer)
+                  terms.push_back(AuctionTerms{offer->reservePrice,
+                                               static_cast<std::uint32_t>(std::max(0, offer->preferredNumberOfBuyers))});
+              else
+                  terms.push_back(std::nullopt);
+          }
+      },
+      // Units belong to the slot allocator; an auction sells what is
+      // left of them when it clears, as confirmed purchases. An offer that
+      // is gone has nothing left to sell, so its bidders all lose.
+      [this](const std::string &offerId, const std::string &bidder) {
+          ReservationResult reservation = slots_.reserve(offerId, bidder);
+          if (reservation.status != ReserveStatus::Reserved)
+              return false;
+          slots_.confirm(offerId, reservation.reservationId);
+          return true;
+      })
 {
+    poster_.setCatalogSource([this] { return storage_.catalogCommitment(); });
+}
+
+TEEEngine::~TEEEngine()
+{
+    if (pipeline_)
+        pipeline_->stop();
+
+    // Set under every mutex so no waiter can miss the wake-up.
+    {
+        std::scoped_lock lock(sweeperMtx_, batchMtx_, speculativeMtx_, verifierMtx_);
+        stopping_ = true;
+    }
+    sweeperCv_.notify_all();
+    batchCv_.notify_all();
+    speculativeCv_.notify_all();
+    verifierCv_.notify_all();
+    for (auto &t : speculativeWorkers_)
+        t.join();
+    if (expirySweeper_.joinable())
+        expirySweeper_.join();
+    if (batchWorker_.joinable())
+        batchWorker_.join();
+    for (auto &t : batchVerifiers_)
+        t.join();
 }
 
 bool TEEEngine::processOffer(
@@ -22,41 +137,646 @@ bool TEEEngine::processOffer(
     const std::string &proofPath,
     const std::string &publicInputsPath)
 {
-    std::cout << "TEEEngine: Received new Offer [" << offerId << "]\n";
+    OfferRequest req;
+    req.offerId = offerId;
+    req.offer.title = title;
+    req.offer.verifiedKeywords = verifiedKeywords;
+    req.offer.unverifiedText = unverifiedText;
+    req.offer.reservePrice = reservePrice;
+    req.offer.preferredNumberOfBuyers = preferredBuyers;
+    req.offer.expiryDays = expiryDays;
+    req.offer.cooldownMonths = cooldownMonths;
+    req.offer.publicVerificationKeyFDE = publicVerificationKeyFDE;
+    req.offer.encryptedPlaintext = encryptedPlaintext;
+    req.offer.nullifier = nullifier;
+    req.proofPath = proofPath;
+    req.publicInputsPath = publicInputsPath;
 
-    bool isProofValid = validator_.validateOfferProof(proofPath, publicInputsPath);
-    if (!isProofValid)
+    std::string error;
+    return processOffer(std::move(req), error);
+}
+
+bool TEEEngine::processOffer(const OfferRequest &req, std::string &error)
+{
+    return processOffer(OfferRequest(req), error);
+}
+
+bool TEEEngine::processOffer(OfferRequest &&req, std::string &error)
+{
+    ScopedLatency timer(ingestLatency);
+    if (!precheckOffer(req, error) || !verifyOffer(req, error))
+    {
+        offersRejected.add();
+        return false;
+    }
+    FinancialDetails details = financialDetailsOf(req);
+    if (!persistOffer(req, error))
+    {
+        offersRejected.add();
+        return false;
+    }
+    postOffer(details);
+    offersAccepted.add();
+    return true;
+}
+
+/*************************
+ * Ingest stages
+ ************************/
+// A malformed key would be stored and then never authenticate an update.
+static bool checkSellerKey(const OfferRequest &req, std::string &error)
+{
+    if (req.offer.sellerPublicKey.empty() || isValidSellerPublicKey(req.offer.sellerPublicKey))
+        return true;
+    TEE_LOG_WARN("TEEEngine", "Malformed seller key, rejecting Offer [{}].", req.offerId);
+    error = "sellerPublicKey must be a hex Ed25519 public key.";
+    return false;
+}
+
+bool TEEEngine::precheckOffer(const OfferRequest &req, std::string &error)
+{
+    TEE_LOG_INFO("TEEEngine", "Received new Offer [{}]", req.offerId);
+
+    if (isFollower())
     {
-        std::cerr << "TEEEngine: Proof invalid for Offer [" << offerId << "]. Rejecting.\n";
+        TEE_LOG_WARN("TEEEngine", "Read-only follower, rejecting Offer [{}].", req.offerId);
+        error = "Read-only follower; submit offers to the primary.";
         return false;
     }
 
-    Offer off;
-    off.title = title;
-    off.verifiedKeywords = verifiedKeywords;
-    off.unverifiedText = unverifiedText;
-    off.reservePrice = reservePrice;
-    off.preferredNumberOfBuyers = preferredBuyers;
-    off.expiryDays = expiryDays;
-    off.cooldownMonths = cooldownMonths;
-    off.publicVerificationKeyFDE = publicVerificationKeyFDE;
-    off.encryptedPlaintext = encryptedPlaintext;
-    off.nullifier = nullifier;
+    if (!checkSellerKey(req, error))
+        return false;
 
+    if (!storage_.wouldAdmit(req.offerId, req.offer))
+    {
+        TEE_LOG_WARN("TEEEngine", "Memory budget exhausted, rejecting Offer [{}].", req.offerId);
+        error = "Memory budget exhausted.";
+        return false;
+    }
+    return true;
+}
+
+bool TEEEngine::verifyOffer(const OfferRequest &req, std::string &error)
+{
+    OfferBinding binding;
+    if (!computeBinding(req.offer, validator_.circuitLayout(), binding, error) ||
+        !validator_.validateOfferProof(req.proofPath, req.publicInputsPath, binding, error))
+    {
+        TEE_LOG_WARN("TEEEngine", "Offer [{}] rejected: {}", req.offerId, error);
+        return false;
+    }
+    return true;
+}
+
+bool TEEEngine::persistOffer(OfferRequest &req, std::string &error)
+{
+    if (!storage_.storeOffer(req.offerId, std::move(req.offer)))
+    {
+        TEE_LOG_WARN("TEEEngine", "Memory budget exhausted while storing Offer [{}].", req.offerId);
+        error = "Memory budget exhausted.";
+        return false;
+    }
+    notifySubscribers({req.offerId});
+    return true;
+}
+
+void TEEEngine::notifySubscribers(const std::vector<std::string> &offerIds)
+{
+    if (subscriptions_.empty())
+        return;
+    auto offers = storage_.projectOffers(offerIds, kNotifiedFields);
+    std::vector<std::shared_ptr<const SubscriptionIndex::Sink>> sinks;
+    for (std::size_t i = 0; i < offers.size(); ++i)
+    {
+        if (!offers[i])
+            continue;
+        ScopedLatency timer(fanoutLatency);
+        sinks.clear();
+        if (subscriptions_.match(offers[i]->verifiedKeywords, sinks) == 0)
+            continue;
+        nlohmann::json message;
+        message["type"] = "offerMatched";
+        message["offerId"] = offerIds[i];
+        projectionToJson(message["offer"], *offers[i], kNotifiedFields);
+        auto buffer = std::make_shared<const std::string>(message.dump());
+        for (const auto &sink : sinks)
+            (*sink)(buffer);
+        notificationsSent.add(sinks.size());
+    }
+}
+
+void TEEEngine::postOffer(const FinancialDetails &details)
+{
     poster_.postFinancialDetails(
-        offerId,
-        reservePrice,
-        preferredBuyers,
-        expiryDays,
-        cooldownMonths,
-        publicVerificationKeyFDE);
+        details.offerId,
+        details.price,
+        details.preferredBuyers,
+        details.expiryDays,
+        details.cooldownMonths,
+        details.fdePublicKey);
+
+    TEE_LOG_INFO("TEEEngine", "Successfully processed Offer [{}].", details.offerId);
+}
+
+FinancialDetails TEEEngine::financialDetailsOf(const OfferRequest &req)
+{
+    return FinancialDetails{
+        req.offerId,
+        req.offer.reservePrice,
+        req.offer.preferredNumberOfBuyers,
+        req.offer.expiryDays,
+        req.offer.cooldownMonths,
+        req.offer.publicVerificationKeyFDE};
+}
+
+void TEEEngine::startIngestPipeline(const IngestPipelineConfig &config)
+{
+    std::vector<StageSpec> stages;
+    stages.push_back({"parse", config.parseWorkers, config.queueCapacity, [](IngestJob &job) {
+                          try
+                          {
+                              job.request = takeOfferRequest(job.message);
+                          }
+                          catch (const std::exception &e)
+                          {
+                              job.result.message = std::string("Malformed offer: ") + e.what();
+                              return false;
+                          }
+                          job.message = nullptr; // strings were moved out; drop the empty DOM
+                          job.result.offerId = job.request.offerId;
+                          return true;
+                      }});
+    stages.push_back({"precheck", config.precheckWorkers, config.queueCapacity, [this](IngestJob &job) {
+                          if (!precheckOffer(job.request, job.result.message))
+                              return false;
+                          // With a speculative slot free the offer is acknowledged
+                          // here and leaves the pipeline; otherwise it waits for
+                          // its proof like any other.
+                          return maxSpeculative_ == 0 || !acceptSpeculatively(job.request, job.ticket, job.result);
+                      }});
+    stages.push_back({"verify", config.verifyWorkers, config.queueCapacity, [this](IngestJob &job) {
+                          return stillWanted(job.ticket, job.result.message) &&
+                                 verifyOffer(job.request, job.result.message);
+                      }, true});
+    stages.push_back({"persist", config.persistWorkers, config.queueCapacity, [this](IngestJob &job) {
+                          job.details = financialDetailsOf(job.request);
+                          return persistOffer(job.request, job.result.message);
+                      }});
+    stages.push_back({"post", config.postWorkers, config.queueCapacity, [this](IngestJob &job) {
+                          postOffer(job.details);
+                          return true;
+                      }});
+
+    verifyDeadline_ = config.verifyDeadline;
+    pipeline_ = std::make_unique<IngestPipeline>(std::move(stages));
+    pipeline_->start();
+    for (std::size_t w = 1; w < std::max<std::size_t>(config.verifyWorkers, 1); ++w)
+        batchVerifiers_.emplace_back(&TEEEngine::batchVerifierLoop, this);
+    batchWorker_ = std::thread(&TEEEngine::batchLoop, this);
+}
+
+bool TEEEngine::submitOffer(nlohmann::json message, IngestCallback done, VerificationTicket ticket)
+{
+    if (pipeline_)
+    {
+        auto start = std::chrono::steady_clock::now();
+        return pipeline_->submit(
+            std::move(message),
+            [start, done = std::move(done)](const IngestResult &result) {
+                // Speculative acks are counted once their proof resolves.
+                if (result.pending)
+                {
+                    speculativeAckLatency.record(std::chrono::steady_clock::now() - start);
+                }
+                else
+                {
+                    ingestLatency.record(std::chrono::steady_clock::now() - start);
+                    (result.accepted ? offersAccepted : offersRejected).add();
+                }
+                done(result);
+            },
+            std::move(ticket));
+    }
+
+    IngestResult result;
+    try
+    {
+        auto req = takeOfferRequest(message);
+        result.offerId = req.offerId;
+        result.accepted = processOffer(std::move(req), result.message);
+    }
+    catch (const std::exception &e)
+    {
+        result.message = std::string("Malformed offer: ") + e.what();
+    }
+    done(result);
+    return true;
+}
 
-    storage_.storeOffer(offerId, off);
+/*************************
+ * Speculative acceptance
+ ************************/
+void TEEEngine::enableSpeculativeAcceptance(std::size_t maxPending, std::size_t workers)
+{
+    maxSpeculative_ = maxPending;
+    if (maxPending == 0)
+        return;
+    for (std::size_t w = 0; w < std::max<std::size_t>(workers, 1); ++w)
+        speculativeWorkers_.emplace_back(&TEEEngine::speculativeLoop, this);
+}
+
+// Takes a prechecked offer. Returns false, with req untouched, when too many
+// offers await verification; otherwise result says whether it was acked.
+// The slot is reserved up front so storePending runs unlocked.
+bool TEEEngine::acceptSpeculatively(OfferRequest &req, const VerificationTicket &ticket, IngestResult &result)
+{
+    result.offerId = req.offerId;
+    if (!stillWanted(ticket, result.message))
+        return true;
+    {
+        std::lock_guard<std::mutex> lock(speculativeMtx_);
+        if (speculativeUnresolved_ >= maxSpeculative_)
+            return false;
+        ++speculativeUnresolved_;
+    }
 
-    std::cout << "TEEEngine: Successfully processed Offer [" << offerId << "].\n";
+    FinancialDetails details = financialDetailsOf(req);
+    if (!storage_.storePending(req.offerId, std::move(req.offer)))
+    {
+        {
+            std::lock_guard<std::mutex> lock(speculativeMtx_);
+            --speculativeUnresolved_;
+        }
+        TEE_LOG_WARN("TEEEngine", "Offer [{}] is already pending or over budget.", req.offerId);
+        result.message = "Offer already awaiting verification, or memory budget exhausted.";
+        return true;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(speculativeMtx_);
+        speculativeQueue_.push_back(
+            SpeculativeJob{std::move(req), std::move(details), ticket, std::chrono::steady_clock::now()});
+    }
+    speculativeCv_.notify_one();
+    result.accepted = true;
+    result.pending = true;
     return true;
 }
 
+void TEEEngine::speculativeLoop()
+{
+    while (true)
+    {
+        SpeculativeJob job;
+        {
+            std::unique_lock<std::mutex> lock(speculativeMtx_);
+            speculativeCv_.wait(lock, [&] { return stopping_ || !speculativeQueue_.empty(); });
+            if (speculativeQueue_.empty())
+                return;
+            job = std::move(speculativeQueue_.front());
+            speculativeQueue_.pop_front();
+        }
+        resolveSpeculative(job);
+        {
+            std::lock_guard<std::mutex> lock(speculativeMtx_);
+            --speculativeUnresolved_;
+        }
+    }
+}
+
+void TEEEngine::resolveSpeculative(SpeculativeJob &job)
+{
+    // Past the ack only the deadline applies: the client already has its
+    // answer, so a dropped connection does not withdraw the offer.
+    std::string error;
+    bool verified = false;
+    if (job.ticket.expired())
+    {
+        verificationsExpired.add();
+        error = "Deadline exceeded before verification.";
+    }
+    else
+    {
+        verified = verifyOffer(job.request, error);
+    }
+    if (!verified)
+    {
+        storage_.discardPending(job.request.offerId);
+        TEE_LOG_WARN("TEEEngine", "Purged speculatively accepted Offer [{}]: {}", job.request.offerId, error);
+        speculativePurged.add();
+        offersRejected.add();
+    }
+    else if (storage_.promotePending(job.request.offerId))
+    {
+        notifySubscribers({job.request.offerId});
+        postOffer(job.details);
+        offersAccepted.add();
+    }
+    speculativeResolveLatency.record(std::chrono::steady_clock::now() - job.ackedAt);
+}
+
+VerificationTicket TEEEngine::verificationTicket(std::shared_ptr<const CancellationToken> token, std::int64_t requestedMs) const
+{
+    auto budget = verifyDeadline_;
+    if (requestedMs > 0 && requestedMs < budget.count())
+        budget = std::chrono::milliseconds(requestedMs);
+    return VerificationTicket{std::chrono::steady_clock::now() + budget, std::move(token)};
+}
+
+std::vector<StageMetrics> TEEEngine::pipelineMetrics()
+{
+    if (!pipeline_)
+        return {};
+    return pipeline_->metrics();
+}
+
+std::vector<IngestResult> TEEEngine::processOffers(std::vector<OfferRequest> requests, const VerificationTicket &ticket)
+{
+    std::size_t n = requests.size();
+    std::vector<IngestResult> results(n);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        results[i].offerId = requests[i].offerId;
+    }
+
+    ScopedLatency timer(batchIngestLatency);
+    TEE_LOG_INFO("TEEEngine", "Received batch of {} Offers", n);
+    if (isFollower())
+    {
+        for (auto &r : results)
+            r.message = "Read-only follower; submit offers to the primary.";
+        offersRejected.add(n);
+        return results;
+    }
+
+    // Keyword commitments for the whole batch in one pass, then the pairing
+    // checks, which dominate, spread over the batch verifiers.
+    std::vector<const Offer *> offers;
+    offers.reserve(n);
+    for (const auto &req : requests)
+        offers.push_back(&req.offer);
+    std::vector<OfferBinding> bindings;
+    std::vector<std::string> bindingErrors;
+    computeBindings(offers, validator_.circuitLayout(), bindings, bindingErrors);
+
+    std::vector<char> valid(n, 0);
+    std::atomic<std::size_t> next{0};
+    runOnBatchVerifiers([&] {
+        std::size_t i;
+        while ((i = next++) < n)
+        {
+            if (!bindingErrors[i].empty())
+                results[i].message = bindingErrors[i];
+            else if (!checkSellerKey(requests[i], results[i].message))
+                continue;
+            else if (stillWanted(ticket, results[i].message))
+                valid[i] = validator_.validateOfferProof(requests[i].proofPath, requests[i].publicInputsPath,
+                                                         bindings[i], results[i].message);
+        }
+    });
+
+    std::vector<OfferRequest *> toStore;
+    std::vector<FinancialDetails> details;
+    std::vector<std::size_t> toStoreIndex;
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        if (!valid[i])
+        {
+            if (results[i].message.empty())
+                results[i].message = "Proof invalid.";
+            continue;
+        }
+        toStore.push_back(&requests[i]);
+        toStoreIndex.push_back(i);
+        details.push_back(financialDetailsOf(requests[i]));
+    }
+
+    std::vector<bool> stored;
+    storage_.storeOffers(toStore, stored);
+
+    std::vector<FinancialDetails> batch;
+    std::vector<std::string> committed;
+    for (std::size_t k = 0; k < toStore.size(); ++k)
+    {
+        IngestResult &result = results[toStoreIndex[k]];
+        if (!stored[k])
+        {
+            result.message = "Memory budget exhausted.";
+            continue;
+        }
+        result.accepted = true;
+        committed.push_back(result.offerId);
+        batch.push_back(std::move(details[k]));
+    }
+    notifySubscribers(committed);
+    poster_.postFinancialDetailsBatch(batch);
+
+    offersAccepted.add(batch.size());
+    offersRejected.add(n - batch.size());
+    TEE_LOG_INFO("TEEEngine", "Batch accepted {} of {} Offers.", batch.size(), n);
+    return results;
+}
+
+bool TEEEngine::submitOffers(std::vector<OfferRequest> requests, std::function<void(std::vector<IngestResult>)> done,
+                             VerificationTicket ticket)
+{
+    if (!batchWorker_.joinable())
+    {
+        done(processOffers(std::move(requests), ticket));
+        return true;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(batchMtx_);
+        if (batchQueue_.size() >= kMaxQueuedBatches)
+            return false;
+        batchQueue_.push_back(std::make_unique<BatchJob>(BatchJob{std::move(requests), std::move(done), std::move(ticket)}));
+    }
+    batchCv_.notify_one();
+    return true;
+}
+
+void TEEEngine::batchLoop()
+{
+    while (true)
+    {
+        std::unique_ptr<BatchJob> job;
+        {
+            std::unique_lock<std::mutex> lock(batchMtx_);
+            batchCv_.wait(lock, [&] { return stopping_ || !batchQueue_.empty(); });
+            if (batchQueue_.empty())
+                return;
+            job = std::move(batchQueue_.front());
+            batchQueue_.pop_front();
+        }
+        job->done(processOffers(std::move(job->requests), job->ticket));
+    }
+}
+
+void TEEEngine::runOnBatchVerifiers(const std::function<void()> &drain)
+{
+    bool shared;
+    {
+        std::lock_guard<std::mutex> lock(verifierMtx_);
+        // Verifiers only exit once stopping_ is set, so a task published
+        // before that is always joined by all of them.
+        shared = !batchVerifiers_.empty() && !stopping_ && verifierTask_ == nullptr;
+        if (shared)
+        {
+            verifierTask_ = &drain;
+            verifiersBusy_ = batchVerifiers_.size();
+            ++verifierGeneration_;
+        }
+    }
+    if (!shared)
+    {
+        drain();
+        return;
+    }
+    verifierCv_.notify_all();
+    drain();
+
+    std::unique_lock<std::mutex> lock(verifierMtx_);
+    verifierDoneCv_.wait(lock, [&] { return verifiersBusy_ == 0; });
+    verifierTask_ = nullptr;
+}
+
+void TEEEngine::batchVerifierLoop()
+{
+    std::uint64_t seen = 0;
+    while (true)
+    {
+        const std::function<void()> *task;
+        {
+            std::unique_lock<std::mutex> lock(verifierMtx_);
+            verifierCv_.wait(lock, [&] { return stopping_ || verifierGeneration_ != seen; });
+            if (verifierGeneration_ == seen)
+                return;
+            seen = verifierGeneration_;
+            task = verifierTask_;
+        }
+        (*task)();
+        {
+            std::lock_guard<std::mutex> lock(verifierMtx_);
+            if (--verifiersBusy_ == 0)
+                verifierDoneCv_.notify_one();
+        }
+    }
+}
+
+/*************************
+ * Metadata updates
+ ************************/
+static bool parseFinancialUpdate(const std::string &payload, std::string &offerId, FinancialUpdate &update, std::string &error)
+{
+    auto j = nlohmann::json::parse(payload, nullptr, false);
+    if (!j.is_object() || !j.contains("offerId") || !j["offerId"].is_string() ||
+        !j.contains("nonce") || !j["nonce"].is_number_unsigned())
+    {
+        error = "Update payload must be a JSON object with offerId and an unsigned nonce.";
+        return false;
+    }
+    offerId = j["offerId"].get<std::string>();
+    update.nonce = j["nonce"].get<std::uint64_t>();
+
+    if (auto it = j.find("reservePrice"); it != j.end())
+    {
+        if (!it->is_number() || it->get<double>() < 0)
+        {
+            error = "reservePrice must be a non-negative number.";
+            return false;
+        }
+        update.reservePrice = it->get<double>();
+    }
+    if (auto it = j.find("preferredBuyers"); it != j.end())
+    {
+        if (!it->is_number_integer() || it->get<int>() < 1)
+        {
+            error = "preferredBuyers must be a positive integer.";
+            return false;
+        }
+        update.preferredBuyers = it->get<int>();
+    }
+    if (auto it = j.find("expiryDays"); it != j.end())
+    {
+        if (!it->is_number_integer() || it->get<int>() < 0)
+        {
+            error = "expiryDays must be a non-negative integer.";
+            return false;
+        }
+        update.expiryDays = it->get<int>();
+    }
+    if (!update.reservePrice && !update.preferredBuyers && !update.expiryDays)
+    {
+        error = "Update changes nothing.";
+        return false;
+    }
+    return true;
+}
+
+bool TEEEngine::updateOffer(const std::string &payload, const std::string &signatureHex,
+                            std::string &offerId, std::string &error)
+{
+    ScopedLatency timer(updateLatency);
+    FinancialUpdate update;
+    if (isFollower())
+        error = "Read-only follower; send updates to the primary.";
+    else if (parseFinancialUpdate(payload, offerId, update, error))
+    {
+        auto current = storage_.projectOffer(offerId, kOfferFieldSellerKey | kOfferFieldUpdateNonce);
+        if (!current)
+            error = "Offer not found.";
+        else if (current->sellerPublicKey.empty())
+            error = "Offer was submitted without a sellerPublicKey and cannot be updated.";
+        else if (update.nonce <= current->updateNonce)
+            error = "Stale nonce; the last applied update used " + std::to_string(current->updateNonce) + ".";
+        else if (!verifySellerSignature(current->sellerPublicKey, payload, signatureHex))
+            error = "Signature does not verify under the offer's seller key.";
+        else if (auto updated = storage_.updateFinancials(offerId, update))
+        {
+            if (update.preferredBuyers)
+                slots_.setCapacity(offerId, static_cast<std::uint32_t>(updated->preferredNumberOfBuyers));
+            auctions_.setTerms(offerId, AuctionTerms{updated->reservePrice,
+                                                     static_cast<std::uint32_t>(updated->preferredNumberOfBuyers)});
+            postOffer(FinancialDetails{offerId, updated->reservePrice, updated->preferredNumberOfBuyers,
+                                       updated->expiryDays, updated->cooldownMonths,
+                                       updated->publicVerificationKeyFDE});
+            return true;
+        }
+        else
+            error = "Offer changed concurrently; retry with a newer nonce.";
+    }
+
+    TEE_LOG_WARN("TEEEngine", "Rejected update of Offer [{}]: {}", offerId, error);
+    updatesRejected.add();
+    return false;
+}
+
+void TEEEngine::configurePosting(const PosterConfig &config, std::shared_ptr<ChainClient> chain)
+{
+    poster_.configure(config, std::move(chain));
+}
+
+std::optional<InclusionReceipt> TEEEngine::inclusionReceipt(const std::string &offerId)
+{
+    return poster_.inclusionReceipt(offerId);
+}
+
+CatalogCommitment TEEEngine::catalogCommitment()
+{
+    return storage_.catalogCommitment();
+}
+
+std::optional<CatalogProof> TEEEngine::catalogProof(const std::string &offerId)
+{
+    return storage_.catalogProof(offerId);
+}
+
+PosterBacklog TEEEngine::postingBacklog()
+{
+    return poster_.backlog();
+}
+
 Offer TEEEngine::getOffer(const std::string &offerId)
 {
     auto maybeOffer = storage_.retrieveOffer(offerId);
@@ -66,3 +786,380 @@ Offer TEEEngine::getOffer(const std::string &offerId)
     }
     return Offer(); // Or throw an exception if not found
 }
+
+std::optional<Offer> TEEEngine::findOffer(const std::string &offerId)
+{
+    return storage_.retrieveOffer(offerId);
+}
+
+std::shared_ptr<const std::string> TEEEngine::offerResponse(const std::string &offerId)
+{
+    return storage_.renderedOffer(offerId, [&](const Offer &offer) {
+        nlohmann::json response;
+        response["status"] = "OK";
+        response["offerId"] = offerId;
+        response["offer"] = offer;
+        return std::make_shared<const std::string>(response.dump());
+    });
+}
+
+void TEEEngine::setResponseCacheBudget(std::size_t budgetBytes)
+{
+    storage_.setResponseCacheCapacity(budgetBytes);
+}
+
+bool TEEEngine::searchOffers(const std::string &query, QueryRank rank, std::size_t limit, QueryResult &result,
+                             std::string &error)
+{
+    ScopedLatency timer(searchLatency);
+    KeywordQuery parsed;
+    if (!parseKeywordQuery(query, parsed, error))
+        return false;
+    result = storage_.searchOffers(parsed, rank, limit);
+    return true;
+}
+
+std::vector<std::string> TEEEngine::listOfferIds()
+{
+    return storage_.listOfferIds();
+}
+
+std::optional<Offer> TEEEngine::projectOffer(const std::string &offerId, OfferFieldMask mask)
+{
+    return storage_.projectOffer(offerId, mask);
+}
+
+std::vector<std::optional<Offer>> TEEEngine::projectOffers(const std::vector<std::string> &offerIds, OfferFieldMask mask)
+{
+    return storage_.projectOffers(offerIds, mask);
+}
+
+ChangeFeedPage TEEEngine::changesSince(std::uint64_t sinceSeq, std::size_t maxChanges)
+{
+    return storage_.changeFeed(sinceSeq, maxChanges);
+}
+
+std::uint64_t TEEEngine::snapshotOffers(std::vector<std::pair<std::string, Offer>> &out)
+{
+    return storage_.snapshot(out);
+}
+
+void TEEEngine::startExpirySweeper(std::chrono::seconds interval)
+{
+    if (isFollower())
+        return;
+
+    expirySweeper_ = std::thread([this, interval] {
+        std::unique_lock<std::mutex> lock(sweeperMtx_);
+        while (!sweeperCv_.wait_for(lock, interval, [&] { return stopping_; }))
+        {
+            lock.unlock();
+            std::size_t expired = storage_.expireOffers();
+            if (expired > 0)
+                TEE_LOG_INFO("TEEEngine", "Expired {} offers.", expired);
+            lock.lock();
+        }
+    });
+}
+
+void TEEEngine::publishChangeLog(const std::string &socketPath)
+{
+    replicationPrimary_ = std::make_unique<ReplicationPrimary>(storage_, socketPath);
+    replicationPrimary_->start();
+}
+
+void TEEEngine::followPrimary(const std::string &socketPath)
+{
+    replicationFollower_ = std::make_unique<ReplicationFollower>(storage_, socketPath);
+    replicationFollower_->start();
+}
+
+bool TEEEngine::isFollower() const
+{
+    return replicationFollower_ != nullptr;
+}
+
+std::optional<ReplicationStatus> TEEEngine::replicationStatus()
+{
+    if (!replicationFollower_)
+        return std::nullopt;
+    return replicationFollower_->status();
+}
+
+void TEEEngine::enableCheckpoints(const std::string &path, std::chrono::seconds interval)
+{
+    Checkpointer::restore(storage_, path);
+    checkpointer_ = std::make_unique<Checkpointer>(storage_, path);
+    if (interval.count() > 0)
+        checkpointer_->startPeriodic(interval);
+}
+
+bool TEEEngine::checkpointNow()
+{
+    return checkpointer_ && checkpointer_->start();
+}
+
+std::optional<CheckpointStats> TEEEngine::checkpointStats()
+{
+    if (!checkpointer_)
+        return std::nullopt;
+    return checkpointer_->lastStats();
+}
+
+void TEEEngine::configureReservations(std::chrono::milliseconds ttl, std::chrono::milliseconds sweepInterval)
+{
+    slots_.setTtl(ttl);
+    if (!isFollower())
+        slots_.startSweeper(sweepInterval);
+}
+
+// Reservations live only on the primary, which is where buyers must go.
+static bool servedByPrimary(bool follower, std::string &error)
+{
+    if (follower)
+        error = "Read-only follower; send purchases to the primary.";
+    return !follower;
+}
+
+bool TEEEngine::reserveSlot(const std::string &offerId, const std::string &buyer, ReservationResult &result,
+                            std::string &error)
+{
+    if (!servedByPrimary(isFollower(), error))
+        return false;
+    if (buyer.empty())
+    {
+        error = "A reservation needs a buyer.";
+        return false;
+    }
+    result = slots_.reserve(offerId, buyer);
+    return true;
+}
+
+bool TEEEngine::confirmPurchase(const std::string &offerId, const std::string &reservationId, ConfirmStatus &status,
+                                std::string &buyer, std::string &error)
+{
+    if (!servedByPrimary(isFollower(), error))
+        return false;
+    status = slots_.confirm(offerId, reservationId, &buyer);
+    if (status == ConfirmStatus::Confirmed)
+        TEE_LOG_INFO("TEEEngine", "Confirmed a purchase of Offer [{}].", offerId);
+    return true;
+}
+
+bool TEEEngine::releaseSlot(const std::string &offerId, const std::string &reservationId, std::string &error)
+{
+    if (!servedByPrimary(isFollower(), error))
+        return false;
+    if (!slots_.release(offerId, reservationId))
+    {
+        error = "No unconfirmed reservation with this id.";
+        return false;
+    }
+    return true;
+}
+
+std::optional<SlotCounts> TEEEngine::slotCounts(const std::string &offerId)
+{
+    if (isFollower())
+        return std::nullopt;
+    if (auto counts = slots_.counts(offerId))
+        return counts;
+    // Not reserved yet: every slot is free.
+    auto offer = storage_.projectOffer(offerId, kOfferFieldPreferredBuyers);
+    if (!offer)
+        return std::nullopt;
+    SlotCounts counts;
+    counts.capacity = static_cast<std::uint32_t>(std::max(0, offer->preferredNumberOfBuyers));
+    return counts;
+}
+
+void TEEEngine::configureAuctions(ClearingRule rule, std::chrono::milliseconds sweepInterval)
+{
+    auctions_.setRule(rule);
+    if (!isFollower())
+        auctions_.startSweeper(sweepInterval);
+}
+
+bool TEEEngine::submitBid(const std::string &offerId, const std::string &bidder, double amount, std::string &error)
+{
+    if (!servedByPrimary(isFollower(), error))
+        return false;
+    if (bidder.empty())
+        error = "A bid needs a bidder.";
+    else if (!std::isfinite(amount) || amount <= 0)
+        error = "amount must be a positive number.";
+    else
+    {
+        switch (auctions_.submitBid(offerId, bidder, amount))
+        {
+        case BidStatus::Accepted:
+            return true;
+        case BidStatus::BelowReserve:
+            error = "Bid is below the reserve price.";
+            break;
+        case BidStatus::Closed:
+            error = "Auction already cleared.";
+            break;
+        case BidStatus::UnknownOffer:
+            error = "Offer not found.";
+            break;
+        }
+    }
+    return false;
+}
+
+bool TEEEngine::clearAuction(const std::string &payload, const std::string &signatureHex, std::string &offerId,
+                             AuctionResult &result, std::string &error)
+{
+    if (!servedByPrimary(isFollower(), error))
+        return false;
+
+    // Clearing happens once, so a replayed request changes nothing and needs no nonce.
+    auto j = nlohmann::json::parse(payload, nullptr, false);
+    if (!j.is_object() || !j.contains("offerId") || !j["offerId"].is_string() ||
+        j.value("action", "") != "clearAuction")
+    {
+        error = "Payload must be a JSON object with offerId and \"action\": \"clearAuction\".";
+        return false;
+    }
+    offerId = j["offerId"].get<std::string>();
+    auto current = storage_.projectOffer(offerId, kOfferFieldSellerKey);
+    if (!current)
+        error = "Offer not found.";
+    else if (current->sellerPublicKey.empty())
+        error = "Offer was submitted without a sellerPublicKey; its auction clears at expiry.";
+    else if (!verifySellerSignature(current->sellerPublicKey, payload, signatureHex))
+        error = "Signature does not verify under the offer's seller key.";
+    else
+    {
+        auto results = auctions_.clear({offerId});
+        if (!results.empty())
+        {
+            result = std::move(results[0]);
+            TEE_LOG_INFO("TEEEngine", "Auction of Offer [{}] cleared: {} winners at {}.", offerId,
+                         result.winners.size(), result.price);
+            return true;
+        }
+        error = "Offer not found.";
+    }
+    return false;
+}
+
+std::optional<AuctionResult> TEEEngine::auctionResult(const std::string &offerId)
+{
+    return auctions_.result(offerId);
+}
+
+std::uint64_t TEEEngine::addSubscriber(SubscriptionIndex::Sink sink)
+{
+    return subscriptions_.addSubscriber(std::move(sink));
+}
+
+void TEEEngine::removeSubscriber(std::uint64_t subscriberId)
+{
+    subscriptions_.removeSubscriber(subscriberId);
+}
+
+bool TEEEngine::subscribe(std::uint64_t subscriberId, const std::vector<std::string> &keywords,
+                          std::uint64_t &subscriptionId, std::string &error)
+{
+    // Offers are committed, and so matched, on the primary only.
+    if (isFollower())
+    {
+        error = "Read-only follower; subscribe on the primary.";
+        return false;
+    }
+    return subscriptions_.subscribe(subscriberId, keywords, subscriptionId, error);
+}
+
+bool TEEEngine::unsubscribe(std::uint64_t subscriberId, std::uint64_t subscriptionId, std::string &error)
+{
+    if (!subscriptions_.unsubscribe(subscriberId, subscriptionId))
+    {
+        error = "Unknown subscription.";
+        return false;
+    }
+    return true;
+}
+
+void TEEEngine::setCircuitLayout(const CircuitLayout &layout)
+{
+    validator_.setCircuitLayout(layout);
+}
+
+void TEEEngine::setMemoryBudget(std::size_t budgetBytes, const std::string &spillDir)
+{
+    storage_.setMemoryBudget(budgetBytes, spillDir);
+}
+
+MemoryUsage TEEEngine::memoryUsage()
+{
+    return storage_.memoryUsage();
+}
+
+void TEEEngine::renderMetrics(std::string &out)
+{
+    MetricsRegistry::instance().render(out);
+
+    MemoryUsage usage = storage_.memoryUsage();
+    appendMetricHeader(out, "tee_storage_offers", "Offers currently stored.", "gauge");
+    appendMetricSample(out, "tee_storage_offers", static_cast<double>(usage.offerCount));
+    appendMetricHeader(out, "tee_storage_bytes", "Accounted storage memory: offers, change log, pending offers and cached responses.", "gauge");
+    appendMetricSample(out, "tee_storage_bytes", static_cast<double>(usage.totalBytes));
+    appendMetricHeader(out, "tee_storage_spilled_offers", "Offers whose plaintext is spilled to disk.", "gauge");
+    appendMetricSample(out, "tee_storage_spilled_offers", static_cast<double>(usage.spilledCount));
+    appendMetricHeader(out, "tee_storage_pending_offers", "Speculatively accepted offers awaiting verification.", "gauge");
+    appendMetricSample(out, "tee_storage_pending_offers", static_cast<double>(usage.pendingCount));
+    appendMetricHeader(out, "tee_catalog_leaf_slots", "Leaf slots in the catalog Merkle tree, empty ones included.", "gauge");
+    appendMetricSample(out, "tee_catalog_leaf_slots", static_cast<double>(storage_.catalogCommitment().leafCount));
+    appendMetricHeader(out, "tee_change_log_head_seq", "Sequence number of the latest storage change.", "gauge");
+    appendMetricSample(out, "tee_change_log_head_seq", static_cast<double>(storage_.headSequence()));
+
+    SlotCounts slots = slots_.totals();
+    appendMetricHeader(out, "tee_slot_reserved", "Buyer slots held by unconfirmed reservations.", "gauge");
+    appendMetricSample(out, "tee_slot_reserved", static_cast<double>(slots.reserved));
+    appendMetricHeader(out, "tee_slot_tracked_offers", "Offers with reservation state.", "gauge");
+    appendMetricSample(out, "tee_slot_tracked_offers", static_cast<double>(slots_.trackedOffers()));
+
+    appendMetricHeader(out, "tee_auction_open", "Auctions taking bids.", "gauge");
+    appendMetricSample(out, "tee_auction_open", static_cast<double>(auctions_.openAuctions()));
+    appendMetricHeader(out, "tee_auction_open_bids", "Sealed bids held by open auctions.", "gauge");
+    appendMetricSample(out, "tee_auction_open_bids", static_cast<double>(auctions_.openBids()));
+
+    appendMetricHeader(out, "tee_search_keywords", "Distinct keywords in the search index.", "gauge");
+    appendMetricSample(out, "tee_search_keywords", static_cast<double>(storage_.indexedKeywords()));
+
+    ResponseCache::Stats cache = storage_.responseCacheStats();
+    appendMetricHeader(out, "tee_response_cache_entries", "Offers with a cached getOffer response.", "gauge");
+    appendMetricSample(out, "tee_response_cache_entries", static_cast<double>(cache.entries));
+    appendMetricHeader(out, "tee_response_cache_bytes", "Bytes of cached getOffer responses.", "gauge");
+    appendMetricSample(out, "tee_response_cache_bytes", static_cast<double>(cache.bytes));
+
+    appendMetricHeader(out, "tee_subscriptions", "Standing keyword subscriptions.", "gauge");
+    appendMetricSample(out, "tee_subscriptions", static_cast<double>(subscriptions_.subscriptions()));
+    appendMetricHeader(out, "tee_subscribers", "Connections holding subscriptions.", "gauge");
+    appendMetricSample(out, "tee_subscribers", static_cast<double>(subscriptions_.subscribers()));
+
+    PosterBacklog backlog = poster_.backlog();
+    appendMetricHeader(out, "tee_onchain_waiting_offers", "Offers queued for on-chain posting, not yet in a batch.", "gauge");
+    appendMetricSample(out, "tee_onchain_waiting_offers", static_cast<double>(backlog.waitingOffers));
+    appendMetricHeader(out, "tee_onchain_outbox_batches", "Batches cut but not yet included or refused for good.", "gauge");
+    appendMetricSample(out, "tee_onchain_outbox_batches", static_cast<double>(backlog.undeliveredBatches));
+
+    auto stages = pipelineMetrics();
+    if (!stages.empty())
+    {
+        appendMetricHeader(out, "tee_pipeline_queue_depth", "Jobs waiting in front of each ingest stage.", "gauge");
+        for (const auto &m : stages)
+        {
+            appendMetricSample(out, "tee_pipeline_queue_depth", static_cast<double>(m.queueDepth), "stage=\"" + m.name + "\"");
+        }
+    }
+
+    auto replication = replicationStatus();
+    if (replication.has_value())
+    {
+        appendMetricHeader(out, "tee_replication_lag_records", "Changes the follower is behind the primary.", "gauge");
+        appendMetricSample(out, "tee_replication_lag_records", static_cast<double>(replication->lagRecords));
+    }
+}
@@ -1,12 +1,39 @@
 #ifndef TEEENGINE_HPP
 #define TEEENGINE_HPP
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <thread>
 #include <vector>
 #include "Offer.hpp"
 #include "TEEStorage.hpp"
 #include "OfferValidator.hpp"
 #include "OnChainPoster.hpp"
+#include "Replication.hpp"
+#include "Checkpointer.hpp"
+#include "IngestPipeline.hpp"
+#include "SlotAllocator.hpp"
+#include "AuctionBook.hpp"
+#include "SubscriptionIndex.hpp"
+
+struct IngestPipelineConfig
+{
+    std::size_t parseWorkers = 1;
+    std::size_t precheckWorkers = 1;
+    std::size_t verifyWorkers = std::max(1u, std::thread::hardware_concurrency());
+    std::size_t persistWorkers = 1;
+    std::size_t postWorkers = 1;
+    std::size_t queueCapacity = 1024;
+    // Verification deadline for requests that do not ask for a shorter one.
+    std::chrono::milliseconds verifyDeadline{30000};
+};
 
 class TEEEngine
 {
@@ -14,9 +41,74 @@ private:
     TEEStorage storage_;
     OfferValidator validator_;
     OnChainPoster poster_;
+    std::unique_ptr<ReplicationPrimary> replicationPrimary_;
+    std::unique_ptr<ReplicationFollower> replicationFollower_;
+    std::unique_ptr<Checkpointer> checkpointer_;
+    std::mutex sweeperMtx_;
+    std::condition_variable sweeperCv_;
+    bool stopping_ = false;
+    std::thread expirySweeper_;
+    std::unique_ptr<IngestPipeline> pipeline_;
+    SlotAllocator slots_;
+    AuctionBook auctions_;
+    SubscriptionIndex subscriptions_;
+    std::chrono::milliseconds verifyDeadline_{IngestPipelineConfig().verifyDeadline};
+
+    // Batches run on their own worker; verification inside a batch is spread
+    // over a fixed set of verifier threads started with it, which sit idle
+    // between batches.
+    struct BatchJob
+    {
+        std::vector<OfferRequest> requests;
+        std::function<void(std::vector<IngestResult>)> done;
+        VerificationTicket ticket;
+    };
+    static constexpr std::size_t kMaxQueuedBatches = 64;
+    std::mutex batchMtx_;
+    std::condition_variable batchCv_;
+    std::deque<std::unique_ptr<BatchJob>> batchQueue_;
+    std::thread batchWorker_;
+    std::mutex verifierMtx_;
+    std::condition_variable verifierCv_;     // a new batch task to join
+    std::condition_variable verifierDoneCv_; // every verifier finished the task
+    const std::function<void()> *verifierTask_ = nullptr;
+    std::uint64_t verifierGeneration_ = 0;
+    std::size_t verifiersBusy_ = 0;
+    std::vector<std::thread> batchVerifiers_;
+
+    void batchLoop();
+    void batchVerifierLoop();
+    // Runs drain on the caller and every verifier and returns once all are
+    // done; drain must share out the work itself. While another batch holds
+    // the verifiers, or before the pipeline starts, it runs on the caller alone.
+    void runOnBatchVerifiers(const std::function<void()> &drain);
+
+    // Speculative acceptance: offers acked before verification wait here,
+    // already stored as pending. unresolved counts queued and in-verification.
+    struct SpeculativeJob
+    {
+        OfferRequest request; // offer already moved into pending storage
+        FinancialDetails details;
+        VerificationTicket ticket;
+        std::chrono::steady_clock::time_point ackedAt;
+    };
+    std::size_t maxSpeculative_ = 0; // 0 = disabled
+    std::size_t speculativeUnresolved_ = 0;
+    std::mutex speculativeMtx_;
+    std::condition_variable speculativeCv_;
+    std::deque<SpeculativeJob> speculativeQueue_;
+    std::vector<std::thread> speculativeWorkers_;
+
+    bool acceptSpeculatively(OfferRequest &req, const VerificationTicket &ticket, IngestResult &result);
+    void speculativeLoop();
+    void resolveSpeculative(SpeculativeJob &job);
+
+    // Pushes newly committed offers to the subscribers they match.
+    void notifySubscribers(const std::vector<std::string> &offerIds);
 
 public:
     explicit TEEEngine(const std::string &vkFilePath);
+    ~TEEEngine();
 
     bool processOffer(
         const std::string &offerId,
@@ -33,8 +125,150 @@ public:
         const std::string &proofPath,
         const std::string &publicInputsPath);
 
+    // Synchronous ingest: precheck, verify, persist, post on-chain.
+    bool processOffer(const OfferRequest &req, std::string &error);
+    bool processOffer(OfferRequest &&req, std::string &error);
+
+    // Individual ingest stages, shared by processOffer and the pipeline.
+    // persistOffer moves req.offer into storage, so take the on-chain
+    // details with financialDetailsOf() before calling it.
+    bool precheckOffer(const OfferRequest &req, std::string &error);
+    bool verifyOffer(const OfferRequest &req, std::string &error);
+    bool persistOffer(OfferRequest &req, std::string &error);
+    void postOffer(const FinancialDetails &details);
+    static FinancialDetails financialDetailsOf(const OfferRequest &req);
+
+    // Asynchronous ingest through the staged pipeline. submitOffer returns
+    // false when the pipeline is saturated (done is not called); without a
+    // started pipeline it runs processOffer inline. Proof checks are taken
+    // earliest deadline first, and work whose ticket was cancelled or whose
+    // deadline passed is answered with an error instead of being verified.
+    void startIngestPipeline(const IngestPipelineConfig &config);
+    bool submitOffer(nlohmann::json message, IngestCallback done, VerificationTicket ticket = {});
+    std::vector<StageMetrics> pipelineMetrics();
+
+    // Ticket due requestedMs from now (capped at the configured deadline;
+    // 0 = the configured deadline), cancelled through token.
+    VerificationTicket verificationTicket(std::shared_ptr<const CancellationToken> token, std::int64_t requestedMs = 0) const;
+
+    // Opt-in: the pipeline's precheck stage stores the offer as pending and
+    // acks it (IngestResult::pending) if its ticket is still live; workers
+    // then verify the proof and promote and post the offer, or purge it if
+    // it fails or its deadline passes first. Pending offers are never visible
+    // to reads. At most maxPending offers await verification; beyond that
+    // offers go on through the pipeline's own verify stage.
+    void enableSpeculativeAcceptance(std::size_t maxPending, std::size_t workers);
+
+    // Bulk ingest with per-item results: one follower check, proofs verified
+    // in parallel, one storage lock for the batch and one on-chain post.
+    std::vector<IngestResult> processOffers(std::vector<OfferRequest> requests, const VerificationTicket &ticket = {});
+    // Asynchronous form; returns false when too many batches are queued.
+    bool submitOffers(std::vector<OfferRequest> requests, std::function<void(std::vector<IngestResult>)> done,
+                      VerificationTicket ticket = {});
+
+    // Seller-authenticated change of reservePrice, preferredBuyers and/or
+    // expiryDays without re-verifying the proof. payload is the signed JSON
+    // text {"offerId", "nonce", ...new values}; signatureHex is an Ed25519
+    // signature over exactly those bytes by the offer's sellerPublicKey.
+    // nonce must exceed the previous update's. The new terms are re-posted.
+    bool updateOffer(const std::string &payload, const std::string &signatureHex,
+                     std::string &offerId, std::string &error);
+
+    // Boolean keyword search, e.g. (EPA OR DOJ) AND fine AND NOT settlement,
+    // returning the best limit offers by rank (see KeywordQuery, KeywordIndex).
+    bool searchOffers(const std::string &query, QueryRank rank, std::size_t limit, QueryResult &result,
+                      std::string &error);
+
     // Retrieve a stored Offer
     Offer getOffer(const std::string &offerId);
+    std::optional<Offer> findOffer(const std::string &offerId);
+    std::vector<std::string> listOfferIds();
+
+    // The serialized getOffer response {"status":"OK","offerId","offer"},
+    // shared by every reader until the offer changes; null if not stored.
+    std::shared_ptr<const std::string> offerResponse(const std::string &offerId);
+    // Byte budget of cached responses (0 = keep none).
+    void setResponseCacheBudget(std::size_t budgetBytes);
+
+    // Lightweight reads of selected fields only (see TEEStorage::projectOffer).
+    std::optional<Offer> projectOffer(const std::string &offerId, OfferFieldMask mask);
+    std::vector<std::optional<Offer>> projectOffers(const std::vector<std::string> &offerIds, OfferFieldMask mask);
+
+    // Incremental catalog sync: events after sinceSeq, or snapshotRequired
+    // when sinceSeq has aged out of the change ring.
+    ChangeFeedPage changesSince(std::uint64_t sinceSeq, std::size_t maxChanges);
+    std::uint64_t snapshotOffers(std::vector<std::pair<std::string, Offer>> &out);
+
+    // Periodically drops expired offers (recorded as Expired changes). Primary only.
+    void startExpirySweeper(std::chrono::seconds interval);
+
+    // Replication: a primary publishes its storage change log on a Unix socket,
+    // a follower tails one and only serves reads.
+    void publishChangeLog(const std::string &socketPath);
+    void followPrimary(const std::string &socketPath);
+    bool isFollower() const;
+    std::optional<ReplicationStatus> replicationStatus();
+
+    // Copy-on-write checkpoints: restores from path if present, then
+    // checkpoints every interval (0 = only on demand).
+    void enableCheckpoints(const std::string &path, std::chrono::seconds interval);
+    bool checkpointNow();
+    std::optional<CheckpointStats> checkpointStats();
+
+    // Shape of the circuit's public signals, for binding offer fields to
+    // them; the default matches circom/email_circuit.circom.
+    void setCircuitLayout(const CircuitLayout &layout);
+
+    // Memory budget for stored offers (0 = unlimited); see TEEStorage.
+    void setMemoryBudget(std::size_t budgetBytes, const std::string &spillDir);
+    MemoryUsage memoryUsage();
+
+    // Catalog commitment: a Merkle root over every stored offer, updated in
+    // O(log n) per change and published with each on-chain batch.
+    CatalogCommitment catalogCommitment();
+    std::optional<CatalogProof> catalogProof(const std::string &offerId);
+
+    // On-chain posting: offers are posted in batches (see OnChainPoster);
+    // the receipt tells whether an offer's batch was included and proves
+    // its place in the batch root.
+    void configurePosting(const PosterConfig &config, std::shared_ptr<ChainClient> chain);
+    std::optional<InclusionReceipt> inclusionReceipt(const std::string &offerId);
+    PosterBacklog postingBacklog();
+
+    // Buyer slots: a buyer reserves one of an offer's preferredBuyers slots
+    // for the reservation TTL and confirms the purchase within it (see
+    // SlotAllocator). Primary only; false with error on a follower.
+    void configureReservations(std::chrono::milliseconds ttl, std::chrono::milliseconds sweepInterval);
+    bool reserveSlot(const std::string &offerId, const std::string &buyer, ReservationResult &result, std::string &error);
+    bool confirmPurchase(const std::string &offerId, const std::string &reservationId, ConfirmStatus &status,
+                         std::string &buyer, std::string &error);
+    bool releaseSlot(const std::string &offerId, const std::string &reservationId, std::string &error);
+    std::optional<SlotCounts> slotCounts(const std::string &offerId);
+
+    // Sealed-bid auctions of an offer's preferredBuyers units at or above its
+    // reservePrice (see AuctionBook). Auctions clear once their offer is
+    // gone, or when the seller signs {"offerId", "action": "clearAuction"}
+    // with the offer's sellerPublicKey. Primary only. The buyer slots own
+    // the units: winners each take one as a confirmed purchase, and once
+    // reservations have taken the rest the remaining bids lose.
+    void configureAuctions(ClearingRule rule, std::chrono::milliseconds sweepInterval);
+    bool submitBid(const std::string &offerId, const std::string &bidder, double amount, std::string &error);
+    bool clearAuction(const std::string &payload, const std::string &signatureHex, std::string &offerId,
+                      AuctionResult &result, std::string &error);
+    std::optional<AuctionResult> auctionResult(const std::string &offerId);
+
+    // Keyword subscriptions: once an offer is committed, every subscriber
+    // with a subscription whose keywords are all among the offer's
+    // verifiedKeywords gets one offerMatched message, serialized once and
+    // shared by all of them (see SubscriptionIndex). Primary only.
+    std::uint64_t addSubscriber(SubscriptionIndex::Sink sink);
+    void removeSubscriber(std::uint64_t subscriberId);
+    bool subscribe(std::uint64_t subscriberId, const std::vector<std::string> &keywords,
+                   std::uint64_t &subscriptionId, std::string &error);
+    bool unsubscribe(std::uint64_t subscriberId, std::uint64_t subscriptionId, std::string &error);
+
+    // Prometheus text exposition: the metrics registry plus engine gauges.
+    void renderMetrics(std::string &out);
 };
 
 #endif // TEEENGINE_HPP
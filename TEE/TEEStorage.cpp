@@ -1,22 +1,659 @@
 #include "TEEStorage.hpp"
+#include "MemoryAccounting.hpp"
+#include "OfferJson.hpp"
+#include "Logger.hpp"
+#include "Metrics.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
 
-void TEEStorage::storeOffer(const std::string &offerId, const Offer &offer)
+static constexpr std::int64_t kMicrosPerDay = 86400LL * 1000000LL;
+
+static LatencyHistogram &storeLatency = MetricsRegistry::instance().histogram(
+    "tee_storage_store_seconds", "Time to store an offer or a batch, including lock wait.");
+static LatencyHistogram &retrieveLatency = MetricsRegistry::instance().histogram(
+    "tee_storage_retrieve_seconds", "Time to look up an offer, including spilled blob reads.");
+
+static std::int64_t nowMicros()
 {
-    std::lock_guard<std::mutex> lock(mtx_);
-    offers_[offerId] = offer;
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+// Plain POSIX I/O: these also run inside forkFrozen children.
+static bool readBlob(const std::string &path, std::string &out)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    char buf[65536];
+    ssize_t n;
+    out.clear();
+    while ((n = ::read(fd, buf, sizeof(buf))) != 0)
+    {
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            ::close(fd);
+            return false;
+        }
+        out.append(buf, static_cast<std::size_t>(n));
+    }
+    ::close(fd);
+    return true;
+}
+
+static bool writeBlob(const std::string &path, const std::string &data)
+{
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0)
+        return false;
+
+    std::size_t written = 0;
+    while (written < data.size())
+    {
+        ssize_t n = ::write(fd, data.data() + written, data.size() - written);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            ::close(fd);
+            return false;
+        }
+        written += static_cast<std::size_t>(n);
+    }
+    return ::close(fd) == 0;
+}
+
+static void appendJsonString(std::string &out, const std::string &value)
+{
+    static const char digits[] = "0123456789abcdef";
+    out.push_back('"');
+    for (char c : value)
+    {
+        switch (c)
+        {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\b': out += "\\b"; break;
+        case '\f': out += "\\f"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+            {
+                out += "\\u00";
+                out.push_back(digits[(c >> 4) & 0xf]);
+                out.push_back(digits[c & 0xf]);
+            }
+            else
+            {
+                out.push_back(c);
+            }
+        }
+    }
+    out.push_back('"');
+}
+
+// Preimage of an offer's catalog leaf (see CatalogProof), written by hand
+// in sorted key order: it is built on every store, and a json DOM of the
+// offer costs more than the hashing.
+static void catalogLeafData(std::string &out, const std::string &offerId, const Offer &offer,
+                            const MerkleHash &plaintextHash)
+{
+    out.clear();
+    out += "{\"offer\":{\"cooldownMonths\":";
+    out += std::to_string(offer.cooldownMonths);
+    out += ",\"encryptedPlaintextHash\":\"";
+    out += toHex(plaintextHash);
+    out += "\",\"expiryDays\":";
+    out += std::to_string(offer.expiryDays);
+    out += ",\"nullifier\":";
+    appendJsonString(out, offer.nullifier);
+    out += ",\"preferredBuyers\":";
+    out += std::to_string(offer.preferredNumberOfBuyers);
+    out += ",\"publicVerificationKeyFDE\":";
+    appendJsonString(out, offer.publicVerificationKeyFDE);
+    out += ",\"reservePrice\":";
+    out += nlohmann::json(offer.reservePrice).dump(); // same formatting as getOffer
+    out += ",\"sellerPublicKey\":";
+    appendJsonString(out, offer.sellerPublicKey);
+    out += ",\"title\":";
+    appendJsonString(out, offer.title);
+    out += ",\"unverifiedText\":";
+    appendJsonString(out, offer.unverifiedText);
+    out += ",\"updateNonce\":";
+    out += std::to_string(offer.updateNonce);
+    out += ",\"verifiedKeywords\":[";
+    for (std::size_t i = 0; i < offer.verifiedKeywords.size(); ++i)
+    {
+        if (i > 0)
+            out.push_back(',');
+        appendJsonString(out, offer.verifiedKeywords[i]);
+    }
+    out += "]},\"offerId\":";
+    appendJsonString(out, offerId);
+    out.push_back('}');
+}
+
+static MerkleHash catalogLeafHash(const std::string &offerId, const Offer &offer, const MerkleHash &plaintextHash)
+{
+    thread_local std::string buffer;
+    catalogLeafData(buffer, offerId, offer, plaintextHash);
+    return merkleLeafHash(buffer);
+}
+
+static std::int64_t expiresAtUs(const Offer &offer, std::int64_t storedAtUs)
+{
+    if (offer.expiryDays <= 0)
+        return std::numeric_limits<std::int64_t>::max();
+    return storedAtUs + offer.expiryDays * kMicrosPerDay;
+}
+
+static bool isExpired(const Offer &offer, std::int64_t storedAtUs, std::int64_t nowUs)
+{
+    return expiresAtUs(offer, storedAtUs) <= nowUs;
+}
+
+const char *changeKindName(ChangeKind kind)
+{
+    switch (kind)
+    {
+    case ChangeKind::Created:
+        return "created";
+    case ChangeKind::Updated:
+        return "updated";
+    case ChangeKind::Expired:
+        return "expired";
+    }
+    return "unknown";
+}
+
+std::optional<ChangeKind> parseChangeKind(const std::string &name)
+{
+    if (name == "created")
+        return ChangeKind::Created;
+    if (name == "updated")
+        return ChangeKind::Updated;
+    if (name == "expired")
+        return ChangeKind::Expired;
+    return std::nullopt;
+}
+
+TEEStorage::TEEStorage(std::size_t changeLogCapacity)
+    : changeLogCapacity_(changeLogCapacity == 0 ? 1 : changeLogCapacity)
+{
+}
+
+/*************************
+ * Accounting helpers
+ ************************/
+std::size_t TEEStorage::entryBytes(const std::string &offerId, const StoredOffer &stored)
+{
+    return kMapNodeOverhead +
+           sizeof(std::pair<const std::string, StoredOffer>) +
+           heapBytes(offerId) +
+           heapBytes(stored.offer) +
+           heapBytes(stored.spillPath) +
+           (stored.inSpillLru ? kListNodeOverhead + sizeof(std::string) + heapBytes(offerId) : 0);
+}
+
+std::size_t TEEStorage::logEntryBytes(const ChangeLogEntry &entry)
+{
+    return sizeof(ChangeLogEntry) + heapBytes(entry.offerId);
+}
+
+std::size_t TEEStorage::pendingEntryBytes(const std::string &offerId, const Offer &offer)
+{
+    return kMapNodeOverhead + sizeof(std::pair<const std::string, Offer>) + heapBytes(offerId) + heapBytes(offer);
+}
+
+void TEEStorage::accountLocked(std::map<std::string, StoredOffer>::iterator it)
+{
+    usage_.offersBytes -= it->second.bytes;
+    it->second.bytes = entryBytes(it->first, it->second);
+    usage_.offersBytes += it->second.bytes;
+}
+
+// Marks the offer's blob as most recently read.
+void TEEStorage::touchLocked(StoredOffer &stored)
+{
+    if (stored.inSpillLru)
+        spillLru_.splice(spillLru_.begin(), spillLru_, stored.spillLru);
+}
+
+void TEEStorage::unlinkSpillLruLocked(StoredOffer &stored)
+{
+    if (stored.inSpillLru)
+    {
+        spillLru_.erase(stored.spillLru);
+        stored.inSpillLru = false;
+        residentBlobBytes_ -= stored.offer.encryptedPlaintext.size();
+    }
+}
+
+void TEEStorage::appendChangeLocked(std::uint64_t seq, std::int64_t commitTimeUs, ChangeKind kind, const std::string &offerId)
+{
+    changeLog_.push_back(ChangeLogEntry{seq, commitTimeUs, kind, offerId});
+    usage_.changeLogBytes += logEntryBytes(changeLog_.back());
+    while (changeLog_.size() > changeLogCapacity_)
+    {
+        usage_.changeLogBytes -= logEntryBytes(changeLog_.front());
+        changeLog_.pop_front();
+    }
+    headSeq_ = seq;
+}
+
+void TEEStorage::putLocked(const std::string &offerId, Offer offer, std::int64_t storedAtUs, bool commit)
+{
+    MerkleHash plaintextHash{};
+    if (commit)
+        plaintextHash = merkleLeafHash(offer.encryptedPlaintext);
+
+    auto it = offers_.find(offerId);
+    if (it == offers_.end())
+    {
+        it = offers_.emplace(offerId, StoredOffer{}).first;
+    }
+    else if (!it->second.spillPath.empty())
+    {
+        ::unlink(it->second.spillPath.c_str());
+        usage_.spilledCount--;
+        usage_.spilledBytes -= it->second.spilledBytes;
+        it->second.spillPath.clear();
+        it->second.spilledBytes = 0;
+    }
+
+    // A resubmitted id keeps its update nonce, so updates signed for the
+    // offer it replaces cannot be replayed against the new one.
+    offer.updateNonce = std::max(offer.updateNonce, it->second.offer.updateNonce);
+    unlinkSpillLruLocked(it->second); // while residentBlobBytes_ still counts the old blob
+    it->second.offer = std::move(offer);
+    it->second.storedAtUs = storedAtUs;
+    nextExpiryUs_ = std::min(nextExpiryUs_, expiresAtUs(it->second.offer, storedAtUs));
+    keywordIndex_.put(offerId, it->second.offer.verifiedKeywords, it->second.offer.reservePrice, storedAtUs);
+    responses_.invalidate(offerId);
+    if (!it->second.offer.encryptedPlaintext.empty())
+    {
+        it->second.spillLru = spillLru_.insert(spillLru_.begin(), offerId);
+        it->second.inSpillLru = true;
+        residentBlobBytes_ += it->second.offer.encryptedPlaintext.size();
+    }
+    it->second.plaintextHash = plaintextHash;
+    accountLocked(it);
+    usage_.offerCount = offers_.size();
+    if (commit)
+        commitLocked(it);
+}
+
+void TEEStorage::eraseLocked(std::map<std::string, StoredOffer>::iterator it)
+{
+    if (!it->second.spillPath.empty())
+    {
+        ::unlink(it->second.spillPath.c_str());
+        usage_.spilledCount--;
+        usage_.spilledBytes -= it->second.spilledBytes;
+    }
+    // loadSnapshot resets the tree before erasing, leaving slots out of range.
+    std::size_t slot = it->second.catalogSlot;
+    if (slot < catalog_.size())
+    {
+        catalog_.set(slot, MerkleHash{});
+        freeCatalogSlots_.push_back(slot);
+    }
+    keywordIndex_.remove(it->first);
+    responses_.invalidate(it->first);
+    unlinkSpillLruLocked(it->second);
+    usage_.offersBytes -= it->second.bytes;
+    offers_.erase(it);
+    usage_.offerCount = offers_.size();
+}
+
+// Recomputes the offer's leaf from its current fields, taking a slot if it has none.
+void TEEStorage::commitLocked(std::map<std::string, StoredOffer>::iterator it)
+{
+    StoredOffer &stored = it->second;
+    MerkleHash leaf = catalogLeafHash(it->first, stored.offer, stored.plaintextHash);
+    if (stored.catalogSlot != kNoCatalogSlot)
+    {
+        catalog_.set(stored.catalogSlot, leaf);
+    }
+    else if (!freeCatalogSlots_.empty())
+    {
+        stored.catalogSlot = freeCatalogSlots_.back();
+        freeCatalogSlots_.pop_back();
+        catalog_.set(stored.catalogSlot, leaf);
+    }
+    else
+    {
+        stored.catalogSlot = catalog_.append(leaf);
+    }
+}
+
+Offer TEEStorage::loadLocked(const StoredOffer &stored) const
+{
+    Offer off = stored.offer;
+    if (!stored.spillPath.empty() && !readBlob(stored.spillPath, off.encryptedPlaintext))
+    {
+        TEE_LOG_ERROR("TEEStorage", "Unable to read spilled blob {}", stored.spillPath);
+    }
+    return off;
+}
+
+Offer TEEStorage::projectLocked(StoredOffer &stored, OfferFieldMask mask)
+{
+    const Offer &src = stored.offer;
+    Offer off{};
+    if (mask & kOfferFieldTitle)
+        off.title = src.title;
+    if (mask & kOfferFieldVerifiedKeywords)
+        off.verifiedKeywords = src.verifiedKeywords;
+    if (mask & kOfferFieldUnverifiedText)
+        off.unverifiedText = src.unverifiedText;
+    if (mask & kOfferFieldReservePrice)
+        off.reservePrice = src.reservePrice;
+    if (mask & kOfferFieldPreferredBuyers)
+        off.preferredNumberOfBuyers = src.preferredNumberOfBuyers;
+    if (mask & kOfferFieldExpiryDays)
+        off.expiryDays = src.expiryDays;
+    if (mask & kOfferFieldCooldownMonths)
+        off.cooldownMonths = src.cooldownMonths;
+    if (mask & kOfferFieldFDEKey)
+        off.publicVerificationKeyFDE = src.publicVerificationKeyFDE;
+    if (mask & kOfferFieldNullifier)
+        off.nullifier = src.nullifier;
+    if (mask & kOfferFieldSellerKey)
+        off.sellerPublicKey = src.sellerPublicKey;
+    if (mask & kOfferFieldUpdateNonce)
+        off.updateNonce = src.updateNonce;
+    if (mask & kOfferFieldEncryptedPlaintext)
+    {
+        touchLocked(stored);
+        if (stored.spillPath.empty())
+            off.encryptedPlaintext = src.encryptedPlaintext;
+        else if (!readBlob(stored.spillPath, off.encryptedPlaintext))
+            TEE_LOG_ERROR("TEEStorage", "Unable to read spilled blob {}", stored.spillPath);
+    }
+    return off;
+}
+
+bool TEEStorage::spillLocked(std::map<std::string, StoredOffer>::iterator it)
+{
+    StoredOffer &stored = it->second;
+    std::string path = spillDir_ + "/" + std::to_string(++spillCounter_) + ".blob";
+    if (!writeBlob(path, stored.offer.encryptedPlaintext))
+    {
+        TEE_LOG_ERROR("TEEStorage", "Unable to spill to {}", path);
+        return false;
+    }
+
+    stored.spilledBytes = stored.offer.encryptedPlaintext.size();
+    stored.spillPath = std::move(path);
+    unlinkSpillLruLocked(stored);
+    std::string().swap(stored.offer.encryptedPlaintext);
+    usage_.spilledCount++;
+    usage_.spilledBytes += stored.spilledBytes;
+    usage_.spills++;
+    // The rendered response would keep the blob in memory.
+    responses_.invalidate(it->first);
+    return true;
+}
+
+std::size_t TEEStorage::usedBytesLocked()
+{
+    return usage_.offersBytes + usage_.changeLogBytes + usage_.pendingBytes + responses_.stats().bytes;
+}
+
+// Under a budget the cache may take at most an eighth of it.
+void TEEStorage::applyResponseCapacityLocked()
+{
+    std::size_t capacity = responseCapacity_;
+    if (budgetBytes_ > 0)
+        capacity = std::min(capacity, budgetBytes_ / 8);
+    responses_.setCapacity(capacity);
+}
+
+void TEEStorage::enforceBudgetLocked(std::size_t incomingBytes, bool allowExpiry)
+{
+    auto used = [&] { return usedBytesLocked() + incomingBytes; };
+    if (budgetBytes_ == 0 || used() <= budgetBytes_)
+        return;
+
+    // 0. Cached responses are only copies; give them up first.
+    std::size_t cached = responses_.stats().bytes;
+    std::size_t excess = used() - budgetBytes_;
+    responses_.trim(cached > excess ? cached - excess : 0);
+    if (used() <= budgetBytes_)
+        return;
+
+    // 1. Offers past their expiry would be dropped anyway. Followers leave
+    //    this to the primary so their sequence numbers stay in step.
+    if (allowExpiry)
+        usage_.expiredEvictions += expireLocked(nowMicros());
+
+    // 2. Spill the coldest blobs down to the low watermark, so a burst of
+    //    stores does not spill one blob each. spillLru_ holds only blobs
+    //    still in memory, so with nothing left to spill this costs nothing.
+    std::size_t lowWatermark = budgetBytes_ / 10 * 9;
+    if (spillDir_.empty())
+        return;
+    while (used() > lowWatermark && !spillLru_.empty())
+    {
+        auto it = offers_.find(spillLru_.back());
+        if (!spillLocked(it))
+            break; // spill directory unwritable; retried on the next store
+        accountLocked(it);
+    }
+}
+
+// Scans only once the earliest expiry may have passed, so calling this on
+// every store over budget does not walk the offers each time.
+std::size_t TEEStorage::expireLocked(std::int64_t nowUs)
+{
+    if (nowUs < nextExpiryUs_)
+        return 0;
+
+    std::vector<std::string> expired;
+    nextExpiryUs_ = std::numeric_limits<std::int64_t>::max();
+    for (const auto &kv : offers_)
+    {
+        if (isExpired(kv.second.offer, kv.second.storedAtUs, nowUs))
+            expired.push_back(kv.first);
+        else
+            nextExpiryUs_ = std::min(nextExpiryUs_, expiresAtUs(kv.second.offer, kv.second.storedAtUs));
+    }
+    for (const auto &offerId : expired)
+    {
+        eraseLocked(offers_.find(offerId));
+        appendChangeLocked(headSeq_ + 1, nowUs, ChangeKind::Expired, offerId);
+    }
+    return expired.size();
+}
+
+// Bytes storing offer under offerId would add, net of the entry it replaces.
+std::size_t TEEStorage::incomingBytesLocked(const std::string &offerId, const Offer &offer)
+{
+    std::size_t incoming = kMapNodeOverhead +
+                           sizeof(std::pair<const std::string, StoredOffer>) +
+                           heapBytes(offerId) +
+                           heapBytes(offer) +
+                           sizeof(ChangeLogEntry) + heapBytes(offerId);
+    auto existing = offers_.find(offerId);
+    if (existing != offers_.end())
+        incoming = incoming > existing->second.bytes ? incoming - existing->second.bytes : 0;
+    return incoming;
+}
+
+bool TEEStorage::admitLocked(const std::string &offerId, const Offer &offer)
+{
+    if (budgetBytes_ == 0)
+        return true;
+
+    std::size_t incoming = incomingBytesLocked(offerId, offer);
+    enforceBudgetLocked(incoming);
+    return usedBytesLocked() + incoming <= budgetBytes_;
+}
+
+/*************************
+ * Offers
+ ************************/
+bool TEEStorage::storeOffer(const std::string &offerId, const Offer &offer)
+{
+    return storeOffer(offerId, Offer(offer));
+}
+
+bool TEEStorage::storeOffer(const std::string &offerId, Offer &&offer)
+{
+    ScopedLatency timer(storeLatency);
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (!admitLocked(offerId, offer))
+        {
+            usage_.rejectedStores++;
+            return false;
+        }
+        ChangeKind kind = offers_.count(offerId) ? ChangeKind::Updated : ChangeKind::Created;
+        std::int64_t now = nowMicros();
+        putLocked(offerId, std::move(offer), now);
+        appendChangeLocked(headSeq_ + 1, now, kind, offerId);
+    }
+    changed_.notify_all();
+    return true;
+}
+
+std::size_t TEEStorage::storeOffers(const std::vector<OfferRequest *> &requests, std::vector<bool> &stored)
+{
+    ScopedLatency timer(storeLatency);
+    std::size_t count = 0;
+    stored.assign(requests.size(), false);
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        std::int64_t now = nowMicros();
+        for (std::size_t i = 0; i < requests.size(); ++i)
+        {
+            OfferRequest &req = *requests[i];
+            if (!admitLocked(req.offerId, req.offer))
+            {
+                usage_.rejectedStores++;
+                continue;
+            }
+            ChangeKind kind = offers_.count(req.offerId) ? ChangeKind::Updated : ChangeKind::Created;
+            putLocked(req.offerId, std::move(req.offer), now);
+            appendChangeLocked(headSeq_ + 1, now, kind, req.offerId);
+            stored[i] = true;
+            ++count;
+        }
+    }
+    if (count > 0)
+        changed_.notify_all();
+    return count;
 }
 
 std::optional<Offer> TEEStorage::retrieveOffer(const std::string &offerId)
 {
+    ScopedLatency timer(retrieveLatency);
     std::lock_guard<std::mutex> lock(mtx_);
     auto it = offers_.find(offerId);
     if (it != offers_.end())
     {
-        return it->second;
+        touchLocked(it->second);
+        return loadLocked(it->second);
     }
     return std::nullopt;
 }
 
+std::optional<Offer> TEEStorage::projectOffer(const std::string &offerId, OfferFieldMask mask)
+{
+    ScopedLatency timer(retrieveLatency);
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto it = offers_.find(offerId);
+    if (it == offers_.end())
+        return std::nullopt;
+    return projectLocked(it->second, mask);
+}
+
+std::vector<std::optional<Offer>> TEEStorage::projectOffers(const std::vector<std::string> &offerIds, OfferFieldMask mask)
+{
+    ScopedLatency timer(retrieveLatency);
+    std::vector<std::optional<Offer>> out(offerIds.size());
+    std::lock_guard<std::mutex> lock(mtx_);
+    for (std::size_t i = 0; i < offerIds.size(); ++i)
+    {
+        auto it = offers_.find(offerIds[i]);
+        if (it != offers_.end())
+            out[i] = projectLocked(it->second, mask);
+    }
+    return out;
+}
+
+std::optional<Offer> TEEStorage::updateFinancials(const std::string &offerId, const FinancialUpdate &update)
+{
+    ScopedLatency timer(storeLatency);
+    std::optional<Offer> updated;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        auto it = offers_.find(offerId);
+        if (it == offers_.end() || update.nonce <= it->second.offer.updateNonce)
+            return std::nullopt;
+
+        Offer &offer = it->second.offer;
+        offer.updateNonce = update.nonce;
+        if (update.reservePrice)
+        {
+            offer.reservePrice = *update.reservePrice;
+            keywordIndex_.put(offerId, offer.verifiedKeywords, offer.reservePrice, it->second.storedAtUs);
+        }
+        if (update.preferredBuyers)
+            offer.preferredNumberOfBuyers = *update.preferredBuyers;
+        if (update.expiryDays)
+        {
+            offer.expiryDays = *update.expiryDays;
+            nextExpiryUs_ = std::min(nextExpiryUs_, expiresAtUs(offer, it->second.storedAtUs));
+        }
+        responses_.invalidate(offerId);
+        commitLocked(it);
+        appendChangeLocked(headSeq_ + 1, nowMicros(), ChangeKind::Updated, offerId);
+        updated = projectLocked(it->second, kOfferFieldsOnChain);
+    }
+    changed_.notify_all();
+    return updated;
+}
+
+ResponseCache::Bytes TEEStorage::renderedOffer(const std::string &offerId, const OfferRenderer &render)
+{
+    return responses_.get(offerId, [&]() -> ResponseCache::Bytes {
+        auto offer = retrieveOffer(offerId);
+        return offer ? render(*offer) : nullptr;
+    });
+}
+
+void TEEStorage::setResponseCacheCapacity(std::size_t capacityBytes)
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    responseCapacity_ = capacityBytes;
+    applyResponseCapacityLocked();
+}
+
+ResponseCache::Stats TEEStorage::responseCacheStats()
+{
+    return responses_.stats();
+}
+
+QueryResult TEEStorage::searchOffers(const KeywordQuery &query, QueryRank rank, std::size_t limit)
+{
+    return keywordIndex_.search(query, rank, limit);
+}
+
+std::size_t TEEStorage::indexedKeywords()
+{
+    return keywordIndex_.keywordCount();
+}
+
 std::vector<std::string> TEEStorage::listOfferIds()
 {
     std::lock_guard<std::mutex> lock(mtx_);
@@ -27,3 +664,341 @@ std::vector<std::string> TEEStorage::listOfferIds()
     }
     return ids;
 }
+
+std::size_t TEEStorage::expireOffers()
+{
+    std::size_t expired;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        expired = expireLocked(nowMicros());
+    }
+    if (expired > 0)
+        changed_.notify_all();
+    return expired;
+}
+
+/*************************
+ * Catalog commitment
+ ************************/
+CatalogCommitment TEEStorage::catalogCommitment()
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    return CatalogCommitment{catalog_.root(), catalog_.size(), headSeq_};
+}
+
+std::optional<CatalogProof> TEEStorage::catalogProof(const std::string &offerId)
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto it = offers_.find(offerId);
+    if (it == offers_.end())
+        return std::nullopt;
+
+    CatalogProof proof;
+    proof.commitment = CatalogCommitment{catalog_.root(), catalog_.size(), headSeq_};
+    proof.leafIndex = it->second.catalogSlot;
+    proof.leaf = catalog_.leaf(proof.leafIndex);
+    catalogLeafData(proof.leafData, it->first, it->second.offer, it->second.plaintextHash);
+    proof.proof = catalog_.proof(proof.leafIndex);
+    return proof;
+}
+
+/*************************
+ * Pending offers
+ ************************/
+bool TEEStorage::storePending(const std::string &offerId, Offer &&offer)
+{
+    ScopedLatency timer(storeLatency);
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (pending_.count(offerId))
+        return false;
+    if (budgetBytes_ != 0)
+    {
+        std::size_t incoming = pendingEntryBytes(offerId, offer);
+        enforceBudgetLocked(incoming);
+        if (usedBytesLocked() + incoming > budgetBytes_)
+        {
+            usage_.rejectedStores++;
+            return false;
+        }
+    }
+
+    auto it = pending_.emplace(offerId, std::move(offer)).first;
+    usage_.pendingBytes += pendingEntryBytes(it->first, it->second);
+    usage_.pendingCount = pending_.size();
+    return true;
+}
+
+bool TEEStorage::promotePending(const std::string &offerId)
+{
+    ScopedLatency timer(storeLatency);
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        auto it = pending_.find(offerId);
+        if (it == pending_.end())
+            return false;
+
+        // Already admitted against the budget when it became pending.
+        usage_.pendingBytes -= pendingEntryBytes(it->first, it->second);
+        Offer offer = std::move(it->second);
+        pending_.erase(it);
+        usage_.pendingCount = pending_.size();
+
+        ChangeKind kind = offers_.count(offerId) ? ChangeKind::Updated : ChangeKind::Created;
+        std::int64_t now = nowMicros();
+        putLocked(offerId, std::move(offer), now);
+        appendChangeLocked(headSeq_ + 1, now, kind, offerId);
+    }
+    changed_.notify_all();
+    return true;
+}
+
+void TEEStorage::discardPending(const std::string &offerId)
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto it = pending_.find(offerId);
+    if (it == pending_.end())
+        return;
+    usage_.pendingBytes -= pendingEntryBytes(it->first, it->second);
+    pending_.erase(it);
+    usage_.pendingCount = pending_.size();
+}
+
+/*************************
+ * Memory budget
+ ************************/
+void TEEStorage::setMemoryBudget(std::size_t budgetBytes, const std::string &spillDir)
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    budgetBytes_ = budgetBytes;
+    spillDir_ = spillDir;
+    usage_.budgetBytes = budgetBytes;
+    applyResponseCapacityLocked();
+    enforceBudgetLocked(0);
+}
+
+// Projects what enforceBudgetLocked could free (the response cache, and
+// with a spill directory every in-memory blob) without doing it. Expired
+// offers are not counted; once one may be due the store decides.
+bool TEEStorage::wouldAdmit(const std::string &offerId, const Offer &offer)
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (budgetBytes_ == 0 || nowMicros() >= nextExpiryUs_)
+        return true;
+
+    std::size_t reclaimable = responses_.stats().bytes;
+    if (!spillDir_.empty())
+        reclaimable += residentBlobBytes_;
+    std::size_t used = usedBytesLocked();
+    used = used > reclaimable ? used - reclaimable : 0;
+    return used + incomingBytesLocked(offerId, offer) <= budgetBytes_;
+}
+
+MemoryUsage TEEStorage::memoryUsage()
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    MemoryUsage usage = usage_;
+    usage.responseCacheBytes = responses_.stats().bytes;
+    usage.totalBytes = usage.offersBytes + usage.changeLogBytes + usage.pendingBytes + usage.responseCacheBytes;
+    return usage;
+}
+
+/*************************
+ * Change log (replication)
+ ************************/
+std::uint64_t TEEStorage::headSequence()
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    return headSeq_;
+}
+
+bool TEEStorage::changesSince(std::uint64_t sinceSeq, std::size_t maxChanges, std::vector<StorageChange> &out)
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (sinceSeq >= headSeq_)
+    {
+        return true;
+    }
+    if (changeLog_.empty() || changeLog_.front().seq > sinceSeq + 1)
+    {
+        return false;
+    }
+
+    auto first = std::partition_point(changeLog_.begin(), changeLog_.end(),
+                                      [&](const ChangeLogEntry &e) { return e.seq <= sinceSeq; });
+    for (auto entryIt = first; entryIt != changeLog_.end() && out.size() < maxChanges; ++entryIt)
+    {
+        const auto &entry = *entryIt;
+        StorageChange change;
+        change.seq = entry.seq;
+        change.commitTimeUs = entry.commitTimeUs;
+        change.offerId = entry.offerId;
+        change.kind = entry.kind;
+        auto it = offers_.find(entry.offerId);
+        if (entry.kind != ChangeKind::Expired && it != offers_.end())
+        {
+            change.hasOffer = true;
+            change.offer = loadLocked(it->second);
+            change.storedAtUs = it->second.storedAtUs;
+        }
+        out.push_back(std::move(change));
+    }
+    return true;
+}
+
+ChangeFeedPage TEEStorage::changeFeed(std::uint64_t sinceSeq, std::size_t maxChanges)
+{
+    ChangeFeedPage page;
+    page.snapshotRequired = !changesSince(sinceSeq, maxChanges, page.changes);
+    page.headSeq = headSequence();
+    page.nextSeq = page.changes.empty() ? sinceSeq : page.changes.back().seq;
+    return page;
+}
+
+bool TEEStorage::waitForChanges(std::uint64_t sinceSeq, std::chrono::milliseconds timeout)
+{
+    std::unique_lock<std::mutex> lock(mtx_);
+    return changed_.wait_for(lock, timeout, [&] { return headSeq_ > sinceSeq; });
+}
+
+std::uint64_t TEEStorage::snapshot(std::vector<std::pair<std::string, Offer>> &out,
+                                   std::vector<std::int64_t> *storedAtUs)
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    out.reserve(out.size() + offers_.size());
+    for (const auto &kv : offers_)
+    {
+        out.emplace_back(kv.first, loadLocked(kv.second));
+        if (storedAtUs)
+            storedAtUs->push_back(kv.second.storedAtUs);
+    }
+    return headSeq_;
+}
+
+void TEEStorage::loadSnapshot(std::uint64_t seq, std::vector<std::pair<std::string, Offer>> offers,
+                              std::vector<std::int64_t> storedAtUs)
+{
+    {
+        // Plaintext hashes are taken up front, in parallel and outside the lock.
+        std::vector<MerkleHash> plaintextHashes(offers.size());
+        parallelChunks(offers.size(), 0, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i)
+                plaintextHashes[i] = merkleLeafHash(offers[i].second.encryptedPlaintext);
+        });
+
+        std::lock_guard<std::mutex> lock(mtx_);
+        catalog_ = IncrementalMerkleTree();
+        freeCatalogSlots_.clear();
+        keywordIndex_.clear();
+        responses_.clear();
+        while (!offers_.empty())
+        {
+            eraseLocked(offers_.begin());
+        }
+        std::int64_t now = nowMicros();
+        std::vector<std::map<std::string, StoredOffer>::iterator> loaded;
+        loaded.reserve(offers.size());
+        for (std::size_t i = 0; i < offers.size(); ++i)
+        {
+            std::int64_t storedAt = i < storedAtUs.size() && storedAtUs[i] > 0 ? storedAtUs[i] : now;
+            putLocked(offers[i].first, std::move(offers[i].second), storedAt, false);
+            auto it = offers_.find(offers[i].first);
+            it->second.plaintextHash = plaintextHashes[i];
+            loaded.push_back(it);
+        }
+
+        // One slot per offer, then a parallel rebuild instead of n path updates.
+        // A repeated id keeps its last slot; the earlier ones stay empty.
+        std::vector<MerkleHash> leaves(loaded.size());
+        parallelChunks(loaded.size(), 0, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i)
+                leaves[i] = catalogLeafHash(loaded[i]->first, loaded[i]->second.offer, loaded[i]->second.plaintextHash);
+        });
+        for (std::size_t i = 0; i < loaded.size(); ++i)
+        {
+            if (loaded[i]->second.catalogSlot != kNoCatalogSlot)
+            {
+                leaves[loaded[i]->second.catalogSlot] = MerkleHash{};
+                freeCatalogSlots_.push_back(loaded[i]->second.catalogSlot);
+            }
+            loaded[i]->second.catalogSlot = i;
+        }
+        catalog_.rebuild(std::move(leaves));
+        changeLog_.clear();
+        usage_.changeLogBytes = 0;
+        headSeq_ = seq;
+        enforceBudgetLocked(0, false);
+    }
+    changed_.notify_all();
+}
+
+void TEEStorage::applyChange(const StorageChange &change)
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (change.seq <= headSeq_)
+        {
+            return;
+        }
+        if (change.kind == ChangeKind::Expired)
+        {
+            auto it = offers_.find(change.offerId);
+            if (it != offers_.end())
+                eraseLocked(it);
+        }
+        else if (change.hasOffer)
+        {
+            // A follower mirrors the primary: it may evict and spill, never refuse.
+            // Updates ship the original storage time, so expiry and the
+            // "recent" rank agree with the primary.
+            putLocked(change.offerId, change.offer, change.storedAtUs > 0 ? change.storedAtUs : change.commitTimeUs);
+        }
+        appendChangeLocked(change.seq, change.commitTimeUs, change.kind, change.offerId);
+        enforceBudgetLocked(0, false);
+    }
+    changed_.notify_all();
+}
+
+/*************************
+ * Copy-on-write checkpoints
+ ************************/
+std::uint64_t TEEStorage::FrozenView::seq() const
+{
+    return storage_.headSeq_;
+}
+
+std::size_t TEEStorage::FrozenView::size() const
+{
+    return storage_.offers_.size();
+}
+
+void TEEStorage::FrozenView::forEach(
+    const std::function<void(const std::string &, const Offer &, std::int64_t storedAtUs)> &visit) const
+{
+    for (const auto &kv : storage_.offers_)
+    {
+        if (kv.second.spillPath.empty())
+            visit(kv.first, kv.second.offer, kv.second.storedAtUs);
+        else
+            visit(kv.first, storage_.loadLocked(kv.second), kv.second.storedAtUs);
+    }
+}
+
+pid_t TEEStorage::forkFrozen(const FrozenWriter &writer, std::int64_t &stallMicros)
+{
+    pid_t pid;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        auto start = std::chrono::steady_clock::now();
+        pid = ::fork();
+        if (pid == 0)
+        {
+            // Only this thread exists in the child and mtx_ is never released
+            // here, so the writer must not call back into TEEStorage.
+            ::_exit(writer(FrozenView(*this)));
+        }
+        stallMicros = std::chrono::duration_cast<std::chrono::microseconds>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+    }
+    return pid;
+}
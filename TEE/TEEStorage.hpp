@@ -1,27 +1,318 @@
 #ifndef TEESTORAGE_HPP
 #define TEESTORAGE_HPP
 
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <list>
 #include <map>
 #include <string>
 #include <mutex>
 #include <optional>
+#include <sys/types.h>
+#include <utility>
 #include <vector>
+#include "IncrementalMerkleTree.hpp"
+#include "KeywordIndex.hpp"
 #include "Offer.hpp"
+#include "ResponseCache.hpp"
+
+enum class ChangeKind : std::uint8_t
+{
+    Created,
+    Updated,
+    Expired
+};
+
+const char *changeKindName(ChangeKind kind);
+std::optional<ChangeKind> parseChangeKind(const std::string &name);
+
+// One entry of the storage change log, with the offer materialized at read
+// time. hasOffer is false for expiries and for offers that have since expired.
+struct StorageChange
+{
+    std::uint64_t seq = 0;
+    std::int64_t commitTimeUs = 0;
+    std::string offerId;
+    ChangeKind kind = ChangeKind::Created;
+    bool hasOffer = false;
+    Offer offer;
+    std::int64_t storedAtUs = 0; // with offer: when it was stored, which updates keep
+};
+
+// A page of the change feed. When snapshotRequired is set the requested
+// sequence has aged out of the ring and the client must resync from
+// snapshot(); otherwise it resumes with changesSince(nextSeq).
+struct ChangeFeedPage
+{
+    bool snapshotRequired = false;
+    std::uint64_t headSeq = 0;
+    std::uint64_t nextSeq = 0;
+    std::vector<StorageChange> changes;
+};
+
+// Byte counts are heap + node bytes as allocated (see MemoryAccounting.hpp).
+struct MemoryUsage
+{
+    std::size_t budgetBytes = 0; // 0 = unlimited
+    std::size_t offersBytes = 0;
+    std::size_t changeLogBytes = 0;
+    std::size_t totalBytes = 0;
+    std::size_t offerCount = 0;
+    std::size_t spilledCount = 0;
+    std::size_t spilledBytes = 0; // on disk
+    std::uint64_t expiredEvictions = 0; // expired offers dropped under budget pressure
+    std::uint64_t spills = 0;
+    std::uint64_t rejectedStores = 0;
+    std::size_t pendingCount = 0; // speculatively accepted, not yet verified
+    std::size_t pendingBytes = 0;
+    std::size_t responseCacheBytes = 0; // rendered read responses, part of totalBytes
+};
+
+// Commitment to the whole catalog: the root of a Merkle tree with one leaf
+// slot per stored offer (slots of removed offers hold zeros until reused).
+struct CatalogCommitment
+{
+    MerkleHash root{};
+    std::size_t leafCount = 0;
+    std::uint64_t seq = 0; // change log head the root reflects
+};
+
+// Inclusion proof of one offer in a CatalogCommitment. leaf is the
+// merkleLeafHash of leafData: {"offer": <the offer as getOffer returns it,
+// with encryptedPlaintext replaced by "encryptedPlaintextHash", the
+// merkleLeafHash of the plaintext>, "offerId": ...}, compact with sorted keys.
+struct CatalogProof
+{
+    CatalogCommitment commitment;
+    std::size_t leafIndex = 0;
+    MerkleHash leaf{};
+    std::string leafData;
+    std::vector<MerkleHash> proof;
+};
 
 class TEEStorage
 {
 private:
+    // The log only keeps ids; the offer body is read from offers_ when shipped,
+    // so several changes to the same id converge on its latest value.
+    struct ChangeLogEntry
+    {
+        std::uint64_t seq;
+        std::int64_t commitTimeUs;
+        ChangeKind kind;
+        std::string offerId;
+    };
+
+    static constexpr std::size_t kNoCatalogSlot = static_cast<std::size_t>(-1);
+
+    struct StoredOffer
+    {
+        Offer offer;
+        std::int64_t storedAtUs = 0;
+        bool inSpillLru = false;            // blob is in memory and may be spilled
+        std::list<std::string>::iterator spillLru; // valid while inSpillLru
+        std::size_t bytes = 0;
+        std::string spillPath; // non-empty while encryptedPlaintext lives on disk
+        std::size_t spilledBytes = 0;
+        MerkleHash plaintextHash{}; // survives spilling, so the leaf can be recomputed
+        std::size_t catalogSlot = kNoCatalogSlot;
+    };
+
     std::mutex mtx_;
-    std::map<std::string, Offer> offers_;
+    std::condition_variable changed_;
+    std::map<std::string, StoredOffer> offers_;
+    std::map<std::string, Offer> pending_;
+    std::deque<ChangeLogEntry> changeLog_;
+    std::size_t changeLogCapacity_;
+    std::uint64_t headSeq_ = 0;
+
+    // Memory budget. Over budget, expired offers are evicted first, then the
+    // least recently read encryptedPlaintext blobs are spilled to spillDir_
+    // down to the low watermark; only then are new offers refused.
+    std::size_t budgetBytes_ = 0;
+    std::string spillDir_;
+    std::list<std::string> spillLru_; // offers with an in-memory blob, most recently read first
+    std::size_t residentBlobBytes_ = 0; // encryptedPlaintext bytes of the offers in spillLru_
+    std::int64_t nextExpiryUs_ = std::numeric_limits<std::int64_t>::max(); // no offer expires earlier
+    std::uint64_t spillCounter_ = 0;
+    MemoryUsage usage_;
+
+    // Catalog commitment, kept current under mtx_; freed slots are reused
+    // so the tree does not grow with churn.
+    IncrementalMerkleTree catalog_;
+    std::vector<std::size_t> freeCatalogSlots_;
+
+    // Keyword search index, kept current under mtx_ but read under its own lock.
+    KeywordIndex keywordIndex_;
+
+    // Rendered read responses, invalidated under mtx_ whenever an offer
+    // changes, goes or is spilled; read under its own lock. Their bytes
+    // count against the memory budget and are the first thing given up.
+    ResponseCache responses_;
+    std::size_t responseCapacity_ = 64u << 20; // as configured, before the budget cap
+
+    void appendChangeLocked(std::uint64_t seq, std::int64_t commitTimeUs, ChangeKind kind, const std::string &offerId);
+    std::size_t expireLocked(std::int64_t nowUs);
+    void putLocked(const std::string &offerId, Offer offer, std::int64_t storedAtUs, bool commit = true);
+    void eraseLocked(std::map<std::string, StoredOffer>::iterator it);
+    void commitLocked(std::map<std::string, StoredOffer>::iterator it);
+    void accountLocked(std::map<std::string, StoredOffer>::iterator it);
+    void touchLocked(StoredOffer &stored);
+    void unlinkSpillLruLocked(StoredOffer &stored);
+    Offer loadLocked(const StoredOffer &stored) const;
+    Offer projectLocked(StoredOffer &stored, OfferFieldMask mask);
+    bool spillLocked(std::map<std::string, StoredOffer>::iterator it);
+    std::size_t usedBytesLocked();
+    void applyResponseCapacityLocked();
+    void enforceBudgetLocked(std::size_t incomingBytes, bool allowExpiry = true);
+    std::size_t incomingBytesLocked(const std::string &offerId, const Offer &offer);
+    // Makes room for offer (expiring, spilling) and says whether it then fits.
+    bool admitLocked(const std::string &offerId, const Offer &offer);
+    static std::size_t entryBytes(const std::string &offerId, const StoredOffer &stored);
+    static std::size_t logEntryBytes(const ChangeLogEntry &entry);
+    static std::size_t pendingEntryBytes(const std::string &offerId, const Offer &offer);
 
 public:
-    TEEStorage() = default;
+    explicit TEEStorage(std::size_t changeLogCapacity = 65536);
+
+    // Returns false if the offer does not fit in the memory budget.
+    bool storeOffer(const std::string &offerId, const Offer &offer);
+    // Adopts offer's buffers instead of copying them.
+    bool storeOffer(const std::string &offerId, Offer &&offer);
 
-    void storeOffer(const std::string &offerId, const Offer &offer);
+    // Stores several offers under one lock acquisition, moving each offer
+    // out of its request; stored[i] reports whether requests[i] fit in the
+    // memory budget. Returns the stored count.
+    std::size_t storeOffers(const std::vector<OfferRequest *> &requests, std::vector<bool> &stored);
 
     std::optional<Offer> retrieveOffer(const std::string &offerId);
 
+    // Copies only the fields in mask; fields outside it are left default.
+    // A spilled plaintext is only read back (and the read only counts for
+    // LRU) when kOfferFieldEncryptedPlaintext is requested.
+    std::optional<Offer> projectOffer(const std::string &offerId, OfferFieldMask mask);
+    std::vector<std::optional<Offer>> projectOffers(const std::vector<std::string> &offerIds, OfferFieldMask mask);
+
     std::vector<std::string> listOfferIds();
+
+    // Applies update in place if its nonce is newer than the offer's, and
+    // records an Updated change. Returns the kOfferFieldsOnChain projection
+    // of the result, or nullopt if the offer is gone or the nonce is stale.
+    std::optional<Offer> updateFinancials(const std::string &offerId, const FinancialUpdate &update);
+
+    // Removes offers past their expiryDays and records an Expired change for each.
+    std::size_t expireOffers();
+
+    /*************************
+     * Catalog commitment
+     ************************/
+    CatalogCommitment catalogCommitment();
+    // O(log n); nullopt if the offer is not stored.
+    std::optional<CatalogProof> catalogProof(const std::string &offerId);
+
+    /*************************
+     * Keyword search
+     ************************/
+    // Boolean query over verifiedKeywords, best limit offers by rank (see
+    // KeywordIndex). Does not take the storage lock.
+    QueryResult searchOffers(const KeywordQuery &query, QueryRank rank, std::size_t limit);
+    std::size_t indexedKeywords();
+
+    /*************************
+     * Rendered reads
+     ************************/
+    // Response bytes rendered from the stored offer, at most once per
+    // change of it however many readers ask at once (see ResponseCache).
+    // Null if the offer is not stored. Under a memory budget the cache is
+    // capped at an eighth of it and its bytes count towards it.
+    using OfferRenderer = std::function<ResponseCache::Bytes(const Offer &offer)>;
+    ResponseCache::Bytes renderedOffer(const std::string &offerId, const OfferRenderer &render);
+    void setResponseCacheCapacity(std::size_t capacityBytes);
+    ResponseCache::Stats responseCacheStats();
+
+    /*************************
+     * Pending offers (speculative acceptance)
+     ************************/
+    // Holds an offer whose proof is still being verified. Pending offers
+    // count against the memory budget but are invisible to reads, the change
+    // log, snapshots and checkpoints. Returns false if the id is already
+    // pending or the offer does not fit.
+    bool storePending(const std::string &offerId, Offer &&offer);
+    // Makes a pending offer visible, recorded as a Created/Updated change.
+    bool promotePending(const std::string &offerId);
+    // Purges a pending offer whose proof failed.
+    void discardPending(const std::string &offerId);
+
+    /*************************
+     * Memory budget
+     ************************/
+    void setMemoryBudget(std::size_t budgetBytes, const std::string &spillDir);
+
+    // Pre-check so callers can refuse an offer before side effects; it
+    // evicts nothing itself. Optimistic: counts what the store could expire
+    // or spill as free, and the store has the final say.
+    bool wouldAdmit(const std::string &offerId, const Offer &offer);
+
+    MemoryUsage memoryUsage();
+
+    /*************************
+     * Change log (replication, client sync)
+     ************************/
+    std::uint64_t headSequence();
+
+    // Up to maxChanges events after sinceSeq, for clients mirroring the catalog.
+    ChangeFeedPage changeFeed(std::uint64_t sinceSeq, std::size_t maxChanges);
+
+    // Copies up to maxChanges changes with seq > sinceSeq into out.
+    // Returns false if sinceSeq has been trimmed from the log, in which
+    // case the reader has to resync from snapshot().
+    bool changesSince(std::uint64_t sinceSeq, std::size_t maxChanges, std::vector<StorageChange> &out);
+
+    // Blocks until the head moves past sinceSeq or the timeout expires.
+    bool waitForChanges(std::uint64_t sinceSeq, std::chrono::milliseconds timeout);
+
+    // Copies every stored offer and returns the sequence the copy reflects.
+    // storedAtUs, if given, receives each offer's storage time in step with out.
+    std::uint64_t snapshot(std::vector<std::pair<std::string, Offer>> &out,
+                           std::vector<std::int64_t> *storedAtUs = nullptr);
+
+    // Follower side: replace the contents with a primary snapshot, or apply
+    // one shipped change while keeping the primary's sequence numbers.
+    // storedAtUs[i] is offers[i]'s original storage time, so expiry still
+    // counts from it; missing or 0 means now.
+    void loadSnapshot(std::uint64_t seq, std::vector<std::pair<std::string, Offer>> offers,
+                      std::vector<std::int64_t> storedAtUs = {});
+    void applyChange(const StorageChange &change);
+
+    /*************************
+     * Copy-on-write checkpoints
+     ************************/
+    // Lock-free view of a frozen image, only valid inside a forkFrozen child.
+    class FrozenView
+    {
+    private:
+        const TEEStorage &storage_;
+
+    public:
+        explicit FrozenView(const TEEStorage &storage) : storage_(storage) {}
+
+        std::uint64_t seq() const;
+        std::size_t size() const;
+
+        // Visits every offer in id order with its storage time, reading
+        // spilled blobs back from disk.
+        void forEach(const std::function<void(const std::string &, const Offer &, std::int64_t storedAtUs)> &visit) const;
+    };
+
+    // Forks while holding the lock so the child sees a frozen, consistent
+    // image. The child runs writer on its copy and exits with its return
+    // value; the parent gets the child pid (or -1) and the time the lock was held.
+    using FrozenWriter = std::function<int(const FrozenView &frozen)>;
+    pid_t forkFrozen(const FrozenWriter &writer, std::int64_t &stallMicros);
 };
 
 #endif // TEESTORAGE_HPP
@@ -0,0 +1,168 @@
+// Sealed-bid auctions at scale: millions of bids over many offers plus one
+// hot offer, then every auction cleared in one batch. Reports bid intake,
+// batched clearing throughput and per-offer clearing latency (the hot
+// offer included), and checks sampled results against a full sort. The
+// losing bids are freed by the following sweep, timed separately.
+//
+// g++ -std=c++17 -O2 auction_bench.cpp AuctionBook.cpp Logger.cpp Metrics.cpp -I. -lpthread -o auction_bench
+// ./auction_bench [offers] [bids] [hotBids] [uniform|second-price]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "AuctionBook.hpp"
+
+struct SentBid
+{
+    double amount;
+    std::size_t seq;
+    std::string bidder;
+};
+
+// Reference clearing: best bid per bidder, sorted, first k at or above the reserve.
+static AuctionResult expected(const std::vector<SentBid> &bids, const AuctionTerms &terms, ClearingRule rule)
+{
+    std::unordered_map<std::string, const SentBid *> best;
+    for (const auto &bid : bids)
+    {
+        auto &slot = best[bid.bidder];
+        if (!slot || bid.amount > slot->amount || (bid.amount == slot->amount && bid.seq < slot->seq))
+            slot = &bid;
+    }
+    std::vector<const SentBid *> ranked;
+    for (const auto &kv : best)
+    {
+        if (kv.second->amount >= terms.reservePrice)
+            ranked.push_back(kv.second);
+    }
+    std::sort(ranked.begin(), ranked.end(), [](const SentBid *a, const SentBid *b) {
+        return a->amount > b->amount || (a->amount == b->amount && a->seq < b->seq);
+    });
+    AuctionResult result;
+    for (std::size_t i = 0; i < ranked.size() && i < terms.units; ++i)
+        result.winners.push_back(AuctionWinner{ranked[i]->bidder, ranked[i]->amount});
+    if (!result.winners.empty())
+    {
+        if (rule == ClearingRule::Uniform)
+            result.price = result.winners.back().bid;
+        else
+            result.price = ranked.size() > terms.units ? ranked[terms.units]->amount : terms.reservePrice;
+    }
+    return result;
+}
+
+static bool sameResult(const AuctionResult &a, const AuctionResult &b)
+{
+    if (a.price != b.price || a.winners.size() != b.winners.size())
+        return false;
+    for (std::size_t i = 0; i < a.winners.size(); ++i)
+    {
+        if (a.winners[i].bidder != b.winners[i].bidder || a.winners[i].bid != b.winners[i].bid)
+            return false;
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    std::size_t offers = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000;
+    std::size_t bids = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 2000000;
+    std::size_t hotBids = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 1000000;
+    ClearingRule rule = ClearingRule::SecondPrice;
+    if (argc > 4 && !parseClearingRule(argv[4], rule))
+    {
+        std::cerr << "rule must be uniform or second-price\n";
+        return 1;
+    }
+
+    std::mt19937_64 rng(7);
+    std::map<std::string, AuctionTerms> catalog;
+    std::vector<std::string> ids;
+    for (std::size_t i = 0; i < offers; ++i)
+    {
+        ids.push_back("offer-" + std::to_string(i));
+        catalog[ids.back()] = AuctionTerms{10.0 + static_cast<double>(rng() % 50), 1 + static_cast<std::uint32_t>(rng() % 16)};
+    }
+    ids.push_back("hot");
+    catalog["hot"] = AuctionTerms{10.0, 100};
+
+    AuctionBook book([&](const std::vector<std::string> &offerIds, std::vector<std::optional<AuctionTerms>> &terms) {
+        terms.clear();
+        for (const auto &id : offerIds)
+        {
+            auto it = catalog.find(id);
+            terms.push_back(it == catalog.end() ? std::nullopt : std::optional<AuctionTerms>(it->second));
+        }
+    });
+    book.setRule(rule);
+
+    // Prices in cents so ties happen; bidders repeat so some bid twice.
+    std::uniform_int_distribution<int> cents(500, 20000);
+    std::uniform_int_distribution<std::size_t> pickOffer(0, offers - 1);
+    constexpr std::size_t kSampled = 50;
+    std::map<std::string, std::vector<SentBid>> sent;
+    std::set<std::string> sampled(ids.begin(), ids.begin() + std::min(kSampled, offers));
+    std::size_t accepted = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < bids + hotBids; ++i)
+    {
+        const std::string &id = i < bids ? ids[pickOffer(rng)] : ids.back();
+        std::string bidder = "bidder-" + std::to_string(rng() % 100000);
+        double amount = cents(rng) / 100.0;
+        bool sample = id == "hot" || sampled.count(id);
+        std::vector<SentBid> *record = sample ? &sent[id] : nullptr;
+        if (book.submitBid(id, bidder, amount) == BidStatus::Accepted)
+        {
+            ++accepted;
+            if (record)
+                record->push_back(SentBid{amount, record->size(), bidder});
+        }
+    }
+    double intake = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << accepted << " of " << bids + hotBids << " bids accepted at "
+              << (bids + hotBids) / intake / 1e6 << " M bids/s (" << book.openAuctions() << " open auctions)\n";
+
+    // The hot offer alone, then everything else in one batch.
+    start = std::chrono::steady_clock::now();
+    auto hot = book.clear({"hot"});
+    double hotMicros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "hot offer: " << hot[0].bids << " bids, " << hot[0].winners.size() << " winners at "
+              << hot[0].price << ", cleared in " << hotMicros << " us\n";
+
+    ids.pop_back();
+    start = std::chrono::steady_clock::now();
+    auto results = book.clear(ids);
+    double batchMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "batch: " << results.size() << " auctions cleared in " << batchMs << " ms, "
+              << batchMs * 1000 / static_cast<double>(results.size()) << " us/offer\n";
+
+    start = std::chrono::steady_clock::now();
+    book.sweep();
+    std::cout << "losing bids freed by the sweep in "
+              << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms\n";
+
+    bool ok = true;
+    std::size_t checked = 0;
+    results.push_back(hot[0]);
+    for (const auto &result : results)
+    {
+        auto it = sent.find(result.offerId);
+        if (it == sent.end())
+            continue;
+        ++checked;
+        if (!sameResult(result, expected(it->second, catalog[result.offerId], rule)))
+        {
+            std::cout << "MISMATCH for " << result.offerId << "\n";
+            ok = false;
+        }
+    }
+    std::cout << checked << " sampled auctions match a full sort: " << (ok ? "ok" : "FAILED") << "\n";
+    return ok ? 0 : 1;
+}
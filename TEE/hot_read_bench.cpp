@@ -0,0 +1,94 @@
+// Thundering herd of getOffer reads on one hot offer, rendered per read vs
+// through the response cache, with updates landing meanwhile. Checks that
+// no read returns bytes older than the update it started after.
+//
+// g++ -std=c++17 -O2 hot_read_bench.cpp TEEStorage.cpp ResponseCache.cpp KeywordIndex.cpp KeywordQuery.cpp IncrementalMerkleTree.cpp Merkle.cpp Logger.cpp Metrics.cpp -I. -lcrypto -lpthread -o hot_read_bench
+// ./hot_read_bench [threads] [readsPerThread] [plaintextBytes] [updateEveryUs]
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "OfferJson.hpp"
+#include "TEEStorage.hpp"
+
+static std::shared_ptr<const std::string> render(const std::string &offerId, const Offer &offer)
+{
+    nlohmann::json response;
+    response["status"] = "OK";
+    response["offerId"] = offerId;
+    response["offer"] = offer;
+    return std::make_shared<const std::string>(response.dump());
+}
+
+int main(int argc, char *argv[])
+{
+    std::size_t threads = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 8;
+    std::size_t reads = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 20000;
+    std::size_t plaintextBytes = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 16384;
+    long updateEveryUs = argc > 4 ? std::strtol(argv[4], nullptr, 10) : 1000;
+
+    Offer offer;
+    offer.title = "Corporate misconduct by a large mining corporation";
+    offer.verifiedKeywords = {"EPA", "fine", "DOJ", "compliance"};
+    offer.encryptedPlaintext = std::string(plaintextBytes, 'x');
+    offer.reservePrice = 5;
+    offer.preferredNumberOfBuyers = 5;
+    offer.expiryDays = 10;
+
+    for (bool cached : {false, true})
+    {
+        TEEStorage storage;
+        storage.storeOffer("hot", offer);
+        std::atomic<std::uint64_t> published{0}; // nonce of the last applied update
+        std::atomic<bool> stop{false};
+        std::atomic<std::size_t> stale{0};
+
+        std::thread updater([&] {
+            for (std::uint64_t nonce = 1; !stop; ++nonce)
+            {
+                FinancialUpdate update;
+                update.nonce = nonce;
+                update.reservePrice = 5 + static_cast<double>(nonce);
+                storage.updateFinancials("hot", update);
+                published = nonce;
+                std::this_thread::sleep_for(std::chrono::microseconds(updateEveryUs));
+            }
+        });
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> readers;
+        for (std::size_t t = 0; t < threads; ++t)
+        {
+            readers.emplace_back([&] {
+                for (std::size_t i = 0; i < reads; ++i)
+                {
+                    std::uint64_t floor = published;
+                    std::shared_ptr<const std::string> bytes;
+                    if (cached)
+                        bytes = storage.renderedOffer("hot", [](const Offer &o) { return render("hot", o); });
+                    else
+                        bytes = render("hot", *storage.retrieveOffer("hot"));
+                    auto pos = bytes->find("\"updateNonce\":");
+                    if (pos == std::string::npos || std::strtoull(bytes->c_str() + pos + 14, nullptr, 10) < floor)
+                        ++stale;
+                }
+            });
+        }
+        for (auto &reader : readers)
+            reader.join();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        stop = true;
+        updater.join();
+
+        std::size_t total = threads * reads;
+        std::cout << (cached ? "cached:   " : "uncached: ") << total << " reads in " << seconds * 1e3 << " ms, "
+                  << total / seconds << " reads/s, " << published << " updates, stale reads: " << stale << "\n";
+        if (stale != 0)
+            return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,110 @@
+// Allocation count per ingested offer: the copying path (frame copied to a
+// string, DOM converted with get<>, offer copied into storage) against the
+// moving path (parse from the frame bytes, strings moved out of the DOM
+// and adopted by the stored offer). Both still pay for the DOM and the
+// parser's token buffers.
+//
+// g++ -std=c++17 -O2 ingest_alloc_bench.cpp TEEStorage.cpp KeywordIndex.cpp KeywordQuery.cpp ResponseCache.cpp IncrementalMerkleTree.cpp Merkle.cpp Logger.cpp Metrics.cpp -I. -lcrypto -lpthread -o ingest_alloc_bench
+// ./ingest_alloc_bench [offers] [plaintextBytes]
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "OfferJson.hpp"
+#include "TEEStorage.hpp"
+
+static std::atomic<std::size_t> allocations{0};
+static std::atomic<std::size_t> allocatedBytes{0};
+
+void *operator new(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+// Out of line so GCC does not pair the inlined free() with new-expressions.
+__attribute__((noinline)) void operator delete(void *p) noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+struct Sample
+{
+    std::size_t allocations;
+    std::size_t bytes;
+    double micros;
+};
+
+template <typename Ingest>
+static Sample measure(const std::vector<std::string> &frames, Ingest ingest)
+{
+    TEEStorage storage;
+    std::size_t a0 = allocations.load();
+    std::size_t b0 = allocatedBytes.load();
+    auto t0 = std::chrono::steady_clock::now();
+    for (const auto &frame : frames)
+    {
+        ingest(storage, frame.data(), frame.size());
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    return Sample{
+        allocations.load() - a0,
+        allocatedBytes.load() - b0,
+        std::chrono::duration<double, std::micro>(t1 - t0).count()};
+}
+
+static void report(const char *name, const Sample &s, std::size_t n)
+{
+    std::cout << name << ": " << double(s.allocations) / n << " allocs/offer, "
+              << double(s.bytes) / n << " bytes/offer, "
+              << s.micros / n << " us/offer\n";
+}
+
+int main(int argc, char *argv[])
+{
+    std::size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000;
+    std::size_t plaintextBytes = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 4096;
+
+    std::vector<std::string> frames;
+    frames.reserve(n);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        nlohmann::json j{
+            {"offerId", "offer-" + std::to_string(i)},
+            {"title", "Quarterly sales export for region " + std::to_string(i % 17)},
+            {"verifiedKeywords", {"finance", "quarterly-report", "confidential-sales-data"}},
+            {"unverifiedText", "Contains the full ledger export with customer segments and margins."},
+            {"reservePrice", 12.5},
+            {"preferredBuyers", 3},
+            {"expiryDays", 30},
+            {"cooldownMonths", 1},
+            {"publicVerificationKeyFDE", std::string(64, 'k')},
+            {"encryptedPlaintext", std::string(plaintextBytes, 'x')},
+            {"nullifier", std::string(64, 'n')},
+            {"proofPath", "/secure/proofs/proof.json"},
+            {"publicInputsPath", "/secure/proofs/public.json"}};
+        frames.push_back(j.dump());
+    }
+
+    Sample copying = measure(frames, [](TEEStorage &storage, const char *data, std::size_t size) {
+        std::string text(data, size);
+        auto req = nlohmann::json::parse(text).get<OfferRequest>();
+        storage.storeOffer(req.offerId, req.offer);
+    });
+    Sample moving = measure(frames, [](TEEStorage &storage, const char *data, std::size_t size) {
+        auto j = nlohmann::json::parse(data, data + size);
+        auto req = takeOfferRequest(j);
+        storage.storeOffer(req.offerId, std::move(req.offer));
+    });
+
+    std::cout << n << " offers, " << plaintextBytes << " byte plaintext\n";
+    report("copying  ", copying, n);
+    report("moving   ", moving, n);
+    return 0;
+}
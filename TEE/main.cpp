@@ -1,5 +1,10 @@
+#include <algorithm>
 #include <iostream>
+#include <thread>
+#include <vector>
 #include "TEEEngine.hpp"
+#include "Logger.hpp"
+#include "AdmissionControl.hpp"
 
 #ifdef USE_BOOST_BEAST
 #include "WebSocketServer.hpp"
@@ -12,23 +17,188 @@ int main(int argc, char *argv[])
     {
         if (argc < 2)
         {
-            std::cerr << "Usage: " << argv[0] << " <vkFilePath>\n";
+            std::cerr << "Usage: " << argv[0] << " <vkFilePath>"
+                      << " [--port N] [--publish-log <socketPath>] [--follow <socketPath>]"
+                      << " [--checkpoint <path>] [--checkpoint-interval <seconds>]"
+                      << " [--memory-budget-mb N] [--spill-dir <dir>]"
+                      << " [--precheck-workers N] [--verify-workers N] [--persist-workers N]"
+                      << " [--log-level debug|info|warn|error|off]"
+                      << " [--ingest-rate N] [--query-rate N] [--address-ingest-rate N] [--address-query-rate N]"
+                      << " [--max-inflight-verifications N] [--speculative-pending N]"
+                      << " [--verify-deadline-ms N] [--circuit-layout maxHeaders,maxBody,maxKeywords,maxKeywordLen]"
+                      << " [--post-batch N] [--post-window-ms N] [--post-encoding packed|merkle] [--chain log|local]"
+                      << " [--reservation-ttl-ms N] [--reservation-sweep-ms N]"
+                      << " [--auction-rule uniform|second-price] [--auction-sweep-ms N]"
+                      << " [--io-threads N] [--response-cache-mb N]\n";
             return 1;
         }
 
         std::string vkPath = argv[1];
+        [[maybe_unused]] unsigned short port = 8080; // only the Beast build listens
+        std::string publishPath;
+        std::string followPath;
+        std::string checkpointPath;
+        int checkpointInterval = 0;
+        std::size_t memoryBudgetMb = 0;
+        std::string spillDir;
+        IngestPipelineConfig pipelineConfig;
+        AdmissionLimits admissionLimits;
+        std::size_t speculativePending = 0;
+        PosterConfig posterConfig;
+        std::string chainKind = "log";
+        LocalChainConfig chainConfig;
+        CircuitLayout circuitLayout;
+        std::chrono::milliseconds reservationTtl{120000};
+        std::chrono::milliseconds reservationSweep{1000};
+        ClearingRule auctionRule = ClearingRule::SecondPrice;
+        std::chrono::milliseconds auctionSweep{1000};
+        [[maybe_unused]] std::size_t ioThreads = 1;
+        std::size_t responseCacheMb = 64;
+        for (int i = 2; i + 1 < argc; i += 2)
+        {
+            std::string flag = argv[i];
+            if (flag == "--port")
+                port = static_cast<unsigned short>(std::stoi(argv[i + 1]));
+            else if (flag == "--publish-log")
+                publishPath = argv[i + 1];
+            else if (flag == "--follow")
+                followPath = argv[i + 1];
+            else if (flag == "--checkpoint")
+                checkpointPath = argv[i + 1];
+            else if (flag == "--checkpoint-interval")
+                checkpointInterval = std::stoi(argv[i + 1]);
+            else if (flag == "--memory-budget-mb")
+                memoryBudgetMb = std::stoul(argv[i + 1]);
+            else if (flag == "--spill-dir")
+                spillDir = argv[i + 1];
+            else if (flag == "--precheck-workers")
+                pipelineConfig.precheckWorkers = std::stoul(argv[i + 1]);
+            else if (flag == "--verify-workers")
+                pipelineConfig.verifyWorkers = std::stoul(argv[i + 1]);
+            else if (flag == "--persist-workers")
+                pipelineConfig.persistWorkers = std::stoul(argv[i + 1]);
+            else if (flag == "--ingest-rate")
+                admissionLimits.ingestRate = std::stod(argv[i + 1]);
+            else if (flag == "--query-rate")
+                admissionLimits.queryRate = std::stod(argv[i + 1]);
+            else if (flag == "--address-ingest-rate")
+                admissionLimits.addressIngestRate = std::stod(argv[i + 1]);
+            else if (flag == "--address-query-rate")
+                admissionLimits.addressQueryRate = std::stod(argv[i + 1]);
+            else if (flag == "--max-inflight-verifications")
+                admissionLimits.maxInFlightVerifications = std::stoul(argv[i + 1]);
+            else if (flag == "--verify-deadline-ms")
+                pipelineConfig.verifyDeadline = std::chrono::milliseconds(std::stol(argv[i + 1]));
+            else if (flag == "--circuit-layout")
+            {
+                if (!parseCircuitLayout(argv[i + 1], circuitLayout))
+                    std::cerr << "Bad circuit layout " << argv[i + 1] << ", using the default\n";
+            }
+            else if (flag == "--io-threads")
+                ioThreads = std::max<std::size_t>(1, std::stoul(argv[i + 1]));
+            else if (flag == "--response-cache-mb")
+                responseCacheMb = std::stoul(argv[i + 1]);
+            else if (flag == "--speculative-pending")
+                speculativePending = std::stoul(argv[i + 1]);
+            else if (flag == "--post-batch")
+                posterConfig.maxBatch = std::stoul(argv[i + 1]);
+            else if (flag == "--post-window-ms")
+                posterConfig.window = std::chrono::milliseconds(std::stol(argv[i + 1]));
+            else if (flag == "--post-encoding")
+                posterConfig.encoding = std::string(argv[i + 1]) == "merkle" ? BatchEncoding::MerkleRoot : BatchEncoding::Packed;
+            else if (flag == "--outbox")
+                posterConfig.outboxPath = argv[i + 1];
+            else if (flag == "--post-pipeline")
+                posterConfig.pipelineDepth = std::stoul(argv[i + 1]);
+            else if (flag == "--chain")
+                chainKind = argv[i + 1];
+            else if (flag == "--chain-block-ms")
+                chainConfig.blockTime = std::chrono::milliseconds(std::stol(argv[i + 1]));
+            else if (flag == "--chain-latency-us")
+                chainConfig.latency = std::chrono::microseconds(std::stol(argv[i + 1]));
+            else if (flag == "--chain-latency-shape")
+            {
+                std::string shape = argv[i + 1];
+                if (shape == "uniform")
+                    chainConfig.latencyShape = LatencyShape::Uniform;
+                else if (shape == "exponential")
+                    chainConfig.latencyShape = LatencyShape::Exponential;
+                else if (shape != "constant")
+                    std::cerr << "Unknown latency shape " << shape << "\n";
+            }
+            else if (flag == "--chain-failure-rate")
+                chainConfig.failureRate = std::stod(argv[i + 1]);
+            else if (flag == "--chain-revert-rate")
+                chainConfig.revertRate = std::stod(argv[i + 1]);
+            else if (flag == "--chain-max-tx-bytes")
+                chainConfig.maxPayloadBytes = std::stoul(argv[i + 1]);
+            else if (flag == "--chain-seed")
+                chainConfig.seed = std::stoull(argv[i + 1]);
+            else if (flag == "--reservation-ttl-ms")
+                reservationTtl = std::chrono::milliseconds(std::stol(argv[i + 1]));
+            else if (flag == "--reservation-sweep-ms")
+                reservationSweep = std::chrono::milliseconds(std::stol(argv[i + 1]));
+            else if (flag == "--auction-rule")
+            {
+                if (!parseClearingRule(argv[i + 1], auctionRule))
+                    std::cerr << "Unknown auction rule " << argv[i + 1] << ", using second-price\n";
+            }
+            else if (flag == "--auction-sweep-ms")
+                auctionSweep = std::chrono::milliseconds(std::stol(argv[i + 1]));
+            else if (flag == "--log-level")
+            {
+                LogLevel level;
+                if (parseLogLevel(argv[i + 1], level))
+                    Logger::setLevel(level);
+                else
+                    std::cerr << "Unknown log level " << argv[i + 1] << "\n";
+            }
+            else
+                std::cerr << "Ignoring unknown option " << flag << "\n";
+        }
+
+        std::shared_ptr<ChainClient> chain;
+        if (chainKind == "local")
+            chain = std::make_shared<LocalChain>(chainConfig);
+        else if (chainKind != "log")
+            std::cerr << "Unknown chain " << chainKind << "\n";
 
         TEEEngine engine(vkPath);
+        engine.setCircuitLayout(circuitLayout);
+        engine.configurePosting(posterConfig, chain);
+        if (memoryBudgetMb > 0)
+            engine.setMemoryBudget(memoryBudgetMb << 20, spillDir);
+        engine.setResponseCacheBudget(responseCacheMb << 20);
+        if (!checkpointPath.empty())
+            engine.enableCheckpoints(checkpointPath, std::chrono::seconds(checkpointInterval));
+        if (!followPath.empty())
+            engine.followPrimary(followPath);
+        else if (!publishPath.empty())
+            engine.publishChangeLog(publishPath);
+        engine.startExpirySweeper(std::chrono::seconds(60));
+        engine.configureReservations(reservationTtl, reservationSweep);
+        engine.configureAuctions(auctionRule, auctionSweep);
+        if (speculativePending > 0 && !engine.isFollower())
+            engine.enableSpeculativeAcceptance(speculativePending, pipelineConfig.verifyWorkers);
 
 #ifdef USE_BOOST_BEAST
+        engine.startIngestPipeline(pipelineConfig);
+
         boost::asio::io_context ioc;
         using tcp = boost::asio::ip::tcp;
-        tcp::endpoint endpoint(tcp::v4(), 8080);
-        auto listener = std::make_shared<Listener>(ioc, endpoint, engine);
+        tcp::endpoint endpoint(tcp::v4(), port);
+        AdmissionController admission(admissionLimits);
+        auto listener = std::make_shared<Listener>(ioc, endpoint, engine, admission);
         listener->run();
 
-        std::cout << "TEE listening on ws://0.0.0.0:8080\n";
+        TEE_LOG_INFO("main", "TEE listening on ws://0.0.0.0:{}{}", port,
+                     engine.isFollower() ? " (read-only follower)" : "");
+        std::vector<std::thread> ioWorkers;
+        for (std::size_t t = 1; t < ioThreads; ++t)
+            ioWorkers.emplace_back([&ioc] { ioc.run(); });
         ioc.run();
+        for (auto &worker : ioWorkers)
+            worker.join();
 #else
         // Local test if not compiled with the server
         std::string dummyOfferId = "offer123";
@@ -64,13 +234,12 @@ int main(int argc, char *argv[])
             publicInputsPath
         );
 
-        std::cout << "Local test Offer processing result: "
-                  << (success ? "SUCCESS" : "FAILURE") << "\n";
+        TEE_LOG_INFO("main", "Local test Offer processing result: {}", success ? "SUCCESS" : "FAILURE");
 #endif
     }
     catch (const std::exception &e)
     {
-        std::cerr << "Exception: " << e.what() << std::endl;
+        TEE_LOG_ERROR("main", "Exception: {}", e.what());
     }
 
     return 0;
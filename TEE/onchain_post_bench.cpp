@@ -0,0 +1,109 @@
+// Cost of on-chain posting as ingest sees it, against the in-process
+// LocalChain: postFinancialDetails latency on the ingest thread, time until
+// every offer is included, transactions and retries, and a check that each
+// posted offer appears exactly once in the payloads the chain recorded.
+// Chain draws are seeded, so runs with the same arguments are comparable.
+//
+// g++ -std=c++17 -O2 onchain_post_bench.cpp OnchainPoster.cpp ChainClient.cpp Merkle.cpp OutboxLog.cpp Logger.cpp Metrics.cpp -I. -lcrypto -lpthread -o onchain_post_bench
+// ./onchain_post_bench [offers] [blockMs] [latencyUs] [failureRate] [maxTxBytes] [outboxPath]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "ChainClient.hpp"
+#include "Logger.hpp"
+#include "OnChainPoster.hpp"
+
+static double percentile(std::vector<double> &samples, double p)
+{
+    if (samples.empty())
+        return 0;
+    std::size_t k = static_cast<std::size_t>(p * (samples.size() - 1));
+    std::nth_element(samples.begin(), samples.begin() + static_cast<std::ptrdiff_t>(k), samples.end());
+    return samples[k];
+}
+
+int main(int argc, char *argv[])
+{
+    std::size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000;
+    LocalChainConfig chainConfig;
+    chainConfig.blockTime = std::chrono::milliseconds(argc > 2 ? std::strtol(argv[2], nullptr, 10) : 100);
+    chainConfig.latency = std::chrono::microseconds(argc > 3 ? std::strtol(argv[3], nullptr, 10) : 5000);
+    chainConfig.latencyShape = LatencyShape::Exponential;
+    chainConfig.failureRate = argc > 4 ? std::strtod(argv[4], nullptr) : 0.05;
+    chainConfig.maxPayloadBytes = argc > 5 ? std::strtoul(argv[5], nullptr, 10) : 0;
+
+    PosterConfig posterConfig;
+    posterConfig.window = std::chrono::milliseconds(50);
+    posterConfig.retryBackoff = std::chrono::milliseconds(10);
+    posterConfig.maxRetryBackoff = std::chrono::milliseconds(1000);
+    if (argc > 6)
+    {
+        posterConfig.outboxPath = argv[6];
+        std::remove(argv[6]);
+    }
+
+    Logger::setLevel(LogLevel::Error);
+    auto chain = std::make_shared<LocalChain>(chainConfig);
+    std::vector<double> postMicros;
+    postMicros.reserve(n);
+    double drainMillis;
+    {
+        OnChainPoster poster;
+        poster.configure(posterConfig, chain);
+
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            auto t0 = std::chrono::steady_clock::now();
+            poster.postFinancialDetails("offer-" + std::to_string(i), 12.5, 3, 30, 1, std::string(64, 'k'));
+            postMicros.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count());
+        }
+        poster.flush();
+        drainMillis = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Every offer should sit in exactly one included transaction.
+    std::map<std::string, int> seen;
+    std::size_t revertedOffers = 0;
+    std::size_t payloadBytes = 0;
+    auto transactions = chain->transactions();
+    for (const auto &tx : transactions)
+    {
+        auto payload = nlohmann::json::parse(tx.payload);
+        if (tx.reverted)
+        {
+            revertedOffers += payload.value("count", std::size_t{0});
+            continue;
+        }
+        payloadBytes += tx.payload.size();
+        for (const auto &leaf : payload["offers"])
+            seen[nlohmann::json::parse(leaf.get<std::string>())["offerId"].get<std::string>()]++;
+    }
+    std::size_t duplicated = 0;
+    for (const auto &entry : seen)
+        duplicated += entry.second > 1;
+
+    LocalChain::Stats stats = chain->stats();
+    std::cout << n << " offers, block " << chainConfig.blockTime.count() << " ms, latency "
+              << chainConfig.latency.count() << " us (exponential), failure rate " << chainConfig.failureRate
+              << (posterConfig.outboxPath.empty() ? "" : ", with outbox") << "\n";
+    std::cout << "post      : p50 " << percentile(postMicros, 0.5) << " us, p99 " << percentile(postMicros, 0.99)
+              << " us, max " << percentile(postMicros, 1.0) << " us\n";
+    std::cout << "drain     : " << drainMillis << " ms until every offer was included or refused\n";
+    std::cout << "chain     : " << transactions.size() << " transactions, " << stats.submissions << " submissions, "
+              << stats.injectedFailures << " injected failures, " << stats.gapTimeouts << " nonce gaps, "
+              << stats.duplicates << " duplicates, " << stats.reverted << " reverted\n";
+    std::cout << "payloads  : " << (transactions.empty() ? 0 : payloadBytes / transactions.size())
+              << " bytes/tx on average\n";
+    std::cout << "verified  : " << seen.size() << " offers included, " << revertedOffers << " in reverted txs, "
+              << duplicated << " duplicated, " << (n - std::min(n, seen.size() + revertedOffers)) << " missing\n";
+    return seen.size() + revertedOffers == n && duplicated == 0 ? 0 : 1;
+}
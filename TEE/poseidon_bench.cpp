@@ -0,0 +1,99 @@
+// Native Poseidon throughput and the per-offer cost of the public-input
+// binding: one hash at a time against one batch, for the widths the
+// email circuit uses (2 for Poseidon(1), 3 for the default keyword
+// commitment, 10 for the nullifier's signature hash). Checks circomlib's
+// test vectors first.
+//
+// g++ -std=c++17 -O2 poseidon_bench.cpp Poseidon.cpp InputBinding.cpp Logger.cpp Metrics.cpp -I. -lpthread -o poseidon_bench
+// ./poseidon_bench [hashes]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "InputBinding.hpp"
+#include "Poseidon.hpp"
+
+// Best of a few runs, in microseconds per item.
+template <typename F>
+static double bestMicros(std::size_t items, F &&run)
+{
+    double best = 1e300;
+    for (int rep = 0; rep < 5; ++rep)
+    {
+        auto start = std::chrono::steady_clock::now();
+        run();
+        best = std::min(best, std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best / static_cast<double>(items);
+}
+
+static bool checkVector(const std::vector<std::uint64_t> &inputs, const std::string &expected)
+{
+    std::vector<FieldElement> elements;
+    for (auto v : inputs)
+        elements.push_back(fieldFromUint(v));
+    std::string got = toDecimal(poseidonHash(elements));
+    if (got != expected)
+        std::cout << "MISMATCH for " << inputs.size() << " inputs: " << got << " != " << expected << "\n";
+    return got == expected;
+}
+
+int main(int argc, char *argv[])
+{
+    std::size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2048;
+
+    bool ok = checkVector({1}, "18586133768512220936620570745912940619677854269274689475585506675881198879027") &&
+              checkVector({1, 2}, "7853200120776062878684798364095072458815029376092732009249414926327459813530") &&
+              checkVector({1, 2, 3, 4}, "18821383157269793795438455681495246036402687001665670618754263018637548127333");
+    std::cout << "circomlib vectors: " << (ok ? "ok" : "FAILED") << "\n";
+
+    for (std::size_t inputs : {1, 2, 9})
+    {
+        std::vector<FieldElement> in(n * inputs), out(n);
+        for (std::size_t i = 0; i < in.size(); ++i)
+            in[i] = fieldFromUint(i * 0x9e3779b97f4a7c15ULL);
+        poseidonHash(in.data(), inputs); // derive the parameters outside the timing
+
+        double scalar = bestMicros(n, [&] {
+            for (std::size_t k = 0; k < n; ++k)
+                out[k] = poseidonHash(&in[k * inputs], inputs);
+        });
+        double batch = bestMicros(n, [&] { poseidonHashBatch(in.data(), inputs, n, out.data()); });
+        std::cout << "Poseidon(" << inputs << ")  : " << scalar << " us/hash one at a time, " << batch
+                  << " us/hash batched\n";
+    }
+
+    CircuitLayout layout;
+    std::vector<Offer> offers(n);
+    std::vector<const Offer *> pointers;
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        offers[i].verifiedKeywords = {"keyword-" + std::to_string(i % 1000)};
+        offers[i].nullifier = std::to_string(1000003 * i + 7);
+        pointers.push_back(&offers[i]);
+    }
+    std::vector<OfferBinding> bindings(n);
+    std::vector<std::string> errors;
+    std::string error;
+    double single = bestMicros(n, [&] {
+        for (std::size_t i = 0; i < n; ++i)
+            computeBinding(offers[i], layout, bindings[i], error);
+    });
+    double batched = bestMicros(n, [&] { computeBindings(pointers, layout, bindings, errors); });
+    std::cout << "binding     : " << single << " us/offer one at a time, " << batched << " us/offer batched ("
+              << layout.commitmentInputs() << "-input commitment)\n";
+
+    std::vector<FieldElement> signature(17);
+    for (std::size_t i = 0; i < signature.size(); ++i)
+        signature[i] = fieldFromUint(0x12345678 + i);
+    FieldElement nullifier;
+    double nullifierMicros = bestMicros(64, [&] {
+        for (int i = 0; i < 64; ++i)
+            emailNullifier(signature, 32, nullifier);
+    });
+    std::cout << "nullifier   : " << nullifierMicros << " us (17 x 32-bit signature limbs)\n";
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,61 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef USE_BOOST_BEAST
+#include "Router.hpp"
+#include "Logger.hpp"
+#endif
+
+int main(int argc, char *argv[])
+{
+#ifdef USE_BOOST_BEAST
+    try
+    {
+        unsigned short port = 9000;
+        std::vector<ShardEndpoint> shards;
+        for (int i = 1; i + 1 < argc; i += 2)
+        {
+            std::string flag = argv[i];
+            std::string value = argv[i + 1];
+            if (flag == "--port")
+            {
+                port = static_cast<unsigned short>(std::stoi(value));
+            }
+            else if (flag == "--shard")
+            {
+                auto colon = value.rfind(':');
+                if (colon == std::string::npos)
+                {
+                    std::cerr << "Shard must be host:port, got " << value << "\n";
+                    return 1;
+                }
+                shards.push_back(ShardEndpoint{value.substr(0, colon), value.substr(colon + 1)});
+            }
+            else
+            {
+                std::cerr << "Ignoring unknown option " << flag << "\n";
+            }
+        }
+
+        if (shards.empty())
+        {
+            std::cerr << "Usage: " << argv[0] << " [--port N] --shard host:port [--shard host:port ...]\n";
+            return 1;
+        }
+
+        boost::asio::io_context ioc;
+        Router router(ioc, tcp::endpoint(tcp::v4(), port), shards);
+        TEE_LOG_INFO("main", "TEE router listening on ws://0.0.0.0:{} with {} shards", port, shards.size());
+        router.run();
+    }
+    catch (const std::exception &e)
+    {
+        TEE_LOG_ERROR("main", "Exception: {}", e.what());
+    }
+#else
+    (void)argc;
+    std::cerr << argv[0] << " requires the WebSocket build (-DUSE_BOOST_BEAST).\n";
+#endif
+    return 0;
+}
@@ -0,0 +1,153 @@
+// Boolean keyword search over a large catalog: offers carry keywords drawn
+// from a skewed vocabulary, random prices and increasing storage times.
+// Runs a mix of typical queries under each rank, reports latency, and
+// checks every answer against a brute-force scan and sort.
+//
+// g++ -std=c++17 -O2 search_bench.cpp KeywordIndex.cpp KeywordQuery.cpp -I. -lpthread -o search_bench
+// ./search_bench [offers] [vocabulary] [limit]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+#include "KeywordIndex.hpp"
+
+struct Sample
+{
+    std::string id;
+    std::set<std::string> keywords;
+    double price;
+    std::int64_t storedAtUs;
+};
+
+static bool matches(const KeywordQuery &query, std::uint32_t node, const Sample &offer)
+{
+    const QueryNode &n = query.nodes[node];
+    switch (n.kind)
+    {
+    case QueryNode::Kind::Term:
+        return offer.keywords.count(n.keyword) > 0;
+    case QueryNode::Kind::Not:
+        return !matches(query, n.children[0], offer);
+    case QueryNode::Kind::And:
+        return std::all_of(n.children.begin(), n.children.end(), [&](std::uint32_t c) { return matches(query, c, offer); });
+    case QueryNode::Kind::Or:
+        return std::any_of(n.children.begin(), n.children.end(), [&](std::uint32_t c) { return matches(query, c, offer); });
+    }
+    return false;
+}
+
+int main(int argc, char *argv[])
+{
+    std::size_t offers = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    std::size_t vocabulary = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 20000;
+    std::size_t limit = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 20;
+
+    std::vector<double> weights;
+    for (std::size_t i = 0; i < vocabulary; ++i)
+        weights.push_back(1.0 / static_cast<double>(i + 1));
+    std::mt19937_64 rng(5);
+    std::discrete_distribution<std::size_t> pickWord(weights.begin(), weights.end());
+    std::uniform_real_distribution<double> pickPrice(1, 5000);
+
+    std::vector<Sample> catalog(offers);
+    KeywordIndex index;
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < offers; ++i)
+    {
+        Sample &offer = catalog[i];
+        offer.id = "offer-" + std::to_string(i);
+        std::size_t n = 3 + rng() % 6;
+        while (offer.keywords.size() < n)
+            offer.keywords.insert("kw" + std::to_string(pickWord(rng)));
+        offer.price = std::round(pickPrice(rng) * 100) / 100;
+        offer.storedAtUs = 1700000000000000 + static_cast<std::int64_t>(i) * 1000;
+        index.put(offer.id, std::vector<std::string>(offer.keywords.begin(), offer.keywords.end()), offer.price,
+                  offer.storedAtUs);
+    }
+    // Churn: drop and re-add some offers so document numbers are reused.
+    for (std::size_t i = 0; i < offers / 10; ++i)
+    {
+        std::size_t k = rng() % offers;
+        index.remove(catalog[k].id);
+        catalog[k].storedAtUs += 1000000000;
+        index.put(catalog[k].id, std::vector<std::string>(catalog[k].keywords.begin(), catalog[k].keywords.end()),
+                  catalog[k].price, catalog[k].storedAtUs);
+    }
+    double buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << offers << " offers, " << index.keywordCount() << " keywords indexed in " << buildMs << " ms\n";
+
+    const std::vector<std::string> queries = {
+        "(kw3 OR kw7) AND kw1 AND NOT kw2",
+        "kw10 AND kw20",
+        "kw0",
+        "kw0 kw1",
+        "NOT kw0",
+        "(kw1 OR kw2 OR kw3) AND NOT (kw4 OR kw5)",
+        "kw150 OR kw151 OR kw152",
+        "kw999 AND (kw0 OR kw1)",
+        "kw19999 AND kw0",
+    };
+    const QueryRank ranks[] = {QueryRank::Recent, QueryRank::PriceLow, QueryRank::PriceHigh};
+
+    bool ok = true;
+    for (const auto &text : queries)
+    {
+        KeywordQuery query;
+        std::string error;
+        if (!parseKeywordQuery(text, query, error))
+        {
+            std::cerr << text << ": " << error << "\n";
+            return 1;
+        }
+        // Brute force once per query.
+        std::vector<const Sample *> expected;
+        for (const auto &offer : catalog)
+        {
+            if (matches(query, query.root, offer))
+                expected.push_back(&offer);
+        }
+
+        for (QueryRank rank : ranks)
+        {
+            std::vector<double> micros;
+            QueryResult result;
+            for (int run = 0; run < 50; ++run)
+            {
+                auto t0 = std::chrono::steady_clock::now();
+                result = index.search(query, rank, limit);
+                micros.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count());
+            }
+            std::sort(micros.begin(), micros.end());
+
+            auto key = [&](const Sample *s) {
+                return rank == QueryRank::Recent ? static_cast<double>(s->storedAtUs)
+                                                 : rank == QueryRank::PriceLow ? -s->price : s->price;
+            };
+            std::vector<const Sample *> best(expected);
+            std::size_t n = std::min(limit, best.size());
+            std::partial_sort(best.begin(), best.begin() + static_cast<std::ptrdiff_t>(n), best.end(),
+                              [&](const Sample *a, const Sample *b) { return key(a) > key(b); });
+            bool same = result.total == expected.size() && result.hits.size() == n;
+            // Ties may be ordered differently; compare the keys rank by rank.
+            for (std::size_t i = 0; same && i < n; ++i)
+            {
+                double got = rank == QueryRank::Recent ? static_cast<double>(result.hits[i].storedAtUs)
+                                                       : rank == QueryRank::PriceLow ? -result.hits[i].reservePrice
+                                                                                     : result.hits[i].reservePrice;
+                same = got == key(best[i]);
+            }
+            ok = ok && same;
+            std::cout << text << " [" << queryRankName(rank) << "]: " << result.total << " matches, p50 "
+                      << micros[micros.size() / 2] << " us, max " << micros.back() << " us"
+                      << (same ? "" : "  MISMATCH") << "\n";
+        }
+    }
+    std::cout << "all answers match a brute-force scan: " << (ok ? "ok" : "FAILED") << "\n";
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,91 @@
+// Thundering herd on one offer: threads hammer reserve() on a single hot
+// offer whose winners confirm, release or let their reservations lapse,
+// while the sweeper frees lapsed slots. Reports attempts per second and
+// checks that the slots were never oversold and that every confirmation
+// counted exactly once.
+//
+// g++ -std=c++17 -O2 slot_reservation_bench.cpp SlotAllocator.cpp Logger.cpp Metrics.cpp -I. -lcrypto -lpthread -o slot_reservation_bench
+// ./slot_reservation_bench [threads] [seconds] [capacity]
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "SlotAllocator.hpp"
+
+int main(int argc, char *argv[])
+{
+    unsigned threads = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : std::max(2u, std::thread::hardware_concurrency());
+    double seconds = argc > 2 ? std::strtod(argv[2], nullptr) : 2;
+    std::uint32_t capacity = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 1000;
+
+    SlotAllocator allocator(std::chrono::milliseconds(20), [capacity](const std::string &offerId) {
+        return offerId == "hot" ? std::optional<std::uint32_t>(capacity) : std::nullopt;
+    });
+    allocator.startSweeper(std::chrono::milliseconds(5));
+
+    std::atomic<bool> stop{false};
+    std::atomic<std::uint64_t> attempts{0}, reserved{0}, confirmed{0}, duplicates{0}, full{0}, soldOut{0};
+    std::atomic<std::uint32_t> maxHeld{0};
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; ++t)
+    {
+        workers.emplace_back([&, t] {
+            std::uint64_t n = 0, mine = 0, ok = 0, dup = 0, f = 0, s = 0;
+            std::string buyer = "buyer-" + std::to_string(t);
+            while (!stop.load(std::memory_order_relaxed))
+            {
+                ReservationResult r = allocator.reserve("hot", buyer);
+                ++n;
+                if (r.status == ReserveStatus::Full)
+                    ++f;
+                else if (r.status == ReserveStatus::SoldOut)
+                    ++s;
+                else if (r.status == ReserveStatus::Reserved)
+                {
+                    // Winners confirm one in eight (twice, the second must be a
+                    // no-op), release one in eight and abandon the rest.
+                    ++mine;
+                    if (mine % 8 == 0)
+                    {
+                        ok += allocator.confirm("hot", r.reservationId) == ConfirmStatus::Confirmed;
+                        dup += allocator.confirm("hot", r.reservationId) == ConfirmStatus::AlreadyConfirmed;
+                    }
+                    else if (mine % 8 == 1)
+                        allocator.release("hot", r.reservationId);
+                    auto counts = allocator.counts("hot");
+                    std::uint32_t held = counts->reserved + counts->confirmed;
+                    std::uint32_t seen = maxHeld.load();
+                    while (held > seen && !maxHeld.compare_exchange_weak(seen, held))
+                        ;
+                }
+            }
+            attempts += n;
+            reserved += mine;
+            confirmed += ok;
+            duplicates += dup;
+            full += f;
+            soldOut += s;
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    stop = true;
+    for (auto &w : workers)
+        w.join();
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    SlotCounts counts = *allocator.counts("hot");
+    bool ok = maxHeld <= capacity && counts.confirmed == confirmed && duplicates == confirmed &&
+              counts.confirmed <= capacity;
+    std::cout << threads << " threads, capacity " << capacity << ": " << attempts / elapsed / 1e6
+              << " M attempts/s (" << reserved << " reserved, " << confirmed << " confirmed, " << full
+              << " full, " << soldOut << " sold out)\n"
+              << "max held " << maxHeld << ", final " << counts.reserved << " reserved + " << counts.confirmed
+              << " confirmed: " << (ok ? "ok" : "OVERSOLD OR MISCOUNTED") << "\n";
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,147 @@
+// Keyword fan-out: many standing subscriptions of one to three keywords,
+// drawn from a skewed vocabulary so popular keywords have long postings,
+// then a stream of offers matched against them. Reports match latency
+// per offer and the subscribers reached, and checks sampled offers against
+// a brute-force scan of every subscription.
+//
+// g++ -std=c++17 -O2 subscription_fanout_bench.cpp SubscriptionIndex.cpp Logger.cpp Metrics.cpp -I. -lpthread -o subscription_fanout_bench
+// ./subscription_fanout_bench [subscriptions] [offers] [vocabulary]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+#include "SubscriptionIndex.hpp"
+
+int main(int argc, char *argv[])
+{
+    std::size_t subscriptions = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+    std::size_t offers = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 2000;
+    std::size_t vocabulary = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 5000;
+
+    // Zipf-like: keyword i is drawn with weight 1 / (i + 1).
+    std::vector<std::string> words;
+    std::vector<double> weights;
+    for (std::size_t i = 0; i < vocabulary; ++i)
+    {
+        words.push_back("kw" + std::to_string(i));
+        weights.push_back(1.0 / static_cast<double>(i + 1));
+    }
+    std::mt19937_64 rng(11);
+    std::discrete_distribution<std::size_t> pickWord(weights.begin(), weights.end());
+    auto draw = [&](std::size_t n) {
+        std::set<std::string> picked;
+        while (picked.size() < n)
+            picked.insert(words[pickWord(rng)]);
+        return std::vector<std::string>(picked.begin(), picked.end());
+    };
+
+    // One subscriber per 8 subscriptions, as if a connection watched several interests.
+    SubscriptionIndex index;
+    std::vector<std::uint64_t> subscribers;
+    std::vector<std::size_t> delivered;
+    std::vector<std::vector<std::string>> interests;
+    std::vector<std::size_t> owner;
+    std::string error;
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < subscriptions; ++i)
+    {
+        if (i % 8 == 0)
+        {
+            std::size_t n = subscribers.size();
+            delivered.push_back(0);
+            subscribers.push_back(index.addSubscriber([&delivered, n](const std::shared_ptr<const std::string> &) {
+                ++delivered[n];
+            }));
+        }
+        interests.push_back(draw(1 + rng() % 3));
+        owner.push_back(subscribers.size() - 1);
+        std::uint64_t id;
+        if (!index.subscribe(subscribers.back(), interests.back(), id, error))
+        {
+            std::cerr << error << "\n";
+            return 1;
+        }
+    }
+    double subscribeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << subscriptions << " subscriptions from " << subscribers.size() << " subscribers indexed in "
+              << subscribeMs << " ms\n";
+
+    // Offers carry five to ten keywords from the same vocabulary.
+    std::vector<std::vector<std::string>> offerKeywords;
+    for (std::size_t i = 0; i < offers; ++i)
+        offerKeywords.push_back(draw(5 + rng() % 6));
+
+    std::vector<std::shared_ptr<const SubscriptionIndex::Sink>> sinks;
+    auto message = std::make_shared<const std::string>("{\"type\":\"offerMatched\"}");
+    std::vector<double> micros;
+    std::size_t matched = 0, reached = 0;
+    for (const auto &keywords : offerKeywords)
+    {
+        auto t0 = std::chrono::steady_clock::now();
+        sinks.clear();
+        matched += index.match(keywords, sinks);
+        for (const auto &sink : sinks)
+            (*sink)(message);
+        micros.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count());
+        reached += sinks.size();
+    }
+    std::sort(micros.begin(), micros.end());
+    double total = 0;
+    for (double m : micros)
+        total += m;
+    std::cout << offers << " offers: " << static_cast<double>(matched) / offers << " subscriptions and "
+              << static_cast<double>(reached) / offers << " subscribers matched per offer; match + hand-out "
+              << total / offers << " us mean, " << micros[micros.size() / 2] << " us p50, "
+              << micros[micros.size() * 99 / 100] << " us p99, " << micros.back() << " us max\n";
+
+    // Brute force over the first offers: which subscribers should have been reached.
+    bool ok = true;
+    std::size_t sampled = std::min<std::size_t>(offers, 20);
+    for (std::size_t o = 0; o < sampled; ++o)
+    {
+        std::set<std::string> have(offerKeywords[o].begin(), offerKeywords[o].end());
+        std::set<std::size_t> expected;
+        for (std::size_t s = 0; s < interests.size(); ++s)
+        {
+            if (std::all_of(interests[s].begin(), interests[s].end(), [&](const std::string &k) { return have.count(k) > 0; }))
+                expected.insert(owner[s]);
+        }
+        std::vector<std::size_t> before(delivered);
+        sinks.clear();
+        index.match(offerKeywords[o], sinks);
+        for (const auto &sink : sinks)
+            (*sink)(message);
+        std::set<std::size_t> got;
+        for (std::size_t n = 0; n < delivered.size(); ++n)
+        {
+            if (delivered[n] == before[n] + 1)
+                got.insert(n);
+            else if (delivered[n] != before[n])
+                ok = false; // told twice
+        }
+        ok = ok && got == expected;
+    }
+
+    // Dropping half the subscribers must leave the index consistent.
+    for (std::size_t n = 0; n < subscribers.size(); n += 2)
+        index.removeSubscriber(subscribers[n]);
+    for (std::size_t o = 0; o < sampled; ++o)
+    {
+        std::vector<std::size_t> before(delivered);
+        sinks.clear();
+        index.match(offerKeywords[o], sinks);
+        for (const auto &sink : sinks)
+            (*sink)(message);
+        for (std::size_t n = 0; n < delivered.size(); n += 2)
+            ok = ok && delivered[n] == before[n];
+    }
+    std::cout << sampled << " sampled offers match a brute-force scan, before and after removals: "
+              << (ok ? "ok" : "FAILED") << " (" << index.subscriptions() << " subscriptions left)\n";
+    return ok ? 0 : 1;
+}
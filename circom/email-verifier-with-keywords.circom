@@ -54,6 +54,7 @@ template EmailVerifierWithKeywords(
     signal output maskedBody[maxBodyLength];
     signal output allKeywordsPresent;
     signal output nullifier;
+    signal output keywordCommitment;
 
     // Instantiate underlying EmailVerifier
     component emailVerifier = EmailVerifier(
@@ -129,4 +130,21 @@ template EmailVerifierWithKeywords(
     nullifier <== emailNullifier.out;
     //log("EmailVerifierWithKeywords refactored: finished nullifier");
 
+    //KEYWORD COMMITMENT
+    // Poseidon(numKeywords, keyword slots packed 31 bytes per element, little-endian),
+    // recomputed by the TEE from the offer's verifiedKeywords (TEE/InputBinding.cpp).
+    var keywordChunks = (maxKeywordLen + 30) \ 31;
+    component keywordHash = Poseidon(1 + maxKeywords * keywordChunks);
+    keywordHash.inputs[0] <== numKeywords;
+    for (var i = 0; i < maxKeywords; i++) {
+        for (var c = 0; c < keywordChunks; c++) {
+            var packed = 0;
+            for (var b = 0; b < 31 && c * 31 + b < maxKeywordLen; b++) {
+                packed += keywords[i][c * 31 + b] * (1 << (8 * b));
+            }
+            keywordHash.inputs[1 + i * keywordChunks + c] <== packed;
+        }
+    }
+    keywordCommitment <== keywordHash.out;
+
 }